@@ -39,6 +39,7 @@
 #include "network/WebServer.h"
 #include "network/httprequesthandler/HTTPImageHandler.h"
 #include "network/httprequesthandler/HTTPVfsHandler.h"
+#include "network/httprequesthandler/HTTPMetricsHandler.h"
 #ifdef HAS_HTTPAPI
 #include "network/httprequesthandler/HTTPApiHandler.h"
 #endif
@@ -80,6 +81,7 @@
 #include "filesystem/DllLibCurl.h"
 #include "filesystem/MythSession.h"
 #include "filesystem/PluginDirectory.h"
+#include "filesystem/ChangeJournal.h"
 #ifdef HAS_FILESYSTEM_SAP
 #include "filesystem/SAPDirectory.h"
 #endif
@@ -357,6 +359,7 @@ CApplication::CApplication(void)
   , m_WebServer(*new CWebServer)
   , m_httpImageHandler(*new CHTTPImageHandler)
   , m_httpVfsHandler(*new CHTTPVfsHandler)
+  , m_httpMetricsHandler(*new CHTTPMetricsHandler)
 #ifdef HAS_JSONRPC
   , m_httpJsonRpcHandler(*new CHTTPJsonRpcHandler)
 #endif
@@ -423,6 +426,7 @@ CApplication::~CApplication(void)
   delete &m_WebServer;
   delete &m_httpImageHandler;
   delete &m_httpVfsHandler;
+  delete &m_httpMetricsHandler;
 #ifdef HAS_HTTPAPI
   delete &m_httpApiHandler;
 #endif
@@ -1168,6 +1172,7 @@ bool CApplication::Initialize()
 #ifdef HAS_WEB_SERVER
   CWebServer::RegisterRequestHandler(&m_httpImageHandler);
   CWebServer::RegisterRequestHandler(&m_httpVfsHandler);
+  CWebServer::RegisterRequestHandler(&m_httpMetricsHandler);
 #ifdef HAS_JSONRPC
   CWebServer::RegisterRequestHandler(&m_httpJsonRpcHandler);
 #endif
@@ -3528,6 +3533,7 @@ void CApplication::Stop(int exitCode)
     CJobManager::GetInstance().CancelJobs();
 
     g_alarmClock.StopThread();
+    XFILE::CChangeJournal::Get().Stop();
 
 #ifdef HAS_HTTPAPI
     if (m_pXbmcHttp)
@@ -3575,6 +3581,7 @@ void CApplication::Stop(int exitCode)
 #ifdef HAS_WEB_SERVER
   CWebServer::UnregisterRequestHandler(&m_httpImageHandler);
   CWebServer::UnregisterRequestHandler(&m_httpVfsHandler);
+  CWebServer::UnregisterRequestHandler(&m_httpMetricsHandler);
 #ifdef HAS_JSONRPC
   CWebServer::UnregisterRequestHandler(&m_httpJsonRpcHandler);
 #endif
@@ -3659,6 +3666,9 @@ void CApplication::Stop(int exitCode)
     // shutdown the AudioEngine
     CAEFactory::Shutdown();
 
+    // closes the idle database connections
+    CDatabaseManager::Get().Deinitialize();
+
     CLog::Log(LOGNOTICE, "stopped");
   }
   catch (...)
@@ -5719,7 +5729,16 @@ void CApplication::StartVideoCleanup()
   if (m_videoInfoScanner->IsScanning())
     return;
 
-  m_videoInfoScanner->CleanDatabase();
+  if (!g_guiSettings.GetBool("videolibrary.backgroundupdate"))
+  {
+    CGUIDialogVideoScan *videoScan = (CGUIDialogVideoScan *)g_windowManager.GetWindow(WINDOW_DIALOG_VIDEO_SCAN);
+    if (videoScan)
+    {
+      m_videoInfoScanner->SetObserver(videoScan);
+      videoScan->ShowScan();
+    }
+  }
+  m_videoInfoScanner->StartCleanDatabase();
 }
 
 void CApplication::StartVideoScan(const CStdString &strDirectory, bool scanAll)
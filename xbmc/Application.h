@@ -73,6 +73,7 @@ class CWebServer;
 class CWebServer;
 class CHTTPImageHandler;
 class CHTTPVfsHandler;
+class CHTTPMetricsHandler;
 #ifdef HAS_JSONRPC
 class CHTTPJsonRpcHandler;
 #endif
@@ -281,6 +282,7 @@ public:
   CWebServer& m_WebServer;
   CHTTPImageHandler& m_httpImageHandler;
   CHTTPVfsHandler& m_httpVfsHandler;
+  CHTTPMetricsHandler& m_httpMetricsHandler;
 #ifdef HAS_JSONRPC
   CHTTPJsonRpcHandler& m_httpJsonRpcHandler;
 #endif
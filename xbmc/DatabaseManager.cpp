@@ -47,12 +47,12 @@ CDatabaseManager::~CDatabaseManager()
 void CDatabaseManager::Initialize(bool addonsOnly)
 {
   Deinitialize();
-  { CAddonDatabase db; UpdateDatabase(db); }
+  { CAddonDatabase db; UpdateDatabase(db, &g_advancedSettings.m_databaseAddons); }
   if (addonsOnly)
     return;
   CLog::Log(LOGDEBUG, "%s, updating databases...", __FUNCTION__);
-  { CViewDatabase db; UpdateDatabase(db); }
-  { CTextureDatabase db; UpdateDatabase(db); }
+  { CViewDatabase db; UpdateDatabase(db, &g_advancedSettings.m_databaseViewModes); }
+  { CTextureDatabase db; UpdateDatabase(db, &g_advancedSettings.m_databaseTextures); }
   { CMusicDatabase db; UpdateDatabase(db, &g_advancedSettings.m_databaseMusic); }
   { CVideoDatabase db; UpdateDatabase(db, &g_advancedSettings.m_databaseVideo); }
   CLog::Log(LOGDEBUG, "%s, updating databases... DONE", __FUNCTION__);
@@ -62,6 +62,7 @@ void CDatabaseManager::Deinitialize()
 {
   CSingleLock lock(m_section);
   m_dbStatus.clear();
+  CDatabase::CloseIdleConnections();
 }
 
 bool CDatabaseManager::CanOpen(const std::string &name)
@@ -4525,79 +4525,69 @@ void CGUIInfoManager::SetLibraryBool(int condition, bool value)
 
 void CGUIInfoManager::ResetLibraryBools()
 {
+  CSingleLock lock(m_libraryQuerySection);
   m_libraryHasMusic = -1;
   m_libraryHasMovies = -1;
   m_libraryHasTVShows = -1;
   m_libraryHasMusicVideos = -1;
   m_libraryHasMovieSets = -1;
+
+  // a query already running may not see the change
+  for (std::map<int, SLibraryQuery>::iterator i = m_libraryQueries.begin(); i != m_libraryQueries.end(); ++i)
+    i->second.future.reset();
+}
+
+template<class TDatabase>
+bool CGUIInfoManager::QueryLibraryBool(int condition, int &cached, const char *sql)
+{
+  CSingleLock lock(m_libraryQuerySection);
+  if (cached >= 0)
+    return cached > 0;
+
+  SLibraryQuery &query = m_libraryQueries[condition];
+  if (!query.future)
+  {
+    TDatabase db;
+    if (!db.Open())
+      return query.value;
+    query.future = db.QueryAsync(sql);
+    db.Close();
+  }
+
+  if (query.future->IsDone())
+  {
+    query.value = query.future->Succeeded() && !query.future->GetResult().records.empty();
+    query.future.reset();
+    cached = query.value ? 1 : 0;
+  }
+  return query.value;
 }
 
 bool CGUIInfoManager::GetLibraryBool(int condition)
 {
   if (condition == LIBRARY_HAS_MUSIC)
   {
-    if (m_libraryHasMusic < 0)
-    { // query
-      CMusicDatabase db;
-      if (db.Open())
-      {
-        m_libraryHasMusic = (db.GetSongsCount() > 0) ? 1 : 0;
-        db.Close();
-      }
-    }
-    return m_libraryHasMusic > 0;
+    return QueryLibraryBool<CMusicDatabase>(condition, m_libraryHasMusic, "SELECT 1 FROM song LIMIT 1");
   }
   else if (condition == LIBRARY_HAS_MOVIES)
   {
-    if (m_libraryHasMovies < 0)
-    {
-      CVideoDatabase db;
-      if (db.Open())
-      {
-        m_libraryHasMovies = db.HasContent(VIDEODB_CONTENT_MOVIES) ? 1 : 0;
-        db.Close();
-      }
-    }
-    return m_libraryHasMovies > 0;
+    return QueryLibraryBool<CVideoDatabase>(condition, m_libraryHasMovies, "SELECT 1 FROM movie LIMIT 1");
   }
   else if (condition == LIBRARY_HAS_MOVIE_SETS)
   {
-    if (m_libraryHasMovieSets < 0)
-    {
-      CVideoDatabase db;
-      if (db.Open())
-      {
-        m_libraryHasMovieSets = db.HasSets() ? 1 : 0;
-        db.Close();
-      }
-    }
-    return m_libraryHasMovieSets > 0;
+    return QueryLibraryBool<CVideoDatabase>(condition, m_libraryHasMovieSets,
+                                           "SELECT sets.idSet,COUNT(1) AS c FROM sets "
+                                           "JOIN setlinkmovie ON sets.idSet=setlinkmovie.idSet "
+                                           "JOIN movie ON setlinkmovie.idMovie=movie.idMovie "
+                                           "GROUP BY sets.idSet HAVING c>1");
   }
   else if (condition == LIBRARY_HAS_TVSHOWS)
   {
-    if (m_libraryHasTVShows < 0)
-    {
-      CVideoDatabase db;
-      if (db.Open())
-      {
-        m_libraryHasTVShows = db.HasContent(VIDEODB_CONTENT_TVSHOWS) ? 1 : 0;
-        db.Close();
-      }
-    }
-    return m_libraryHasTVShows > 0;
+    return QueryLibraryBool<CVideoDatabase>(condition, m_libraryHasTVShows, "SELECT 1 FROM tvshow LIMIT 1");
   }
   else if (condition == LIBRARY_HAS_MUSICVIDEOS)
   {
-    if (m_libraryHasMusicVideos < 0)
-    {
-      CVideoDatabase db;
-      if (db.Open())
-      {
-        m_libraryHasMusicVideos = db.HasContent(VIDEODB_CONTENT_MUSICVIDEOS) ? 1 : 0;
-        db.Close();
-      }
-    }
-    return m_libraryHasMusicVideos > 0;
+    return QueryLibraryBool<CVideoDatabase>(condition, m_libraryHasMusicVideos, "SELECT 1 FROM musicvideo LIMIT 1");
   }
   else if (condition == LIBRARY_HAS_VIDEO)
   {
@@ -36,6 +36,7 @@
 
 #include <list>
 #include <map>
+#include <boost/shared_ptr.hpp>
 
 namespace MUSIC_INFO
 {
@@ -43,6 +44,7 @@ namespace MUSIC_INFO
 }
 class CVideoInfoTag;
 class CFileItem;
+class CDatabaseFuture;
 class CGUIListItem;
 class CDateTime;
 namespace INFO
@@ -699,6 +701,16 @@ public:
   void SetLibraryBool(int condition, bool value);
   bool GetLibraryBool(int condition);
   void ResetLibraryBools();
+
+  /*! \brief Answer a library condition without waiting on the database on the render thread.
+   The query runs on a worker, and the last answer (false at first) is returned until it completes.
+   \param condition the LIBRARY_HAS_* condition.
+   \param cached the cached answer, set once the query completes, -1 while unknown.
+   \param TDatabase the database to query.
+   \param sql a query returning a row if the condition holds.
+   */
+  template<class TDatabase>
+  bool QueryLibraryBool(int condition, int &cached, const char *sql);
   CStdString LocalizeTime(const CDateTime &time, TIME_FORMAT format) const;
 
   int TranslateSingleString(const CStdString &strCondition);
@@ -806,6 +818,15 @@ protected:
   int m_libraryHasMusicVideos;
   int m_libraryHasMovieSets;
 
+  struct SLibraryQuery
+  {
+    SLibraryQuery() : value(false) {}
+    boost::shared_ptr<CDatabaseFuture> future; ///< the query in progress, if any
+    bool value;                                ///< the last answer
+  };
+  std::map<int, SLibraryQuery> m_libraryQueries;
+  CCriticalSection m_libraryQuerySection;
+
   CCriticalSection m_critInfo;
 };
 
@@ -159,6 +159,14 @@ CStdString CTextureCacheJob::DecodeImageURL(const CStdString &url, unsigned int
       {
         width = height = g_advancedSettings.GetThumbSize();
       }
+      else if (option == "width" && !value.IsEmpty())
+      {
+        width = (unsigned int)atoi(value.c_str());
+      }
+      else if (option == "height" && !value.IsEmpty())
+      {
+        height = (unsigned int)atoi(value.c_str());
+      }
       else if (option == "flipped")
       {
         additional_info = "flipped";
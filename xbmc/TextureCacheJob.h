@@ -98,8 +98,8 @@ private:
 
   /*! \brief Decode an image URL to the underlying image, width, height and orientation
    \param url wrapped URL of the image
-   \param width width derived from URL
-   \param height height derived from URL
+   \param width width derived from URL ("size=thumb" or "width=<n>" option), 0 if unconstrained
+   \param height height derived from URL ("size=thumb" or "height=<n>" option), 0 if unconstrained
    \param additional_info additional information, such as "flipped" to flip horizontally
    \return URL of the underlying image file.
    */
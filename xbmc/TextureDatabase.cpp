@@ -20,6 +20,7 @@
  */
 
 #include "TextureDatabase.h"
+#include "settings/AdvancedSettings.h"
 #include "utils/log.h"
 #include "XBDateTime.h"
 #include "dbwrappers/dataset.h"
@@ -35,7 +36,7 @@ CTextureDatabase::~CTextureDatabase()
 
 bool CTextureDatabase::Open()
 {
-  return CDatabase::Open();
+  return CDatabase::Open(g_advancedSettings.m_databaseTextures);
 }
 
 bool CTextureDatabase::CreateTables()
@@ -156,6 +156,13 @@ CVideoThumbLoader::~CVideoThumbLoader()
 void CVideoThumbLoader::OnLoaderStart()
 {
   m_database->Open();
+
+  // one query for the whole listing, rather than one for each item in LoadItem
+  if (m_pVecItems)
+  {
+    m_database->GetArtForItems(*m_pVecItems);
+    m_database->GetStreamDetailsForItems(*m_pVecItems);
+  }
 }
 
 void CVideoThumbLoader::OnLoaderFinish()
@@ -515,6 +522,10 @@ CMusicThumbLoader::~CMusicThumbLoader()
 void CMusicThumbLoader::OnLoaderStart()
 {
   m_database->Open();
+
+  // one query for the whole listing, rather than one for each item in LoadItem
+  if (m_pVecItems)
+    m_database->GetArtForItems(*m_pVecItems);
 }
 
 void CMusicThumbLoader::OnLoaderFinish()
@@ -21,6 +21,7 @@
 
 #include "ViewDatabase.h"
 #include "utils/URIUtils.h"
+#include "settings/AdvancedSettings.h"
 #include "settings/Settings.h"
 #include "ViewState.h"
 #include "utils/log.h"
@@ -44,7 +45,7 @@ CViewDatabase::~CViewDatabase(void)
 //********************************************************************************************************************************
 bool CViewDatabase::Open()
 {
-  return CDatabase::Open();
+  return CDatabase::Open(g_advancedSettings.m_databaseViewModes);
 }
 
 bool CViewDatabase::CreateTables()
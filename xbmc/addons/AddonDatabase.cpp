@@ -21,6 +21,7 @@
 
 #include "AddonDatabase.h"
 #include "addons/AddonManager.h"
+#include "settings/AdvancedSettings.h"
 #include "utils/log.h"
 #include "utils/Variant.h"
 #include "XBDateTime.h"
@@ -40,7 +41,7 @@ CAddonDatabase::~CAddonDatabase()
 
 bool CAddonDatabase::Open()
 {
-  return CDatabase::Open();
+  return CDatabase::Open(g_advancedSettings.m_databaseAddons);
 }
 
 bool CAddonDatabase::CreateTables()
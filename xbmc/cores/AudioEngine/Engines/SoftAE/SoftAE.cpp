@@ -865,13 +865,19 @@ void CSoftAE::Run()
     /* if we have enough room in the buffer */
     if (m_buffer.Free() >= m_frameSize)
     {
+      /*
+        pcm is mixed in blocks filling all the room we have, raw data is
+        passed through one frame at a time
+      */
+      unsigned int frames = m_rawPassthrough ? 1 : m_buffer.Free() / m_frameSize;
+
       /* take some data for our use from the buffer */
-      uint8_t *out = (uint8_t*)m_buffer.Take(m_frameSize);
-      memset(out, 0, m_frameSize);
+      uint8_t *out = (uint8_t*)m_buffer.Take(frames * m_frameSize);
+      memset(out, 0, frames * m_frameSize);
 
       /* run the stream stage */
       CSoftAEStream *oldMaster = m_masterStream;
-      if ((this->*m_streamStageFn)(m_chLayout.Count(), out, restart) > 0)
+      if ((this->*m_streamStageFn)(m_chLayout.Count(), out, frames, restart) > 0)
         hasAudio = true; /* have some audio */
 
       /* if in audiophile mode and the master stream has changed, flag for restart */
@@ -1123,7 +1129,7 @@ int CSoftAE::RunTranscodeStage(bool hasAudio)
   return encodedFrames;
 }
 
-unsigned int CSoftAE::RunRawStreamStage(unsigned int channelCount, void *out, bool &restart)
+unsigned int CSoftAE::RunRawStreamStage(unsigned int channelCount, void *out, unsigned int frames, bool &restart)
 {
   StreamList resumeStreams;
   static StreamList::iterator itt;
@@ -1167,7 +1173,7 @@ unsigned int CSoftAE::RunRawStreamStage(unsigned int channelCount, void *out, bo
   return mixed;
 }
 
-unsigned int CSoftAE::RunStreamStage(unsigned int channelCount, void *out, bool &restart)
+unsigned int CSoftAE::RunStreamStage(unsigned int channelCount, void *out, unsigned int frames, bool &restart)
 {
   float *dst = (float*)out;
   unsigned int mixed = 0;
@@ -1185,40 +1191,27 @@ unsigned int CSoftAE::RunStreamStage(unsigned int channelCount, void *out, bool
   {
     CSoftAEStream *stream = *itt;
 
-    float *frame = (float*)stream->GetFrame();
-    if (!frame && stream->IsDrained() && stream->m_slave && stream->m_slave->IsPaused())
-      resumeStreams.push_back(stream);
-
-    if (!frame)
-      continue;
-
-    float volume = stream->GetVolume() * stream->GetReplayGain();
-    #ifdef __SSE__
-    if (channelCount > 1)
-      CAEUtil::SSEMulAddArray(dst, frame, volume, channelCount);
-    else
-    #endif
+    /* a block can span several of the stream's packets */
+    unsigned int done = 0;
+    while (done < frames)
     {
-      /* unrolled loop for performance */
-      unsigned int blocks = channelCount & ~0x3;
-      unsigned int i      = 0;
-      for (i = 0; i < blocks; i += 4)
+      unsigned int count = frames - done;
+      float volume, step;
+      float *frame = (float*)stream->GetFrames(count, volume, step);
+      if (!frame)
       {
-        dst[i+0] += frame[i+0] * volume;
-        dst[i+1] += frame[i+1] * volume;
-        dst[i+2] += frame[i+2] * volume;
-        dst[i+3] += frame[i+3] * volume;
+        if (stream->IsDrained() && stream->m_slave && stream->m_slave->IsPaused())
+          resumeStreams.push_back(stream);
+        break;
       }
 
-      switch (channelCount & 0x3)
-      {
-        case 3: dst[i] += frame[i] * volume; ++i;
-        case 2: dst[i] += frame[i] * volume; ++i;
-        case 1: dst[i] += frame[i] * volume;
-      }
+      const float rgain = stream->GetReplayGain();
+      CAEUtil::MulAddRamp(dst + done * channelCount, frame, volume * rgain, step * rgain, count, channelCount);
+      done += count;
     }
 
-    ++mixed;
+    if (done)
+      ++mixed;
   }
 
   ResumeSlaveStreams(resumeStreams);
@@ -219,9 +219,16 @@ private:
   int          RunRawOutputStage(bool hasAudio);
   int          RunTranscodeStage(bool hasAudio);
 
-  unsigned int (CSoftAE::*m_streamStageFn)(unsigned int channelCount, void *out, bool &restart);
-  unsigned int RunRawStreamStage (unsigned int channelCount, void *out, bool &restart);
-  unsigned int RunStreamStage    (unsigned int channelCount, void *out, bool &restart);
+  /*! \brief Run the stream stage, mixing the playing streams into out.
+   \param channelCount the number of channels per frame
+   \param out the buffer to mix into, it is zeroed by the caller
+   \param frames the number of frames to produce, the raw stage always takes one
+   \param restart set to true if the sink needs to be reopened
+   \return the number of streams that contributed audio
+   */
+  unsigned int (CSoftAE::*m_streamStageFn)(unsigned int channelCount, void *out, unsigned int frames, bool &restart);
+  unsigned int RunRawStreamStage (unsigned int channelCount, void *out, unsigned int frames, bool &restart);
+  unsigned int RunStreamStage    (unsigned int channelCount, void *out, unsigned int frames, bool &restart);
 
   void         ResumeSlaveStreams(const StreamList &streams);
   void         RunNormalizeStage (unsigned int channelCount, void *out, unsigned int mixed);
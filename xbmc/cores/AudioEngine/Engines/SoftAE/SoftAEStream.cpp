@@ -21,6 +21,7 @@
 
 #include "system.h"
 #include "threads/SingleLock.h"
+#include "settings/AdvancedSettings.h"
 #include "utils/log.h"
 #include "utils/MathUtils.h"
 
@@ -45,7 +46,8 @@ CSoftAEStream::CSoftAEStream(enum AEDataFormat dataFormat, unsigned int sampleRa
   m_rgain           (1.0f ),
   m_refillBuffer    (0    ),
   m_convertFn       (NULL ),
-  m_ssrc            (NULL ),
+  m_resampleBuffer  (NULL ),
+  m_resampleFrames  (0    ),
   m_framesBuffered  (0    ),
   m_newPacket       (NULL ),
   m_packet          (NULL ),
@@ -56,8 +58,6 @@ CSoftAEStream::CSoftAEStream(enum AEDataFormat dataFormat, unsigned int sampleRa
   m_fadeRunning     (false),
   m_slave           (NULL )
 {
-  m_ssrcData.data_out = NULL;
-
   m_initDataFormat        = dataFormat;
   m_initSampleRate        = sampleRate;
   m_initEncodedSampleRate = encodedSampleRate;
@@ -108,8 +108,8 @@ void CSoftAEStream::Initialize()
 
     if (m_resample)
     {
-      _aligned_free(m_ssrcData.data_out);
-      m_ssrcData.data_out = NULL;
+      _aligned_free(m_resampleBuffer);
+      m_resampleBuffer = NULL;
     }
   }
 
@@ -187,14 +187,10 @@ void CSoftAEStream::Initialize()
   /* if we need to resample, set it up */
   if (m_resample)
   {
-    int err;
-    m_ssrc                   = src_new(SRC_SINC_MEDIUM_QUALITY, m_initChannelLayout.Count(), &err);
-    m_ssrcData.data_in       = m_convertBuffer;
-    m_internalRatio          = (double)AE.GetSampleRate() / (double)m_initSampleRate;
-    m_ssrcData.src_ratio     = m_internalRatio;
-    m_ssrcData.data_out      = (float*)_aligned_malloc(m_format.m_frameSamples * (int)std::ceil(m_ssrcData.src_ratio) * sizeof(float), 16);
-    m_ssrcData.output_frames = m_format.m_frames * (long)std::ceil(m_ssrcData.src_ratio);
-    m_ssrcData.end_of_input  = 0;
+    m_internalRatio  = (double)AE.GetSampleRate() / (double)m_initSampleRate;
+    m_resampler.Initialize(m_initChannelLayout.Count(), (enum AEResampleQuality)g_advancedSettings.m_audioResampleQuality, m_internalRatio * m_resampleRatio);
+    m_resampleFrames = m_format.m_frames * (unsigned int)std::ceil(m_resampler.GetRatio());
+    m_resampleBuffer = (float*)_aligned_malloc(m_resampleFrames * m_initChannelLayout.Count() * sizeof(float), 16);
   }
 
   m_chLayoutCount = m_format.m_channelLayout.Count();
@@ -218,9 +214,9 @@ CSoftAEStream::~CSoftAEStream()
 
   if (m_resample)
   {
-    _aligned_free(m_ssrcData.data_out);
-    src_delete(m_ssrc);
-    m_ssrc = NULL;
+    _aligned_free(m_resampleBuffer);
+    m_resampler.Deinitialize();
+    m_resampleBuffer = NULL;
   }
 
   CLog::Log(LOGDEBUG, "CSoftAEStream::~CSoftAEStream - Destructed");
@@ -316,12 +312,10 @@ unsigned int CSoftAEStream::ProcessFrameBuffer()
   /* resample it if we need to */
   if (m_resample)
   {
-    m_ssrcData.input_frames = samples / m_chLayoutCount;
-    if (src_process(m_ssrc, &m_ssrcData) != 0)
-      return 0;
-    data     = (uint8_t*)m_ssrcData.data_out;
-    frames   = m_ssrcData.output_frames_gen;
-    consumed = m_ssrcData.input_frames_used * m_bytesPerFrame;
+    unsigned int inFrames = samples / m_chLayoutCount;
+    frames   = m_resampler.Process(m_convertBuffer, inFrames, m_resampleBuffer, m_resampleFrames);
+    data     = (uint8_t*)m_resampleBuffer;
+    consumed = inFrames * m_bytesPerFrame;
     if (!frames)
       return consumed;
 
@@ -401,26 +395,44 @@ unsigned int CSoftAEStream::ProcessFrameBuffer()
 }
 
 uint8_t* CSoftAEStream::GetFrame()
+{
+  unsigned int frames = 1;
+  float volume, step;
+  return GetFrames(frames, volume, step);
+}
+
+uint8_t* CSoftAEStream::GetFrames(unsigned int &frames, float &volume, float &step)
 {
   CExclusiveLock lock(m_lock);
 
-  /* if we are fading, this runs even if we have underrun as it is time based */
-  if (m_fadeRunning)
+  uint8_t *ret = GetPacketFrames(frames);
+
+  /*
+    if we are fading, this runs even if we have underrun as it is time based,
+    the ramp covers the frames returned, or the whole request on underrun
+  */
+  volume = m_volume;
+  step   = 0.0f;
+  if (m_fadeRunning && frames)
   {
-    m_volume += m_fadeStep;
-    m_volume = std::min(1.0f, std::max(0.0f, m_volume));
-    if (m_fadeDirUp)
-    {
-      if (m_volume >= m_fadeTarget)
-        m_fadeRunning = false;
-    }
-    else
+    float target = m_volume + m_fadeStep * frames;
+    target = std::min(1.0f, std::max(0.0f, target));
+    if (m_fadeDirUp ? target >= m_fadeTarget : target <= m_fadeTarget)
     {
-      if (m_volume <= m_fadeTarget)
-        m_fadeRunning = false;
+      target        = m_fadeTarget;
+      m_fadeRunning = false;
     }
+
+    step     = (target - m_volume) / frames;
+    volume   = m_volume + step;
+    m_volume = target;
   }
 
+  return ret;
+}
+
+uint8_t* CSoftAEStream::GetPacketFrames(unsigned int &frames)
+{
   /* if we have been deleted or are refilling but not draining */
   if (!m_valid || m_delete || (m_refillBuffer && !m_draining))
     return NULL;
@@ -451,15 +463,20 @@ uint8_t* CSoftAEStream::GetFrame()
     m_outBuffer.pop_front();
   }
 
-  /* fetch one frame of data */
-  uint8_t *ret = (uint8_t*)m_packet->data.CursorRead(m_aeBytesPerFrame);
+  /* fetch as many frames as the packet holds, up to the amount requested */
+  unsigned int available = (m_packet->data.Used() - m_packet->data.CursorOffset()) / m_aeBytesPerFrame;
+  frames = std::min(frames, available);
+  uint8_t *ret = (uint8_t*)m_packet->data.CursorRead(frames * m_aeBytesPerFrame);
 
-  /* we have a frame, if we have a viz we need to hand the data to it */
-  if (m_audioCallback && !m_packet->vizData.CursorEnd())
+  /* we have frames, if we have a viz we need to hand the data to it */
+  unsigned int vizFrames = frames;
+  while (m_audioCallback && vizFrames && !m_packet->vizData.CursorEnd())
   {
-    float *vizData = (float*)m_packet->vizData.CursorRead(2 * sizeof(float));
-    memcpy(m_vizBuffer + m_vizBufferSamples, vizData, 2 * sizeof(float));
-    m_vizBufferSamples += 2;
+    unsigned int copy = std::min(vizFrames, (512 - m_vizBufferSamples) / 2);
+    float *vizData = (float*)m_packet->vizData.CursorRead(copy * 2 * sizeof(float));
+    memcpy(m_vizBuffer + m_vizBufferSamples, vizData, copy * 2 * sizeof(float));
+    m_vizBufferSamples += copy * 2;
+    vizFrames          -= copy;
     if (m_vizBufferSamples == 512)
     {
       m_audioCallback->OnAudioData(m_vizBuffer, 512);
@@ -467,7 +484,7 @@ uint8_t* CSoftAEStream::GetFrame()
     }
   }
 
-  --m_framesBuffered;
+  m_framesBuffered -= frames;
   return ret;
 }
 
@@ -550,10 +567,7 @@ void CSoftAEStream::InternalFlush()
 {
   /* reset the resampler */
   if (m_resample)
-  {
-    m_ssrcData.end_of_input = 0;
-    src_reset(m_ssrc);
-  }
+    m_resampler.Reset();
 
   /* invalidate any incoming samples */
   m_newPacket->data.Empty();
@@ -585,7 +599,7 @@ double CSoftAEStream::GetResampleRatio()
     return 1.0f;
 
   CSharedLock lock(m_lock);
-  return m_ssrcData.src_ratio;
+  return m_resampler.GetRatio();
 }
 
 bool CSoftAEStream::SetResampleRatio(double ratio)
@@ -595,19 +609,16 @@ bool CSoftAEStream::SetResampleRatio(double ratio)
 
   CSharedLock lock(m_lock);
 
-  int oldRatioInt = (int)std::ceil(m_ssrcData.src_ratio);
-
   m_resampleRatio = ratio;
-
-  src_set_ratio(m_ssrc, m_resampleRatio * m_internalRatio);
-  m_ssrcData.src_ratio = m_resampleRatio * m_internalRatio;
+  m_resampler.SetRatio(m_resampleRatio * m_internalRatio);
 
   //Check the resample buffer size and resize if necessary.
-  if (oldRatioInt < std::ceil(m_ssrcData.src_ratio))
+  unsigned int frames = m_format.m_frames * (unsigned int)std::ceil(m_resampler.GetRatio());
+  if (m_resampleFrames < frames)
   {
-    _aligned_free(m_ssrcData.data_out);
-    m_ssrcData.data_out      = (float*)_aligned_malloc(m_format.m_frameSamples * (int)std::ceil(m_ssrcData.src_ratio) * sizeof(float), 16);
-    m_ssrcData.output_frames = m_format.m_frames * (long)std::ceil(m_ssrcData.src_ratio);
+    _aligned_free(m_resampleBuffer);
+    m_resampleFrames = frames;
+    m_resampleBuffer = (float*)_aligned_malloc(m_resampleFrames * m_initChannelLayout.Count() * sizeof(float), 16);
   }
   return true;
 }
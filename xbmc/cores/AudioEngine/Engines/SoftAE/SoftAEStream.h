@@ -20,7 +20,6 @@
  *
  */
 
-#include <samplerate.h>
 #include <list>
 
 #include "threads/SharedSection.h"
@@ -28,6 +27,7 @@
 #include "AEAudioFormat.h"
 #include "Interfaces/AEStream.h"
 #include "Utils/AEConvert.h"
+#include "Utils/AEResampler.h"
 #include "Utils/AERemap.h"
 #include "Utils/AEBuffer.h"
 
@@ -44,6 +44,13 @@ protected:
   void Destroy();
   uint8_t* GetFrame();
 
+  /*
+    get up to frames contiguous frames, frames is updated with the amount
+    returned, volume is the gain of the first frame and step the per frame
+    change of the gain while a fade is running
+  */
+  uint8_t* GetFrames(unsigned int &frames, float &volume, float &step);
+
   bool IsPaused   () { return m_paused; }
   bool IsDestroyed() { return m_delete; }
   bool IsValid    () { return m_valid;  }
@@ -124,11 +131,13 @@ private:
   unsigned int        m_samplesPerFrame;
   CAEChannelInfo      m_aeChannelLayout;
   unsigned int        m_aeBytesPerFrame;
-  SRC_STATE          *m_ssrc;
-  SRC_DATA            m_ssrcData;
+  CAEResampler        m_resampler;
+  float              *m_resampleBuffer;
+  unsigned int        m_resampleFrames;
   unsigned int        m_framesBuffered;
   std::list<PPacket*> m_outBuffer;
   unsigned int        ProcessFrameBuffer();
+  uint8_t*            GetPacketFrames(unsigned int &frames);
   PPacket            *m_newPacket;
   PPacket            *m_packet;
   uint8_t            *m_packetPos;
@@ -0,0 +1,323 @@
+/*
+ *      Copyright (C) 2010-2012 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "system.h"
+#include "AEResampler.h"
+#include "utils/log.h"
+
+#include <math.h>
+#include <string.h>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+#ifdef __ARM_NEON__
+#include <arm_neon.h>
+#endif
+
+#define AE_RESAMPLE_PHASES   256
+/* keep the passband just below nyquist to leave room for the transition band */
+#define AE_RESAMPLE_ROLLOFF  0.95
+/* rebuild the filter only if a downsampling ratio moves the cutoff this much */
+#define AE_RESAMPLE_CUTOFF_TOLERANCE 0.01
+
+static const struct
+{
+  unsigned int taps;
+  double       beta;
+} QualityTable[] =
+{
+  { 8 , 5.0 }, /* AE_RESAMPLE_FASTEST */
+  { 16, 6.5 }, /* AE_RESAMPLE_LOW     */
+  { 32, 8.0 }, /* AE_RESAMPLE_MEDIUM  */
+  { 64, 9.5 }  /* AE_RESAMPLE_BEST    */
+};
+
+/* zeroth order modified bessel function of the first kind */
+static double BesselI0(double x)
+{
+  double sum  = 1.0;
+  double term = 1.0;
+  double half = x * 0.5;
+  for (int k = 1; k < 50; ++k)
+  {
+    term *= (half / k) * (half / k);
+    sum  += term;
+    if (term < sum * 1e-12)
+      break;
+  }
+  return sum;
+}
+
+CAEResampler::CAEResampler() :
+  m_channels(0),
+  m_taps    (0),
+  m_beta    (0.0),
+  m_ratio   (1.0),
+  m_step    (1.0),
+  m_cutoff  (0.0),
+  m_time    (0.0),
+  m_filter  (NULL),
+  m_coeffs  (NULL),
+  m_capacity(0),
+  m_frames  (0)
+{
+}
+
+CAEResampler::~CAEResampler()
+{
+  Deinitialize();
+}
+
+bool CAEResampler::Initialize(unsigned int channels, enum AEResampleQuality quality, double ratio)
+{
+  Deinitialize();
+  if (channels == 0 || ratio <= 0.0)
+    return false;
+
+  if (quality < AE_RESAMPLE_FASTEST) quality = AE_RESAMPLE_FASTEST;
+  if (quality > AE_RESAMPLE_BEST   ) quality = AE_RESAMPLE_BEST;
+
+  m_channels = channels;
+  m_taps     = QualityTable[quality].taps;
+  m_beta     = QualityTable[quality].beta;
+  m_filter   = (float*)_aligned_malloc((AE_RESAMPLE_PHASES + 1) * m_taps * sizeof(float), 16);
+  m_coeffs   = (float*)_aligned_malloc(m_taps * sizeof(float), 16);
+
+  m_ratio = ratio;
+  m_step  = 1.0 / ratio;
+  BuildFilter(std::min(1.0, ratio) * AE_RESAMPLE_ROLLOFF);
+  Reset();
+
+  CLog::Log(LOGDEBUG, "CAEResampler::Initialize - %u channels, %u taps, ratio %f", m_channels, m_taps, m_ratio);
+  return true;
+}
+
+void CAEResampler::Deinitialize()
+{
+  if (m_filter)
+    _aligned_free(m_filter);
+  if (m_coeffs)
+    _aligned_free(m_coeffs);
+
+  m_filter   = NULL;
+  m_coeffs   = NULL;
+  m_channels = 0;
+  m_taps     = 0;
+  m_capacity = 0;
+  m_frames   = 0;
+  m_buffer.clear();
+}
+
+void CAEResampler::BuildFilter(double cutoff)
+{
+  /*
+    phase p holds the taps for an output position p / PHASES frames past an
+    input frame, tap k is applied to input frame (k - half + 1) relative to it
+  */
+  const int    half = m_taps / 2;
+  const double norm = 1.0 / BesselI0(m_beta);
+
+  for (unsigned int p = 0; p <= AE_RESAMPLE_PHASES; ++p)
+  {
+    float  *row  = m_filter + p * m_taps;
+    double  frac = (double)p / AE_RESAMPLE_PHASES;
+    double  sum  = 0.0;
+
+    for (unsigned int k = 0; k < m_taps; ++k)
+    {
+      double d = (double)((int)k - half + 1) - frac;
+      double x = d / half;
+      double w = fabs(x) < 1.0 ? BesselI0(m_beta * sqrt(1.0 - x * x)) * norm : 0.0;
+      double s = d == 0.0 ? 1.0 : sin(M_PI * cutoff * d) / (M_PI * cutoff * d);
+      double v = cutoff * s * w;
+      row[k] = (float)v;
+      sum   += v;
+    }
+
+    /* normalize every phase for unity gain at DC */
+    if (sum != 0.0)
+      for (unsigned int k = 0; k < m_taps; ++k)
+        row[k] = (float)(row[k] / sum);
+  }
+
+  m_cutoff = cutoff;
+}
+
+void CAEResampler::SetRatio(double ratio)
+{
+  if (ratio <= 0.0 || ratio == m_ratio)
+    return;
+
+  m_ratio = ratio;
+  m_step  = 1.0 / ratio;
+
+  double cutoff = std::min(1.0, ratio) * AE_RESAMPLE_ROLLOFF;
+  if (m_filter && fabs(cutoff - m_cutoff) > m_cutoff * AE_RESAMPLE_CUTOFF_TOLERANCE)
+    BuildFilter(cutoff);
+}
+
+void CAEResampler::Reset()
+{
+  /* prime the history with silence so the first output lines up with the first input */
+  m_frames = m_taps ? m_taps / 2 - 1 : 0;
+  m_time   = m_frames;
+  if (m_capacity < m_taps)
+  {
+    m_capacity = m_taps;
+    m_buffer.resize(m_capacity * m_channels);
+  }
+  if (!m_buffer.empty())
+    memset(&m_buffer[0], 0, m_buffer.size() * sizeof(float));
+}
+
+unsigned int CAEResampler::GetBufferedFrames() const
+{
+  return m_frames > (unsigned int)m_time ? m_frames - (unsigned int)m_time : 0;
+}
+
+void CAEResampler::Push(const float *in, unsigned int frames)
+{
+  if (m_frames + frames > m_capacity)
+  {
+    unsigned int capacity = std::max(m_capacity * 2, m_frames + frames);
+    std::vector<float> buffer(capacity * m_channels);
+    for (unsigned int ch = 0; ch < m_channels; ++ch)
+      memcpy(&buffer[ch * capacity], &m_buffer[ch * m_capacity], m_frames * sizeof(float));
+    m_buffer.swap(buffer);
+    m_capacity = capacity;
+  }
+
+  /* deinterleave so the filter runs over contiguous memory */
+  for (unsigned int ch = 0; ch < m_channels; ++ch)
+  {
+    float       *dst = &m_buffer[ch * m_capacity + m_frames];
+    const float *src = in + ch;
+    for (unsigned int i = 0; i < frames; ++i, src += m_channels)
+      dst[i] = *src;
+  }
+  m_frames += frames;
+}
+
+void CAEResampler::Discard()
+{
+  /* keep the history the filter needs for the next output frame */
+  const unsigned int keep = m_taps / 2 - 1;
+  unsigned int pos = (unsigned int)m_time;
+  if (pos <= keep)
+    return;
+
+  unsigned int drop = std::min(pos - keep, m_frames);
+  for (unsigned int ch = 0; ch < m_channels; ++ch)
+  {
+    float *buf = &m_buffer[ch * m_capacity];
+    memmove(buf, buf + drop, (m_frames - drop) * sizeof(float));
+  }
+  m_frames -= drop;
+  m_time   -= drop;
+}
+
+inline float CAEResampler::DotProduct(const float *a, const float *b, const unsigned int count)
+{
+  /* count is always a multiple of 4, b is always 16 byte aligned */
+#if defined(__SSE__)
+  __m128 acc = _mm_setzero_ps();
+  for (unsigned int i = 0; i < count; i += 4)
+    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_load_ps(b + i)));
+  acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+  acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+  return _mm_cvtss_f32(acc);
+#elif defined(__ARM_NEON__)
+  float32x4_t acc = vdupq_n_f32(0.0f);
+  for (unsigned int i = 0; i < count; i += 4)
+    acc = vmlaq_f32(acc, vld1q_f32(a + i), vld1q_f32(b + i));
+  float32x2_t sum = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+  sum = vpadd_f32(sum, sum);
+  return vget_lane_f32(sum, 0);
+#else
+  float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+  for (unsigned int i = 0; i < count; i += 4)
+  {
+    s0 += a[i + 0] * b[i + 0];
+    s1 += a[i + 1] * b[i + 1];
+    s2 += a[i + 2] * b[i + 2];
+    s3 += a[i + 3] * b[i + 3];
+  }
+  return (s0 + s1) + (s2 + s3);
+#endif
+}
+
+unsigned int CAEResampler::Process(const float *in, unsigned int inFrames, float *out, unsigned int outFrames)
+{
+  if (!m_filter)
+    return 0;
+
+  if (inFrames)
+    Push(in, inFrames);
+
+  const int half = m_taps / 2;
+  unsigned int generated = 0;
+  while (generated < outFrames)
+  {
+    unsigned int pos = (unsigned int)m_time;
+    /* need half frames of lookahead past the current position */
+    if (pos + half >= m_frames)
+      break;
+
+    /* interpolate the filter for the exact sub-sample position */
+    double       phase = (m_time - pos) * AE_RESAMPLE_PHASES;
+    unsigned int index = (unsigned int)phase;
+    float        frac  = (float)(phase - index);
+    const float *row0  = m_filter + index * m_taps;
+    const float *row1  = row0 + m_taps;
+
+#if defined(__SSE__)
+    __m128 f = _mm_set1_ps(frac);
+    for (unsigned int k = 0; k < m_taps; k += 4)
+    {
+      __m128 a = _mm_load_ps(row0 + k);
+      __m128 b = _mm_load_ps(row1 + k);
+      _mm_store_ps(m_coeffs + k, _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), f)));
+    }
+#elif defined(__ARM_NEON__)
+    for (unsigned int k = 0; k < m_taps; k += 4)
+    {
+      float32x4_t a = vld1q_f32(row0 + k);
+      float32x4_t b = vld1q_f32(row1 + k);
+      vst1q_f32(m_coeffs + k, vmlaq_n_f32(a, vsubq_f32(b, a), frac));
+    }
+#else
+    for (unsigned int k = 0; k < m_taps; ++k)
+      m_coeffs[k] = row0[k] + (row1[k] - row0[k]) * frac;
+#endif
+
+    const unsigned int start = pos - half + 1;
+    for (unsigned int ch = 0; ch < m_channels; ++ch)
+      *out++ = DotProduct(&m_buffer[ch * m_capacity + start], m_coeffs, m_taps);
+
+    m_time += m_step;
+    ++generated;
+  }
+
+  Discard();
+  return generated;
+}
@@ -0,0 +1,96 @@
+/*
+ *      Copyright (C) 2010-2012 Team XBMC
+ *      http://xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+#pragma once
+
+#include <vector>
+
+enum AEResampleQuality
+{
+  AE_RESAMPLE_FASTEST = 0, /* 8 taps  */
+  AE_RESAMPLE_LOW,         /* 16 taps */
+  AE_RESAMPLE_MEDIUM,      /* 32 taps */
+  AE_RESAMPLE_BEST         /* 64 taps */
+};
+
+/**
+ * Polyphase windowed-sinc resampler for interleaved float audio.
+ *
+ * The filter is a kaiser windowed sinc sampled at a fixed number of phases,
+ * the coefficients for the exact sub-sample position are linearly
+ * interpolated between two neighbouring phases, so the ratio can be changed
+ * between every call without glitches or table rebuilds (as needed when
+ * syncing audio to the video clock).
+ *
+ * All input passed to Process is consumed, output that did not fit is kept
+ * and returned on the next call.
+ */
+class CAEResampler
+{
+public:
+  CAEResampler();
+  ~CAEResampler();
+
+  bool Initialize(unsigned int channels, enum AEResampleQuality quality, double ratio);
+  void Deinitialize();
+
+  /* ratio is output rate / input rate, same as libsamplerate's src_ratio */
+  void   SetRatio(double ratio);
+  double GetRatio() const { return m_ratio; }
+
+  /* drop any buffered audio, the filter starts from silence again */
+  void Reset();
+
+  /**
+   * Resample audio
+   * @param in interleaved input samples
+   * @param inFrames number of input frames, all of them are consumed
+   * @param out interleaved output buffer
+   * @param outFrames size of the output buffer in frames
+   * @return the number of frames written to out
+   */
+  unsigned int Process(const float *in, unsigned int inFrames, float *out, unsigned int outFrames);
+
+  /* number of input frames buffered that have not yet been resampled */
+  unsigned int GetBufferedFrames() const;
+
+  unsigned int GetTaps() const { return m_taps; }
+
+private:
+  void BuildFilter(double cutoff);
+  void Push(const float *in, unsigned int frames);
+  void Discard();
+
+  static float DotProduct(const float *a, const float *b, const unsigned int count);
+
+  unsigned int m_channels;
+  unsigned int m_taps;
+  double       m_beta;
+  double       m_ratio;
+  double       m_step;     /* input frames per output frame */
+  double       m_cutoff;   /* cutoff the filter table was built for */
+  double       m_time;     /* position of the next output frame in m_buffer */
+
+  float              *m_filter; /* (AE_RESAMPLE_PHASES + 1) * m_taps coefficients */
+  float              *m_coeffs; /* interpolated coefficients for the current position */
+  std::vector<float>  m_buffer; /* planar history, m_capacity frames per channel */
+  unsigned int        m_capacity;
+  unsigned int        m_frames;
+};
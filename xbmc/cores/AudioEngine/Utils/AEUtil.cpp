@@ -27,6 +27,10 @@
 #include "utils/log.h"
 #include "utils/TimeUtils.h"
 
+#ifdef __ARM_NEON__
+#include <arm_neon.h>
+#endif
+
 using namespace std;
 
 /* declare the rng seed and initialize it */
@@ -208,8 +212,8 @@ void CAEUtil::SSEMulAddArray(float *data, float *add, const float mul, uint32_t
 {
   const __m128 m = _mm_set_ps1(mul);
 
-  /* work around invalid alignment */
-  while ((((uintptr_t)data & 0xF) || ((uintptr_t)add & 0xF)) && count > 0)
+  /* work around invalid alignment of the destination */
+  while (((uintptr_t)data & 0xF) && count > 0)
   {
     data[0] += add[0] * mul;
     ++add;
@@ -217,12 +221,25 @@ void CAEUtil::SSEMulAddArray(float *data, float *add, const float mul, uint32_t
     --count;
   }
 
+  /* the source is often offset from the destination, read it unaligned rather than one by one */
   uint32_t even = count & ~0x3;
-  for (uint32_t i = 0; i < even; i+=4, data+=4, add+=4)
+  if ((uintptr_t)add & 0xF)
   {
-    __m128 ad      = _mm_load_ps(add );
-    __m128 to      = _mm_load_ps(data);
-    *(__m128*)data = _mm_add_ps (to, _mm_mul_ps(ad, m));
+    for (uint32_t i = 0; i < even; i+=4, data+=4, add+=4)
+    {
+      __m128 ad      = _mm_loadu_ps(add );
+      __m128 to      = _mm_load_ps (data);
+      *(__m128*)data = _mm_add_ps  (to, _mm_mul_ps(ad, m));
+    }
+  }
+  else
+  {
+    for (uint32_t i = 0; i < even; i+=4, data+=4, add+=4)
+    {
+      __m128 ad      = _mm_load_ps(add );
+      __m128 to      = _mm_load_ps(data);
+      *(__m128*)data = _mm_add_ps (to, _mm_mul_ps(ad, m));
+    }
   }
 
   if (even != count)
@@ -256,6 +273,86 @@ void CAEUtil::SSEMulAddArray(float *data, float *add, const float mul, uint32_t
 }
 #endif
 
+void CAEUtil::MulAddRamp(float *data, const float *add, float mul, const float step, uint32_t frames, const uint32_t channels)
+{
+  /* constant gain, treat it as one long array */
+  if (step == 0.0f)
+  {
+    uint32_t count = frames * channels;
+#if defined(__SSE__)
+    SSEMulAddArray(data, (float*)add, mul, count);
+#else
+  #if defined(__ARM_NEON__)
+    const float32x4_t m = vdupq_n_f32(mul);
+    for (uint32_t even = count & ~0x3; even; even -= 4, data += 4, add += 4)
+      vst1q_f32(data, vmlaq_f32(vld1q_f32(data), vld1q_f32(add), m));
+    count &= 0x3;
+  #endif
+    for (uint32_t i = 0; i < count; ++i)
+      data[i] += add[i] * mul;
+#endif
+    return;
+  }
+
+#if defined(__SSE__) || defined(__ARM_NEON__)
+  if (channels == 2)
+  {
+    /* two frames per vector, each with its own gain */
+    uint32_t pairs = frames >> 1;
+  #if defined(__SSE__)
+    __m128       m = _mm_setr_ps(mul, mul, mul + step, mul + step);
+    const __m128 s = _mm_set_ps1(step * 2.0f);
+    for (uint32_t i = 0; i < pairs; ++i, data += 4, add += 4)
+    {
+      _mm_storeu_ps(data, _mm_add_ps(_mm_loadu_ps(data), _mm_mul_ps(_mm_loadu_ps(add), m)));
+      m = _mm_add_ps(m, s);
+    }
+  #else
+    const float       g[4] = {mul, mul, mul + step, mul + step};
+    float32x4_t       m    = vld1q_f32(g);
+    const float32x4_t s    = vdupq_n_f32(step * 2.0f);
+    for (uint32_t i = 0; i < pairs; ++i, data += 4, add += 4)
+    {
+      vst1q_f32(data, vmlaq_f32(vld1q_f32(data), vld1q_f32(add), m));
+      m = vaddq_f32(m, s);
+    }
+  #endif
+    mul    += step * 2.0f * pairs;
+    frames &= 0x1;
+  }
+  else if (channels >= 4)
+  {
+    /* one gain per frame, vectorize over the channels */
+    const uint32_t blocks = channels & ~0x3;
+    for (; frames; --frames, mul += step)
+    {
+      uint32_t i = 0;
+  #if defined(__SSE__)
+      const __m128 m = _mm_set_ps1(mul);
+      for (; i < blocks; i += 4)
+        _mm_storeu_ps(data + i, _mm_add_ps(_mm_loadu_ps(data + i), _mm_mul_ps(_mm_loadu_ps(add + i), m)));
+  #else
+      const float32x4_t m = vdupq_n_f32(mul);
+      for (; i < blocks; i += 4)
+        vst1q_f32(data + i, vmlaq_f32(vld1q_f32(data + i), vld1q_f32(add + i), m));
+  #endif
+      for (; i < channels; ++i)
+        data[i] += add[i] * mul;
+      data += channels;
+      add  += channels;
+    }
+  }
+#endif
+
+  for (; frames; --frames, mul += step)
+  {
+    for (uint32_t i = 0; i < channels; ++i)
+      data[i] += add[i] * mul;
+    data += channels;
+    add  += channels;
+  }
+}
+
 inline float CAEUtil::SoftClamp(const float x)
 {
 #if 1
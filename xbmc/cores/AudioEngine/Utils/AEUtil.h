@@ -81,6 +81,12 @@ public:
   static void SSEMulArray     (float *data, const float mul, uint32_t count);
   static void SSEMulAddArray  (float *data, float *add, const float mul, uint32_t count);
   #endif
+
+  /*
+    Mix frames of interleaved audio into data, the gain starts at mul for the
+    first frame and changes by step for every following frame (volume ramp)
+  */
+  static void MulAddRamp(float *data, const float *add, float mul, const float step, uint32_t frames, const uint32_t channels);
   static void ClampArray(float *data, uint32_t count);
 
   /*
@@ -29,6 +29,10 @@
 #include "URL.h"
 #include <samplerate.h>
 
+#ifdef _WIN32
+#pragma comment(lib, "libsamplerate-0.lib")
+#endif
+
 #include "AEConvert.h"
 #include "AEUtil.h"
 #include "AERemap.h"
@@ -0,0 +1,278 @@
+/*
+ *      Copyright (C) 2005-2012 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+/*
+ * aebench - compares CAEResampler against libsamplerate, which it replaced
+ * for playback, on the conversions playback needs: 44.1 <-> 48 kHz and the
+ * small ratios used to sync audio to the video clock.
+ *
+ *   aebench [--seconds=<n>]
+ *
+ * Every quality tier of CAEResampler and every sinc converter of libsamplerate
+ * resamples a stereo sine at a few frequencies, fed in blocks of the size the
+ * audio engine uses. For each it reports the SNR of the output against an
+ * ideal sine at the output rate (after the filter has settled) and the
+ * realtime factor, ie. how many seconds of audio are resampled per second
+ * of CPU time.
+ */
+
+#include "system.h"
+#include "cores/AudioEngine/Utils/AEResampler.h"
+#include "utils/log.h"
+#include "utils/TimeUtils.h"
+
+#include <math.h>
+#include <samplerate.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define BENCH_CHANNELS    2
+#define BENCH_BLOCK       1024  /* frames per call, about what the audio engine passes */
+#define BENCH_SETTLE      0.1   /* seconds of output skipped while the filters settle */
+
+struct Conversion
+{
+  const char *name;
+  double      inRate;
+  double      ratio;
+};
+
+static const Conversion conversions[] =
+{
+  { "44.1k->48k",   44100.0, 48000.0 / 44100.0 },
+  { "48k->44.1k",   48000.0, 44100.0 / 48000.0 },
+  { "48k sync",     48000.0, 1.001             },
+};
+
+static const double frequencies[] = { 1000.0, 10000.0, 18000.0 };
+
+struct Result
+{
+  double snr;      /* worst SNR over the test frequencies, dB */
+  double realtime; /* seconds of audio resampled per second of CPU time */
+};
+
+class IResampler
+{
+public:
+  virtual ~IResampler() {}
+  virtual bool Init(double ratio) = 0;
+  virtual unsigned int Process(const float *in, unsigned int inFrames, float *out, unsigned int outFrames) = 0;
+};
+
+class CAEResamplerBench : public IResampler
+{
+public:
+  CAEResamplerBench(AEResampleQuality quality) : m_quality(quality) {}
+  virtual bool Init(double ratio) { return m_resampler.Initialize(BENCH_CHANNELS, m_quality, ratio); }
+  virtual unsigned int Process(const float *in, unsigned int inFrames, float *out, unsigned int outFrames)
+  {
+    return m_resampler.Process(in, inFrames, out, outFrames);
+  }
+private:
+  AEResampleQuality m_quality;
+  CAEResampler      m_resampler;
+};
+
+class CSRCBench : public IResampler
+{
+public:
+  CSRCBench(int converter) : m_converter(converter), m_state(NULL), m_ratio(1.0) {}
+  virtual ~CSRCBench() { if (m_state) src_delete(m_state); }
+  virtual bool Init(double ratio)
+  {
+    int error;
+    if (m_state)
+      src_delete(m_state);
+    m_ratio = ratio;
+    m_state = src_new(m_converter, BENCH_CHANNELS, &error);
+    return m_state != NULL;
+  }
+  virtual unsigned int Process(const float *in, unsigned int inFrames, float *out, unsigned int outFrames)
+  {
+    /* the way CDVDPlayerResampler and CSoftAEStream used it: all input consumed per call */
+    unsigned int written = 0;
+    while (inFrames > 0 && written < outFrames)
+    {
+      SRC_DATA data;
+      memset(&data, 0, sizeof(data));
+      data.data_in       = (float *)in;
+      data.input_frames  = inFrames;
+      data.data_out      = out + written * BENCH_CHANNELS;
+      data.output_frames = outFrames - written;
+      data.src_ratio     = m_ratio;
+      if (src_process(m_state, &data) != 0)
+        break;
+      in       += data.input_frames_used * BENCH_CHANNELS;
+      inFrames -= data.input_frames_used;
+      written  += data.output_frames_gen;
+      if (data.input_frames_used == 0 && data.output_frames_gen == 0)
+        break;
+    }
+    return written;
+  }
+private:
+  int        m_converter;
+  SRC_STATE *m_state;
+  double     m_ratio;
+};
+
+/* SNR of the first channel against the best fitting sine of the given frequency */
+static double MeasureSNR(const std::vector<float> &out, unsigned int frames, double frequency, double rate)
+{
+  unsigned int start = (unsigned int)(BENCH_SETTLE * rate);
+  if (frames <= start + 1)
+    return 0.0;
+
+  /* least squares fit of a * sin + b * cos */
+  double w = 2.0 * M_PI * frequency / rate;
+  double ss = 0.0, cc = 0.0, sc = 0.0, ys = 0.0, yc = 0.0;
+  for (unsigned int i = start; i < frames; i++)
+  {
+    double s = sin(w * i), c = cos(w * i), y = out[i * BENCH_CHANNELS];
+    ss += s * s; cc += c * c; sc += s * c;
+    ys += y * s; yc += y * c;
+  }
+  double det = ss * cc - sc * sc;
+  if (det == 0.0)
+    return 0.0;
+  double a = (ys * cc - yc * sc) / det;
+  double b = (yc * ss - ys * sc) / det;
+
+  double signal = 0.0, noise = 0.0;
+  for (unsigned int i = start; i < frames; i++)
+  {
+    double fit = a * sin(w * i) + b * cos(w * i);
+    double err = out[i * BENCH_CHANNELS] - fit;
+    signal += fit * fit;
+    noise  += err * err;
+  }
+  if (noise <= 0.0)
+    return 200.0;
+  return 10.0 * log10(signal / noise);
+}
+
+static bool Run(IResampler *resampler, const Conversion &conversion, double seconds, Result &result)
+{
+  unsigned int inFrames = (unsigned int)(conversion.inRate * seconds);
+  std::vector<float> in(inFrames * BENCH_CHANNELS);
+  std::vector<float> out((unsigned int)(inFrames * conversion.ratio + BENCH_BLOCK * 4) * BENCH_CHANNELS);
+
+  result.snr = 1000.0;
+  double cpu = 0.0;
+  for (unsigned int f = 0; f < sizeof(frequencies) / sizeof(frequencies[0]); f++)
+  {
+    /* skip frequencies above the output's nyquist */
+    if (frequencies[f] >= conversion.inRate * conversion.ratio * 0.45)
+      continue;
+
+    double w = 2.0 * M_PI * frequencies[f] / conversion.inRate;
+    for (unsigned int i = 0; i < inFrames; i++)
+      for (unsigned int c = 0; c < BENCH_CHANNELS; c++)
+        in[i * BENCH_CHANNELS + c] = (float)(0.5 * sin(w * i));
+
+    if (!resampler->Init(conversion.ratio))
+      return false;
+
+    unsigned int written = 0;
+    int64_t start = CurrentHostCounter();
+    for (unsigned int i = 0; i < inFrames; i += BENCH_BLOCK)
+    {
+      unsigned int frames = std::min((unsigned int)BENCH_BLOCK, inFrames - i);
+      written += resampler->Process(&in[i * BENCH_CHANNELS], frames,
+                                    &out[written * BENCH_CHANNELS], out.size() / BENCH_CHANNELS - written);
+    }
+    cpu += (double)(CurrentHostCounter() - start) / CurrentHostFrequency();
+
+    double snr = MeasureSNR(out, written, frequencies[f], conversion.inRate * conversion.ratio);
+    if (snr < result.snr)
+      result.snr = snr;
+  }
+
+  result.realtime = cpu > 0.0 ? seconds * (sizeof(frequencies) / sizeof(frequencies[0])) / cpu : 0.0;
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  double seconds = 10.0;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strncmp(argv[i], "--seconds=", 10) == 0)
+      seconds = atof(argv[i] + 10);
+    else
+    {
+      fprintf(stderr, "usage: %s [--seconds=<n>]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (seconds < 1.0)
+    seconds = 1.0;
+
+  CLog::SetLogLevel(LOG_LEVEL_NONE);
+
+  struct
+  {
+    const char *name;
+    IResampler *resampler;
+  } resamplers[] =
+  {
+    { "CAEResampler fastest",  new CAEResamplerBench(AE_RESAMPLE_FASTEST) },
+    { "CAEResampler low",      new CAEResamplerBench(AE_RESAMPLE_LOW)     },
+    { "CAEResampler medium",   new CAEResamplerBench(AE_RESAMPLE_MEDIUM)  },
+    { "CAEResampler best",     new CAEResamplerBench(AE_RESAMPLE_BEST)    },
+    { "src sinc fastest",      new CSRCBench(SRC_SINC_FASTEST)            },
+    { "src sinc medium",       new CSRCBench(SRC_SINC_MEDIUM_QUALITY)     },
+    { "src sinc best",         new CSRCBench(SRC_SINC_BEST_QUALITY)       },
+  };
+
+  printf("%-22s", "");
+  for (unsigned int c = 0; c < sizeof(conversions) / sizeof(conversions[0]); c++)
+    printf("  %-20s", conversions[c].name);
+  printf("\n%-22s", "");
+  for (unsigned int c = 0; c < sizeof(conversions) / sizeof(conversions[0]); c++)
+    printf("  %8s %11s", "SNR dB", "x realtime");
+  printf("\n");
+
+  int ret = 0;
+  for (unsigned int r = 0; r < sizeof(resamplers) / sizeof(resamplers[0]); r++)
+  {
+    printf("%-22s", resamplers[r].name);
+    for (unsigned int c = 0; c < sizeof(conversions) / sizeof(conversions[0]); c++)
+    {
+      Result result;
+      if (Run(resamplers[r].resampler, conversions[c], seconds, result))
+        printf("  %8.1f %11.0f", result.snr, result.realtime);
+      else
+      {
+        printf("  %20s", "failed");
+        ret = 1;
+      }
+      fflush(stdout);
+    }
+    printf("\n");
+    delete resamplers[r].resampler;
+  }
+
+  return ret;
+}
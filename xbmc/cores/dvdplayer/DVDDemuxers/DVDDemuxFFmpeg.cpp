@@ -457,6 +457,12 @@ bool CDVDDemuxFFmpeg::Open(CDVDInputStream* pInput)
   // reset any timeout
   m_timeout.SetInfinite();
 
+  // restore the keyframe index gathered during earlier playback
+  if (g_advancedSettings.m_videoDemuxIndexCache
+  &&  m_pInput->IsStreamType(DVDSTREAM_TYPE_FILE)
+  &&  m_ioContext && m_ioContext->seekable)
+    m_indexCache.Load(m_pFormatContext, m_dllAvFormat, strFile);
+
   // if format can be nonblocking, let's use that
   m_pFormatContext->flags |= AVFMT_FLAG_NONBLOCK;
 
@@ -500,6 +506,9 @@ void CDVDDemuxFFmpeg::Dispose()
 
   if (m_pFormatContext)
   {
+    m_indexCache.Save(m_pFormatContext);
+    m_indexCache = CDVDDemuxIndexCache();
+
     if (m_ioContext && m_pFormatContext->pb && m_pFormatContext->pb != m_ioContext)
     {
       CLog::Log(LOGWARNING, "CDVDDemuxFFmpeg::Dispose - demuxer changed our byte context behind our back, possible memleak");
@@ -22,6 +22,7 @@
  */
 
 #include "DVDDemux.h"
+#include "DVDDemuxIndexCache.h"
 #include "DllAvFormat.h"
 #include "DllAvCodec.h"
 #include "DllAvUtil.h"
@@ -140,6 +141,7 @@ protected:
   int      m_speed;
   unsigned m_program;
   XbmcThreads::EndTime  m_timeout;
+  CDVDDemuxIndexCache   m_indexCache;
 
   CDVDInputStream* m_pInput;
 };
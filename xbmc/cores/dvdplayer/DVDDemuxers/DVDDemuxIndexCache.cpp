@@ -0,0 +1,314 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#if (defined HAVE_CONFIG_H) && (!defined WIN32)
+  #include "config.h"
+#endif
+#ifndef __STDC_CONSTANT_MACROS
+#define __STDC_CONSTANT_MACROS
+#endif
+#include <vector>
+#include <algorithm>
+#include "DVDDemuxIndexCache.h"
+#include "DllAvFormat.h"
+#include "filesystem/File.h"
+#include "filesystem/Directory.h"
+#include "FileItem.h"
+#include "XBDateTime.h"
+#include "utils/Crc32.h"
+#include "utils/log.h"
+
+using namespace XFILE;
+
+#define INDEX_CACHE_PATH     "special://temp/demuxindex/"
+#define INDEX_CACHE_MAGIC    0x58494458 // XIDX
+#define INDEX_CACHE_VERSION  2          // 2: video streams only
+#define INDEX_CACHE_MAX      (1 << 20)  // entries per stream
+#define INDEX_CACHE_MAX_SIZE (32 << 20) // bytes kept in INDEX_CACHE_PATH
+#define INDEX_CACHE_MAX_AGE  30         // days an index is kept after it was last written
+
+struct IndexCacheHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  int64_t  size;
+  int64_t  mtime;
+  uint32_t streams; ///< number of IndexCacheStream records that follow
+};
+
+struct IndexCacheStream
+{
+  int32_t  index;
+  int32_t  codec;
+  uint32_t entries;
+};
+
+struct IndexCacheEntry
+{
+  int64_t  pos;
+  int64_t  timestamp;
+  int32_t  size;
+  int32_t  distance;
+};
+
+CDVDDemuxIndexCache::CDVDDemuxIndexCache()
+{
+  m_entries = 0;
+}
+
+bool CDVDDemuxIndexCache::GetCacheFile(const CStdString &strFile, CStdString &cacheFile, int64_t &size, int64_t &mtime)
+{
+  struct __stat64 st;
+  if (CFile::Stat(strFile, &st) != 0 || st.st_size <= 0)
+    return false;
+
+  size  = st.st_size;
+  mtime = st.st_mtime;
+
+  Crc32 crc;
+  crc.ComputeFromLowerCase(strFile);
+  cacheFile.Format(INDEX_CACHE_PATH "%08x.idx", (unsigned int)crc);
+  return true;
+}
+
+unsigned int CDVDDemuxIndexCache::CountEntries(AVFormatContext *context)
+{
+  unsigned int entries = 0;
+  for (unsigned int i = 0; i < context->nb_streams; i++)
+  {
+    if (context->streams[i]->codec->codec_type == AVMEDIA_TYPE_VIDEO)
+      entries += context->streams[i]->nb_index_entries;
+  }
+  return entries;
+}
+
+AVStream *CDVDDemuxIndexCache::FindVideoStream(AVFormatContext *context, int index, int codec)
+{
+  // mpegts and friends add streams as they turn up, so the index may have moved
+  if (index >= 0 && (unsigned int)index < context->nb_streams)
+  {
+    AVStream *st = context->streams[index];
+    if (st->codec->codec_type == AVMEDIA_TYPE_VIDEO && st->codec->codec_id == codec)
+      return st;
+  }
+  for (unsigned int i = 0; i < context->nb_streams; i++)
+  {
+    AVStream *st = context->streams[i];
+    if (st->codec->codec_type == AVMEDIA_TYPE_VIDEO && st->codec->codec_id == codec)
+      return st;
+  }
+  return NULL;
+}
+
+struct IndexCacheFile
+{
+  CDateTime    date;
+  CStdString   path;
+  int64_t      size;
+  bool operator<(const IndexCacheFile &right) const { return date < right.date; }
+};
+
+void CDVDDemuxIndexCache::Prune()
+{
+  CFileItemList items;
+  if (!CDirectory::GetDirectory(INDEX_CACHE_PATH, items, ".idx", DIR_FLAG_NO_FILE_DIRS | DIR_FLAG_BYPASS_CACHE))
+    return;
+
+  std::vector<IndexCacheFile> files;
+  int64_t total = 0;
+  for (int i = 0; i < items.Size(); i++)
+  {
+    if (items[i]->m_bIsFolder)
+      continue;
+    IndexCacheFile file;
+    file.date = items[i]->m_dateTime;
+    file.path = items[i]->GetPath();
+    file.size = items[i]->m_dwSize;
+    files.push_back(file);
+    total += file.size;
+  }
+
+  // drop the oldest first, until what is left is recent and small enough
+  std::sort(files.begin(), files.end());
+  CDateTime expired = CDateTime::GetCurrentDateTime() - CDateTimeSpan(INDEX_CACHE_MAX_AGE, 0, 0, 0);
+  for (std::vector<IndexCacheFile>::const_iterator i = files.begin(); i != files.end(); ++i)
+  {
+    if (total <= INDEX_CACHE_MAX_SIZE && (!i->date.IsValid() || i->date >= expired))
+      break;
+    if (CFile::Delete(i->path))
+    {
+      CLog::Log(LOGDEBUG, "%s - removed index cache %s", __FUNCTION__, i->path.c_str());
+      total -= i->size;
+    }
+  }
+}
+
+bool CDVDDemuxIndexCache::Load(AVFormatContext *context, DllAvFormat &dll, const CStdString &strFile)
+{
+  m_file    = strFile;
+  m_entries = CountEntries(context);
+
+  CStdString cacheFile;
+  int64_t size, mtime;
+  if (!GetCacheFile(strFile, cacheFile, size, mtime))
+  {
+    m_file.Empty();
+    return false;
+  }
+
+  CFile file;
+  if (!file.Open(cacheFile))
+    return false;
+
+  IndexCacheHeader header;
+  if (file.Read(&header, sizeof(header)) != sizeof(header)
+  ||  header.magic   != INDEX_CACHE_MAGIC
+  ||  header.version != INDEX_CACHE_VERSION
+  ||  header.size    != size
+  ||  header.mtime   != mtime)
+  {
+    CLog::Log(LOGDEBUG, "%s - stale index cache for %s", __FUNCTION__, strFile.c_str());
+    file.Close();
+    CFile::Delete(cacheFile);
+    return false;
+  }
+
+  std::vector<IndexCacheEntry> entries;
+  unsigned int added = 0;
+  for (unsigned int i = 0; i < header.streams; i++)
+  {
+    IndexCacheStream stream;
+    if (file.Read(&stream, sizeof(stream)) != sizeof(stream)
+    ||  stream.entries > INDEX_CACHE_MAX)
+      break;
+
+    entries.resize(stream.entries);
+    if (stream.entries == 0)
+      continue;
+    if (file.Read(&entries[0], sizeof(IndexCacheEntry) * stream.entries) != sizeof(IndexCacheEntry) * stream.entries)
+      break;
+
+    // the video stream may not have been probed yet, keep the cache for next time
+    AVStream *st = FindVideoStream(context, stream.index, stream.codec);
+    if (!st)
+      continue;
+
+    // the demuxer already knows more than we do, leave it alone
+    if ((unsigned int)st->nb_index_entries >= stream.entries)
+      continue;
+
+    for (unsigned int j = 0; j < stream.entries; j++)
+    {
+      const IndexCacheEntry &e = entries[j];
+      if (dll.av_add_index_entry(st, e.pos, e.timestamp, e.size, e.distance, AVINDEX_KEYFRAME) >= 0)
+        added++;
+    }
+  }
+
+  m_entries = CountEntries(context);
+  if (added)
+    CLog::Log(LOGDEBUG, "%s - restored %u index entries for %s", __FUNCTION__, added, strFile.c_str());
+  return added > 0;
+}
+
+bool CDVDDemuxIndexCache::Save(AVFormatContext *context)
+{
+  if (m_file.IsEmpty() || !context)
+    return false;
+
+  // nothing new was learned while playing
+  if (CountEntries(context) <= m_entries)
+    return false;
+
+  CStdString cacheFile;
+  int64_t size, mtime;
+  if (!GetCacheFile(m_file, cacheFile, size, mtime))
+    return false;
+
+  if (!CDirectory::Exists(INDEX_CACHE_PATH))
+    CDirectory::Create(INDEX_CACHE_PATH);
+
+  CFile file;
+  if (!file.OpenForWrite(cacheFile, true))
+  {
+    CLog::Log(LOGWARNING, "%s - unable to write index cache %s", __FUNCTION__, cacheFile.c_str());
+    return false;
+  }
+
+  IndexCacheHeader header;
+  header.magic   = INDEX_CACHE_MAGIC;
+  header.version = INDEX_CACHE_VERSION;
+  header.size    = size;
+  header.mtime   = mtime;
+  header.streams = 0;
+  for (unsigned int i = 0; i < context->nb_streams; i++)
+  {
+    if (context->streams[i]->codec->codec_type == AVMEDIA_TYPE_VIDEO)
+      header.streams++;
+  }
+  bool ok = file.Write(&header, sizeof(header)) == sizeof(header);
+
+  // seeking only ever goes by the video stream
+  std::vector<IndexCacheEntry> entries;
+  for (unsigned int i = 0; ok && i < context->nb_streams; i++)
+  {
+    AVStream *st = context->streams[i];
+    if (st->codec->codec_type != AVMEDIA_TYPE_VIDEO)
+      continue;
+
+    // only keyframes are usable as seek targets
+    entries.clear();
+    for (int j = 0; j < st->nb_index_entries && entries.size() < INDEX_CACHE_MAX; j++)
+    {
+      const AVIndexEntry &ie = st->index_entries[j];
+      if (!(ie.flags & AVINDEX_KEYFRAME))
+        continue;
+      IndexCacheEntry e;
+      e.pos       = ie.pos;
+      e.timestamp = ie.timestamp;
+      e.size      = ie.size;
+      e.distance  = ie.min_distance;
+      entries.push_back(e);
+    }
+
+    IndexCacheStream stream;
+    stream.index   = i;
+    stream.codec   = st->codec->codec_id;
+    stream.entries = entries.size();
+    ok = file.Write(&stream, sizeof(stream)) == sizeof(stream);
+    if (ok && !entries.empty())
+      ok = file.Write(&entries[0], sizeof(IndexCacheEntry) * entries.size()) == (int)(sizeof(IndexCacheEntry) * entries.size());
+  }
+  file.Close();
+
+  if (!ok)
+  {
+    CLog::Log(LOGWARNING, "%s - failed writing index cache %s", __FUNCTION__, cacheFile.c_str());
+    CFile::Delete(cacheFile);
+    return false;
+  }
+
+  CLog::Log(LOGDEBUG, "%s - stored index for %s", __FUNCTION__, m_file.c_str());
+  m_entries = CountEntries(context);
+
+  Prune();
+  return true;
+}
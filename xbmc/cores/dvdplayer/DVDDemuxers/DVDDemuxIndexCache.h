@@ -0,0 +1,73 @@
+#pragma once
+
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stdint.h>
+#include "utils/StdString.h"
+
+struct AVFormatContext;
+struct AVStream;
+class DllAvFormat;
+
+/*!
+ \brief Persistent keyframe index for files demuxed through ffmpeg.
+
+ Containers that lack a usable index (matroska without cues, avi/ts
+ over a network) force lavf to scan the file on every seek to build its
+ AVStream index. The index lavf gathers for the video stream during
+ playback is stored on disk, keyed by path, size and modification time,
+ and fed back into the stream the next time the file is opened.
+ */
+class CDVDDemuxIndexCache
+{
+public:
+  CDVDDemuxIndexCache();
+
+  /*!
+   \brief Add the cached index entries for a file to the opened streams.
+   \param context the opened format context
+   \param dll the avformat dll used to add the entries
+   \param strFile path of the file being demuxed
+   \return true if entries were added from the cache
+   */
+  bool Load(AVFormatContext *context, DllAvFormat &dll, const CStdString &strFile);
+
+  /*!
+   \brief Store the index of the streams if it grew since Load().
+   \param context the format context, before it is closed
+   \return true if the index was written
+   */
+  bool Save(AVFormatContext *context);
+
+private:
+  static bool GetCacheFile(const CStdString &strFile, CStdString &cacheFile, int64_t &size, int64_t &mtime);
+  static unsigned int CountEntries(AVFormatContext *context);
+  static AVStream *FindVideoStream(AVFormatContext *context, int index, int codec);
+
+  /*!
+   \brief Remove index files that are too old, oldest first until the cache is small enough.
+   */
+  static void Prune();
+
+  CStdString   m_file;
+  unsigned int m_entries; ///< number of index entries after Load()
+};
@@ -20,7 +20,7 @@
  */
 #pragma once
 
-#include <samplerate.h>
+#include "cores/AudioEngine/Utils/AEResampler.h"
 
 #define MAXRATIO 30
 
@@ -48,11 +48,10 @@ class CDVDPlayerResampler
 
   private:
 
-    int        m_nrchannels;
-    int        m_quality;
-    SRC_STATE* m_converter;
-    SRC_DATA   m_converterdata;
-    double     m_ratio;
+    int                    m_nrchannels;
+    enum AEResampleQuality m_quality;
+    CAEResampler           m_converter;
+    double                 m_ratio;
 
     float*     m_buffer;     //buffer for the audioframes
     int        m_bufferfill; //how many unread frames there are in the buffer
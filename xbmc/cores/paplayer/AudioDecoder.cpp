@@ -21,13 +21,115 @@
 
 #include "AudioDecoder.h"
 #include "CodecFactory.h"
+#include "settings/AdvancedSettings.h"
 #include "settings/GUISettings.h"
 #include "FileItem.h"
 #include "music/tags/MusicInfoTag.h"
 #include "threads/SingleLock.h"
+#include "utils/JobManager.h"
 #include "utils/log.h"
 #include <math.h>
 
+#define MIN_CACHED_HEAD_MS 1000 /* heads shorter than this are not worth caching */
+
+/* shared between a decoder and the job opening its codec, so either side can go away first */
+class CCodecOpenState
+{
+public:
+  CCodecOpenState() : m_codec(NULL), m_position(0), m_done(false), m_abandoned(false) {}
+
+  CCriticalSection m_section;
+  ICodec*          m_codec;
+  int64_t          m_position; /* where the codec resumes, as returned by its seek */
+  bool             m_done;
+  bool             m_abandoned;
+};
+
+class CCodecOpenJob : public CJob
+{
+public:
+  CCodecOpenJob(const boost::shared_ptr<CCodecOpenState> &state, const CStdString &path, const CStdString &mimeType,
+                unsigned int filecache, int64_t totalTime, int64_t seekTime) :
+    m_state    (state),
+    m_path     (path),
+    m_mimeType (mimeType),
+    m_filecache(filecache),
+    m_totalTime(totalTime),
+    m_seekTime (seekTime)
+  {
+  }
+
+  virtual const char *GetType() const { return "audiodecoderopen"; }
+
+  virtual bool DoWork()
+  {
+    ICodec *codec = CAudioDecoder::OpenCodec(m_path, m_mimeType, m_filecache);
+    int64_t position = 0;
+    if (codec)
+    {
+      if (m_totalTime)
+        codec->SetTotalTime(m_totalTime);
+      if (m_seekTime)
+        position = codec->Seek(m_seekTime);
+    }
+
+    CSingleLock lock(m_state->m_section);
+    if (m_state->m_abandoned)
+    {
+      delete codec;
+      return false;
+    }
+
+    m_state->m_codec    = codec;
+    m_state->m_position = position;
+    m_state->m_done     = true;
+    return codec != NULL;
+  }
+
+private:
+  boost::shared_ptr<CCodecOpenState> m_state;
+  CStdString   m_path;
+  CStdString   m_mimeType;
+  unsigned int m_filecache;
+  int64_t      m_totalTime;
+  int64_t      m_seekTime;
+};
+
+/* shared between a decoder and the job pre-decoding it, so the decoder can go away first */
+class CPreDecodeState
+{
+public:
+  CPreDecodeState(CAudioDecoder *decoder) : m_decoder(decoder), m_running(false) {}
+
+  CCriticalSection m_section;
+  CAudioDecoder*   m_decoder; /* NULL once the decoder is destroyed */
+  volatile bool    m_running;
+};
+
+class CPreDecodeJob : public CJob
+{
+public:
+  CPreDecodeJob(const boost::shared_ptr<CPreDecodeState> &state) : m_state(state) {}
+
+  virtual const char *GetType() const { return "audiodecoderpredecode"; }
+
+  virtual bool DoWork()
+  {
+    while (true)
+    {
+      CSingleLock lock(m_state->m_section);
+      if (!m_state->m_decoder || !m_state->m_decoder->PreDecodeStep())
+      {
+        m_state->m_running = false;
+        return true;
+      }
+    }
+  }
+
+private:
+  boost::shared_ptr<CPreDecodeState> m_state;
+};
+
 CAudioDecoder::CAudioDecoder()
 {
   m_codec = NULL;
@@ -36,6 +138,22 @@ CAudioDecoder::CAudioDecoder()
 
   m_status = STATUS_NO_FILE;
   m_canPlay = false;
+
+  m_sampleRate = 0;
+  m_encodedSampleRate = 0;
+  m_dataFormat = AE_FMT_INVALID;
+  m_bitsPerSample = 0;
+  m_totalTime = 0;
+  m_canSeek = false;
+  m_bitrate = 0;
+
+  m_pendingSeek = -1;
+  m_spliceTime = 0;
+  m_skipBytes = 0;
+  m_headLimit = 0;
+  m_queueSize = 0;
+  m_baseSize = 0;
+  m_predecodeSize = 0;
 }
 
 CAudioDecoder::~CAudioDecoder()
@@ -45,9 +163,60 @@ CAudioDecoder::~CAudioDecoder()
 
 void CAudioDecoder::Destroy()
 {
+  /* stop pre-decoding, which waits for a read in progress */
+  if (m_preDecode)
+  {
+    CSingleLock stateLock(m_preDecode->m_section);
+    m_preDecode->m_decoder = NULL;
+  }
+  m_preDecode.reset();
+
   CSingleLock lock(m_critSection);
   m_status = STATUS_NO_FILE;
 
+  /* hand the decoded head over to the pcm cache */
+  if (m_head && m_codec)
+  {
+    /* trim it to a whole number of ms so the codec can resume exactly where it ends */
+    unsigned int blockSize = (m_bitsPerSample >> 3) * m_channelInfo.Count();
+    unsigned int a = m_sampleRate, b = 1000;
+    while (b) { unsigned int t = a % b; a = b; b = t; }
+    size_t frames = m_head->m_data.size() / blockSize;
+    frames -= frames % (m_sampleRate / a);
+    m_head->m_data.resize(frames * blockSize);
+
+    if (m_head->GetDuration() >= MIN_CACHED_HEAD_MS || (m_eof && frames))
+    {
+      m_head->m_channelInfo       = m_channelInfo;
+      m_head->m_sampleRate        = m_sampleRate;
+      m_head->m_encodedSampleRate = m_encodedSampleRate;
+      m_head->m_dataFormat        = m_dataFormat;
+      m_head->m_bitsPerSample     = m_bitsPerSample;
+      m_head->m_totalTime         = m_codec->m_TotalTime;
+      m_head->m_canSeek           = m_codec->CanSeek();
+      m_head->m_bitrate           = m_codec->m_Bitrate;
+      m_head->m_codecName         = m_codec->m_CodecName;
+      m_head->m_replayGain        = m_codec->m_replayGain;
+      CPCMCache::Get().Add(m_head);
+    }
+  }
+  m_head.reset();
+
+  /* let a pending background open clean up after itself */
+  if (m_opening)
+  {
+    CSingleLock stateLock(m_opening->m_section);
+    if (m_opening->m_done)
+    {
+      delete m_opening->m_codec;
+      m_opening->m_codec = NULL;
+    }
+    m_opening->m_abandoned = true;
+  }
+  m_opening.reset();
+  m_pendingSeek = -1;
+  m_skipBytes = 0;
+
   m_pcmBuffer.Destroy();
 
   if ( m_codec )
@@ -57,6 +226,20 @@ void CAudioDecoder::Destroy()
   m_canPlay = false;
 }
 
+ICodec* CAudioDecoder::OpenCodec(const CStdString &path, const CStdString &mimeType, unsigned int filecache)
+{
+  ICodec *codec = CodecFactory::CreateCodecDemux(path, mimeType, filecache);
+
+  if (!codec || !codec->Init(path, filecache))
+  {
+    CLog::Log(LOGERROR, "CAudioDecoder: Unable to Init Codec while loading file %s", path.c_str());
+    delete codec;
+    return NULL;
+  }
+
+  return codec;
+}
+
 bool CAudioDecoder::Create(const CFileItem &file, int64_t seekOffset)
 {
   Destroy();
@@ -75,12 +258,18 @@ bool CAudioDecoder::Create(const CFileItem &file, int64_t seekOffset)
   else if ( file.IsOnLAN() )
     filecache = g_guiSettings.GetInt("cacheaudio.lan");
 
-  // create our codec
-  m_codec=CodecFactory::CreateCodecDemux(file.GetPath(), file.GetMimeType(), filecache * 1024);
+  // if we played this recently we can start from the cached head while the codec opens
+  if (CPCMCache::Get().IsEnabled())
+  {
+    CPCMSegmentPtr segment = CPCMCache::Get().Find(file.GetPath(), seekOffset);
+    if (segment && CreateFromCache(file, segment, filecache))
+      return true;
+  }
 
-  if (!m_codec || !m_codec->Init(file.GetPath(), filecache * 1024))
+  // create our codec
+  m_codec = OpenCodec(file.GetPath(), file.GetMimeType(), filecache * 1024);
+  if (!m_codec)
   {
-    CLog::Log(LOGERROR, "CAudioDecoder: Unable to Init Codec while loading file %s", file.GetPath().c_str());
     Destroy();
     return false;
   }
@@ -93,8 +282,13 @@ bool CAudioDecoder::Create(const CFileItem &file, int64_t seekOffset)
     return false;
   }
 
-  /* allocate the pcmBuffer for 2 seconds of audio */
-  m_pcmBuffer.Create(2 * blockSize * m_codec->m_SampleRate);
+  /* allocate the pcmBuffer, 2 seconds, which grows to the pre-decode window only while queued */
+  m_baseSize = 2 * blockSize * m_codec->m_SampleRate;
+  m_predecodeSize = std::max<unsigned int>(m_baseSize, std::min<uint64_t>((uint64_t)g_advancedSettings.m_audioPreDecodeSeconds * blockSize * m_codec->m_SampleRate, PREDECODE_MAX_BYTES));
+  m_pcmBuffer.Create(m_baseSize);
+
+  /* the stream is queued once 2 seconds are decoded, the rest fills while waiting to play */
+  m_queueSize = (unsigned int)(m_baseSize * 0.9);
 
   // set total time from the given tag
   if (file.HasMusicInfoTag() && file.GetMusicInfoTag()->GetDuration())
@@ -103,28 +297,181 @@ bool CAudioDecoder::Create(const CFileItem &file, int64_t seekOffset)
   if (seekOffset)
     m_codec->Seek(seekOffset);
 
+  SetFormat(m_codec);
+
+  // capture the head of the stream so a skip back to it is instant
+  if (CPCMCache::Get().IsEnabled() && m_codec->CanSeek())
+  {
+    m_head.reset(new CPCMSegment());
+    m_head->m_path        = file.GetPath();
+    m_head->m_startOffset = seekOffset;
+    m_headLimit           = m_predecodeSize;
+  }
+
   m_status = STATUS_QUEUING;
 
   return true;
 }
 
+bool CAudioDecoder::CreateFromCache(const CFileItem &file, const CPCMSegmentPtr &segment, unsigned int filecache)
+{
+  unsigned int blockSize = (segment->m_bitsPerSample >> 3) * segment->m_channelInfo.Count();
+  if (blockSize == 0 || segment->m_sampleRate == 0)
+    return false;
+
+  m_channelInfo       = segment->m_channelInfo;
+  m_sampleRate        = segment->m_sampleRate;
+  m_encodedSampleRate = segment->m_encodedSampleRate;
+  m_dataFormat        = segment->m_dataFormat;
+  m_bitsPerSample     = segment->m_bitsPerSample;
+  m_totalTime         = segment->m_totalTime;
+  m_canSeek           = segment->m_canSeek;
+  m_bitrate           = segment->m_bitrate;
+  m_codecName         = segment->m_codecName;
+  m_replayGain        = segment->m_replayGain;
+
+  m_baseSize = 2 * blockSize * m_sampleRate;
+  m_predecodeSize = std::max<unsigned int>(m_baseSize, std::min<uint64_t>((uint64_t)g_advancedSettings.m_audioPreDecodeSeconds * blockSize * m_sampleRate, PREDECODE_MAX_BYTES));
+  m_pcmBuffer.Create(std::max<unsigned int>(m_baseSize, segment->m_data.size()));
+  m_pcmBuffer.WriteData(&segment->m_data[0], segment->m_data.size());
+
+  int64_t totalTime = 0;
+  if (file.HasMusicInfoTag() && file.GetMusicInfoTag()->GetDuration())
+    totalTime = file.GetMusicInfoTag()->GetDuration();
+
+  /* open the codec in the background and have it continue where the cached audio ends */
+  m_spliceTime = segment->m_startOffset + segment->GetDuration();
+  m_opening.reset(new CCodecOpenState());
+  CJobManager::GetInstance().AddJob(new CCodecOpenJob(m_opening, file.GetPath(), file.GetMimeType(), filecache * 1024,
+                                                      totalTime, m_spliceTime),
+                                    NULL, CJob::PRIORITY_HIGH);
+
+  CLog::Log(LOGINFO, "CAudioDecoder: Starting %s from %" PRId64 "ms of cached audio", file.GetPath().c_str(), segment->GetDuration());
+  m_status = STATUS_QUEUED;
+
+  return true;
+}
+
+bool CAudioDecoder::AdoptCodec()
+{
+  if (m_codec)
+    return true;
+  if (!m_opening)
+    return false;
+
+  ICodec *codec;
+  int64_t position;
+  {
+    CSingleLock stateLock(m_opening->m_section);
+    if (!m_opening->m_done)
+      return false;
+    codec = m_opening->m_codec;
+    position = m_opening->m_position;
+    m_opening->m_codec = NULL;
+  }
+  m_opening.reset();
+
+  if (codec && m_pendingSeek < 0 && position < 0)
+  {
+    CLog::Log(LOGERROR, "CAudioDecoder: Unable to seek to where the cached audio ends");
+    delete codec;
+    codec = NULL;
+  }
+
+  if (codec && ((unsigned int)codec->m_SampleRate != m_sampleRate ||
+                (unsigned int)codec->m_BitsPerSample != m_bitsPerSample ||
+                codec->GetChannelInfo().Count() != m_channelInfo.Count()))
+  {
+    CLog::Log(LOGERROR, "CAudioDecoder: Stream format no longer matches the cached audio");
+    delete codec;
+    codec = NULL;
+  }
+
+  if (!codec)
+  {
+    /* play out what we have */
+    CLog::Log(LOGERROR, "CAudioDecoder: Unable to open the codec, ending after the cached audio");
+    m_eof = true;
+    if (m_status < STATUS_ENDING)
+      m_status = STATUS_ENDING;
+    return false;
+  }
+
+  m_codec = codec;
+  if (m_pendingSeek > -1)
+  {
+    m_codec->Seek(m_pendingSeek);
+    m_pendingSeek = -1;
+  }
+  else if (position < m_spliceTime)
+  {
+    /* the codec resumes before the end of the cached audio, drop what was played already */
+    unsigned int blockSize = (m_bitsPerSample >> 3) * m_channelInfo.Count();
+    m_skipBytes = (unsigned int)((m_spliceTime - position) * m_sampleRate / 1000) * blockSize;
+  }
+  else if (position > m_spliceTime)
+    CLog::Log(LOGWARNING, "CAudioDecoder: The codec resumes %" PRId64 "ms after the end of the cached audio", position - m_spliceTime);
+
+  return true;
+}
+
+void CAudioDecoder::SetFormat(ICodec *codec)
+{
+  m_channelInfo       = codec->GetChannelInfo();
+  m_sampleRate        = codec->m_SampleRate;
+  m_encodedSampleRate = codec->m_EncodedSampleRate;
+  m_dataFormat        = codec->m_DataFormat;
+  m_bitsPerSample     = codec->m_BitsPerSample;
+  m_totalTime         = codec->m_TotalTime;
+  m_canSeek           = codec->CanSeek();
+  m_bitrate           = codec->m_Bitrate;
+  m_codecName         = codec->m_CodecName;
+  m_replayGain        = codec->m_replayGain;
+}
+
+void CAudioDecoder::CaptureHead(const char *data, unsigned int size)
+{
+  size_t captured = m_head->m_data.size();
+  if (captured >= m_headLimit)
+    return;
+
+  size = std::min<unsigned int>(size, m_headLimit - captured);
+  m_head->m_data.insert(m_head->m_data.end(), data, data + size);
+}
+
 void CAudioDecoder::GetDataFormat(CAEChannelInfo *channelInfo, unsigned int *samplerate, unsigned int *encodedSampleRate, enum AEDataFormat *dataFormat)
 {
-  if (!m_codec)
+  if (m_status == STATUS_NO_FILE)
     return;
 
-  if (channelInfo      ) *channelInfo       = m_codec->GetChannelInfo();
-  if (samplerate       ) *samplerate        = m_codec->m_SampleRate;
-  if (encodedSampleRate) *encodedSampleRate = m_codec->m_EncodedSampleRate;
-  if (dataFormat       ) *dataFormat        = m_codec->m_DataFormat;
+  if (channelInfo      ) *channelInfo       = m_channelInfo;
+  if (samplerate       ) *samplerate        = m_sampleRate;
+  if (encodedSampleRate) *encodedSampleRate = m_encodedSampleRate;
+  if (dataFormat       ) *dataFormat        = m_dataFormat;
 }
 
 int64_t CAudioDecoder::Seek(int64_t time)
 {
+  CSingleLock lock(m_critSection);
   m_pcmBuffer.Clear();
-  if (!m_codec)
-    return 0;
+
+  m_skipBytes = 0;
+
+  /* the head is only contiguous up to here */
+  if (m_head)
+    m_headLimit = m_head->m_data.size();
+
   if (time < 0) time = 0;
+  if (!m_codec)
+  {
+    if (!m_opening)
+      return 0;
+
+    /* the codec is still being opened, seek once it is ready */
+    if (time > m_totalTime) time = m_totalTime;
+    m_pendingSeek = time;
+    return time;
+  }
   if (time > m_codec->m_TotalTime) time = m_codec->m_TotalTime;
   return m_codec->Seek(time);
 }
@@ -133,22 +480,30 @@ int64_t CAudioDecoder::TotalTime()
 {
   if (m_codec)
     return m_codec->m_TotalTime;
-  return 0;
+  return m_totalTime;
+}
+
+void CAudioDecoder::SetStatus(int status)
+{
+  CSingleLock lock(m_critSection);
+  m_status = status;
 }
 
 unsigned int CAudioDecoder::GetDataSize()
 {
+  CSingleLock lock(m_critSection);
   if (m_status == STATUS_QUEUING || m_status == STATUS_NO_FILE)
     return 0;
   // check for end of file and end of buffer
   if (m_status == STATUS_ENDING && m_pcmBuffer.getMaxReadSize() < PACKET_SIZE)
     m_status = STATUS_ENDED;
-  return std::min(m_pcmBuffer.getMaxReadSize() / (m_codec->m_BitsPerSample >> 3), (unsigned int)OUTPUT_SAMPLES);
+  return std::min(m_pcmBuffer.getMaxReadSize() / (m_bitsPerSample >> 3), (unsigned int)OUTPUT_SAMPLES);
 }
 
 void *CAudioDecoder::GetData(unsigned int samples)
 {
-  unsigned int size  = samples * (m_codec->m_BitsPerSample >> 3);
+  CSingleLock lock(m_critSection);
+  unsigned int size  = samples * (m_bitsPerSample >> 3);
   if (size > sizeof(m_outputBuffer))
   {
     CLog::Log(LOGERROR, "CAudioDecoder::GetData - More data was requested then we have space to buffer!");
@@ -175,6 +530,9 @@ void *CAudioDecoder::GetData(unsigned int samples)
 
 int CAudioDecoder::ReadSamples(int numsamples)
 {
+  // grab a lock to ensure the codec is created at this point, the pre-decode job reads too
+  CSingleLock lock(m_critSection);
+
   if (m_status == STATUS_NO_FILE || m_status == STATUS_ENDING || m_status == STATUS_ENDED)
     return RET_SLEEP;             // nothing loaded yet
 
@@ -182,25 +540,42 @@ int CAudioDecoder::ReadSamples(int numsamples)
   if (m_status == STATUS_QUEUED && m_canPlay)
     m_status = STATUS_PLAYING;
 
-  // grab a lock to ensure the codec is created at this point.
-  CSingleLock lock(m_critSection);
+  // a stream started from the pcm cache plays the cached audio until its codec is ready
+  if (!m_codec && !AdoptCodec())
+    return RET_SLEEP;
+
+  // give back what was decoded ahead once playing has drained it
+  if (m_status == STATUS_PLAYING && m_pcmBuffer.getSize() > m_baseSize && m_pcmBuffer.getMaxReadSize() <= m_baseSize / 2)
+    ResizeBuffer(m_baseSize);
 
   // Read in more data
-  int maxsize = std::min<int>(INPUT_SAMPLES, m_pcmBuffer.getMaxWriteSize() / (m_codec->m_BitsPerSample >> 3));
+  int maxsize = std::min<int>(INPUT_SAMPLES, m_pcmBuffer.getMaxWriteSize() / (m_bitsPerSample >> 3));
   numsamples = std::min<int>(numsamples, maxsize);
-  numsamples -= (numsamples % m_codec->GetChannelInfo().Count());  // make sure it's divisible by our number of channels
+  numsamples -= (numsamples % m_channelInfo.Count());  // make sure it's divisible by our number of channels
   if ( numsamples )
   {
     int readSize = 0;
-    int result = m_codec->ReadPCM(m_pcmInputBuffer, numsamples * (m_codec->m_BitsPerSample >> 3), &readSize);
+    int result = m_codec->ReadPCM(m_pcmInputBuffer, numsamples * (m_bitsPerSample >> 3), &readSize);
 
-    if (result != READ_ERROR && readSize)
+    // drop what overlaps the cached audio the stream was started from
+    unsigned int skip = 0;
+    if (result != READ_ERROR && m_skipBytes)
+    {
+      skip = std::min<unsigned int>(m_skipBytes, readSize);
+      m_skipBytes -= skip;
+      readSize -= skip;
+    }
+
+    if (result != READ_ERROR && (readSize || skip))
     {
       // move it into our buffer
-      m_pcmBuffer.WriteData((char *)m_pcmInputBuffer, readSize);
+      if (readSize)
+        m_pcmBuffer.WriteData((char *)m_pcmInputBuffer + skip, readSize);
+      if (m_head && readSize)
+        CaptureHead((char *)m_pcmInputBuffer + skip, readSize);
 
       // update status
-      if (m_status == STATUS_QUEUING && m_pcmBuffer.getMaxReadSize() > m_pcmBuffer.getSize() * 0.9)
+      if (m_status == STATUS_QUEUING && m_pcmBuffer.getMaxReadSize() > m_queueSize)
       {
         CLog::Log(LOGINFO, "AudioDecoder: File is queued");
         m_status = STATUS_QUEUED;
@@ -233,6 +608,59 @@ int CAudioDecoder::ReadSamples(int numsamples)
   return RET_SLEEP; // nothing to do
 }
 
+void CAudioDecoder::PreDecode()
+{
+  if (m_canPlay || (m_status != STATUS_QUEUING && m_status != STATUS_QUEUED))
+    return;
+
+  /* nothing to do until there is room for another read */
+  if (m_pcmBuffer.getMaxWriteSize() < INPUT_SAMPLES * (m_bitsPerSample >> 3) && m_pcmBuffer.getSize() >= m_predecodeSize)
+    return;
+
+  if (!m_preDecode)
+    m_preDecode.reset(new CPreDecodeState(this));
+  else if (m_preDecode->m_running)
+    return;
+
+  m_preDecode->m_running = true;
+  if (!CJobManager::GetInstance().AddJob(new CPreDecodeJob(m_preDecode), NULL))
+    m_preDecode->m_running = false;
+}
+
+bool CAudioDecoder::PreDecodeStep()
+{
+  CSingleLock lock(m_critSection);
+
+  /* the player thread reads the stream once it has started */
+  if (m_canPlay || (m_status != STATUS_QUEUING && m_status != STATUS_QUEUED))
+    return false;
+
+  /* only a waiting stream gets the larger buffer */
+  if (m_pcmBuffer.getMaxWriteSize() < INPUT_SAMPLES * (m_bitsPerSample >> 3) && m_pcmBuffer.getSize() < m_predecodeSize)
+    ResizeBuffer(m_predecodeSize);
+
+  return ReadSamples(PACKET_SIZE) == RET_SUCCESS;
+}
+
+void CAudioDecoder::ResizeBuffer(unsigned int size)
+{
+  unsigned int used = m_pcmBuffer.getMaxReadSize();
+  if (size < used)
+    return;
+
+  std::vector<char> data(used);
+  if (used)
+    m_pcmBuffer.ReadData(&data[0], used);
+  m_pcmBuffer.Destroy();
+  if (!m_pcmBuffer.Create(size))
+  {
+    CLog::Log(LOGERROR, "CAudioDecoder: Unable to allocate %u bytes of pcm buffer", size);
+    m_pcmBuffer.Create(used ? used : m_baseSize);
+  }
+  if (used)
+    m_pcmBuffer.WriteData(&data[0], used);
+}
+
 float CAudioDecoder::GetReplayGain()
 {
 #define REPLAY_GAIN_DEFAULT_LEVEL 89.0f
@@ -244,28 +672,28 @@ float CAudioDecoder::GetReplayGain()
   float peak = 0.0f;
   if (g_guiSettings.m_replayGain.iType == REPLAY_GAIN_ALBUM)
   {
-    if (m_codec->m_replayGain.iHasGainInfo & REPLAY_GAIN_HAS_ALBUM_INFO)
+    if (m_replayGain.iHasGainInfo & REPLAY_GAIN_HAS_ALBUM_INFO)
     {
-      replaydB = (float)g_guiSettings.m_replayGain.iPreAmp + (float)m_codec->m_replayGain.iAlbumGain * 0.01f;
-      peak = m_codec->m_replayGain.fAlbumPeak;
+      replaydB = (float)g_guiSettings.m_replayGain.iPreAmp + (float)m_replayGain.iAlbumGain * 0.01f;
+      peak = m_replayGain.fAlbumPeak;
     }
-    else if (m_codec->m_replayGain.iHasGainInfo & REPLAY_GAIN_HAS_TRACK_INFO)
+    else if (m_replayGain.iHasGainInfo & REPLAY_GAIN_HAS_TRACK_INFO)
     {
-      replaydB = (float)g_guiSettings.m_replayGain.iPreAmp + (float)m_codec->m_replayGain.iTrackGain * 0.01f;
-      peak = m_codec->m_replayGain.fTrackPeak;
+      replaydB = (float)g_guiSettings.m_replayGain.iPreAmp + (float)m_replayGain.iTrackGain * 0.01f;
+      peak = m_replayGain.fTrackPeak;
     }
   }
   else if (g_guiSettings.m_replayGain.iType == REPLAY_GAIN_TRACK)
   {
-    if (m_codec->m_replayGain.iHasGainInfo & REPLAY_GAIN_HAS_TRACK_INFO)
+    if (m_replayGain.iHasGainInfo & REPLAY_GAIN_HAS_TRACK_INFO)
     {
-      replaydB = (float)g_guiSettings.m_replayGain.iPreAmp + (float)m_codec->m_replayGain.iTrackGain * 0.01f;
-      peak = m_codec->m_replayGain.fTrackPeak;
+      replaydB = (float)g_guiSettings.m_replayGain.iPreAmp + (float)m_replayGain.iTrackGain * 0.01f;
+      peak = m_replayGain.fTrackPeak;
     }
-    else if (m_codec->m_replayGain.iHasGainInfo & REPLAY_GAIN_HAS_ALBUM_INFO)
+    else if (m_replayGain.iHasGainInfo & REPLAY_GAIN_HAS_ALBUM_INFO)
     {
-      replaydB = (float)g_guiSettings.m_replayGain.iPreAmp + (float)m_codec->m_replayGain.iAlbumGain * 0.01f;
-      peak = m_codec->m_replayGain.fAlbumPeak;
+      replaydB = (float)g_guiSettings.m_replayGain.iPreAmp + (float)m_replayGain.iAlbumGain * 0.01f;
+      peak = m_replayGain.fAlbumPeak;
     }
   }
   // convert to a gain type
@@ -23,16 +23,21 @@
 
 #include "threads/Thread.h"
 #include "ICodec.h"
+#include "PCMCache.h"
 #include "threads/CriticalSection.h"
 #include "utils/RingBuffer.h"
 #include "cores/AudioEngine/Utils/AEChannelInfo.h"
 
 class CFileItem;
+class CCodecOpenState;
+class CPreDecodeState;
 
 #define PACKET_SIZE 3840    // audio packet size - we keep 1 in reserve for gapless playback
                             // using a multiple of 1, 2, 3, 4, 5, 6 to guarantee track alignment
                             // note that 7 or higher channels won't work too well.
 
+#define PREDECODE_MAX_BYTES (6 * 1024 * 1024) // most a queued stream decodes ahead, whatever its format
+
 #define INPUT_SIZE PACKET_SIZE * 3      // input data size we read from the codecs at a time
                                         // * 3 to allow 24 bit audio
 
@@ -62,22 +67,37 @@ public:
 
   int ReadSamples(int numsamples);
 
-  bool CanSeek() { if (m_codec) return m_codec->CanSeek(); else return false; };
+  bool CanSeek() { if (m_codec) return m_codec->CanSeek(); else return m_canSeek; };
   int64_t Seek(int64_t time);
   int64_t TotalTime();
   void Start() { m_canPlay = true;}; // cause a pre-buffered stream to start.
+  void PreDecode(); // keep filling a queued stream on a worker thread until it starts.
   int GetStatus() { return m_status; };
-  void SetStatus(int status) { m_status = status; };
+  void SetStatus(int status);
 
   void GetDataFormat(CAEChannelInfo *channelInfo, unsigned int *samplerate, unsigned int *encodedSampleRate, enum AEDataFormat *dataFormat);
-  unsigned int GetChannels() { if (m_codec) return m_codec->GetChannelInfo().Count(); else return 0; };
+  unsigned int GetChannels() { return m_channelInfo.Count(); };
   // Data management
   unsigned int GetDataSize();
   void *GetData(unsigned int samples);
-  ICodec *GetCodec() const { return m_codec; }
+  ICodec *GetCodec() const { return m_codec; } // NULL while the codec is opened in the background
+  int GetBitrate() const { return m_codec ? m_codec->m_Bitrate : m_bitrate; }
+  CStdString GetCodecName() const { return m_codec ? m_codec->m_CodecName : m_codecName; }
   float GetReplayGain();
 
+  // creates and initializes the codec for the given file, NULL on failure
+  static ICodec* OpenCodec(const CStdString &path, const CStdString &mimeType, unsigned int filecache);
+
 private:
+  friend class CPreDecodeJob;
+
+  bool CreateFromCache(const CFileItem &file, const CPCMSegmentPtr &segment, unsigned int filecache);
+  bool AdoptCodec();
+  void SetFormat(ICodec *codec);
+  void CaptureHead(const char *data, unsigned int size);
+  bool PreDecodeStep();
+  void ResizeBuffer(unsigned int size);
+
   // pcm buffer
   CRingBuffer m_pcmBuffer;
 
@@ -92,9 +112,37 @@ private:
   bool    m_eof;
   int     m_status;
   bool    m_canPlay;
+  unsigned int m_queueSize; // bytes to decode before the stream is queued
+  unsigned int m_baseSize;  // size of the pcm buffer while playing
+  unsigned int m_predecodeSize; // size it grows to while the stream waits to play
 
   // the codec we're using
   ICodec*          m_codec;
 
+  // stream format, kept so a stream started from the pcm cache can play before its codec is open
+  CAEChannelInfo    m_channelInfo;
+  unsigned int      m_sampleRate;
+  unsigned int      m_encodedSampleRate;
+  enum AEDataFormat m_dataFormat;
+  unsigned int      m_bitsPerSample;
+  int64_t           m_totalTime;
+  bool              m_canSeek;
+  int               m_bitrate;
+  CStdString        m_codecName;
+  CReplayGain       m_replayGain;
+
+  // background codec open when started from the pcm cache
+  boost::shared_ptr<CCodecOpenState> m_opening;
+  int64_t          m_pendingSeek;   // seek requested before the codec was ready, -1 for none
+  int64_t          m_spliceTime;    // time at which the cached audio ends
+  unsigned int     m_skipBytes;     // decoded bytes overlapping the cached audio, to be dropped
+
+  // job filling a queued stream before it starts
+  boost::shared_ptr<CPreDecodeState> m_preDecode;
+
+  // head of the stream being captured for the pcm cache
+  CPCMSegmentPtr   m_head;
+  unsigned int     m_headLimit;     // max bytes to capture
+
   CCriticalSection m_critSection;
 };
@@ -35,7 +35,7 @@
 #include "cores/AudioEngine/Utils/AEUtil.h"
 #include "cores/AudioEngine/Interfaces/AEStream.h"
 
-#define TIME_TO_CACHE_NEXT_FILE 5000 /* 5 seconds before end of song, start caching the next song */
+#define TIME_TO_CACHE_NEXT_FILE 5000 /* at least 5 seconds before end of song, start caching the next song */
 #define FAST_XFADE_TIME           80 /* 80 milliseconds */
 #define MAX_SKIP_XFADE_TIME     2000 /* max 2 seconds crossfade on track skip */
 
@@ -345,9 +345,11 @@ bool PAPlayer::QueueNextFileEx(const CFileItem &file, bool fadeIn/* = true */)
   if (si->m_endOffset)
     streamTotalTime = si->m_endOffset - si->m_startOffset;
   
+  /* queue the next file early enough for it to pre-decode a full window */
+  int64_t cacheTime = std::max<int64_t>(TIME_TO_CACHE_NEXT_FILE, g_advancedSettings.m_audioPreDecodeSeconds * 1000);
   si->m_prepareNextAtFrame = 0;
-  if (streamTotalTime >= TIME_TO_CACHE_NEXT_FILE + m_defaultCrossfadeMS)
-    si->m_prepareNextAtFrame = (int)((streamTotalTime - TIME_TO_CACHE_NEXT_FILE - m_defaultCrossfadeMS) * si->m_sampleRate / 1000.0f);
+  if (streamTotalTime >= cacheTime + m_defaultCrossfadeMS)
+    si->m_prepareNextAtFrame = (int)((streamTotalTime - cacheTime - m_defaultCrossfadeMS) * si->m_sampleRate / 1000.0f);
 
   si->m_prepareTriggered = false;
 
@@ -603,7 +605,12 @@ inline bool PAPlayer::ProcessStream(StreamInfo *si, double &delay, double &buffe
   /* if we have not started yet and the stream has been primed */
   unsigned int space = si->m_stream->GetSpace();
   if (!si->m_started && !space)
+  {
+    /* keep filling the decoder so the transition survives a slow source, without
+       blocking this thread on its reads */
+    si->m_decoder.PreDecode();
     return true;
+  }
 
   /* see if it is time yet to FF/RW or a direct seek */
   if (!si->m_playNextTriggered && ((m_playbackSpeed != 1 && si->m_framesSent >= si->m_seekNextAtFrame) || si->m_seekFrame > -1))
@@ -881,8 +888,8 @@ void PAPlayer::UpdateGUIData(StreamInfo *si)
 
   const ICodec* codec = si->m_decoder.GetCodec();
 
-  m_playerGUIData.m_audioBitrate = codec ? codec->m_Bitrate : 0;
-  strncpy(m_playerGUIData.m_codec,codec ? codec->m_CodecName : "",20);
+  m_playerGUIData.m_audioBitrate = si->m_decoder.GetBitrate();
+  strncpy(m_playerGUIData.m_codec,si->m_decoder.GetCodecName().c_str(),20);
   m_playerGUIData.m_cacheLevel   = codec ? codec->GetCacheLevel() : 0;
 
   int64_t total = si->m_decoder.TotalTime();
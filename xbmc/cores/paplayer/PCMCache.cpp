@@ -0,0 +1,119 @@
+/*
+ *      Copyright (C) 2005-2012 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "system.h"
+#include "PCMCache.h"
+#include "settings/AdvancedSettings.h"
+#include "threads/SingleLock.h"
+#include "utils/log.h"
+
+CPCMSegment::CPCMSegment() :
+  m_startOffset      (0),
+  m_sampleRate       (0),
+  m_encodedSampleRate(0),
+  m_dataFormat       (AE_FMT_INVALID),
+  m_bitsPerSample    (0),
+  m_totalTime        (0),
+  m_canSeek          (false),
+  m_bitrate          (0)
+{
+}
+
+int64_t CPCMSegment::GetDuration() const
+{
+  unsigned int blockSize = (m_bitsPerSample >> 3) * m_channelInfo.Count();
+  if (!blockSize || !m_sampleRate)
+    return 0;
+
+  return (int64_t)(m_data.size() / blockSize) * 1000 / m_sampleRate;
+}
+
+CPCMCache::CPCMCache() :
+  m_size(0)
+{
+}
+
+CPCMCache& CPCMCache::Get()
+{
+  static CPCMCache cache;
+  return cache;
+}
+
+bool CPCMCache::IsEnabled() const
+{
+  return g_advancedSettings.m_audioPCMCacheSize > 0;
+}
+
+CPCMSegmentPtr CPCMCache::Find(const CStdString &path, int64_t startOffset)
+{
+  CSingleLock lock(m_section);
+  for (SegmentList::iterator itt = m_segments.begin(); itt != m_segments.end(); ++itt)
+  {
+    CPCMSegmentPtr segment = *itt;
+    if (segment->m_startOffset == startOffset && segment->m_path.Equals(path))
+    {
+      /* move it to the front so it is the last to be evicted */
+      m_segments.erase(itt);
+      m_segments.push_front(segment);
+      return segment;
+    }
+  }
+
+  return CPCMSegmentPtr();
+}
+
+void CPCMCache::Add(const CPCMSegmentPtr &segment)
+{
+  if (!segment || segment->m_data.empty())
+    return;
+
+  size_t limit = (size_t)g_advancedSettings.m_audioPCMCacheSize * 1024 * 1024;
+  if (segment->m_data.size() > limit)
+    return;
+
+  CSingleLock lock(m_section);
+  for (SegmentList::iterator itt = m_segments.begin(); itt != m_segments.end(); ++itt)
+  {
+    if ((*itt)->m_startOffset == segment->m_startOffset && (*itt)->m_path.Equals(segment->m_path))
+    {
+      m_size -= (*itt)->m_data.size();
+      m_segments.erase(itt);
+      break;
+    }
+  }
+
+  Trim(limit - segment->m_data.size());
+
+  m_segments.push_front(segment);
+  m_size += segment->m_data.size();
+
+  CLog::Log(LOGDEBUG, "CPCMCache::Add - Cached %" PRId64 "ms of %s (%u segments, %u bytes)",
+            segment->GetDuration(), segment->m_path.c_str(), (unsigned int)m_segments.size(), (unsigned int)m_size);
+}
+
+void CPCMCache::Trim(size_t limit)
+{
+  while (!m_segments.empty() && m_size > limit)
+  {
+    m_size -= m_segments.back()->m_data.size();
+    m_segments.pop_back();
+  }
+}
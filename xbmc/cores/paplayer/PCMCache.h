@@ -0,0 +1,86 @@
+#pragma once
+
+/*
+ *      Copyright (C) 2005-2012 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <list>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+
+#include "ReplayGain.h"
+#include "threads/CriticalSection.h"
+#include "utils/StdString.h"
+#include "cores/AudioEngine/AEAudioFormat.h"
+#include "cores/AudioEngine/Utils/AEChannelInfo.h"
+
+/* the decoded head of a stream along with everything needed to start playing
+ * it back before the codec has been opened again */
+class CPCMSegment
+{
+public:
+  CPCMSegment();
+
+  /* duration of the decoded data in ms */
+  int64_t GetDuration() const;
+
+  CStdString        m_path;              /* the file the segment was decoded from */
+  int64_t           m_startOffset;       /* the offset in ms decoding started at */
+  CAEChannelInfo    m_channelInfo;       /* channel layout information */
+  unsigned int      m_sampleRate;        /* sample rate of the stream */
+  unsigned int      m_encodedSampleRate; /* the encoded sample rate of raw streams */
+  enum AEDataFormat m_dataFormat;        /* data format of the samples */
+  unsigned int      m_bitsPerSample;     /* bits per sample as reported by the codec */
+  int64_t           m_totalTime;         /* total time of the stream in ms */
+  bool              m_canSeek;           /* if the codec could seek */
+  int               m_bitrate;           /* codec bitrate for the GUI */
+  CStdString        m_codecName;         /* codec name for the GUI */
+  CReplayGain       m_replayGain;        /* replaygain info of the stream */
+  std::vector<char> m_data;              /* the decoded pcm data */
+};
+
+typedef boost::shared_ptr<CPCMSegment> CPCMSegmentPtr;
+
+/* bounded, most recently used cache of decoded stream heads, used to make
+ * restarting a recently played item instant */
+class CPCMCache
+{
+public:
+  static CPCMCache& Get();
+
+  /* returns true if caching is enabled */
+  bool IsEnabled() const;
+
+  /* find the segment decoded from path at startOffset, NULL if none */
+  CPCMSegmentPtr Find(const CStdString &path, int64_t startOffset);
+
+  /* store a segment, replacing any previous one for the same path and offset */
+  void Add(const CPCMSegmentPtr &segment);
+
+private:
+  CPCMCache();
+  void Trim(size_t limit);
+
+  typedef std::list<CPCMSegmentPtr> SegmentList;
+
+  CCriticalSection m_section;
+  SegmentList      m_segments; /* most recently used first */
+  size_t           m_size;     /* bytes of pcm data held */
+};
@@ -0,0 +1,419 @@
+/*
+ *      Copyright (C) 2005-2012 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+/*
+ * papbench - decodes a corpus of audio files through the paplayer codecs as
+ * fast as possible and reports, per codec, the realtime factor, the peak
+ * resident memory while decoding and the number of heap allocations.
+ *
+ *   papbench [--baseline=<file>] [--update-baseline] [--tolerance=<percent>] <file or folder>...
+ *
+ * With --baseline the results are compared against a previous run and the
+ * exit code is 1 if any codec regressed by more than the tolerance (10% by
+ * default). With --update-baseline the results are written to the file instead.
+ */
+
+#include "system.h"
+#include "cores/paplayer/CodecFactory.h"
+#include "cores/paplayer/ICodec.h"
+#include "filesystem/Directory.h"
+#include "filesystem/SpecialProtocol.h"
+#include "settings/AdvancedSettings.h"
+#include "settings/Settings.h"
+#include "threads/Atomics.h"
+#include "utils/log.h"
+#include "utils/TimeUtils.h"
+#include "utils/URIUtils.h"
+#include "FileItem.h"
+#include "Util.h"
+#include "XbmcContext.h"
+
+#include <map>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+#define BENCH_BUFFER_SAMPLES 3840   /* same request size PAPlayer uses */
+#define BENCH_MAX_EMPTY_READS 1000  /* give up on codecs that stop returning data without EOF */
+
+/* count heap allocations by interposing the allocator, this also sees the
+ * allocations of the codec libraries we dlopen */
+static volatile long g_allocations = 0;
+
+#if defined(TARGET_LINUX) && defined(__GLIBC__)
+#define HAS_ALLOCATION_COUNT
+
+extern "C"
+{
+  void *__libc_malloc (size_t size);
+  void *__libc_calloc (size_t nmemb, size_t size);
+  void *__libc_realloc(void *ptr, size_t size);
+
+  void *malloc(size_t size)
+  {
+    AtomicIncrement(&g_allocations);
+    return __libc_malloc(size);
+  }
+
+  void *calloc(size_t nmemb, size_t size)
+  {
+    AtomicIncrement(&g_allocations);
+    return __libc_calloc(nmemb, size);
+  }
+
+  void *realloc(void *ptr, size_t size)
+  {
+    AtomicIncrement(&g_allocations);
+    return __libc_realloc(ptr, size);
+  }
+}
+#endif
+
+struct BenchResult
+{
+  BenchResult() : files(0), failed(0), audioTime(0.0), decodeTime(0.0), peakMemory(0), allocations(0) {}
+
+  double Realtime() const { return decodeTime > 0.0 ? audioTime / decodeTime : 0.0; }
+
+  unsigned int files;       /* files decoded */
+  unsigned int failed;      /* files that failed to open or decode */
+  double       audioTime;   /* seconds of audio decoded */
+  double       decodeTime;  /* seconds spent decoding */
+  long         peakMemory;  /* peak resident memory in KB while decoding a file */
+  long         allocations; /* heap allocations while decoding, -1 if unknown */
+};
+
+typedef std::map<CStdString, BenchResult> BenchResults;
+
+static void ResetPeakMemory()
+{
+#if defined(TARGET_LINUX)
+  /* writing 5 resets the peak resident set size (VmHWM) */
+  FILE *f = fopen("/proc/self/clear_refs", "w");
+  if (f)
+  {
+    fputs("5", f);
+    fclose(f);
+  }
+#endif
+}
+
+static long GetPeakMemory()
+{
+#if defined(TARGET_LINUX)
+  FILE *f = fopen("/proc/self/status", "r");
+  if (f)
+  {
+    char line[256];
+    long peak = -1;
+    while (fgets(line, sizeof(line), f))
+      if (sscanf(line, "VmHWM: %ld", &peak) == 1)
+        break;
+    fclose(f);
+    if (peak >= 0)
+      return peak;
+  }
+#endif
+
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return -1;
+#if defined(TARGET_DARWIN)
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+}
+
+static void CollectFiles(const CStdString &path, std::vector<CStdString> &files)
+{
+  if (!XFILE::CDirectory::Exists(path))
+  {
+    files.push_back(path);
+    return;
+  }
+
+  CFileItemList items;
+  if (!XFILE::CDirectory::GetDirectory(path, items, g_settings.m_musicExtensions, XFILE::DIR_FLAG_NO_FILE_DIRS))
+  {
+    fprintf(stderr, "Unable to read %s\n", path.c_str());
+    return;
+  }
+
+  items.Sort(SORT_METHOD_FILE, SortOrderAscending);
+  for (int i = 0; i < items.Size(); i++)
+  {
+    CFileItemPtr item = items[i];
+    if (item->m_bIsFolder)
+      CollectFiles(item->GetPath(), files);
+    else if (!item->IsPlayList() && !item->IsCUESheet())
+      files.push_back(item->GetPath());
+  }
+}
+
+static void DecodeFile(const CStdString &path, BenchResults &results)
+{
+  CStdString extension = URIUtils::GetExtension(path);
+  extension.ToLower();
+
+  ICodec *codec = CodecFactory::CreateCodecDemux(path, "", 0);
+  if (!codec || !codec->Init(path, 0))
+  {
+    fprintf(stderr, "%s: unable to open\n", path.c_str());
+    results[extension].failed++;
+    delete codec;
+    return;
+  }
+
+  /* group the results by codec, falling back to the extension for codecs without a name */
+  CStdString name = codec->m_CodecName.IsEmpty() ? extension : codec->m_CodecName;
+  BenchResult &result = results[name];
+
+  unsigned int channels   = codec->GetChannelInfo().Count();
+  unsigned int blockSize  = (codec->m_BitsPerSample >> 3) * channels;
+  unsigned int sampleRate = codec->m_SampleRate;
+  if (!blockSize || !sampleRate)
+  {
+    fprintf(stderr, "%s: codec provided invalid parameters (%d-bit, %u channels)\n", path.c_str(), codec->m_BitsPerSample, channels);
+    result.failed++;
+    delete codec;
+    return;
+  }
+
+  int size = (BENCH_BUFFER_SAMPLES - BENCH_BUFFER_SAMPLES % channels) * (codec->m_BitsPerSample >> 3);
+  std::vector<BYTE> buffer(size);
+
+  ResetPeakMemory();
+  long    allocations = g_allocations;
+  int64_t bytes       = 0;
+  int     emptyReads  = 0;
+  bool    failed      = false;
+  int64_t start       = CurrentHostCounter();
+
+  for (;;)
+  {
+    int actual = 0;
+    int ret    = codec->ReadPCM(&buffer[0], size, &actual);
+    bytes += actual;
+
+    if (ret == READ_EOF)
+      break;
+    if (ret == READ_ERROR || (!actual && ++emptyReads > BENCH_MAX_EMPTY_READS))
+    {
+      failed = true;
+      break;
+    }
+    if (actual)
+      emptyReads = 0;
+  }
+
+  double decodeTime = (double)(CurrentHostCounter() - start) / (double)CurrentHostFrequency();
+  allocations       = g_allocations - allocations;
+  long peak         = GetPeakMemory();
+
+  delete codec;
+
+  if (failed)
+  {
+    fprintf(stderr, "%s: decoding failed after %" PRId64 " bytes\n", path.c_str(), bytes);
+    result.failed++;
+    return;
+  }
+
+  result.files++;
+  result.audioTime  += (double)(bytes / blockSize) / (double)sampleRate;
+  result.decodeTime += decodeTime;
+  result.peakMemory  = std::max(result.peakMemory, peak);
+#ifdef HAS_ALLOCATION_COUNT
+  result.allocations += allocations;
+#else
+  result.allocations = -1;
+#endif
+}
+
+static bool LoadBaseline(const CStdString &file, BenchResults &baseline)
+{
+  FILE *f = fopen(file.c_str(), "r");
+  if (!f)
+    return false;
+
+  char line[512];
+  while (fgets(line, sizeof(line), f))
+  {
+    if (line[0] == '#' || line[0] == '\n')
+      continue;
+
+    BenchResult result;
+    double realtime;
+    char   name[256];
+    if (sscanf(line, "%lf %ld %ld %255[^\n]", &realtime, &result.peakMemory, &result.allocations, name) != 4)
+      continue;
+
+    /* only the ratio is stored, so keep it as one second of decode time */
+    result.files      = 1;
+    result.audioTime  = realtime;
+    result.decodeTime = 1.0;
+    baseline[name]    = result;
+  }
+
+  fclose(f);
+  return true;
+}
+
+static bool SaveBaseline(const CStdString &file, const BenchResults &results)
+{
+  FILE *f = fopen(file.c_str(), "w");
+  if (!f)
+    return false;
+
+  fprintf(f, "# papbench baseline: <realtime factor> <peak memory KB> <allocations> <codec>\n");
+  for (BenchResults::const_iterator it = results.begin(); it != results.end(); ++it)
+  {
+    if (it->second.files)
+      fprintf(f, "%.2f %ld %ld %s\n", it->second.Realtime(), it->second.peakMemory, it->second.allocations, it->first.c_str());
+  }
+
+  fclose(f);
+  return true;
+}
+
+/* returns the number of regressed codecs */
+static int CompareBaseline(const BenchResults &results, const BenchResults &baseline, double tolerance)
+{
+  int regressions = 0;
+  for (BenchResults::const_iterator it = baseline.begin(); it != baseline.end(); ++it)
+  {
+    BenchResults::const_iterator current = results.find(it->first);
+    if (current == results.end() || !current->second.files)
+    {
+      printf("%-16s not in this run, skipped\n", it->first.c_str());
+      continue;
+    }
+
+    const BenchResult &now  = current->second;
+    const BenchResult &then = it->second;
+    CStdString reasons;
+
+    if (now.Realtime() < then.Realtime() * (1.0 - tolerance))
+      reasons.AppendFormat(" realtime %.2fx -> %.2fx", then.Realtime(), now.Realtime());
+    if (then.peakMemory > 0 && now.peakMemory > then.peakMemory * (1.0 + tolerance))
+      reasons.AppendFormat(" peak %ldKB -> %ldKB", then.peakMemory, now.peakMemory);
+    if (then.allocations >= 0 && now.allocations >= 0 && now.allocations > then.allocations * (1.0 + tolerance) + 16)
+      reasons.AppendFormat(" allocations %ld -> %ld", then.allocations, now.allocations);
+
+    if (!reasons.IsEmpty())
+    {
+      printf("%-16s REGRESSION%s\n", it->first.c_str(), reasons.c_str());
+      regressions++;
+    }
+  }
+
+  return regressions;
+}
+
+static void PrintUsage()
+{
+  fprintf(stderr, "Usage: papbench [--baseline=<file>] [--update-baseline] [--tolerance=<percent>] <file or folder>...\n");
+}
+
+int main(int argc, char* argv[])
+{
+  XBMC::Context context;
+
+  CStdString baselineFile;
+  bool       updateBaseline = false;
+  double     tolerance      = 0.10;
+  std::vector<CStdString> paths;
+
+  for (int i = 1; i < argc; i++)
+  {
+    CStdString arg = argv[i];
+    if (arg.Left(11) == "--baseline=")
+      baselineFile = arg.Mid(11);
+    else if (arg == "--update-baseline")
+      updateBaseline = true;
+    else if (arg.Left(12) == "--tolerance=")
+      tolerance = atof(arg.Mid(12).c_str()) / 100.0;
+    else if (arg.length() != 0 && arg[0] != '-')
+      paths.push_back(arg);
+    else
+    {
+      PrintUsage();
+      return 2;
+    }
+  }
+
+  if (paths.empty() || (updateBaseline && baselineFile.IsEmpty()))
+  {
+    PrintUsage();
+    return 2;
+  }
+
+  setlocale(LC_NUMERIC, "C");
+  g_advancedSettings.Initialize();
+  CLog::SetLogLevel(LOG_LEVEL_NONE);
+
+  /* the codecs load their libraries from special://xbmcbin */
+  CStdString xbmcBinPath, xbmcPath;
+  CUtil::GetHomePath(xbmcBinPath, "XBMC_BIN_HOME");
+  CUtil::GetHomePath(xbmcPath);
+  CSpecialProtocol::SetXBMCBinPath(xbmcBinPath);
+  CSpecialProtocol::SetXBMCPath(xbmcPath);
+  CSpecialProtocol::SetTempPath(P_tmpdir);
+
+  std::vector<CStdString> files;
+  for (std::vector<CStdString>::iterator it = paths.begin(); it != paths.end(); ++it)
+    CollectFiles(*it, files);
+
+  BenchResults results;
+  for (std::vector<CStdString>::iterator it = files.begin(); it != files.end(); ++it)
+    DecodeFile(*it, results);
+
+  printf("%-16s %6s %6s %10s %10s %10s %12s\n", "codec", "files", "failed", "audio (s)", "realtime", "peak (KB)", "allocations");
+  for (BenchResults::iterator it = results.begin(); it != results.end(); ++it)
+  {
+    const BenchResult &r = it->second;
+    printf("%-16s %6u %6u %10.1f %9.1fx %10ld %12ld\n", it->first.c_str(), r.files, r.failed, r.audioTime, r.Realtime(), r.peakMemory, r.allocations);
+  }
+
+  if (baselineFile.IsEmpty())
+    return 0;
+
+  if (updateBaseline)
+  {
+    if (!SaveBaseline(baselineFile, results))
+    {
+      fprintf(stderr, "Unable to write baseline %s\n", baselineFile.c_str());
+      return 2;
+    }
+    return 0;
+  }
+
+  BenchResults baseline;
+  if (!LoadBaseline(baselineFile, baseline))
+  {
+    fprintf(stderr, "Unable to read baseline %s\n", baselineFile.c_str());
+    return 2;
+  }
+
+  return CompareBaseline(results, baseline, tolerance) ? 1 : 0;
+}
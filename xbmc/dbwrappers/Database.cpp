@@ -19,6 +19,8 @@
  *
  */
 
+#include <map>
+
 #include "Database.h"
 #include "settings/Settings.h"
 #include "settings/AdvancedSettings.h"
@@ -27,7 +29,10 @@
 #include "filesystem/File.h"
 #include "utils/AutoPtrHandle.h"
 #include "utils/log.h"
+#include "utils/StringUtils.h"
 #include "utils/URIUtils.h"
+#include "threads/SingleLock.h"
+#include "utils/JobManager.h"
 #include "sqlitedataset.h"
 #include "DatabaseManager.h"
 
@@ -39,12 +44,24 @@ using namespace AUTOPTR;
 using namespace dbiplus;
 
 #define MAX_COMPRESS_COUNT 20
+#define MAX_IDLE_CONNECTIONS 4 // per database
+#define MAX_QUERY_BATCH_SIZE 262144
+#define MIN_SEARCH_INDEX_LENGTH 2
+
+// connections of closed CDatabase instances, kept open for the next instance opening the same database
+static CCriticalSection s_idleSection;
+static std::multimap<std::string, Database*> s_idleConnections;
+
+// write counters of the databases, by base name
+static CCriticalSection s_revisionSection;
+static std::map<std::string, long> s_revisions;
 
 CDatabase::CDatabase(void)
 {
   m_openCount = 0;
   m_sqlite = true;
-  m_bMultiWrite = false;
+  m_batch = false;
+  m_batchDepth = 0;
 }
 
 CDatabase::~CDatabase(void)
@@ -74,6 +91,104 @@ uint32_t CDatabase::ComputeCRC(const CStdString &text)
   return crc;
 }
 
+void CDatabase::MaterializeView(const CStdString &table, const CStdString &view, const CStdString &key)
+{
+  CLog::Log(LOGINFO, "create %s", table.c_str());
+  m_pDS->exec("DROP TABLE IF EXISTS " + table);
+  m_pDS->exec("CREATE TABLE " + table + " AS SELECT * FROM " + view);
+  m_pDS->exec("CREATE UNIQUE INDEX ix_" + table + "_1 ON " + table + " (" + key + ")");
+}
+
+CStdString CDatabase::RefreshRowsSQL(const CStdString &table, const CStdString &view, const CStdString &where)
+{
+  return "DELETE FROM " + table + " WHERE " + where + "; " +
+         "INSERT INTO " + table + " SELECT * FROM " + view + " WHERE " + where + "; ";
+}
+
+void CDatabase::CreateTrigger(const CStdString &name, const CStdString &event, const CStdString &body)
+{
+  m_pDS->exec("DROP TRIGGER IF EXISTS " + name);
+
+  CStdString trigger = event, statements = body;
+  int on = event.Find(" ON ");
+  if (!m_sqlite && event.Left(10).Equals("UPDATE OF ") && on > 10)
+  {
+    // mysql has no UPDATE OF, so the body checks whether one of the columns changed instead
+    CStdStringArray columns;
+    StringUtils::SplitString(event.Mid(10, on - 10), ",", columns);
+    CStdString changed;
+    for (unsigned int i = 0; i < columns.size(); i++)
+    {
+      columns[i].Trim();
+      changed += (changed.IsEmpty() ? "NOT (new." : " OR NOT (new.") + columns[i] + " <=> old." + columns[i] + ")";
+    }
+    trigger = "UPDATE" + event.Mid(on);
+    statements = "IF " + changed + " THEN " + body + "END IF; ";
+  }
+
+  m_pDS->exec("CREATE TRIGGER " + name + " AFTER " + trigger + " FOR EACH ROW BEGIN " + statements + "END");
+}
+
+bool CDatabase::CreateSearchIndex(const CStdString &table, const CStdString &columns)
+{
+  if (!m_sqlite)
+    return false;
+
+  CLog::Log(LOGINFO, "create %s", table.c_str());
+  m_pDS->exec("DROP TABLE IF EXISTS " + table);
+  try
+  {
+    // prefix indexes keep search-as-you-type fast for the first few letters typed
+    m_pDS->exec("CREATE VIRTUAL TABLE " + table + " USING fts4(" + columns + ", prefix=\"2,3\")");
+  }
+  catch (...)
+  {
+    CLog::Log(LOGWARNING, "%s - full-text search isn't available, %s not created", __FUNCTION__, table.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool CDatabase::HasSearchIndex(const CStdString &table)
+{
+  if (!m_sqlite)
+    return false;
+  return !GetSingleValue("sqlite_master", "name", PrepareSQL("type='table' AND name='%s'", table.c_str())).IsEmpty();
+}
+
+CStdString CDatabase::SearchIndexSQL(const CStdString &table, const CStdString &search, const CStdString &weights, int limit, const CStdString &column /* = "" */)
+{
+  // single letters match too much of the library to rank quickly, so are left to the LIKE queries
+  if (search.GetLength() < MIN_SEARCH_INDEX_LENGTH)
+    return "";
+
+  // each word is matched as a prefix, dropping anything that is part of the FTS query syntax
+  CStdString match;
+  CStdString text(search);
+  text.ToLower();
+  CStdStringArray words;
+  StringUtils::SplitString(text, " ", words);
+  for (unsigned int i = 0; i < words.size(); i++)
+  {
+    CStdString word;
+    for (unsigned int j = 0; j < words[i].size(); j++)
+    {
+      unsigned char c = words[i][j];
+      if (isalnum(c) || c >= 0x80)
+        word += c;
+    }
+    if (!word.IsEmpty())
+      match += (match.IsEmpty() ? "" : " ") + (column.IsEmpty() ? "" : column + ":") + word + "*";
+  }
+  if (match.IsEmpty())
+    return "";
+
+  CStdString sql = PrepareSQL("SELECT docid, searchrank(matchinfo(%s, 'pcx'), %s) AS rank FROM %s WHERE %s MATCH '%s' ORDER BY rank DESC",
+                              table.c_str(), weights.c_str(), table.c_str(), table.c_str(), match.c_str());
+  if (limit > 0)
+    sql.AppendFormat(" LIMIT %i", limit);
+  return sql;
+}
 
 CStdString CDatabase::FormatSQL(CStdString strStmt, ...)
 {
@@ -206,41 +321,130 @@ bool CDatabase::QueueInsertQuery(const CStdString &strQuery)
   if (strQuery.IsEmpty())
     return false;
 
-  if (!m_bMultiWrite)
-  {
-    if (NULL == m_pDB.get()) return false;
-    if (NULL == m_pDS2.get()) return false;
-
-    m_bMultiWrite = true;
-    m_pDS2->insert();
-  }
-
-  m_pDS2->add_insert_sql(strQuery);
+  if (!InTransaction())
+    return ExecuteQuery(strQuery);
 
+  m_queuedQueries.push_back(strQuery);
   return true;
 }
 
 bool CDatabase::CommitInsertQueries()
 {
-  bool bReturn = false;
+  if (m_queuedQueries.empty())
+    return true;
+
+  std::vector<std::string> queries;
+  queries.swap(m_queuedQueries);
+
+  if (NULL == m_pDB.get()) return false;
+  if (NULL == m_pDS.get()) return false;
 
-  if (m_bMultiWrite)
+  try
   {
+    // send the queries as multiple statements, in batches that stay well below the packet size
+    // limit of mysql servers. Multiple statements are only allowed for these batches, so that no
+    // other query can smuggle in a statement of its own.
+    m_pDB->set_multi_statements(true);
+    std::string batch;
+    for (std::vector<std::string>::const_iterator i = queries.begin(); i != queries.end(); ++i)
+    {
+      batch += *i + ";\n";
+      if (batch.size() >= MAX_QUERY_BATCH_SIZE || i + 1 == queries.end())
+      {
+        m_pDS->exec(batch);
+        batch.clear();
+      }
+    }
+    m_pDB->set_multi_statements(false);
+    return true;
+  }
+  catch(...)
+  {
+    m_pDB->set_multi_statements(false);
+    CLog::Log(LOGERROR, "%s - failed to execute %u queries",
+        __FUNCTION__, (unsigned int)queries.size());
+  }
+
+  return false;
+}
+
+/*! \brief A connection of its own to the database of another CDatabase, for running queries off its thread.
+ */
+class CDatabaseConnection : public CDatabase
+{
+public:
+  CDatabaseConnection(const std::string &name, int version) : m_name(name), m_version(version) {};
+  virtual ~CDatabaseConnection() { Close(); };
+
+  Dataset *GetDataset() { return m_pDS.get(); };
+
+protected:
+  virtual int GetMinVersion() const { return m_version; };
+  virtual const char *GetBaseDBName() const { return m_name.c_str(); };
+
+private:
+  std::string m_name;
+  int         m_version;
+};
+
+/*! \brief Job running a query for CDatabase::QueryAsync()
+ */
+class CDatabaseQueryJob : public CJob
+{
+public:
+  CDatabaseQueryJob(const std::string &name, int version, const DatabaseSettings &settings, const std::string &query, const CDatabaseFuturePtr &future)
+    : m_name(name), m_version(version), m_settings(settings), m_query(query), m_future(future) {};
+
+  virtual const char *GetType() const { return "databasequery"; };
+
+  virtual bool DoWork()
+  {
+    CDatabaseConnection db(m_name, m_version);
     try
     {
-      m_bMultiWrite = false;
-      m_pDS2->post();
-      m_pDS2->clear_insert_sql();
-      bReturn = true;
+      if (db.Open(m_settings))
+      {
+        Dataset *ds = db.GetDataset();
+        if (ds->query(m_query.c_str()))
+        {
+          const result_set &result = ds->get_result_set();
+          m_future->m_result.record_header = result.record_header;
+          m_future->m_result.records.reserve(result.records.size());
+          for (query_data::const_iterator i = result.records.begin(); i != result.records.end(); ++i)
+            m_future->m_result.records.push_back(new sql_record(**i));
+          m_future->m_success = true;
+        }
+        ds->close();
+      }
     }
-    catch(...)
+    catch (...)
     {
-      CLog::Log(LOGERROR, "%s - failed to execute queries",
-          __FUNCTION__);
+      CLog::Log(LOGERROR, "%s - failed on query '%s'", __FUNCTION__, m_query.c_str());
     }
+    m_future->m_done.Set();
+    return m_future->m_success;
   }
 
-  return bReturn;
+private:
+  std::string        m_name;
+  int                m_version;
+  DatabaseSettings   m_settings;
+  std::string        m_query;
+  CDatabaseFuturePtr m_future;
+};
+
+CDatabaseFuturePtr CDatabase::QueryAsync(const CStdString &strQuery)
+{
+  CDatabaseFuturePtr future(new CDatabaseFuture);
+  if (!m_settings)
+  {
+    CLog::Log(LOGERROR, "%s - database is not open, unable to run query '%s'", __FUNCTION__, strQuery.c_str());
+    future->m_done.Set();
+    return future;
+  }
+
+  CJobManager::GetInstance().AddJob(new CDatabaseQueryJob(GetBaseDBName(), GetMinVersion(), *m_settings, strQuery, future), NULL, CJob::PRIORITY_HIGH);
+  return future;
 }
 
 bool CDatabase::Open()
@@ -266,7 +470,49 @@ bool CDatabase::Open(const DatabaseSettings &settings)
 
   CStdString dbName = dbSettings.name;
   dbName.AppendFormat("%d", GetMinVersion());
-  return Connect(dbName, dbSettings, false);
+
+  // reuse an idle connection to the same database if there is one, which saves opening the file
+  // and reading its schema again or a connection to the server
+  std::string key = dbSettings.type + "://" + dbSettings.user + "@" + dbSettings.host + ":" + dbSettings.port + "/" + dbName;
+  Database *connection = NULL;
+  {
+    CSingleLock lock(s_idleSection);
+    std::multimap<std::string, Database*>::iterator i = s_idleConnections.find(key);
+    if (i != s_idleConnections.end())
+    {
+      connection = i->second;
+      s_idleConnections.erase(i);
+    }
+  }
+
+  if (connection)
+  {
+    m_pDB.reset(connection);
+    m_pDS.reset(m_pDB->CreateDataset());
+    m_pDS2.reset(m_pDB->CreateDataset());
+    m_openCount = 1;
+  }
+  else if (!Connect(dbName, dbSettings, false))
+    return false;
+
+  m_connectionKey = key;
+  m_settings.reset(new DatabaseSettings(settings));
+  return true;
+}
+
+void CDatabase::CloseIdleConnections()
+{
+#ifdef HAS_MYSQL
+  CLog::Log(LOGDEBUG, "%s - mysql query latencies: %s", __FUNCTION__, MysqlDatabase::getLatencyReport().c_str());
+#endif
+
+  CSingleLock lock(s_idleSection);
+  for (std::multimap<std::string, Database*>::iterator i = s_idleConnections.begin(); i != s_idleConnections.end(); ++i)
+  {
+    i->second->disconnect();
+    delete i->second;
+  }
+  s_idleConnections.clear();
 }
 
 void CDatabase::InitSettings(DatabaseSettings &dbSettings)
@@ -399,6 +645,8 @@ bool CDatabase::Connect(const CStdString &dbName, const DatabaseSettings &dbSett
   // database name is always required
   m_pDB->setDatabase(dbName.c_str());
 
+  m_pDB->set_write_counter(GetRevisionCounter(GetBaseDBName()));
+
   // create the datasets
   m_pDS.reset(m_pDB->CreateDataset());
   m_pDS2.reset(m_pDB->CreateDataset());
@@ -429,8 +677,22 @@ bool CDatabase::Connect(const CStdString &dbName, const DatabaseSettings &dbSett
     // sqlite3 post connection operations
     if (dbSettings.type.Equals("sqlite3"))
     {
-      m_pDS->exec("PRAGMA cache_size=4096\n");
-      m_pDS->exec("PRAGMA synchronous='NORMAL'\n");
+      CStdString pragma;
+      // write-ahead logging lets readers carry on while the library is being written to
+      if (!dbSettings.journalmode.IsEmpty())
+      {
+        pragma.Format("PRAGMA journal_mode=%s\n", dbSettings.journalmode.c_str());
+        m_pDS->exec(pragma);
+      }
+      pragma.Format("PRAGMA cache_size=%i\n", dbSettings.cachesize);
+      m_pDS->exec(pragma);
+      pragma.Format("PRAGMA synchronous='%s'\n", dbSettings.synchronous.c_str());
+      m_pDS->exec(pragma);
+      if (dbSettings.mmapsize > 0)
+      {
+        pragma.Format("PRAGMA mmap_size=%" PRId64"\n", (int64_t)dbSettings.mmapsize * 1024 * 1024);
+        m_pDS->exec(pragma);
+      }
       m_pDS->exec("PRAGMA count_changes='OFF'\n");
     }
   }
@@ -508,12 +770,31 @@ void CDatabase::Close()
 
   m_openCount = 0;
 
+  std::string key = m_connectionKey;
+  m_connectionKey.clear();
+  m_settings.reset();
+  m_queuedQueries.clear();
+
   if (NULL == m_pDB.get() ) return ;
+  if (m_batch)
+    CommitBatch();
   if (NULL != m_pDS.get()) m_pDS->close();
-  m_pDB->disconnect();
-  m_pDB.reset();
   m_pDS.reset();
   m_pDS2.reset();
+
+  // keep the connection for reuse, unless it was left in a transaction
+  if (!key.empty() && !m_pDB->in_transaction())
+  {
+    CSingleLock lock(s_idleSection);
+    if (s_idleConnections.count(key) < MAX_IDLE_CONNECTIONS)
+    {
+      s_idleConnections.insert(std::make_pair(key, m_pDB.release()));
+      return;
+    }
+  }
+
+  m_pDB->disconnect();
+  m_pDB.reset();
 }
 
 bool CDatabase::Compress(bool bForce /* =true */)
@@ -559,6 +840,20 @@ void CDatabase::Interupt()
 
 void CDatabase::BeginTransaction()
 {
+  if (m_batch)
+  {
+    try
+    {
+      if (NULL != m_pDB.get())
+        m_pDB->start_savepoint(GetSavepointName(++m_batchDepth));
+    }
+    catch (...)
+    {
+      CLog::Log(LOGERROR, "database:begintransaction failed to start a savepoint");
+    }
+    return;
+  }
+
   try
   {
     if (NULL != m_pDB.get())
@@ -572,6 +867,30 @@ void CDatabase::BeginTransaction()
 
 bool CDatabase::CommitTransaction()
 {
+  if (!CommitInsertQueries())
+  {
+    RollbackTransaction();
+    return false;
+  }
+
+  if (m_batch)
+  {
+    if (m_batchDepth == 0)
+      return true;
+
+    try
+    {
+      if (NULL != m_pDB.get())
+        m_pDB->release_savepoint(GetSavepointName(m_batchDepth));
+    }
+    catch (...)
+    {
+      CLog::Log(LOGERROR, "database:committransaction failed to release a savepoint");
+    }
+    m_batchDepth--;
+    return true;
+  }
+
   try
   {
     if (NULL != m_pDB.get())
@@ -587,6 +906,30 @@ bool CDatabase::CommitTransaction()
 
 void CDatabase::RollbackTransaction()
 {
+  m_queuedQueries.clear();
+
+  if (m_batch)
+  {
+    if (m_batchDepth > 0)
+    {
+      // only the writes of this transaction are rolled back, the rest of the batch is kept
+      try
+      {
+        if (NULL != m_pDB.get())
+          m_pDB->rollback_savepoint(GetSavepointName(m_batchDepth));
+      }
+      catch (...)
+      {
+        CLog::Log(LOGERROR, "database:rollbacktransaction failed to roll back a savepoint");
+      }
+      m_batchDepth--;
+      return;
+    }
+
+    CLog::Log(LOGERROR, "database:rollbacktransaction - rolling back the entire batch");
+    m_batch = false;
+  }
+
   try
   {
     if (NULL != m_pDB.get())
@@ -600,10 +943,56 @@ void CDatabase::RollbackTransaction()
 
 bool CDatabase::InTransaction()
 {
-  if (NULL != m_pDB.get()) return false;
+  if (NULL == m_pDB.get()) return false;
   return m_pDB->in_transaction();
 }
 
+bool CDatabase::BeginBatch()
+{
+  if (m_batch)
+    return true;
+
+  if (NULL == m_pDB.get() || !m_pDB->supports_savepoints())
+    return false;
+
+  BeginTransaction();
+  m_batch = true;
+  m_batchDepth = 0;
+  return true;
+}
+
+bool CDatabase::CommitBatch()
+{
+  if (!m_batch)
+    return false;
+
+  if (m_batchDepth > 0)
+    CLog::Log(LOGWARNING, "database:commitbatch - %u transactions were left open in the batch", m_batchDepth);
+
+  m_batch = false;
+  m_batchDepth = 0;
+  return CommitTransaction();
+}
+
+unsigned int CDatabase::GetRevision(const std::string &baseDBName)
+{
+  return (unsigned int)*GetRevisionCounter(baseDBName);
+}
+
+volatile long *CDatabase::GetRevisionCounter(const std::string &baseDBName)
+{
+  // entries are never removed, so the counters stay where they are
+  CSingleLock lock(s_revisionSection);
+  return &s_revisions[baseDBName];
+}
+
+std::string CDatabase::GetSavepointName(unsigned int depth)
+{
+  CStdString name;
+  name.Format("batch%u", depth);
+  return name;
+}
+
 bool CDatabase::CreateTables()
 {
 
@@ -22,6 +22,8 @@
  */
 
 #include "utils/StdString.h"
+#include "dbwrappers/qry_dat.h"
+#include "threads/Event.h"
 
 namespace dbiplus {
   class Database;
@@ -29,9 +31,48 @@ namespace dbiplus {
 }
 
 #include <memory>
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
 
 class DatabaseSettings; // forward
 
+/*! \brief The result of a query run on a worker thread by CDatabase::QueryAsync()
+ */
+class CDatabaseFuture
+{
+public:
+  CDatabaseFuture() : m_done(true), m_success(false) {};
+
+  /*! \brief Wait for the query to complete.
+   \param timeout the time to wait, in ms.
+   \return true if the query has completed, false if it timed out.
+   */
+  bool Wait(unsigned int timeout) { return m_done.WaitMSec(timeout); };
+
+  /*! \brief Whether the query has completed, without waiting for it.
+   */
+  bool IsDone() { return m_done.WaitMSec(0); };
+
+  /*! \brief Whether the query succeeded. Only valid once it has completed.
+   */
+  bool Succeeded() const { return m_success; };
+
+  /*! \brief The rows returned by the query. Only valid once it has completed.
+   */
+  const dbiplus::result_set &GetResult() const { return m_result; };
+
+private:
+  friend class CDatabase;
+  friend class CDatabaseQueryJob;
+
+  CEvent              m_done;
+  bool                m_success;
+  dbiplus::result_set m_result;
+};
+
+typedef boost::shared_ptr<CDatabaseFuture> CDatabaseFuturePtr;
+
 class CDatabase
 {
 public:
@@ -49,6 +90,38 @@ public:
   void RollbackTransaction();
   bool InTransaction();
 
+  /*! \brief Start a batch of writes committed in a single transaction.
+   While a batch is open, BeginTransaction() and CommitTransaction() open and release a savepoint
+   within the batch rather than starting and committing their own transaction, so code that manages
+   its own transactions can be batched as is. A RollbackTransaction() only rolls back the writes made
+   since its BeginTransaction(); one without a matching BeginTransaction() rolls back and ends the
+   whole batch, which InBatch() tells.
+   Backends without savepoints (MySQL runs with autocommit) can't keep a failed transaction out of
+   the batch, so no batch is started for them and each transaction commits as usual.
+   \return true if a batch was started, false if the backend can't batch.
+   \sa CommitBatch
+   */
+  bool BeginBatch();
+
+  /*! \brief Commit all writes made since BeginBatch()
+   \return true if the batch was committed, false if it failed or was rolled back.
+   \sa BeginBatch
+   */
+  bool CommitBatch();
+
+  bool InBatch() const { return m_batch; };
+
+  /*! \brief Close the sqlite connections kept open for reuse.
+   Databases opened afterwards open a new connection.
+   */
+  static void CloseIdleConnections();
+
+  /*! \brief Revision of a database, which changes with every write made to it by this process,
+   whichever connection it is made through. Writes made by other processes aren't seen.
+   \param baseDBName the base name of the database, eg. "MyVideos".
+   */
+  static unsigned int GetRevision(const std::string &baseDBName);
+
   static CStdString FormatSQL(CStdString strStmt, ...);
   CStdString PrepareSQL(CStdString strStmt, ...) const;
 
@@ -101,7 +174,9 @@ public:
   bool OpenDS();
 
   /*!
-   * @brief Put an INSERT or REPLACE query in the queue.
+   * @brief Put an INSERT, REPLACE or DELETE query whose result isn't needed in the queue.
+   * @remarks Queued queries are sent together, in as few round trips to the server as possible, when
+   * the transaction is committed. Outside of a transaction the query is executed immediately.
    * @param strQuery The query to queue.
    * @return True if the query was added successfully, false otherwise.
    */
@@ -113,6 +188,14 @@ public:
    */
   bool CommitInsertQueries();
 
+  /*!
+   * @brief Run a SELECT query on a worker thread, using a connection of its own to the same database.
+   * @remarks The database must be open. The query has to be complete, ie. PrepareSQL'ed.
+   * @param strQuery The query to run.
+   * @return The future result of the query.
+   */
+  CDatabaseFuturePtr QueryAsync(const CStdString &strQuery);
+
 protected:
   friend class CDatabaseManager;
   bool Update(const DatabaseSettings &db);
@@ -123,6 +206,55 @@ protected:
   virtual bool Open();
   virtual bool CreateTables();
   virtual void CreateViews() {};
+
+  /*! \brief Materialize a view into a table, which is then kept up to date with triggers.
+   The table is rebuilt from the view, so this should be called whenever the view is (re)created.
+   \param table name of the table to create, eg. "movielist".
+   \param view name of the view to materialize, eg. "movieview".
+   \param key column identifying a row of the view, which is given a unique index.
+   \sa RefreshRowsSQL, CreateTrigger
+   */
+  void MaterializeView(const CStdString &table, const CStdString &view, const CStdString &key);
+
+  /*! \brief SQL replacing the rows of a materialized view that match a condition, for use in a trigger body.
+   \param table the materialized view.
+   \param view the view it was created from.
+   \param where the condition, eg. "idFile=new.idFile".
+   */
+  static CStdString RefreshRowsSQL(const CStdString &table, const CStdString &view, const CStdString &where);
+
+  /*! \brief (Re)create a trigger run after each row affected by a statement.
+   \param name name of the trigger.
+   \param event the statement and table it is run for, eg. "UPDATE ON files". Updates may be restricted
+   to some columns, eg. "UPDATE OF playCount, lastPlayed ON files", which mysql checks in the body.
+   \param body the SQL statements to run, each terminated by a semicolon.
+   */
+  void CreateTrigger(const CStdString &name, const CStdString &event, const CStdString &body);
+
+  /*! \brief (Re)create a full-text search index, an sqlite FTS4 table with one row per item.
+   The docid of each row is the id of the item it indexes. Rows are kept up to date with triggers.
+   \param table name of the index, eg. "songsearch".
+   \param columns the indexed text columns, eg. "strTitle, strArtists".
+   \return true if the index was created, false if the database doesn't support full-text search.
+   \sa SearchIndexSQL
+   */
+  bool CreateSearchIndex(const CStdString &table, const CStdString &columns);
+
+  /*! \brief Whether a full-text search index exists, ie. was created by CreateSearchIndex().
+   */
+  bool HasSearchIndex(const CStdString &table);
+
+  /*! \brief Query of a full-text search index for the items matching all words of a search as a prefix.
+   The query returns the columns "docid" and "rank", ordered by decreasing rank.
+   \param table the index to search.
+   \param search the text to search for, as typed by the user.
+   \param weights the weight of a match in each column of the index, eg. "10, 2, 1".
+   \param limit the maximum number of items returned, 0 for all of them.
+   \param column the column of the index to search, empty to search all of them.
+   \return the query, or an empty string if the search is too short or contains no words.
+   */
+  CStdString SearchIndexSQL(const CStdString &table, const CStdString &search, const CStdString &weights, int limit, const CStdString &column = "");
+
   virtual bool UpdateOldVersion(int version) { return true; };
 
   virtual int GetMinVersion() const=0;
@@ -141,7 +273,13 @@ private:
   void InitSettings(DatabaseSettings &dbSettings);
   bool Connect(const CStdString &dbName, const DatabaseSettings &db, bool create);
   bool UpdateVersionNumber();
+  static std::string GetSavepointName(unsigned int depth);
+  static volatile long *GetRevisionCounter(const std::string &baseDBName);
 
-  bool m_bMultiWrite; /*!< True if there are any queries in the queue, false otherwise */
+  std::vector<std::string> m_queuedQueries; /*!< Queries waiting to be sent in a batch */
+  bool m_batch;       /*!< True while a batch transaction is open, false otherwise */
+  unsigned int m_batchDepth; /*!< Number of transactions open within the batch, each being a savepoint */
   unsigned int m_openCount;
+  std::string m_connectionKey; /*!< Identifies the database of a connection that can be reused once closed, empty otherwise */
+  boost::shared_ptr<DatabaseSettings> m_settings; /*!< The settings the database was opened with, for QueryAsync() */
 };
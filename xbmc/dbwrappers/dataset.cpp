@@ -27,6 +27,7 @@
  **********************************************************************/
 
 #include "dataset.h"
+#include "threads/Atomics.h"
 #include "utils/log.h"
 #include <cstring>
 
@@ -48,12 +49,29 @@ Database::Database() {
   login = "";
   passwd = "";
   sequence_table = "db_sequence";
+  write_counter = NULL;
+  uncommitted_writes = false;
 }
 
 Database::~Database() {
   disconnect();		// Disconnect if connected to database
 }
 
+void Database::count_write() {
+  if (in_transaction())
+    uncommitted_writes = true;
+  if (write_counter)
+    AtomicIncrement(write_counter);
+}
+
+void Database::count_commit() {
+  // readers may have cached what they saw before the commit made the changes visible
+  if (uncommitted_writes) {
+    uncommitted_writes = false;
+    count_write();
+  }
+}
+
 int Database::connectFull(const char *newHost, const char *newPort, const char *newDb, const char *newLogin, const char *newPasswd) {
   host = newHost;
   port = newPort;
@@ -72,6 +72,8 @@ protected:
     host, port, db, login, passwd, //Login info
     sequence_table, //Sequence table for nextid
     default_charset; //Default character set
+  volatile long *write_counter; //Counter of the writes, see set_write_counter()
+  bool uncommitted_writes; //Whether the current transaction changed any rows
 
 public:
 /* constructor */
@@ -107,6 +109,12 @@ public:
   const char *getSequenceTable(void) { return sequence_table.c_str(); }
 /* Get the default character set */
   const char *getDefaultCharset(void) { return default_charset.c_str(); }
+/* Set the counter bumped by every statement that changes rows and every transaction committing such changes */
+  void set_write_counter(volatile long *counter) { write_counter = counter; }
+/* Bump the write counter, if any, after a statement changed rows */
+  void count_write();
+/* Bump the write counter again when a transaction that changed rows is committed */
+  void count_commit();
 
 /* virtual methods that must be overloaded in derived classes */
 
@@ -135,6 +143,17 @@ public:
   virtual void commit_transaction() {};
   virtual void rollback_transaction() {};
 
+/* virtual methods for savepoints, which nest within a transaction */
+
+  virtual bool supports_savepoints() const { return false; };
+  virtual void start_savepoint(const std::string &name) {};
+  virtual void release_savepoint(const std::string &name) {};
+  virtual void rollback_savepoint(const std::string &name) {};
+
+/* allow several statements, separated by semicolons, in a single exec() */
+
+  virtual void set_multi_statements(bool on) {};
+
 /* virtual methods for formatting */
 
   /*! \brief Prepare a SQL statement for execution or querying using C printf nomenclature.
@@ -19,12 +19,16 @@
  *
  */
 
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <set>
 
 #include "utils/log.h"
 #include "system.h" // for GetLastError()
+#include "threads/CriticalSection.h"
+#include "threads/SingleLock.h"
+#include "threads/SystemClock.h"
 
 #ifdef HAS_MYSQL
 #include "mysqldataset.h"
@@ -41,12 +45,20 @@ using namespace std;
 
 namespace dbiplus {
 
+// upper bounds (in ms) of the buckets of the query latency histogram, the last bucket is unbounded
+static const unsigned int latency_bounds[] = { 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000 };
+#define LATENCY_BUCKETS (sizeof(latency_bounds) / sizeof(latency_bounds[0]) + 1)
+
+static CCriticalSection latency_section;
+static unsigned int latency_counts[LATENCY_BUCKETS];
+
 //************* MysqlDatabase implementation ***************
 
 MysqlDatabase::MysqlDatabase() {
 
   active = false;
   _in_transaction = false;     // for transaction
+  _multi_statements = false;
 
   error = "Unknown database error";//S_NO_CONNECTION;
   host = "localhost";
@@ -123,6 +135,10 @@ int MysqlDatabase::connect(bool create_new) {
     // establish connection with just user credentials
     if (mysql_real_connect(conn, host.c_str(),login.c_str(),passwd.c_str(), NULL, atoi(port.c_str()),NULL,0) != NULL)
     {
+      // a reconnect in the middle of a batch of writes has to allow its multiple statements again
+      if (_multi_statements)
+        mysql_set_server_option(conn, MYSQL_OPTION_MULTI_STATEMENTS_ON);
+
       // disable mysql autocommit since we handle it
       //mysql_autocommit(conn, false);
 
@@ -292,6 +308,7 @@ int MysqlDatabase::copy(const char *backup_name) {
 int MysqlDatabase::query_with_reconnect(const char* query) {
   int attempts = 5;
   int result;
+  unsigned int start = XbmcThreads::SystemClockMillis();
 
   // try to reconnect if server is gone
   while ( ((result = mysql_real_query(conn, query, strlen(query))) != MYSQL_OK) &&
@@ -303,9 +320,43 @@ int MysqlDatabase::query_with_reconnect(const char* query) {
     connect(true);
   }
 
+  add_latency(XbmcThreads::SystemClockMillis() - start);
   return result;
 }
 
+void MysqlDatabase::add_latency(unsigned int ms) {
+  unsigned int bucket = 0;
+  while (bucket < LATENCY_BUCKETS - 1 && ms >= latency_bounds[bucket])
+    bucket++;
+
+  CSingleLock lock(latency_section);
+  latency_counts[bucket]++;
+}
+
+void MysqlDatabase::getLatencyHistogram(std::vector<unsigned int> &bounds, std::vector<unsigned int> &counts) {
+  bounds.assign(latency_bounds, latency_bounds + LATENCY_BUCKETS - 1);
+
+  CSingleLock lock(latency_section);
+  counts.assign(latency_counts, latency_counts + LATENCY_BUCKETS);
+}
+
+std::string MysqlDatabase::getLatencyReport() {
+  std::vector<unsigned int> bounds, counts;
+  getLatencyHistogram(bounds, counts);
+
+  std::string report;
+  char bucket[64];
+  for (unsigned int i = 0; i < counts.size(); i++)
+  {
+    if (i < bounds.size())
+      sprintf(bucket, "%s<%ums: %u", i ? ", " : "", bounds[i], counts[i]);
+    else
+      sprintf(bucket, ", >=%ums: %u", bounds.back(), counts[i]);
+    report += bucket;
+  }
+  return report;
+}
+
 long MysqlDatabase::nextid(const char* sname) {
   CLog::Log(LOGDEBUG,"MysqlDatabase::nextid for %s",sname);
   if (!active) return DB_UNEXPECTED_RESULT;
@@ -359,6 +410,7 @@ void MysqlDatabase::commit_transaction() {
     mysql_commit(conn);
     CLog::Log(LOGDEBUG,"Mysql commit transaction");
     _in_transaction = false;
+    count_commit();
   }
 }
 
@@ -368,9 +420,17 @@ void MysqlDatabase::rollback_transaction() {
     mysql_rollback(conn);
     CLog::Log(LOGDEBUG,"Mysql rollback transaction");
     _in_transaction = false;
+    uncommitted_writes = false;
   }
 }
 
+void MysqlDatabase::set_multi_statements(bool on) {
+  _multi_statements = on;
+  if (active && mysql_set_server_option(conn, on ? MYSQL_OPTION_MULTI_STATEMENTS_ON : MYSQL_OPTION_MULTI_STATEMENTS_OFF))
+    CLog::Log(LOGERROR, "Unable to %s multiple statements: [%d](%s)",
+              on ? "allow" : "disallow", mysql_errno(conn), mysql_error(conn));
+}
+
 bool MysqlDatabase::exists(void) {
   bool ret = false;
 
@@ -1352,10 +1412,16 @@ int MysqlDataset::exec(const string &sql) {
   // force the charset and collation to UTF-8
   if ( ci_find(qry, "CREATE TABLE") != string::npos )
   {
-    qry += " CHARACTER SET utf8 COLLATE utf8_general_ci";
+    // table options go before the select of CREATE TABLE ... AS SELECT
+    if ( (loc=ci_find(qry, " AS SELECT ")) != string::npos )
+      qry.insert(loc, " CHARACTER SET utf8 COLLATE utf8_general_ci");
+    else
+      qry += " CHARACTER SET utf8 COLLATE utf8_general_ci";
   }
-  // sqlite3 requires the BEGIN and END pragmas when creating triggers. mysql does not.
-  else if ( ci_find(qry, "CREATE TRIGGER") != string::npos )
+  // sqlite3 requires the BEGIN and END pragmas when creating triggers. mysql does not,
+  // but still needs them around a body of more than one statement.
+  else if ( ci_find(qry, "CREATE TRIGGER") != string::npos &&
+            std::count(qry.begin(), qry.end(), ';') <= 1 )
   {
     if ( (loc=ci_find(qry, "BEGIN ")) != string::npos )
     {
@@ -1370,12 +1436,29 @@ int MysqlDataset::exec(const string &sql) {
 
   CLog::Log(LOGDEBUG,"Mysql execute: %s", qry.c_str());
 
-  if (db->setErr( static_cast<MysqlDatabase *>(db)->query_with_reconnect(qry.c_str()), qry.c_str()) != MYSQL_OK)
+  int result = static_cast<MysqlDatabase *>(db)->query_with_reconnect(qry.c_str());
+  // only statements changing rows count as writes, not SET or schema changes
+  my_ulonglong changes = mysql_affected_rows(handle());
+  if (result == MYSQL_OK && changes > 0 && changes != (my_ulonglong)-1)
+    db->count_write();
+  if (db->setErr(result, qry.c_str()) != MYSQL_OK)
   {
     throw DbErrors(db->getErrorMsg());
   }
   else
   {
+    // the results of every statement of a batch have to be consumed before the next query
+    MYSQL *conn = handle();
+    int status;
+    while ((status = mysql_next_result(conn)) == 0)
+    {
+      MYSQL_RES *stmt = mysql_store_result(conn);
+      if (stmt)
+        mysql_free_result(stmt);
+    }
+    if (status > 0 && db->setErr(mysql_errno(conn), qry.c_str()) != MYSQL_OK)
+      throw DbErrors(db->getErrorMsg());
+
     // TODO: collect results and store in exec_res
     return res;
   }
@@ -23,6 +23,8 @@
 #define _MYSQLDATASET_H
 
 #include <stdio.h>
+#include <string>
+#include <vector>
 #include "dataset.h"
 #include "mysql/mysql.h"
 
@@ -37,6 +39,7 @@ protected:
 /* connect descriptor */
   MYSQL* conn;
   bool _in_transaction;
+  bool _multi_statements;
   int last_err;
 
 
@@ -78,14 +81,24 @@ public:
   virtual void commit_transaction();
   virtual void rollback_transaction();
 
+  virtual void set_multi_statements(bool on);
+
 /* virtual methods for formatting */
   virtual std::string vprepare(const char *format, va_list args);
 
   bool in_transaction() {return _in_transaction;};
   int query_with_reconnect(const char* query);
 
+/* histogram of the round trip times of the queries of all connections. counts[i] is the number of
+   queries that took less than bounds[i] ms, the last count is of those that took longer */
+  static void getLatencyHistogram(std::vector<unsigned int> &bounds, std::vector<unsigned int> &counts);
+/* the latency histogram in a form suitable for logging */
+  static std::string getLatencyReport();
+
 private:
 
+  static void add_latency(unsigned int ms);
+
   typedef struct StrAccum StrAccum;
 
   char et_getdigit(double *val, int *cnt);
@@ -79,11 +79,47 @@ int callback(void* res_ptr,int ncol, char** reslt,char** cols)
   return 0;  
 }
 
-static int busy_callback(void*, int busyCount)
+static int busy_callback(void *db, int busyCount)
 {
-	Sleep(100);
-	OutputDebugString("SQLite collision\n");
-	return 1;
+  // back off quickly for the short locks taken by readers, more slowly for writes
+  unsigned int wait = busyCount < 10 ? 10 : 100;
+  Sleep(wait);
+  ((SqliteDatabase *)db)->addBusyWait(wait);
+  return 1;
+}
+
+/* searchrank(matchinfo(table, 'pcx'), weight0, weight1, ...) ranks the rows of a full-text search.
+   Each column a word matches in adds the weight of the column, scaled by how rare the word is in that column,
+   so that eg. a match in a title ranks above matches in plots. */
+static void search_rank(sqlite3_context *context, int argc, sqlite3_value **argv)
+{
+  if (argc < 1 || sqlite3_value_bytes(argv[0]) < (int)(2 * sizeof(unsigned int)))
+  {
+    sqlite3_result_double(context, 0.0);
+    return;
+  }
+
+  const unsigned int *info = (const unsigned int *)sqlite3_value_blob(argv[0]);
+  unsigned int phrases = info[0];
+  unsigned int columns = info[1];
+  if (sqlite3_value_bytes(argv[0]) < (int)((2 + 3 * phrases * columns) * sizeof(unsigned int)))
+  {
+    sqlite3_result_double(context, 0.0);
+    return;
+  }
+
+  double rank = 0.0;
+  for (unsigned int phrase = 0; phrase < phrases; phrase++)
+  {
+    for (unsigned int column = 0; column < columns; column++)
+    {
+      const unsigned int *hits = &info[2 + 3 * (phrase * columns + column)];
+      double weight = (int)column + 1 < argc ? sqlite3_value_double(argv[column + 1]) : 1.0;
+      if (hits[0] > 0)
+        rank += weight * hits[0] / hits[1];
+    }
+  }
+  sqlite3_result_double(context, rank);
 }
 
 //************* SqliteDatabase implementation ***************
@@ -92,6 +128,8 @@ SqliteDatabase::SqliteDatabase() {
 
   active = false;	
   _in_transaction = false;		// for transaction
+  busyWaits = 0;
+  busyTime = 0;
 
   error = "Unknown database error";//S_NO_CONNECTION;
   host = "localhost";
@@ -222,7 +260,8 @@ int SqliteDatabase::connect(bool create) {
       flags |= SQLITE_OPEN_CREATE;
     if (sqlite3_open_v2(db_fullpath.c_str(), &conn, flags, NULL)==SQLITE_OK)
     {
-      sqlite3_busy_handler(conn, busy_callback, NULL);
+      sqlite3_busy_handler(conn, busy_callback, this);
+      sqlite3_create_function(conn, "searchrank", -1, SQLITE_UTF8, NULL, search_rank, NULL, NULL);
       char* err=NULL;
       if (setErr(sqlite3_exec(getHandle(),"PRAGMA empty_result_callbacks=ON",NULL,NULL,&err),"PRAGMA empty_result_callbacks=ON") != SQLITE_OK)
       {
@@ -260,10 +299,23 @@ bool SqliteDatabase::exists(void)
 
 void SqliteDatabase::disconnect(void) {
   if (active == false) return;
+  if (busyWaits)
+    CLog::Log(LOGDEBUG, "%s - waited %u times for a total of %u ms on locks held by other connections to %s",
+              __FUNCTION__, busyWaits, busyTime, db.c_str());
+  busyWaits = 0;
+  busyTime = 0;
   sqlite3_close(conn);
   active = false;
 }
 
+void SqliteDatabase::addBusyWait(unsigned int ms) {
+  busyWaits++;
+  busyTime += ms;
+  // a lock held this long usually means a scan is writing while the GUI reads
+  if (busyTime >= 1000 && (busyTime - ms) / 1000 != busyTime / 1000)
+    CLog::Log(LOGDEBUG, "%s - %u ms spent waiting on locks to %s", __FUNCTION__, busyTime, db.c_str());
+}
+
 int SqliteDatabase::create() {
   return connect(true);
 }
@@ -362,6 +414,7 @@ void SqliteDatabase::commit_transaction() {
   if (active) {
     sqlite3_exec(conn,"commit",NULL,NULL,NULL);
     _in_transaction = false;
+    count_commit();
   }
 }
 
@@ -369,9 +422,33 @@ void SqliteDatabase::rollback_transaction() {
   if (active) {
     sqlite3_exec(conn,"rollback",NULL,NULL,NULL);
     _in_transaction = false;
+    uncommitted_writes = false;
   }  
 }
 
+void SqliteDatabase::start_savepoint(const std::string &name) {
+  if (active && _in_transaction) {
+    std::string sql = "savepoint " + name;
+    sqlite3_exec(conn,sql.c_str(),NULL,NULL,NULL);
+  }
+}
+
+void SqliteDatabase::release_savepoint(const std::string &name) {
+  if (active && _in_transaction) {
+    std::string sql = "release savepoint " + name;
+    sqlite3_exec(conn,sql.c_str(),NULL,NULL,NULL);
+  }
+}
+
+void SqliteDatabase::rollback_savepoint(const std::string &name) {
+  if (active && _in_transaction) {
+    // rolling back to a savepoint leaves it open, so release it as well
+    std::string sql = "rollback to savepoint " + name;
+    sqlite3_exec(conn,sql.c_str(),NULL,NULL,NULL);
+    release_savepoint(name);
+  }
+}
+
 
 // methods for formatting
 // ---------------------------------------------
@@ -580,7 +657,12 @@ int SqliteDataset::exec(const string &sql) {
       qry = qry.substr(0, pos);
   }
 
-  if((res = db->setErr(sqlite3_exec(handle(),qry.c_str(),&callback,&exec_res,&errmsg),qry.c_str())) == SQLITE_OK)
+  // only statements changing rows count as writes, not PRAGMAs or schema changes
+  int changes = sqlite3_total_changes(handle());
+  res = db->setErr(sqlite3_exec(handle(),qry.c_str(),&callback,&exec_res,&errmsg),qry.c_str());
+  if (sqlite3_total_changes(handle()) != changes)
+    db->count_write();
+  if (res == SQLITE_OK)
     return res;
   else
     {
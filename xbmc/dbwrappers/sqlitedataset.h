@@ -45,6 +45,8 @@ protected:
   sqlite3 *conn;
   bool _in_transaction;
   int last_err;
+  unsigned int busyWaits; // number of times a lock had to be waited for
+  unsigned int busyTime;  // total time spent waiting for locks, in ms
 
 public:
 /* default constructor */
@@ -89,11 +91,19 @@ public:
   virtual void commit_transaction();
   virtual void rollback_transaction();
 
+  virtual bool supports_savepoints() const { return true; };
+  virtual void start_savepoint(const std::string &name);
+  virtual void release_savepoint(const std::string &name);
+  virtual void rollback_savepoint(const std::string &name);
+
 /* virtual methods for formatting */
   virtual std::string vprepare(const char *format, va_list args);
 
   bool in_transaction() {return _in_transaction;}; 	
 
+/* records time spent waiting for locks held by other connections, for measuring contention */
+  void addBusyWait(unsigned int ms);
+
 };
 
 
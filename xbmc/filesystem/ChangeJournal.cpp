@@ -0,0 +1,256 @@
+/*
+ *      Copyright (C) 2012 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "system.h"
+#include "ChangeJournal.h"
+#include "URL.h"
+#include "settings/AdvancedSettings.h"
+#include "threads/SingleLock.h"
+#include "threads/SystemClock.h"
+#include "utils/log.h"
+#include "utils/URIUtils.h"
+
+#ifdef TARGET_LINUX
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#define WATCH_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_ATTRIB | \
+                    IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR)
+#endif
+
+using namespace std;
+using namespace XFILE;
+
+/* whether there are any paths at or below directory */
+static bool HasPathBelow(const set<CStdString> &paths, const CStdString &directory)
+{
+  set<CStdString>::const_iterator i = paths.lower_bound(directory);
+  return i != paths.end() && URIUtils::IsInPath(*i, directory);
+}
+
+static bool HasPathBelow(const map<CStdString, unsigned int> &paths, const CStdString &directory)
+{
+  map<CStdString, unsigned int>::const_iterator i = paths.lower_bound(directory);
+  return i != paths.end() && URIUtils::IsInPath(i->first, directory);
+}
+
+CChangeJournal::CChangeJournal() : CThread("CChangeJournal")
+{
+  m_fd = -1;
+  m_sequence = 1;
+}
+
+CChangeJournal::~CChangeJournal()
+{
+  Stop();
+}
+
+CChangeJournal &CChangeJournal::Get()
+{
+  static CChangeJournal journal;
+  return journal;
+}
+
+bool CChangeJournal::IsEnabled() const
+{
+#ifdef TARGET_LINUX
+  return g_advancedSettings.m_bChangeJournal;
+#else
+  return false;
+#endif
+}
+
+bool CChangeJournal::CanWatch(const CStdString &directory) const
+{
+  // only folders on local (or locally mounted) filesystems can be watched
+  CURL url(directory);
+  return IsEnabled() && url.GetProtocol().IsEmpty();
+}
+
+void CChangeJournal::Stop()
+{
+  StopThread();
+
+  CSingleLock lock(m_section);
+#ifdef TARGET_LINUX
+  if (m_fd >= 0)
+    close(m_fd); // removes all the watches
+#endif
+  m_fd = -1;
+  m_watches.clear();
+  m_watchedPaths.clear();
+  m_dirty.clear();
+  m_complete.clear();
+  m_unwatched.clear();
+  m_lastFullScan.clear();
+}
+
+unsigned int CChangeJournal::BeginScan(const CStdString &directory)
+{
+  if (!CanWatch(directory))
+    return 0;
+
+#ifdef TARGET_LINUX
+  CSingleLock lock(m_section);
+  if (m_fd < 0)
+  {
+    m_fd = inotify_init();
+    if (m_fd < 0)
+    {
+      CLog::Log(LOGERROR, "%s - unable to initialize inotify (%s)", __FUNCTION__, strerror(errno));
+      return 0;
+    }
+    Create();
+  }
+
+  if (m_watchedPaths.find(directory) == m_watchedPaths.end())
+  {
+    int wd = inotify_add_watch(m_fd, directory.c_str(), WATCH_MASK);
+    if (wd < 0)
+    {
+      CLog::Log(LOGDEBUG, "%s - unable to watch %s (%s)", __FUNCTION__, directory.c_str(), strerror(errno));
+      m_unwatched.insert(directory);
+      return 0;
+    }
+    m_unwatched.erase(directory);
+    m_watches[wd] = directory;
+    m_watchedPaths[directory] = wd;
+  }
+  m_complete.erase(directory); // until EndScan() says otherwise
+  return m_sequence;
+#else
+  return 0;
+#endif
+}
+
+void CChangeJournal::EndScan(const CStdString &directory, unsigned int token)
+{
+  if (!token)
+    return;
+
+  CSingleLock lock(m_section);
+  if (m_watchedPaths.find(directory) == m_watchedPaths.end())
+    return; // removed while we were scanning
+
+  // changes seen before the scan started have now been picked up
+  map<CStdString, unsigned int>::iterator i = m_dirty.lower_bound(directory);
+  while (i != m_dirty.end() && URIUtils::IsInPath(i->first, directory))
+  {
+    if (i->second <= token)
+      m_dirty.erase(i++);
+    else
+      ++i;
+  }
+  m_complete.insert(directory);
+}
+
+bool CChangeJournal::IsUnchanged(const CStdString &directory)
+{
+  if (!IsEnabled())
+    return false;
+
+  CSingleLock lock(m_section);
+  if (m_fd < 0 || m_complete.find(directory) == m_complete.end())
+    return false;
+
+  return !HasPathBelow(m_dirty, directory) && !HasPathBelow(m_unwatched, directory);
+}
+
+bool CChangeJournal::IsFullScanDue(const string &library)
+{
+  CSingleLock lock(m_section);
+  map<string, unsigned int>::const_iterator i = m_lastFullScan.find(library);
+  if (i == m_lastFullScan.end())
+    return true;
+
+  return XbmcThreads::SystemClockMillis() - i->second >= (unsigned int)g_advancedSettings.m_iChangeJournalFullScanHours * 3600000;
+}
+
+void CChangeJournal::SetFullScanDone(const string &library)
+{
+  CSingleLock lock(m_section);
+  m_lastFullScan[library] = XbmcThreads::SystemClockMillis();
+}
+
+void CChangeJournal::MarkDirty(const CStdString &directory)
+{
+  m_dirty[directory] = ++m_sequence;
+}
+
+void CChangeJournal::RemoveWatch(int wd)
+{
+  map<int, CStdString>::iterator i = m_watches.find(wd);
+  if (i == m_watches.end())
+    return;
+
+  m_complete.erase(i->second);
+  m_watchedPaths.erase(i->second);
+  m_watches.erase(i);
+}
+
+void CChangeJournal::Process()
+{
+#ifdef TARGET_LINUX
+  char buffer[16384] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+
+  while (!m_bStop)
+  {
+    struct pollfd pfd;
+    pfd.fd = m_fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, 500) <= 0 || !(pfd.revents & POLLIN))
+      continue;
+
+    ssize_t len = read(m_fd, buffer, sizeof(buffer));
+    if (len <= 0)
+      continue;
+
+    CSingleLock lock(m_section);
+    for (char *ptr = buffer; ptr < buffer + len; ptr += sizeof(struct inotify_event) + ((struct inotify_event *)ptr)->len)
+    {
+      const struct inotify_event *event = (const struct inotify_event *)ptr;
+      if (event->mask & IN_Q_OVERFLOW)
+      { // changes were lost, so nothing can be trusted until scanned again
+        CLog::Log(LOGWARNING, "%s - event queue overflowed, all folders will be rescanned", __FUNCTION__);
+        m_complete.clear();
+        continue;
+      }
+
+      map<int, CStdString>::const_iterator i = m_watches.find(event->wd);
+      if (i == m_watches.end())
+        continue;
+
+      if (event->mask & IN_IGNORED)
+        RemoveWatch(event->wd); // the folder was deleted or unmounted
+      else if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF))
+      {
+        MarkDirty(URIUtils::GetParentPath(i->second));
+        RemoveWatch(event->wd);
+      }
+      else
+        MarkDirty(i->second);
+    }
+  }
+#endif
+}
@@ -0,0 +1,109 @@
+#pragma once
+/*
+ *      Copyright (C) 2012 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <map>
+#include <set>
+#include <string>
+
+#include "threads/CriticalSection.h"
+#include "threads/Thread.h"
+#include "utils/StdString.h"
+
+namespace XFILE
+{
+  /*! \brief Journal of changes to the local folders of the library.
+
+   Folders are watched (using inotify on Linux) as the library scanners visit them, and any change
+   within a watched folder marks it dirty. A folder that was completely scanned, and in which nothing
+   has changed since, can be skipped by the scanners without listing or hashing it.
+
+   Only changes made through this machine are seen, so network shares mounted locally can be changed
+   behind our back by other clients. A full hash check is therefore still made periodically, as set by
+   the <changejournal><fullscanhours> advanced setting.
+
+   The journal is kept in memory only, as nothing is watched while XBMC isn't running. The first update
+   of each library after startup is always a full one.
+   */
+  class CChangeJournal : CThread
+  {
+  public:
+    static CChangeJournal &Get();
+
+    /*! \brief Whether the journal is enabled and supported on this platform.
+     */
+    bool IsEnabled() const;
+
+    /*! \brief Whether a folder can be watched, ie. the journal is enabled and the folder is on a local filesystem.
+     */
+    bool CanWatch(const CStdString &directory) const;
+
+    /*! \brief Stop watching folders and forget all changes.
+     */
+    void Stop();
+
+    /*! \brief Start watching a folder the scanner is about to scan.
+     \param directory the folder to watch.
+     \return a token to pass to EndScan() once the folder and its subfolders have been scanned, 0 if the folder can't be watched.
+     */
+    unsigned int BeginScan(const CStdString &directory);
+
+    /*! \brief Mark a folder and everything below it as scanned.
+     Changes seen after BeginScan() was called keep the folder dirty.
+     \param directory the folder that was scanned.
+     \param token the token returned by BeginScan().
+     */
+    void EndScan(const CStdString &directory, unsigned int token);
+
+    /*! \brief Whether nothing below a folder has changed since it was last completely scanned.
+     */
+    bool IsUnchanged(const CStdString &directory);
+
+    /*! \brief Whether a library is due a full check, in which case the journal should not be used to skip folders.
+     \param library the name of the library, eg "video" or "music".
+     */
+    bool IsFullScanDue(const std::string &library);
+
+    /*! \brief Record that a library has been fully checked.
+     */
+    void SetFullScanDone(const std::string &library);
+
+  protected:
+    virtual void Process();
+
+  private:
+    CChangeJournal();
+    virtual ~CChangeJournal();
+
+    void MarkDirty(const CStdString &directory);
+    void RemoveWatch(int wd);
+
+    CCriticalSection m_section;
+    int m_fd;
+    unsigned int m_sequence;                            ///< incremented for every change seen
+    std::map<int, CStdString> m_watches;                ///< folders being watched, by watch descriptor
+    std::map<CStdString, int> m_watchedPaths;           ///< watch descriptors, by folder
+    std::map<CStdString, unsigned int> m_dirty;         ///< folders that changed, with the sequence of the last change
+    std::set<CStdString> m_complete;                    ///< folders that were completely scanned
+    std::set<CStdString> m_unwatched;                   ///< folders that could not be watched
+    std::map<std::string, unsigned int> m_lastFullScan; ///< time of the last full check of each library
+  };
+}
@@ -24,12 +24,14 @@
 #include "SmartPlaylistDirectory.h"
 #include "utils/log.h"
 #include "playlists/SmartPlayList.h"
+#include "playlists/SmartPlaylistCache.h"
 #include "music/MusicDatabase.h"
 #include "video/VideoDatabase.h"
 #include "Directory.h"
 #include "File.h"
 #include "FileItem.h"
 #include "settings/GUISettings.h"
+#include "settings/Settings.h"
 #include "utils/URIUtils.h"
 
 namespace XFILE
@@ -63,6 +65,16 @@ namespace XFILE
     if (g_guiSettings.GetBool("filelists.ignorethewhensorting"))
       sorting.sortAttributes = SortAttributeIgnoreArticle;
 
+    // random playlists are expected to list different items every time
+    CStdString cacheKey;
+    unsigned int revision = CSmartPlaylistCache::GetRevision();
+    if (sorting.sortBy != SortByRandom)
+    {
+      cacheKey.Format("%s|%d|%s", playlist.GetSignature().c_str(), (int)sorting.sortAttributes, g_settings.GetProfileUserDataFolder().c_str());
+      if (CSmartPlaylistCache::Get().GetItems(cacheKey, items))
+        return true;
+    }
+
     if (playlist.GetType().Equals("movies") ||
         playlist.GetType().Equals("tvshows") ||
         playlist.GetType().Equals("episodes"))
@@ -169,11 +181,14 @@ namespace XFILE
     }
 
     if (playlist.GetType().Equals("mixed"))
-      return success || success2;
+      success = success || success2;
     else if (playlist.GetType().Equals("musicvideos"))
-      return success2;
-    else
-      return success;
+      success = success2;
+
+    if (success && !cacheKey.IsEmpty())
+      CSmartPlaylistCache::Get().SetItems(cacheKey, playlist, items, revision);
+
+    return success;
   }
 
   bool CSmartPlaylistDirectory::ContainsFiles(const CStdString& strPath)
@@ -182,15 +197,18 @@ namespace XFILE
     return true;
   }
 
+  CStdString CSmartPlaylistDirectory::GetPlaylistsPath(const CStdString& playlistType)
+  {
+    if (playlistType == "songs" || playlistType == "albums")
+      return "special://musicplaylists/";
+    // all others are video
+    return "special://videoplaylists/";
+  }
+
   CStdString CSmartPlaylistDirectory::GetPlaylistByName(const CStdString& name, const CStdString& playlistType)
   {
     CFileItemList list;
-    bool filesExist = false;
-    if (playlistType == "songs" || playlistType == "albums")
-      filesExist = CDirectory::GetDirectory("special://musicplaylists/", list, ".xsp", false);
-    else // all others are video
-      filesExist = CDirectory::GetDirectory("special://videoplaylists/", list, ".xsp", false);
-    if (filesExist)
+    if (CDirectory::GetDirectory(GetPlaylistsPath(playlistType), list, ".xsp", false))
     {
       for (int i = 0; i < list.Size(); i++)
       {
@@ -40,5 +40,6 @@ namespace XFILE
     static bool GetDirectory(const CSmartPlaylist &playlist, CFileItemList& items);
 
     static CStdString GetPlaylistByName(const CStdString& name, const CStdString& playlistType);
+    static CStdString GetPlaylistsPath(const CStdString& playlistType);
   };
 }
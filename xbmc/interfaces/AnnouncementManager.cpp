@@ -20,7 +20,10 @@
  */
 
 #include "AnnouncementManager.h"
+#include "threads/Event.h"
 #include "threads/SingleLock.h"
+#include "threads/Thread.h"
+#include <deque>
 #include <stdio.h>
 #include "utils/log.h"
 #include "utils/Variant.h"
@@ -35,8 +38,128 @@
 using namespace std;
 using namespace ANNOUNCEMENT;
 
+namespace ANNOUNCEMENT
+{
+  /*!
+   \brief Passes announcements on to an announcer on a thread of its own
+   */
+  class CAnnouncementQueue : public CThread
+  {
+  public:
+    CAnnouncementQueue(IAnnouncer *listener, const std::string &name, unsigned int maxQueued)
+      : CThread(name.c_str()), m_listener(listener), m_name(name), m_maxQueued(maxQueued),
+        m_maxDepth(0), m_delivered(0), m_coalesced(0), m_dropped(0)
+    { }
+
+    IAnnouncer *GetListener() const { return m_listener; }
+
+    void Push(AnnouncementFlag flag, const char *sender, const char *message, const CVariant &data)
+    {
+      CSingleLock lock(m_section);
+      if (!m_queue.empty() && IsCoalescable(flag, message) &&
+          m_queue.back().flag == flag && m_queue.back().message == message && m_queue.back().sender == sender)
+      {
+        // only the latest state is of interest
+        m_queue.back().data = data;
+        m_coalesced++;
+      }
+      else
+      {
+        if (m_queue.size() >= m_maxQueued)
+        {
+          if (m_dropped == 0)
+            CLog::Log(LOGWARNING, "CAnnouncementManager - %s is falling behind, dropping announcements", m_name.c_str());
+          m_queue.pop_front();
+          m_dropped++;
+        }
+
+        m_queue.push_back(Announcement());
+        Announcement &announcement = m_queue.back();
+        announcement.flag = flag;
+        announcement.sender = sender;
+        announcement.message = message;
+        announcement.data = data;
+        if (m_queue.size() > m_maxDepth)
+          m_maxDepth = m_queue.size();
+      }
+      m_queued.Set();
+    }
+
+    void GetStatistics(AnnouncementQueueStatistics &statistics)
+    {
+      CSingleLock lock(m_section);
+      statistics.name      = m_name;
+      statistics.queued    = m_queue.size();
+      statistics.maxQueued = m_maxDepth;
+      statistics.delivered = m_delivered;
+      statistics.coalesced = m_coalesced;
+      statistics.dropped   = m_dropped;
+    }
+
+  protected:
+    virtual void Process()
+    {
+      while (!m_bStop)
+      {
+        Announcement announcement;
+        bool announce = false;
+        {
+          CSingleLock lock(m_section);
+          if (!m_queue.empty())
+          {
+            announce = true;
+            announcement.flag = m_queue.front().flag;
+            announcement.sender.swap(m_queue.front().sender);
+            announcement.message.swap(m_queue.front().message);
+            announcement.data.swap(m_queue.front().data);
+            m_queue.pop_front();
+          }
+        }
+
+        if (!announce)
+        {
+          AbortableWait(m_queued);
+          continue;
+        }
+
+        m_listener->Announce(announcement.flag, announcement.sender.c_str(), announcement.message.c_str(), announcement.data);
+
+        CSingleLock lock(m_section);
+        m_delivered++;
+      }
+    }
+
+  private:
+    typedef struct Announcement
+    {
+      AnnouncementFlag flag;
+      std::string sender;
+      std::string message;
+      CVariant data;
+    } Announcement;
+
+    static bool IsCoalescable(AnnouncementFlag flag, const char *message)
+    {
+      return (flag == Player && (strcmp(message, "OnSeek") == 0 || strcmp(message, "OnSpeedChanged") == 0)) ||
+             (flag == Application && strcmp(message, "OnVolumeChanged") == 0);
+    }
+
+    IAnnouncer *m_listener;
+    std::string m_name;
+    std::deque<Announcement> m_queue;
+    unsigned int m_maxQueued;
+    unsigned int m_maxDepth;
+    unsigned int m_delivered;
+    unsigned int m_coalesced;
+    unsigned int m_dropped;
+    CEvent m_queued;
+    CCriticalSection m_section;
+  };
+}
+
 CCriticalSection CAnnouncementManager::m_critSection;
 vector<IAnnouncer *> CAnnouncementManager::m_announcers;
+vector<CAnnouncementQueue *> CAnnouncementManager::m_queues;
 
 void CAnnouncementManager::AddAnnouncer(IAnnouncer *listener)
 {
@@ -47,20 +170,65 @@ void CAnnouncementManager::AddAnnouncer(IAnnouncer *listener)
   m_announcers.push_back(listener);
 }
 
-void CAnnouncementManager::RemoveAnnouncer(IAnnouncer *listener)
+void CAnnouncementManager::AddQueuedAnnouncer(IAnnouncer *listener, const std::string &name, unsigned int maxQueued /* = 256 */)
 {
   if (!listener)
     return;
 
+  CAnnouncementQueue *queue = new CAnnouncementQueue(listener, name, maxQueued);
+  queue->Create();
+
   CSingleLock lock (m_critSection);
-  for (unsigned int i = 0; i < m_announcers.size(); i++)
+  m_queues.push_back(queue);
+}
+
+void CAnnouncementManager::RemoveAnnouncer(IAnnouncer *listener)
+{
+  if (!listener)
+    return;
+
+  CAnnouncementQueue *queue = NULL;
   {
-    if (m_announcers[i] == listener)
+    CSingleLock lock (m_critSection);
+    for (unsigned int i = 0; i < m_announcers.size(); i++)
     {
-      m_announcers.erase(m_announcers.begin() + i);
-      return;
+      if (m_announcers[i] == listener)
+      {
+        m_announcers.erase(m_announcers.begin() + i);
+        return;
+      }
+    }
+
+    for (unsigned int i = 0; i < m_queues.size(); i++)
+    {
+      if (m_queues[i]->GetListener() == listener)
+      {
+        queue = m_queues[i];
+        m_queues.erase(m_queues.begin() + i);
+        break;
+      }
     }
   }
+
+  if (queue)
+  {
+    // wait outside the lock, as the announcer may be making an announcement itself
+    queue->StopThread();
+
+    AnnouncementQueueStatistics statistics;
+    queue->GetStatistics(statistics);
+    CLog::Log(LOGDEBUG, "CAnnouncementManager - %s removed, %u announcements delivered, %u coalesced, %u dropped, at most %u queued",
+              statistics.name.c_str(), statistics.delivered, statistics.coalesced, statistics.dropped, statistics.maxQueued);
+    delete queue;
+  }
+}
+
+void CAnnouncementManager::GetQueueStatistics(std::vector<AnnouncementQueueStatistics> &statistics)
+{
+  CSingleLock lock (m_critSection);
+  statistics.resize(m_queues.size());
+  for (unsigned int i = 0; i < m_queues.size(); i++)
+    m_queues[i]->GetStatistics(statistics[i]);
 }
 
 void CAnnouncementManager::Announce(AnnouncementFlag flag, const char *sender, const char *message)
@@ -73,6 +241,9 @@ void CAnnouncementManager::Announce(AnnouncementFlag flag, const char *sender, c
 {
   CLog::Log(LOGDEBUG, "CAnnouncementManager - Announcement: %s from %s", message, sender);
   CSingleLock lock (m_critSection);
+  for (unsigned int i = 0; i < m_queues.size(); i++)
+    m_queues[i]->Push(flag, sender, message, data);
+
   for (unsigned int i = 0; i < m_announcers.size(); i++)
     m_announcers[i]->Announce(flag, sender, message, data);
 }
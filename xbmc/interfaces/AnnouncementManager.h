@@ -23,21 +23,61 @@
 #include "IAnnouncer.h"
 #include "FileItem.h"
 #include "threads/CriticalSection.h"
+#include <string>
 #include <vector>
 
 namespace ANNOUNCEMENT
 {
+  class CAnnouncementQueue;
+
+  /*!
+   \brief Statistics of the queue of an announcer added with AddQueuedAnnouncer()
+   */
+  typedef struct AnnouncementQueueStatistics
+  {
+    std::string  name;
+    unsigned int queued;    ///< announcements currently waiting in the queue
+    unsigned int maxQueued; ///< most announcements ever waiting in the queue
+    unsigned int delivered; ///< announcements passed on to the announcer
+    unsigned int coalesced; ///< announcements merged into the one queued before them
+    unsigned int dropped;   ///< announcements dropped because the queue was full
+  } AnnouncementQueueStatistics;
+
   class CAnnouncementManager
   {
   public:
     static void AddAnnouncer(IAnnouncer *listener);
+
+    /*!
+     \brief Add an announcer which is called on a thread of its own rather than on the
+     thread making the announcement, for announcers which may be slow (eg. sending to clients).
+     The announcements are queued, and if the announcer falls behind the oldest ones are
+     dropped. Frequent announcements about the same state (eg. OnSeek, OnVolumeChanged)
+     replace the one queued right before them if it is about the same state.
+     \param listener the announcer to add.
+     \param name name of the announcer, used for its thread and in the log.
+     \param maxQueued the number of announcements the queue can hold.
+     */
+    static void AddQueuedAnnouncer(IAnnouncer *listener, const std::string &name, unsigned int maxQueued = 256);
+
+    /*!
+     \brief Remove an announcer. For a queued announcer the announcements still queued
+     are dropped, and this waits for the announcement being passed on, if any.
+     */
     static void RemoveAnnouncer(IAnnouncer *listener);
+
+    /*!
+     \brief Get the statistics of the queues of all queued announcers
+     */
+    static void GetQueueStatistics(std::vector<AnnouncementQueueStatistics> &statistics);
+
     static void Announce(AnnouncementFlag flag, const char *sender, const char *message);
     static void Announce(AnnouncementFlag flag, const char *sender, const char *message, CVariant &data);
     static void Announce(AnnouncementFlag flag, const char *sender, const char *message, CFileItemPtr item);
     static void Announce(AnnouncementFlag flag, const char *sender, const char *message, CFileItemPtr item, CVariant &data);
   private:
     static std::vector<IAnnouncer *> m_announcers;
+    static std::vector<CAnnouncementQueue *> m_queues;
     static CCriticalSection m_critSection;
   };
 }
@@ -256,6 +256,33 @@ JSONRPC_STATUS CAudioLibrary::GetRecentlyPlayedSongs(const CStdString &method, I
   return OK;
 }
 
+JSONRPC_STATUS CAudioLibrary::Search(const CStdString &method, ITransportLayer *transport, IClient *client, const CVariant &parameterObject, CVariant &result)
+{
+  CMusicDatabase musicdatabase;
+  if (!musicdatabase.Open())
+    return InternalError;
+
+  int start, end;
+  ParseLimits(parameterObject, start, end);
+
+  const MediaType types[] = { MediaTypeArtist, MediaTypeAlbum, MediaTypeSong };
+  const char *ids[] = { "artistid", "albumid", "songid" };
+  const char *lists[] = { "artists", "albums", "songs" };
+  for (unsigned int i = 0; i < sizeof(types) / sizeof(types[0]); i++)
+  {
+    // the best matches come first, so only those within the limits are needed
+    CFileItemList items;
+    if (!musicdatabase.SearchIndex(types[i], parameterObject["term"].asString(), items, end > 0 ? end : 1000))
+      return InternalError;
+
+    CVariant list;
+    HandleFileItemList(ids[i], false, lists[i], items, parameterObject, list);
+    result[lists[i]] = list.isMember(lists[i]) ? list[lists[i]] : CVariant(CVariant::VariantTypeArray);
+  }
+
+  return OK;
+}
+
 JSONRPC_STATUS CAudioLibrary::GetGenres(const CStdString &method, ITransportLayer *transport, IClient *client, const CVariant &parameterObject, CVariant &result)
 {
   CMusicDatabase musicdatabase;
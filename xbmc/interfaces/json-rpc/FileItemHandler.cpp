@@ -303,7 +303,13 @@ void CFileItemHandler::HandleFileItem(const char *ID, bool allowFile, const char
   if (resultname)
   {
     if (append)
-      result[resultname].append(object);
+    {
+      // swap the item into the list rather than copying it
+      CVariant &list = result[resultname];
+      list.push_back(CVariant(CVariant::VariantTypeNull));
+      if (list.isArray())
+        list[list.size() - 1].swap(object);
+    }
     else
       result[resultname] = object;
   }
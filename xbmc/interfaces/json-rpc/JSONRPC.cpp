@@ -22,19 +22,112 @@
 #include <string.h>
 
 #include "JSONRPC.h"
+#include "ResultCache.h"
 #include "ServiceDescription.h"
 #include "input/ButtonTranslator.h"
 #include "interfaces/AnnouncementManager.h"
 #include "settings/AdvancedSettings.h"
+#include "threads/Event.h"
+#include "threads/SingleLock.h"
+#include "utils/JobManager.h"
 #include "utils/log.h"
 #include "utils/Variant.h"
 
+#include <boost/shared_ptr.hpp>
+
+#define MAX_BATCH_JOBS  4
+
 using namespace ANNOUNCEMENT;
 using namespace JSONRPC;
 using namespace std;
 
 bool CJSONRPC::m_initialized = false;
 
+namespace JSONRPC
+{
+  /*!
+   \brief Read-only calls of a batch request, run by the thread
+   handling the request and by as many worker threads as are free
+   */
+  class CJSONRPCBatch
+  {
+  public:
+    CJSONRPCBatch(const std::vector<const CVariant*> &requests, ITransportLayer *transport, IClient *client)
+      : m_requests(requests), m_responses(requests.size()), m_hasResponse(requests.size(), false),
+        m_transport(transport), m_client(client), m_next(0), m_finished(0), m_done(true)
+    { }
+
+    /*!
+     \brief Run the next call which hasn't been started yet
+     \return false if all calls have already been started, true otherwise
+     */
+    bool RunNext()
+    {
+      unsigned int index;
+      {
+        CSingleLock lock(m_section);
+        if (m_next >= m_requests.size())
+          return false;
+        index = m_next++;
+      }
+
+      CVariant response;
+      bool hasResponse = CJSONRPC::HandleMethodCall(*m_requests[index], response, m_transport, m_client);
+
+      CSingleLock lock(m_section);
+      m_responses[index].swap(response);
+      m_hasResponse[index] = hasResponse;
+      if (++m_finished == m_requests.size())
+        m_done.Set();
+      return true;
+    }
+
+    /*!
+     \brief Wait for the calls started by other threads to finish
+     and move the responses of all calls to the given array
+     */
+    void Finish(CVariant &responses)
+    {
+      m_done.Wait();
+      for (unsigned int index = 0; index < m_responses.size(); index++)
+      {
+        if (!m_hasResponse[index])
+          continue;
+        responses.push_back(CVariant(CVariant::VariantTypeNull));
+        responses[responses.size() - 1].swap(m_responses[index]);
+      }
+    }
+
+  private:
+    std::vector<const CVariant*> m_requests;
+    std::vector<CVariant> m_responses;
+    std::vector<bool> m_hasResponse;
+    ITransportLayer *m_transport;
+    IClient *m_client;
+    unsigned int m_next;
+    unsigned int m_finished;
+    CEvent m_done;
+    CCriticalSection m_section;
+  };
+
+  class CJSONRPCBatchJob : public CJob
+  {
+  public:
+    CJSONRPCBatchJob(const boost::shared_ptr<CJSONRPCBatch> &batch) : m_batch(batch) { }
+
+    virtual bool DoWork()
+    {
+      while (m_batch->RunNext()) ;
+      return true;
+    }
+
+    virtual const char *GetType() const { return "jsonrpcbatch"; }
+
+  private:
+    boost::shared_ptr<CJSONRPCBatch> m_batch;
+  };
+}
+
 void CJSONRPC::Initialize()
 {
   if (m_initialized)
@@ -162,7 +255,16 @@ JSONRPC_STATUS CJSONRPC::NotifyAll(const CStdString &method, ITransportLayer *tr
 
 CStdString CJSONRPC::MethodCall(const CStdString &inputString, ITransportLayer *transport, IClient *client)
 {
-  CVariant inputroot, outputroot, result;
+  CVariant outputroot;
+  if (!MethodCall(inputString, transport, client, outputroot))
+    return "";
+
+  return CJSONVariantWriter::Write(outputroot, g_advancedSettings.m_jsonOutputCompact);
+}
+
+bool CJSONRPC::MethodCall(const CStdString &inputString, ITransportLayer *transport, IClient *client, CVariant &outputroot)
+{
+  CVariant inputroot;
   bool hasResponse = false;
 
   CLog::Log(LOGDEBUG, "JSONRPC: Incoming request: %s", inputString.c_str());
@@ -179,15 +281,8 @@ CStdString CJSONRPC::MethodCall(const CStdString &inputString, ITransportLayer *
       }
       else
       {
-        for (CVariant::const_iterator_array itr = inputroot.begin_array(); itr != inputroot.end_array(); itr++)
-        {
-          CVariant response;
-          if (HandleMethodCall(*itr, response, transport, client))
-          {
-            outputroot.append(response);
-            hasResponse = true;
-          }
-        }
+        HandleBatchCall(inputroot, outputroot, transport, client);
+        hasResponse = outputroot.size() > 0;
       }
     }
     else
@@ -200,8 +295,55 @@ CStdString CJSONRPC::MethodCall(const CStdString &inputString, ITransportLayer *
     hasResponse = true;
   }
 
-  CStdString str = hasResponse ? CJSONVariantWriter::Write(outputroot, g_advancedSettings.m_jsonOutputCompact) : "";
-  return str;
+  return hasResponse;
+}
+
+void CJSONRPC::HandleBatchCall(const CVariant& requests, CVariant& responses, ITransportLayer *transport, IClient *client)
+{
+  CVariant::const_iterator_array itr = requests.begin_array();
+  while (itr != requests.end_array())
+  {
+    // Collect the read-only calls following each other
+    std::vector<const CVariant*> readOnly;
+    for (; itr != requests.end_array(); itr++)
+    {
+      if (!IsProperJSONRPC(*itr))
+        break;
+
+      CStdString methodName = (*itr)["method"].asString();
+      if (!CJSONServiceDescription::IsReadOnly(methodName.ToLower()))
+        break;
+
+      readOnly.push_back(&(*itr));
+    }
+
+    if (readOnly.size() > 1)
+    {
+      // Run them concurrently, helping out with the calls this thread
+      // would otherwise wait for so that there is no need to wait for
+      // a free worker
+      boost::shared_ptr<CJSONRPCBatch> batch(new CJSONRPCBatch(readOnly, transport, client));
+      for (unsigned int job = 0; job < min((size_t)MAX_BATCH_JOBS, readOnly.size() - 1); job++)
+        CJobManager::GetInstance().AddJob(new CJSONRPCBatchJob(batch), NULL, CJob::PRIORITY_HIGH);
+
+      while (batch->RunNext()) ;
+      batch->Finish(responses);
+    }
+    else if (readOnly.size() == 1)
+      itr--;
+
+    // Any other call is run on its own after the calls before it
+    if (itr != requests.end_array())
+    {
+      CVariant response;
+      if (HandleMethodCall(*itr, response, transport, client))
+      {
+        responses.push_back(CVariant(CVariant::VariantTypeNull));
+        responses[responses.size() - 1].swap(response);
+      }
+      itr++;
+    }
+  }
 }
 
 bool CJSONRPC::HandleMethodCall(const CVariant& request, CVariant& response, ITransportLayer *transport, IClient *client)
@@ -222,7 +364,17 @@ bool CJSONRPC::HandleMethodCall(const CVariant& request, CVariant& response, ITr
 
     CLog::Log(LOGDEBUG, "JSONRPC: Calling %s", methodName.c_str());
     if ((errorCode = CJSONServiceDescription::CheckCall(methodName, request["params"], transport, client, isNotification, method, params)) == OK)
-      errorCode = method(methodName, transport, client, params, result);
+    {
+      if (!CResultCache::IsCacheable(methodName))
+        errorCode = method(methodName, transport, client, params, result);
+      else if (!CResultCache::Get().GetResult(methodName, params, result))
+      {
+        unsigned int revision = CResultCache::Get().GetRevision();
+        errorCode = method(methodName, transport, client, params, result);
+        if (errorCode == OK)
+          CResultCache::Get().SetResult(methodName, params, result, revision);
+      }
+    }
     else
       result = params;
   }
@@ -232,7 +384,14 @@ bool CJSONRPC::HandleMethodCall(const CVariant& request, CVariant& response, ITr
     errorCode = InvalidRequest;
   }
 
-  BuildResponse(request, errorCode, result, response);
+  if (errorCode == OK)
+  {
+    // swap the result into the response rather than copying all of it
+    BuildResponse(request, errorCode, CVariant(), response);
+    response["result"].swap(result);
+  }
+  else
+    BuildResponse(request, errorCode, result, response);
 
   return !isNotification;
 }
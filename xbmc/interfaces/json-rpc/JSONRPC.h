@@ -32,6 +32,8 @@
 
 namespace JSONRPC
 {
+  class CJSONRPCBatch;
+
   /*!
    \ingroup jsonrpc
    \brief JSON RPC handler
@@ -63,6 +65,21 @@ namespace JSONRPC
      */
     static CStdString MethodCall(const CStdString &inputString, ITransportLayer *transport, IClient *client);
 
+    /*
+     \brief Handles an incoming JSON-RPC request, leaving writing the response to the caller
+     \param inputString received JSON-RPC request
+     \param transport Transport protocol on which the request arrived
+     \param client Client which sent the request
+     \param response [out] JSON-RPC response to be sent back to the client
+     \return true if there is a response to send back, false otherwise (eg. for notifications)
+
+     Large responses can be sent while they are written, with CJSONVariantStream.
+
+     The read-only calls of a batch request are run concurrently on worker threads,
+     the other calls are run one after another, in the order they were sent.
+     */
+    static bool MethodCall(const CStdString &inputString, ITransportLayer *transport, IClient *client, CVariant &response);
+
     static JSONRPC_STATUS Introspect(const CStdString &method, ITransportLayer *transport, IClient *client, const CVariant& parameterObject, CVariant &result);
     static JSONRPC_STATUS Version(const CStdString &method, ITransportLayer *transport, IClient *client, const CVariant& parameterObject, CVariant &result);
     static JSONRPC_STATUS Permission(const CStdString &method, ITransportLayer *transport, IClient *client, const CVariant& parameterObject, CVariant &result);
@@ -72,7 +89,10 @@ namespace JSONRPC
     static JSONRPC_STATUS NotifyAll(const CStdString &method, ITransportLayer *transport, IClient *client, const CVariant& parameterObject, CVariant &result);
   
   private:
+    friend class CJSONRPCBatch;
+
     static void setup();
+    static void HandleBatchCall(const CVariant& requests, CVariant& responses, ITransportLayer *transport, IClient *client);
     static bool HandleMethodCall(const CVariant& request, CVariant& response, ITransportLayer *transport, IClient *client);
     static inline bool IsProperJSONRPC(const CVariant& inputroot);
 
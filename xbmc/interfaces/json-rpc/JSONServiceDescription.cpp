@@ -24,6 +24,7 @@
 #include "utils/log.h"
 #include "utils/StdString.h"
 #include "utils/JSONVariantParser.h"
+#include "threads/SingleLock.h"
 #include "JSONRPC.h"
 #include "PlayerOperations.h"
 #include "PlaylistOperations.h"
@@ -39,10 +40,14 @@
 using namespace std;
 using namespace JSONRPC;
 
+#define MAX_CHECKED_PARAMETERS  8 // per method
+
 std::map<std::string, CVariant> CJSONServiceDescription::m_notifications = std::map<std::string, CVariant>();
 CJSONServiceDescription::CJsonRpcMethodMap CJSONServiceDescription::m_actionMap;
 std::map<std::string, JSONSchemaTypeDefinition> CJSONServiceDescription::m_types = std::map<std::string, JSONSchemaTypeDefinition>();
 CJSONServiceDescription::IncompleteSchemaDefinitionMap CJSONServiceDescription::m_incompleteDefinitions = CJSONServiceDescription::IncompleteSchemaDefinitionMap();
+std::map<std::string, std::vector<CJSONServiceDescription::CheckedParameters> > CJSONServiceDescription::m_checkedParameters;
+CCriticalSection CJSONServiceDescription::m_checkedParametersSection;
 
 JsonRpcMethodMap CJSONServiceDescription::m_methodMaps[] = {
 // JSON-RPC
@@ -113,6 +118,7 @@ JsonRpcMethodMap CJSONServiceDescription::m_methodMaps[] = {
   { "AudioLibrary.GetRecentlyPlayedAlbums",         CAudioLibrary::GetRecentlyPlayedAlbums },
   { "AudioLibrary.GetRecentlyPlayedSongs",          CAudioLibrary::GetRecentlyPlayedSongs },
   { "AudioLibrary.GetGenres",                       CAudioLibrary::GetGenres },
+  { "AudioLibrary.Search",                          CAudioLibrary::Search },
   { "AudioLibrary.SetArtistDetails",                CAudioLibrary::SetArtistDetails },
   { "AudioLibrary.SetAlbumDetails",                 CAudioLibrary::SetAlbumDetails },
   { "AudioLibrary.SetSongDetails",                  CAudioLibrary::SetSongDetails },
@@ -136,6 +142,7 @@ JsonRpcMethodMap CJSONServiceDescription::m_methodMaps[] = {
   { "VideoLibrary.GetRecentlyAddedMovies",          CVideoLibrary::GetRecentlyAddedMovies },
   { "VideoLibrary.GetRecentlyAddedEpisodes",        CVideoLibrary::GetRecentlyAddedEpisodes },
   { "VideoLibrary.GetRecentlyAddedMusicVideos",     CVideoLibrary::GetRecentlyAddedMusicVideos },
+  { "VideoLibrary.Search",                          CVideoLibrary::Search },
   { "VideoLibrary.SetMovieDetails",                 CVideoLibrary::SetMovieDetails },
   { "VideoLibrary.SetTVShowDetails",                CVideoLibrary::SetTVShowDetails },
   { "VideoLibrary.SetEpisodeDetails",               CVideoLibrary::SetEpisodeDetails },
@@ -184,7 +191,8 @@ JsonRpcMethodMap CJSONServiceDescription::m_methodMaps[] = {
 
 // XBMC operations
   { "XBMC.GetInfoLabels",                           CXBMCOperations::GetInfoLabels },
-  { "XBMC.GetInfoBooleans",                         CXBMCOperations::GetInfoBooleans }
+  { "XBMC.GetInfoBooleans",                         CXBMCOperations::GetInfoBooleans },
+  { "XBMC.GetWebServerStatistics",                  CXBMCOperations::GetWebServerStatistics }
 };
 
 JSONSchemaTypeDefinition::JSONSchemaTypeDefinition()
@@ -1189,42 +1197,21 @@ bool JsonRpcMethod::Parse(const CVariant &value)
 }
 
 JSONRPC_STATUS JsonRpcMethod::Check(const CVariant &requestParameters, ITransportLayer *transport, IClient *client, bool notification, MethodCall &methodCall, CVariant &outputParameters) const
+{
+  JSONRPC_STATUS status = CheckAccess(transport, client, notification);
+  if (status != OK)
+    return status;
+
+  methodCall = method;
+  return CheckParameters(requestParameters, outputParameters);
+}
+
+JSONRPC_STATUS JsonRpcMethod::CheckAccess(ITransportLayer *transport, IClient *client, bool notification) const
 {
   if (transport != NULL && (transport->GetCapabilities() & transportneed) == transportneed)
   {
     if (client != NULL && (client->GetPermissionFlags() & permission) == permission && (!notification || (permission & OPERATION_PERMISSION_NOTIFICATION) == permission))
-    {
-      methodCall = method;
-
-      // Count the number of actually handled (present)
-      // parameters
-      unsigned int handled = 0;
-      CVariant errorData = CVariant(CVariant::VariantTypeObject);
-      errorData["method"] = name;
-
-      // Loop through all the parameters to check
-      for (unsigned int i = 0; i < parameters.size(); i++)
-      {
-        // Evaluate the current parameter
-        JSONRPC_STATUS status = checkParameter(requestParameters, parameters.at(i), i, outputParameters, handled, errorData);
-        if (status != OK)
-        {
-          // Return the error data object in the outputParameters reference
-          outputParameters = errorData;
-          return status;
-        }
-      }
-
-      // Check if there were unnecessary parameters
-      if (handled < requestParameters.size())
-      {
-        errorData["message"] = "Too many parameters";
-        outputParameters = errorData;
-        return InvalidParams;
-      }
-
       return OK;
-    }
     else
       return BadPermission;
   }
@@ -1232,6 +1219,38 @@ JSONRPC_STATUS JsonRpcMethod::Check(const CVariant &requestParameters, ITranspor
   return MethodNotFound;
 }
 
+JSONRPC_STATUS JsonRpcMethod::CheckParameters(const CVariant &requestParameters, CVariant &outputParameters) const
+{
+  // Count the number of actually handled (present)
+  // parameters
+  unsigned int handled = 0;
+  CVariant errorData = CVariant(CVariant::VariantTypeObject);
+  errorData["method"] = name;
+
+  // Loop through all the parameters to check
+  for (unsigned int i = 0; i < parameters.size(); i++)
+  {
+    // Evaluate the current parameter
+    JSONRPC_STATUS status = checkParameter(requestParameters, parameters.at(i), i, outputParameters, handled, errorData);
+    if (status != OK)
+    {
+      // Return the error data object in the outputParameters reference
+      outputParameters = errorData;
+      return status;
+    }
+  }
+
+  // Check if there were unnecessary parameters
+  if (handled < requestParameters.size())
+  {
+    errorData["message"] = "Too many parameters";
+    outputParameters = errorData;
+    return InvalidParams;
+  }
+
+  return OK;
+}
+
 bool JsonRpcMethod::parseParameter(const CVariant &value, JSONSchemaTypeDefinition &parameter)
 {
   parameter.name = GetString(value["name"], "");
@@ -1769,10 +1788,37 @@ JSONRPC_STATUS CJSONServiceDescription::Print(CVariant &result, ITransportLayer
 JSONRPC_STATUS CJSONServiceDescription::CheckCall(const char* const method, const CVariant &requestParameters, ITransportLayer *transport, IClient *client, bool notification, MethodCall &methodCall, CVariant &outputParameters)
 {
   CJsonRpcMethodMap::JsonRpcMethodIterator iter = m_actionMap.find(method);
-  if (iter != m_actionMap.end())
-    return iter->second.Check(requestParameters, transport, client, notification, methodCall, outputParameters);
+  if (iter == m_actionMap.end())
+    return MethodNotFound;
 
-  return MethodNotFound;
+  JSONRPC_STATUS status = iter->second.CheckAccess(transport, client, notification);
+  if (status != OK)
+    return status;
+
+  methodCall = iter->second.method;
+
+  // The outcome of the check only depends on the parameters so
+  // there is no need to check the same parameters again
+  if (getCheckedParameters(iter->first, requestParameters, outputParameters))
+    return OK;
+
+  status = iter->second.CheckParameters(requestParameters, outputParameters);
+  if (status == OK)
+    addCheckedParameters(iter->first, requestParameters, outputParameters);
+
+  return status;
+}
+
+bool CJSONServiceDescription::IsReadOnly(const std::string &method)
+{
+  CJsonRpcMethodMap::JsonRpcMethodIterator iter = m_actionMap.find(method);
+  return iter != m_actionMap.end() && iter->second.permission == ReadData;
+}
+
+void CJSONServiceDescription::ClearCheckedParameters()
+{
+  CSingleLock lock(m_checkedParametersSection);
+  m_checkedParameters.clear();
 }
 
 JSONSchemaTypeDefinition* CJSONServiceDescription::GetType(const std::string &identification)
@@ -1909,6 +1955,41 @@ void CJSONServiceDescription::getReferencedTypes(const JSONSchemaTypeDefinition
     getReferencedTypes(type.unionTypes.at(index), referencedTypes);
 }
 
+bool CJSONServiceDescription::getCheckedParameters(const std::string &method, const CVariant &requestParameters, CVariant &outputParameters)
+{
+  CSingleLock lock(m_checkedParametersSection);
+  std::map<std::string, std::vector<CheckedParameters> >::const_iterator iter = m_checkedParameters.find(method);
+  if (iter == m_checkedParameters.end())
+    return false;
+
+  for (std::vector<CheckedParameters>::const_iterator checked = iter->second.begin(); checked != iter->second.end(); checked++)
+  {
+    // CVariant doesn't consider two null values equal
+    if (checked->request.isNull() ? requestParameters.isNull() : checked->request == requestParameters)
+    {
+      outputParameters = checked->output;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void CJSONServiceDescription::addCheckedParameters(const std::string &method, const CVariant &requestParameters, const CVariant &outputParameters)
+{
+  CSingleLock lock(m_checkedParametersSection);
+  std::vector<CheckedParameters> &checked = m_checkedParameters[method];
+
+  // Forget the oldest parameters once there are enough of them
+  if (checked.size() >= MAX_CHECKED_PARAMETERS)
+    checked.erase(checked.begin());
+
+  CheckedParameters parameters;
+  parameters.request = requestParameters;
+  parameters.output = outputParameters;
+  checked.push_back(parameters);
+}
+
 CJSONServiceDescription::CJsonRpcMethodMap::CJsonRpcMethodMap()
 {
   m_actionmap = std::map<std::string, JsonRpcMethod>();
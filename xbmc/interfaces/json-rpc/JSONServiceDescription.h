@@ -25,6 +25,7 @@
 #include <limits>
 
 #include "JSONUtils.h"
+#include "threads/CriticalSection.h"
 
 namespace JSONRPC
 {
@@ -224,6 +225,16 @@ namespace JSONRPC
   
     bool Parse(const CVariant &value);
     JSONRPC_STATUS Check(const CVariant &requestParameters, ITransportLayer *transport, IClient *client, bool notification, MethodCall &methodCall, CVariant &outputParameters) const;
+    /*!
+     \brief Checks whether the method can be called over the given
+     transport by the given client
+     */
+    JSONRPC_STATUS CheckAccess(ITransportLayer *transport, IClient *client, bool notification) const;
+    /*!
+     \brief Checks the given parameters against the accepted parameters
+     and fills in the default values of the missing optional ones
+     */
+    JSONRPC_STATUS CheckParameters(const CVariant &requestParameters, CVariant &outputParameters) const;
     
     std::string missingReference;    
     
@@ -375,6 +386,19 @@ namespace JSONRPC
      */
     static JSONRPC_STATUS CheckCall(const char* method, const CVariant &requestParameters, ITransportLayer *transport, IClient *client, bool notification, MethodCall &methodCall, CVariant &outputParameters);
     
+    /*!
+     \brief Whether the given method only reads data, so that it can
+     be called concurrently with other such methods
+     \param method Name of the method (in lower case)
+     */
+    static bool IsReadOnly(const std::string &method);
+
+    /*!
+     \brief Forgets the parameters which passed the check, so that
+     the following calls are checked against the schema again
+     */
+    static void ClearCheckedParameters();
+
     static JSONSchemaTypeDefinition* GetType(const std::string &identification);
 
   private:
@@ -386,6 +410,9 @@ namespace JSONRPC
 
     static void getReferencedTypes(const JSONSchemaTypeDefinition &type, std::vector<std::string> &referencedTypes);
 
+    static bool getCheckedParameters(const std::string &method, const CVariant &requestParameters, CVariant &outputParameters);
+    static void addCheckedParameters(const std::string &method, const CVariant &requestParameters, const CVariant &outputParameters);
+
     class CJsonRpcMethodMap
     {
     public:
@@ -406,6 +433,19 @@ namespace JSONRPC
     static std::map<std::string, CVariant> m_notifications;
     static JsonRpcMethodMap m_methodMaps[];
 
+    /*!
+     \brief Parameters which passed the check and the resulting
+     output parameters, remembered for every method so that repeated
+     calls (like the polling done by remotes) skip the schema check.
+     */
+    typedef struct CheckedParameters
+    {
+      CVariant request;
+      CVariant output;
+    } CheckedParameters;
+    static std::map<std::string, std::vector<CheckedParameters> > m_checkedParameters;
+    static CCriticalSection m_checkedParametersSection;
+
     typedef enum SchemaDefinition
     {
       SchemaDefinitionType,
@@ -0,0 +1,196 @@
+/*
+ *      Copyright (C) 2012 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "system.h"
+#include "ResultCache.h"
+#include "JSONServiceDescription.h"
+#include "dbwrappers/Database.h"
+#include "interfaces/AnnouncementManager.h"
+#include "settings/AdvancedSettings.h"
+#include "settings/Settings.h"
+#include "threads/SingleLock.h"
+#include "utils/Crc32.h"
+#include "utils/JSONVariantParser.h"
+#include "utils/JSONVariantWriter.h"
+#include "utils/log.h"
+#include "utils/StdString.h"
+
+#include <time.h>
+
+#define MAX_CACHED_SIZE     (4 * 1024 * 1024)
+
+using namespace std;
+using namespace ANNOUNCEMENT;
+using namespace JSONRPC;
+
+CResultCache::CResultCache()
+  : m_size(0), m_revision(0), m_started((unsigned int)time(NULL))
+{
+  CAnnouncementManager::AddAnnouncer(this);
+}
+
+CResultCache::~CResultCache()
+{
+  CAnnouncementManager::RemoveAnnouncer(this);
+}
+
+CResultCache &CResultCache::Get()
+{
+  static CResultCache cache;
+  return cache;
+}
+
+bool CResultCache::IsCacheable(const std::string &method)
+{
+  if (method.compare(0, 16, "videolibrary.get") == 0)
+  {
+    if (g_advancedSettings.m_databaseVideo.type.Equals("mysql"))
+      return false;
+  }
+  else if (method.compare(0, 16, "audiolibrary.get") == 0)
+  {
+    if (g_advancedSettings.m_databaseMusic.type.Equals("mysql"))
+      return false;
+  }
+  else
+    return false;
+
+  return CJSONServiceDescription::IsReadOnly(method);
+}
+
+unsigned int CResultCache::GetRevision()
+{
+  // the databases count the writes that aren't announced, like play counts and bookmarks
+  unsigned int revision = CDatabase::GetRevision("MyVideos") + CDatabase::GetRevision("MyMusic");
+
+  CSingleLock lock(m_critSection);
+  return revision + m_revision;
+}
+
+bool CResultCache::GetResult(const std::string &method, const CVariant &parameters, CVariant &result)
+{
+  std::string key = GetKey(method, parameters);
+  unsigned int revision = GetRevision();
+
+  CSingleLock lock(m_critSection);
+  map<string, CachedResult>::iterator iter = m_results.find(key);
+  if (iter == m_results.end())
+    return false;
+
+  if (iter->second.revision != revision)
+  {
+    RemoveResult(key);
+    return false;
+  }
+
+  result = iter->second.result;
+  return true;
+}
+
+void CResultCache::SetResult(const std::string &method, const CVariant &parameters, const CVariant &result, unsigned int revision)
+{
+  // the libraries changed while the result was retrieved
+  if (revision != GetRevision())
+    return;
+
+  std::string key = GetKey(method, parameters);
+  size_t size = CJSONVariantWriter::Write(result, true).size();
+  if (size > MAX_CACHED_SIZE / 4)
+    return;
+
+  CSingleLock lock(m_critSection);
+  RemoveResult(key);
+  while (!m_order.empty() && m_size + size > MAX_CACHED_SIZE)
+    RemoveResult(m_order.front());
+
+  CachedResult &cached = m_results[key];
+  cached.result = result;
+  cached.revision = revision;
+  cached.size = size;
+  m_order.push_back(key);
+  m_size += size;
+}
+
+void CResultCache::RemoveResult(const std::string &key)
+{
+  map<string, CachedResult>::iterator iter = m_results.find(key);
+  if (iter == m_results.end())
+    return;
+
+  m_size -= iter->second.size;
+  m_results.erase(iter);
+  m_order.remove(key);
+}
+
+bool CResultCache::GetETag(const std::string &request, std::string &tag)
+{
+  CVariant requests = CJSONVariantParser::Parse((const unsigned char *)request.c_str(), request.size());
+  if (requests.isObject())
+  {
+    CVariant batch(CVariant::VariantTypeArray);
+    batch.push_back(requests);
+    requests.swap(batch);
+  }
+
+  if (!requests.isArray() || requests.size() == 0)
+    return false;
+
+  for (CVariant::const_iterator_array itr = requests.begin_array(); itr != requests.end_array(); itr++)
+  {
+    if (!itr->isObject() || !(*itr)["method"].isString())
+      return false;
+
+    CStdString method = (*itr)["method"].asString();
+    if (!IsCacheable(method.ToLower()))
+      return false;
+  }
+
+  Crc32 crc;
+  crc.Compute(request.c_str(), request.size());
+  crc.Compute(g_settings.GetProfileUserDataFolder());
+
+  CStdString etag;
+  etag.Format("\"%x-%x-%08x\"", m_started, GetRevision(), (uint32_t)crc);
+  tag = etag;
+  return true;
+}
+
+void CResultCache::Announce(AnnouncementFlag flag, const char *sender, const char *message, const CVariant &data)
+{
+  if (!(flag & (VideoLibrary | AudioLibrary)))
+    return;
+
+  if (strcmp(message, "OnUpdate") == 0 || strcmp(message, "OnRemove") == 0 ||
+      strcmp(message, "OnScanFinished") == 0 || strcmp(message, "OnCleanFinished") == 0)
+  {
+    CSingleLock lock(m_critSection);
+    m_revision++;
+    m_results.clear();
+    m_order.clear();
+    m_size = 0;
+  }
+}
+
+std::string CResultCache::GetKey(const std::string &method, const CVariant &parameters)
+{
+  // the parameters have been checked, so their properties are sorted and defaults filled in
+  return method + "|" + g_settings.GetProfileUserDataFolder() + "|" + CJSONVariantWriter::Write(parameters, true);
+}
@@ -0,0 +1,102 @@
+#pragma once
+/*
+ *      Copyright (C) 2012 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <list>
+#include <map>
+#include <string>
+
+#include "interfaces/IAnnouncer.h"
+#include "threads/CriticalSection.h"
+#include "utils/Variant.h"
+
+namespace JSONRPC
+{
+  /*!
+   \ingroup jsonrpc
+   \brief Cache of the results of the methods reading the video and music libraries.
+
+   Results are cached by method and by the parameters the method was called with,
+   once they have been checked (so with the defaults of missing parameters filled in).
+   Every write to the video or music database, and every library change announced by the
+   announcement manager, changes the revision of the libraries, which invalidates all
+   cached results. The oldest results are dropped once the cached results take up
+   too much memory.
+
+   The revision also tags the responses sent over HTTP, so that a client sending the
+   same request again can be told that the response hasn't changed.
+
+   Nothing is cached from MySQL databases, whose changes made by other clients
+   aren't announced.
+   */
+  class CResultCache : public ANNOUNCEMENT::IAnnouncer
+  {
+  public:
+    static CResultCache &Get();
+
+    /*!
+     \brief Whether the results of the given method can be cached
+     \param method Name of the method (in lower case)
+     */
+    static bool IsCacheable(const std::string &method);
+
+    /*!
+     \brief Current revision of the libraries, to be passed to SetResult()
+     for a result retrieved after calling this
+     */
+    unsigned int GetRevision();
+
+    bool GetResult(const std::string &method, const CVariant &parameters, CVariant &result);
+    void SetResult(const std::string &method, const CVariant &parameters, const CVariant &result, unsigned int revision);
+
+    /*!
+     \brief Get the entity tag of the response to a request
+     \param request JSON-RPC request, as received
+     \param tag [out] Entity tag of the response, quoted
+     \return true if the response only depends on the libraries, false if it can't be tagged
+     */
+    bool GetETag(const std::string &request, std::string &tag);
+
+    virtual void Announce(ANNOUNCEMENT::AnnouncementFlag flag, const char *sender, const char *message, const CVariant &data);
+
+  private:
+    CResultCache();
+    virtual ~CResultCache();
+
+    static std::string GetKey(const std::string &method, const CVariant &parameters);
+
+    void RemoveResult(const std::string &key);
+
+    typedef struct CachedResult
+    {
+      CVariant result;
+      unsigned int revision;
+      size_t size;
+    } CachedResult;
+
+    CCriticalSection m_critSection;
+    std::map<std::string, CachedResult> m_results;
+    std::list<std::string> m_order; // keys of the cached results, oldest first
+    size_t m_size;                  // serialized size of the cached results
+    unsigned int m_revision;
+    unsigned int m_started;
+  };
+}
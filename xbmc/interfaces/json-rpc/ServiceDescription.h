@@ -1640,6 +1640,30 @@ namespace JSONRPC
         "}"
       "}"
     "}",
+    "\"AudioLibrary.Search\": {"
+      "\"type\": \"method\","
+      "\"description\": \"Search the artists, albums and songs, best matches first. Each word of the term matches the start of a word of the name, or for songs of the title, artist or album\","
+      "\"transport\": \"Response\","
+      "\"permission\": \"ReadData\","
+      "\"params\": ["
+        "{ \"name\": \"term\", \"type\": \"string\", \"minLength\": 1, \"required\": true },"
+        "{ \"name\": \"limits\", \"$ref\": \"List.Limits\", \"description\": \"The limits applied to each of the lists returned\" }"
+      "],"
+      "\"returns\": {"
+        "\"type\": \"object\","
+        "\"properties\": {"
+          "\"artists\": { \"type\": \"array\", \"required\": true,"
+            "\"items\": { \"$ref\": \"Audio.Details.Artist\" }"
+          "},"
+          "\"albums\": { \"type\": \"array\", \"required\": true,"
+            "\"items\": { \"$ref\": \"Audio.Details.Album\" }"
+          "},"
+          "\"songs\": { \"type\": \"array\", \"required\": true,"
+            "\"items\": { \"$ref\": \"Audio.Details.Song\" }"
+          "}"
+        "}"
+      "}"
+    "}",
     "\"AudioLibrary.GetGenres\": {"
       "\"type\": \"method\","
       "\"description\": \"Retrieve all genres\","
@@ -2048,6 +2072,33 @@ namespace JSONRPC
         "}"
       "}"
     "}",
+    "\"VideoLibrary.Search\": {"
+      "\"type\": \"method\","
+      "\"description\": \"Search the movies, tv shows, episodes and music videos, best matches first. Each word of the term matches the start of a word of the title, plot, cast or tags\","
+      "\"transport\": \"Response\","
+      "\"permission\": \"ReadData\","
+      "\"params\": ["
+        "{ \"name\": \"term\", \"type\": \"string\", \"minLength\": 1, \"required\": true },"
+        "{ \"name\": \"limits\", \"$ref\": \"List.Limits\", \"description\": \"The limits applied to each of the lists returned\" }"
+      "],"
+      "\"returns\": {"
+        "\"type\": \"object\","
+        "\"properties\": {"
+          "\"movies\": { \"type\": \"array\", \"required\": true,"
+            "\"items\": { \"$ref\": \"Video.Details.Movie\" }"
+          "},"
+          "\"tvshows\": { \"type\": \"array\", \"required\": true,"
+            "\"items\": { \"$ref\": \"Video.Details.TVShow\" }"
+          "},"
+          "\"episodes\": { \"type\": \"array\", \"required\": true,"
+            "\"items\": { \"$ref\": \"Video.Details.Episode\" }"
+          "},"
+          "\"musicvideos\": { \"type\": \"array\", \"required\": true,"
+            "\"items\": { \"$ref\": \"Video.Details.MusicVideo\" }"
+          "}"
+        "}"
+      "}"
+    "}",
     "\"VideoLibrary.SetMovieDetails\": {"
       "\"type\": \"method\","
       "\"description\": \"Update the given movie with the given details\","
@@ -2506,6 +2557,17 @@ namespace JSONRPC
         "\"type\": \"object\","
         "\"description\": \"List of key-value pairs of the retrieved info booleans\""
       "}"
+    "}",
+    "\"XBMC.GetWebServerStatistics\": {"
+      "\"type\": \"method\","
+      "\"description\": \"Retrieve the latency and throughput of the requests handled by the web server\","
+      "\"transport\": \"Response\","
+      "\"permission\": \"ReadData\","
+      "\"params\": [],"
+      "\"returns\": {"
+        "\"type\": \"object\","
+        "\"description\": \"Number of requests being handled, seconds covered by the statistics, the statistics of every request handler by name and those of the queue of every announcer passing announcements on to clients, by name\""
+      "}"
     "}"
   };
 
@@ -356,6 +356,33 @@ JSONRPC_STATUS CVideoLibrary::GetGenres(const CStdString &method, ITransportLaye
   return OK;
 }
 
+JSONRPC_STATUS CVideoLibrary::Search(const CStdString &method, ITransportLayer *transport, IClient *client, const CVariant &parameterObject, CVariant &result)
+{
+  CVideoDatabase videodatabase;
+  if (!videodatabase.Open())
+    return InternalError;
+
+  int start, end;
+  ParseLimits(parameterObject, start, end);
+
+  const MediaType types[] = { MediaTypeMovie, MediaTypeTvShow, MediaTypeEpisode, MediaTypeMusicVideo };
+  const char *ids[] = { "movieid", "tvshowid", "episodeid", "musicvideoid" };
+  const char *lists[] = { "movies", "tvshows", "episodes", "musicvideos" };
+  for (unsigned int i = 0; i < sizeof(types) / sizeof(types[0]); i++)
+  {
+    // the best matches come first, so only those within the limits are needed
+    CFileItemList items;
+    if (!videodatabase.SearchIndex(types[i], parameterObject["term"].asString(), items, end > 0 ? end : 1000))
+      return InternalError;
+
+    CVariant list;
+    HandleFileItemList(ids[i], false, lists[i], items, parameterObject, list);
+    result[lists[i]] = list.isMember(lists[i]) ? list[lists[i]] : CVariant(CVariant::VariantTypeArray);
+  }
+
+  return OK;
+}
+
 JSONRPC_STATUS CVideoLibrary::SetMovieDetails(const CStdString &method, ITransportLayer *transport, IClient *client, const CVariant &parameterObject, CVariant &result)
 {
   int id = (int)parameterObject["movieid"].asInteger();
@@ -24,6 +24,8 @@
 #include "Util.h"
 #include "utils/Variant.h"
 #include "powermanagement/PowerManager.h"
+#include "network/httprequesthandler/HTTPRequestStatistics.h"
+#include "interfaces/AnnouncementManager.h"
 
 using namespace JSONRPC;
 
@@ -93,3 +95,22 @@ JSONRPC_STATUS CXBMCOperations::GetInfoBooleans(const CStdString &method, ITrans
 
   return OK;
 }
+
+JSONRPC_STATUS CXBMCOperations::GetWebServerStatistics(const CStdString &method, ITransportLayer *transport, IClient *client, const CVariant &parameterObject, CVariant &result)
+{
+  CHTTPRequestStatistics::Get().GetStatistics(result);
+
+  std::vector<ANNOUNCEMENT::AnnouncementQueueStatistics> queues;
+  ANNOUNCEMENT::CAnnouncementManager::GetQueueStatistics(queues);
+  result["announcers"] = CVariant(CVariant::VariantTypeObject);
+  for (std::vector<ANNOUNCEMENT::AnnouncementQueueStatistics>::const_iterator queue = queues.begin(); queue != queues.end(); ++queue)
+  {
+    CVariant &object = result["announcers"][queue->name];
+    object["queued"] = queue->queued;
+    object["maxqueued"] = queue->maxQueued;
+    object["delivered"] = queue->delivered;
+    object["coalesced"] = queue->coalesced;
+    object["dropped"] = queue->dropped;
+  }
+  return OK;
+}
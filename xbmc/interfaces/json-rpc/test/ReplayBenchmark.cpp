@@ -0,0 +1,249 @@
+/*
+ *      Copyright (C) 2005-2012 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+/*
+ * rpcbench - replays a recorded remote-control session through the JSON-RPC
+ * call checks and reports, per method, the time spent checking a call.
+ *
+ *   rpcbench [--passes=<n>] <session file>
+ *
+ * The session file holds one JSON-RPC request per line, as sent by the remote
+ * (anything before the first '{' is ignored, so lines copied from a debug log
+ * work too). remote-session.json next to this file is a recording of a remote
+ * browsing the movie library and polling the player during playback.
+ *
+ * Every request goes through CJSONServiceDescription::CheckCall, the access
+ * and schema checks that run before a method is executed, but the methods
+ * themselves aren't called as they need the running application. Each call
+ * is timed twice:
+ *  - uncached: the remembered parameters are cleared first, so the
+ *    parameters are checked against the schema;
+ *  - cached:   the parameters were seen before, as for a remote polling.
+ */
+
+#include "system.h"
+#include "interfaces/json-rpc/JSONRPC.h"
+#include "interfaces/json-rpc/JSONServiceDescription.h"
+#include "settings/AdvancedSettings.h"
+#include "utils/JSONVariantParser.h"
+#include "utils/JSONVariantWriter.h"
+#include "utils/log.h"
+#include "utils/TimeUtils.h"
+#include "utils/Variant.h"
+#include "XbmcContext.h"
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace JSONRPC;
+
+class CBenchTransport : public ITransportLayer
+{
+public:
+  virtual bool PrepareDownload(const char *path, CVariant &details, std::string &protocol) { return false; }
+  virtual bool Download(const char *path, CVariant &result) { return false; }
+  virtual int GetCapabilities() { return Response | Announcing; }
+};
+
+class CBenchClient : public IClient
+{
+public:
+  virtual int GetPermissionFlags() { return OPERATION_PERMISSION_ALL; }
+  virtual int GetAnnouncementFlags() { return 0; }
+  virtual bool SetAnnouncementFlags(int flags) { return true; }
+};
+
+struct Request
+{
+  std::string method; /* in lower case, as CJSONRPC passes it */
+  CVariant    params;
+  bool        notification;
+};
+
+struct BenchResult
+{
+  BenchResult() : calls(0), failed(0), uncached(0.0), cached(0.0) {}
+
+  unsigned int calls;    /* calls in the session */
+  unsigned int failed;   /* calls failing the check */
+  double       uncached; /* seconds spent checking against the schema */
+  double       cached;   /* seconds spent checking remembered parameters */
+};
+
+typedef std::map<std::string, BenchResult> BenchResults;
+
+static void PrintUsage()
+{
+  fprintf(stderr, "Usage: rpcbench [--passes=<n>] <session file>\n");
+}
+
+static bool LoadSession(const char *path, std::vector<Request> &session)
+{
+  FILE *f = fopen(path, "r");
+  if (!f)
+    return false;
+
+  char line[16384];
+  unsigned int lineNumber = 0;
+  while (fgets(line, sizeof(line), f))
+  {
+    lineNumber++;
+    const char *json = strchr(line, '{');
+    if (!json)
+      continue;
+
+    CVariant request = CJSONVariantParser::Parse((const unsigned char *)json, strlen(json));
+    if (!request.isObject() || !request["method"].isString())
+    {
+      fprintf(stderr, "%s:%u: not a JSON-RPC request\n", path, lineNumber);
+      continue;
+    }
+
+    Request call;
+    CStdString method = request["method"].asString();
+    call.method = method.ToLower();
+    call.params = request["params"];
+    call.notification = !request.isMember("id");
+    session.push_back(call);
+  }
+
+  fclose(f);
+  return true;
+}
+
+static double CheckCall(const Request &call, ITransportLayer *transport, IClient *client, bool &ok)
+{
+  MethodCall method;
+  CVariant params;
+
+  int64_t start = CurrentHostCounter();
+  ok = CJSONServiceDescription::CheckCall(call.method.c_str(), call.params, transport, client, call.notification, method, params) == OK;
+  return (double)(CurrentHostCounter() - start) / CurrentHostFrequency();
+}
+
+int main(int argc, char* argv[])
+{
+  XBMC::Context context;
+
+  unsigned int passes = 100;
+  const char *sessionFile = NULL;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (strncmp(argv[i], "--passes=", 9) == 0)
+      passes = std::max(1, atoi(argv[i] + 9));
+    else if (argv[i][0] != '-' && !sessionFile)
+      sessionFile = argv[i];
+    else
+    {
+      PrintUsage();
+      return 2;
+    }
+  }
+
+  if (!sessionFile)
+  {
+    PrintUsage();
+    return 2;
+  }
+
+  setlocale(LC_NUMERIC, "C");
+  g_advancedSettings.Initialize();
+  CLog::SetLogLevel(LOG_LEVEL_NONE);
+
+  CJSONRPC::Initialize();
+
+  std::vector<Request> session;
+  if (!LoadSession(sessionFile, session) || session.empty())
+  {
+    fprintf(stderr, "Unable to read a session from %s\n", sessionFile);
+    return 2;
+  }
+
+  CBenchTransport transport;
+  CBenchClient client;
+  BenchResults results;
+
+  for (std::vector<Request>::const_iterator call = session.begin(); call != session.end(); ++call)
+  {
+    BenchResult &result = results[call->method];
+    bool ok;
+    CheckCall(*call, &transport, &client, ok);
+    result.calls++;
+    if (!ok)
+    {
+      result.failed++;
+      fprintf(stderr, "%s: fails the check with %s\n", call->method.c_str(), CJSONVariantWriter::Write(call->params, true).c_str());
+    }
+  }
+
+  for (unsigned int pass = 0; pass < passes; pass++)
+  {
+    for (std::vector<Request>::const_iterator call = session.begin(); call != session.end(); ++call)
+    {
+      BenchResult &result = results[call->method];
+      bool ok;
+
+      CJSONServiceDescription::ClearCheckedParameters();
+      result.uncached += CheckCall(*call, &transport, &client, ok);
+    }
+
+    /* every call of the session is remembered after this */
+    for (std::vector<Request>::const_iterator call = session.begin(); call != session.end(); ++call)
+    {
+      bool ok;
+      CheckCall(*call, &transport, &client, ok);
+    }
+
+    for (std::vector<Request>::const_iterator call = session.begin(); call != session.end(); ++call)
+    {
+      BenchResult &result = results[call->method];
+      bool ok;
+      result.cached += CheckCall(*call, &transport, &client, ok);
+    }
+  }
+
+  BenchResult total;
+  printf("%-32s %6s %6s %14s %14s %8s\n", "method", "calls", "failed", "uncached (us)", "cached (us)", "speedup");
+  for (BenchResults::const_iterator it = results.begin(); it != results.end(); ++it)
+  {
+    const BenchResult &r = it->second;
+    double count = (double)r.calls * passes;
+    printf("%-32s %6u %6u %14.2f %14.2f %7.1fx\n", it->first.c_str(), r.calls, r.failed,
+           r.uncached * 1e6 / count, r.cached * 1e6 / count, r.cached > 0.0 ? r.uncached / r.cached : 0.0);
+
+    total.calls    += r.calls;
+    total.failed   += r.failed;
+    total.uncached += r.uncached;
+    total.cached   += r.cached;
+  }
+
+  double count = (double)total.calls * passes;
+  printf("%-32s %6u %6u %14.2f %14.2f %7.1fx\n", "(session)", total.calls, total.failed,
+         total.uncached * 1e6 / count, total.cached * 1e6 / count, total.cached > 0.0 ? total.uncached / total.cached : 0.0);
+
+  return 0;
+}
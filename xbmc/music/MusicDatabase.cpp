@@ -259,6 +259,67 @@ void CMusicDatabase::CreateViews()
               "FROM artist "
               "  LEFT OUTER JOIN artistinfo ON"
               "    artist.idArtist = artistinfo.idArtist");
+
+  // song listings read this copy of the view so that they don't need to join, with triggers
+  // on every table the view joins keeping it up to date
+  MaterializeView("songlist", "songview", "idSong");
+  m_pDS->exec("CREATE INDEX ix_songlist_2 ON songlist (idAlbum)");
+
+  // full-text search indexes of song titles, albums and artists, rebuilt from the tables
+  CStdString songSearch, songSearchUpdate, songSearchDelete, albumSearch, albumSearchDelete, artistSearch, artistSearchDelete;
+  if (CreateSearchIndex("songsearch", "strTitle, strArtists, strAlbum") &&
+      CreateSearchIndex("albumsearch", "strAlbum, strArtists") &&
+      CreateSearchIndex("artistsearch", "strArtist"))
+  {
+    m_pDS->exec("INSERT INTO songsearch (docid, strTitle, strArtists, strAlbum) SELECT idSong, strTitle, strArtists, strAlbum FROM songlist");
+    m_pDS->exec("INSERT INTO albumsearch (docid, strAlbum, strArtists) SELECT idAlbum, strAlbum, strArtists FROM album");
+    m_pDS->exec("INSERT INTO artistsearch (docid, strArtist) SELECT idArtist, strArtist FROM artist");
+
+    songSearch = "INSERT INTO songsearch (docid, strTitle, strArtists, strAlbum) SELECT idSong, strTitle, strArtists, strAlbum FROM songlist WHERE idSong=new.idSong; ";
+    // play counts etc. are updated far more often than the indexed details
+    CStdString songChanged = "(new.strTitle IS NOT old.strTitle OR new.strArtists IS NOT old.strArtists OR new.idAlbum IS NOT old.idAlbum)";
+    songSearchUpdate = "DELETE FROM songsearch WHERE docid=new.idSong AND " + songChanged + "; "
+                       "INSERT INTO songsearch (docid, strTitle, strArtists, strAlbum) SELECT idSong, strTitle, strArtists, strAlbum FROM songlist WHERE idSong=new.idSong AND " + songChanged + "; ";
+    songSearchDelete = "DELETE FROM songsearch WHERE docid=old.idSong; ";
+    albumSearch = "DELETE FROM albumsearch WHERE docid=new.idAlbum; "
+                  "INSERT INTO albumsearch (docid, strAlbum, strArtists) VALUES (new.idAlbum, new.strAlbum, new.strArtists); "
+                  "DELETE FROM songsearch WHERE docid IN (SELECT idSong FROM song WHERE idAlbum=new.idAlbum); "
+                  "INSERT INTO songsearch (docid, strTitle, strArtists, strAlbum) SELECT idSong, strTitle, strArtists, strAlbum FROM songlist WHERE idAlbum=new.idAlbum; ";
+    albumSearchDelete = "DELETE FROM albumsearch WHERE docid=old.idAlbum; ";
+    artistSearch = "DELETE FROM artistsearch WHERE docid=new.idArtist; "
+                   "INSERT INTO artistsearch (docid, strArtist) VALUES (new.idArtist, new.strArtist); ";
+    artistSearchDelete = "DELETE FROM artistsearch WHERE docid=old.idArtist; ";
+  }
+
+  CLog::Log(LOGINFO, "create list triggers");
+  CreateTrigger("insert_song", "INSERT ON song", "INSERT INTO songlist SELECT * FROM songview WHERE idSong=new.idSong; " + songSearch);
+  // the update triggers only run for the columns in the view, paths for example have their hash updated with each scan
+  CreateTrigger("update_song", "UPDATE OF idAlbum, idPath, strArtists, strGenres, strTitle, iTrack, iDuration, iYear, dwFileNameCRC, strFileName, "
+                               "strMusicBrainzTrackID, strMusicBrainzArtistID, strMusicBrainzAlbumID, strMusicBrainzAlbumArtistID, strMusicBrainzTRMID, "
+                               "iTimesPlayed, iStartOffset, iEndOffset, lastplayed, rating, comment ON song",
+                RefreshRowsSQL("songlist", "songview", "idSong=new.idSong") + songSearchUpdate);
+  CreateTrigger("delete_song", "DELETE ON song", "DELETE FROM art WHERE media_id=old.idSong AND media_type='song'; "
+                                                 "DELETE FROM songlist WHERE idSong=old.idSong; " + songSearchDelete);
+  CreateTrigger("update_album", "UPDATE OF strAlbum, strArtists, bCompilation ON album", RefreshRowsSQL("songlist", "songview", "idAlbum=new.idAlbum") + albumSearch);
+  CreateTrigger("delete_album", "DELETE ON album", "DELETE FROM art WHERE media_id=old.idAlbum AND media_type='album'; " + albumSearchDelete);
+  CreateTrigger("delete_artist", "DELETE ON artist", "DELETE FROM art WHERE media_id=old.idArtist AND media_type='artist'; " + artistSearchDelete);
+  if (!albumSearch.IsEmpty())
+  {
+    CreateTrigger("insert_album", "INSERT ON album", albumSearch);
+    CreateTrigger("insert_artist", "INSERT ON artist", artistSearch);
+    CreateTrigger("update_artist", "UPDATE OF strArtist ON artist", artistSearch);
+  }
+  else
+  {
+    m_pDS->exec("DROP TRIGGER IF EXISTS insert_album");
+    m_pDS->exec("DROP TRIGGER IF EXISTS insert_artist");
+    m_pDS->exec("DROP TRIGGER IF EXISTS update_artist");
+  }
+  CreateTrigger("update_path", "UPDATE OF strPath ON path", RefreshRowsSQL("songlist", "songview", "idSong IN (SELECT idSong FROM song WHERE idPath=new.idPath)"));
+  CreateTrigger("insert_karaokedata", "INSERT ON karaokedata", RefreshRowsSQL("songlist", "songview", "idSong=new.idSong"));
+  CreateTrigger("update_karaokedata", "UPDATE OF idSong, iKaraNumber, iKaraDelay, strKaraEncoding ON karaokedata",
+                RefreshRowsSQL("songlist", "songview", "idSong=new.idSong"));
+  CreateTrigger("delete_karaokedata", "DELETE ON karaokedata", RefreshRowsSQL("songlist", "songview", "idSong=old.idSong"));
 }
 
 int CMusicDatabase::AddAlbum(const CAlbum &album, vector<int> &songIDs)
@@ -534,13 +595,13 @@ int CMusicDatabase::AddGenre(const CStdString& strGenre1)
       m_pDS->exec(strSQL.c_str());
 
       int idGenre = (int)m_pDS->lastinsertid();
-      m_genreCache.insert(pair<CStdString, int>(strGenre1, idGenre));
+      m_genreCache.insert(pair<CStdString, int>(strGenre, idGenre));
       return idGenre;
     }
     else
     {
       int idGenre = m_pDS->fv("idGenre").get_asInt();
-      m_genreCache.insert(pair<CStdString, int>(strGenre1, idGenre));
+      m_genreCache.insert(pair<CStdString, int>(strGenre, idGenre));
       m_pDS->close();
       return idGenre;
     }
@@ -584,13 +645,13 @@ int CMusicDatabase::AddArtist(const CStdString& strArtist1)
       strSQL=PrepareSQL("insert into artist (idArtist, strArtist) values( NULL, '%s' )", strArtist.c_str());
       m_pDS->exec(strSQL.c_str());
       int idArtist = (int)m_pDS->lastinsertid();
-      m_artistCache.insert(pair<CStdString, int>(strArtist1, idArtist));
+      m_artistCache.insert(pair<CStdString, int>(strArtist, idArtist));
       return idArtist;
     }
     else
     {
       int idArtist = (int)m_pDS->fv("idArtist").get_asInt();
-      m_artistCache.insert(pair<CStdString, int>(strArtist1, idArtist));
+      m_artistCache.insert(pair<CStdString, int>(strArtist, idArtist));
       m_pDS->close();
       return idArtist;
     }
@@ -608,7 +669,7 @@ bool CMusicDatabase::AddSongArtist(int idArtist, int idSong, bool featured, int
   CStdString strSQL;
   strSQL=PrepareSQL("replace into song_artist (idArtist, idSong, boolFeatured, iOrder) values(%i,%i,%i,%i)",
                     idArtist, idSong, featured == true ? 1 : 0, iOrder);
-  return ExecuteQuery(strSQL);
+  return QueueInsertQuery(strSQL);
 };
 
 bool CMusicDatabase::AddAlbumArtist(int idArtist, int idAlbum, bool featured, int iOrder)
@@ -616,7 +677,7 @@ bool CMusicDatabase::AddAlbumArtist(int idArtist, int idAlbum, bool featured, in
   CStdString strSQL;
   strSQL=PrepareSQL("replace into album_artist (idArtist, idAlbum, boolFeatured, iOrder) values(%i,%i,%i,%i)",
                     idArtist, idAlbum, featured == true ? 1 : 0, iOrder);
-  return ExecuteQuery(strSQL);
+  return QueueInsertQuery(strSQL);
 };
 
 bool CMusicDatabase::AddSongGenre(int idGenre, int idSong, int iOrder)
@@ -627,7 +688,7 @@ bool CMusicDatabase::AddSongGenre(int idGenre, int idSong, int iOrder)
   CStdString strSQL;
   strSQL=PrepareSQL("replace into song_genre (idGenre, idSong, iOrder) values(%i,%i,%i)",
                     idGenre, idSong, iOrder);
-  return ExecuteQuery(strSQL);};
+  return QueueInsertQuery(strSQL);};
 
 bool CMusicDatabase::AddAlbumGenre(int idGenre, int idAlbum, int iOrder)
 {
@@ -637,7 +698,7 @@ bool CMusicDatabase::AddAlbumGenre(int idGenre, int idAlbum, int iOrder)
   CStdString strSQL;
   strSQL=PrepareSQL("replace into album_genre (idGenre, idAlbum, iOrder) values(%i,%i,%i)",
                     idGenre, idAlbum, iOrder);
-  return ExecuteQuery(strSQL);
+  return QueueInsertQuery(strSQL);
 };
 
 bool CMusicDatabase::GetAlbumsByArtist(int idArtist, bool includeFeatured, std::vector<long> &albums)
@@ -1114,7 +1175,11 @@ bool CMusicDatabase::SearchArtists(const CStdString& search, CFileItemList &arti
     int idVariousArtist = AddArtist(g_localizeStrings.Get(340));
 
     CStdString strSQL;
-    if (search.GetLength() >= MIN_FULL_SEARCH_LENGTH)
+    CStdString match = HasSearchIndex("artistsearch") ? SearchIndexSQL("artistsearch", search, "1", 1000) : "";
+    if (!match.IsEmpty())
+      strSQL.Format("select artist.* from (%s) as hits join artist on artist.idArtist=hits.docid "
+                    "where artist.idArtist <> %i order by hits.rank desc", match.c_str(), idVariousArtist);
+    else if (search.GetLength() >= MIN_FULL_SEARCH_LENGTH)
       strSQL=PrepareSQL("select * from artist "
                                 "where (strArtist like '%s%%' or strArtist like '%% %s%%') and idArtist <> %i "
                                 , search.c_str(), search.c_str(), idVariousArtist );
@@ -1768,6 +1833,66 @@ bool CMusicDatabase::Search(const CStdString& search, CFileItemList &items)
   return true;
 }
 
+bool CMusicDatabase::SearchIndex(MediaType mediaType, const CStdString& search, CFileItemList &items, int limit /* = 1000 */)
+{
+  CStdString index, table, key, name, weights, type, baseDir;
+  switch (mediaType)
+  {
+  case MediaTypeArtist:
+    index = "artistsearch"; table = "artist"; key = "idArtist"; name = "strArtist"; weights = "1";
+    type = "artist"; baseDir = "musicdb://2/";
+    break;
+  case MediaTypeAlbum:
+    index = "albumsearch"; table = "album"; key = "idAlbum"; name = "strAlbum"; weights = "10, 4";
+    type = "album"; baseDir = "musicdb://3/";
+    break;
+  case MediaTypeSong:
+    index = "songsearch"; table = "songlist"; key = "idSong"; name = "strTitle"; weights = "10, 4, 2";
+    type = "song"; baseDir = "musicdb://4/";
+    break;
+  default:
+    return false;
+  }
+
+  CStdString strSQL;
+  try
+  {
+    if (NULL == m_pDB.get()) return false;
+    if (NULL == m_pDS.get()) return false;
+
+    CStdString match = HasSearchIndex(index) ? SearchIndexSQL(index, search, weights, limit) : "";
+    if (!match.IsEmpty())
+      strSQL.Format("select %s.%s, %s.%s from (%s) as hits join %s on %s.%s=hits.docid order by hits.rank desc",
+                    table.c_str(), key.c_str(), table.c_str(), name.c_str(), match.c_str(), table.c_str(), table.c_str(), key.c_str());
+    else
+      strSQL = PrepareSQL("select %s, %s from %s where %s like '%s%%' order by %s limit %i",
+                          key.c_str(), name.c_str(), table.c_str(), name.c_str(), search.c_str(), name.c_str(), limit);
+
+    if (!m_pDS->query(strSQL.c_str()))
+      return false;
+
+    while (!m_pDS->eof())
+    {
+      int id = m_pDS->fv(0).get_asInt();
+      CStdString path;
+      path.Format(mediaType == MediaTypeSong ? "%s%i" : "%s%i/", baseDir.c_str(), id);
+      CFileItemPtr item(new CFileItem(path, mediaType != MediaTypeSong));
+      item->SetLabel(m_pDS->fv(1).get_asString());
+      item->GetMusicInfoTag()->SetTitle(item->GetLabel());
+      item->GetMusicInfoTag()->SetDatabaseId(id, type);
+      items.Add(item);
+      m_pDS->next();
+    }
+    m_pDS->close();
+    return true;
+  }
+  catch (...)
+  {
+    CLog::Log(LOGERROR, "%s (%s) failed", __FUNCTION__, strSQL.c_str());
+  }
+  return false;
+}
+
 bool CMusicDatabase::SearchSongs(const CStdString& search, CFileItemList &items)
 {
   try
@@ -1776,7 +1901,10 @@ bool CMusicDatabase::SearchSongs(const CStdString& search, CFileItemList &items)
     if (NULL == m_pDS.get()) return false;
 
     CStdString strSQL;
-    if (search.GetLength() >= MIN_FULL_SEARCH_LENGTH)
+    CStdString match = HasSearchIndex("songsearch") ? SearchIndexSQL("songsearch", search, "10, 4, 2", 1000) : "";
+    if (!match.IsEmpty())
+      strSQL = "select songlist.* from (" + match + ") as hits join songlist on songlist.idSong=hits.docid order by hits.rank desc";
+    else if (search.GetLength() >= MIN_FULL_SEARCH_LENGTH)
       strSQL=PrepareSQL("select * from songview where strTitle like '%s%%' or strTitle like '%% %s%%' limit 1000", search.c_str(), search.c_str());
     else
       strSQL=PrepareSQL("select * from songview where strTitle like '%s%%' limit 1000", search.c_str());
@@ -1812,7 +1940,10 @@ bool CMusicDatabase::SearchAlbums(const CStdString& search, CFileItemList &album
     if (NULL == m_pDS.get()) return false;
 
     CStdString strSQL;
-    if (search.GetLength() >= MIN_FULL_SEARCH_LENGTH)
+    CStdString match = HasSearchIndex("albumsearch") ? SearchIndexSQL("albumsearch", search, "10, 4", 1000) : "";
+    if (!match.IsEmpty())
+      strSQL = "select albumview.* from (" + match + ") as hits join albumview on albumview.idAlbum=hits.docid order by hits.rank desc";
+    else if (search.GetLength() >= MIN_FULL_SEARCH_LENGTH)
       strSQL=PrepareSQL("select * from albumview where strAlbum like '%s%%' or strAlbum like '%% %s%%'", search.c_str(), search.c_str());
     else
       strSQL=PrepareSQL("select * from albumview where strAlbum like '%s%%'", search.c_str());
@@ -3054,15 +3185,23 @@ bool CMusicDatabase::GetSongsByWhere(const CStdString &baseDir, const CStdString
     int total = -1;
 
     // We don't use PrepareSQL here, as the WHERE clause is already formatted.
-    CStdString strSQL = "select * from songview " + whereClause;
-    // Apply the limiting directly here if there's no special sorting but limiting
+    CStdString strSQL = "select * from songlist AS songview " + whereClause;
+    // Apply the sorting and limiting directly here if there's no special sorting or it maps to a column
+    SortDescription sorting = sortDescription;
+    std::string order;
     CStdString whereLower = whereClause;
     whereLower.ToLower();
     if (whereLower.find(" limit ") == string::npos &&
-        sortDescription.sortBy == SortByNone &&
-       (sortDescription.limitStart > 0 || sortDescription.limitEnd > 0))
+       (sortDescription.limitStart > 0 || sortDescription.limitEnd > 0) &&
+       (sortDescription.sortBy == SortByNone ||
+       (whereLower.find(" order by ") == string::npos && DatabaseUtils::BuildOrderClause(sortDescription, MediaTypeSong, order))))
     {
-      total = (int)strtol(GetSingleValue("SELECT COUNT(1) FROM songview " + whereClause, m_pDS).c_str(), NULL, 10);
+      total = (int)strtol(GetSingleValue("SELECT COUNT(1) FROM songlist AS songview " + whereClause, m_pDS).c_str(), NULL, 10);
+      if (!order.empty())
+      {
+        strSQL += " ORDER BY " + order;
+        sorting.sortBy = SortByNone;
+      }
       strSQL += DatabaseUtils::BuildLimitClause(sortDescription.limitEnd, sortDescription.limitStart);
     }
 
@@ -3085,7 +3224,7 @@ bool CMusicDatabase::GetSongsByWhere(const CStdString &baseDir, const CStdString
     
     DatabaseResults results;
     results.reserve(iRowsFound);
-    if (!SortUtils::SortFromDataset(sortDescription, MediaTypeSong, m_pDS, results))
+    if (!SortUtils::SortFromDataset(sorting, MediaTypeSong, m_pDS, results))
       return false;
 
     // get data from returned rows
@@ -3694,6 +3833,11 @@ int CMusicDatabase::GetArtistByName(const CStdString& strArtist)
     if (NULL == m_pDB.get()) return false;
     if (NULL == m_pDS.get()) return false;
 
+    // artists added while scanning are cached
+    map<CStdString, int>::const_iterator it = m_artistCache.find(strArtist);
+    if (it != m_artistCache.end())
+      return it->second;
+
     CStdString strSQL=PrepareSQL("select idArtist from artist where artist.strArtist like '%s'", strArtist.c_str());
 
     // run query
@@ -5017,6 +5161,119 @@ bool CMusicDatabase::GetArtForItem(int mediaId, const string &mediaType, map<str
   return false;
 }
 
+void CMusicDatabase::GetArtForItems(CFileItemList &items)
+{
+  // the songs and albums without art by media type and id, and the albums of the songs among them
+  map<pair<string, int>, vector<CFileItemPtr> > artItems;
+  map<int, vector<CFileItemPtr> > albumItems;
+  map<string, set<int> > ids;
+  for (int i = 0; i < items.Size(); i++)
+  {
+    CFileItemPtr item = items[i];
+    if (!item->HasMusicInfoTag() || !item->GetArt().empty())
+      continue;
+
+    const MUSIC_INFO::CMusicInfoTag &tag = *item->GetMusicInfoTag();
+    if (tag.GetDatabaseId() < 0 || (tag.GetType() != "song" && tag.GetType() != "album"))
+      continue;
+
+    artItems[make_pair(tag.GetType(), tag.GetDatabaseId())].push_back(item);
+    ids[tag.GetType()].insert(tag.GetDatabaseId());
+    if (tag.GetType() == "song" && tag.GetAlbumId() >= 0)
+    {
+      albumItems[tag.GetAlbumId()].push_back(item);
+      ids["album"].insert(tag.GetAlbumId());
+    }
+  }
+
+  if (ids.empty() || NULL == m_pDB.get() || NULL == m_pDS2.get())
+    return;
+
+  try
+  {
+    CStdString where, artistWhere;
+    for (map<string, set<int> >::const_iterator type = ids.begin(); type != ids.end(); ++type)
+    {
+      CStdString typeIds;
+      for (set<int>::const_iterator id = type->second.begin(); id != type->second.end(); ++id)
+        typeIds += PrepareSQL(typeIds.IsEmpty() ? "%i" : ",%i", *id);
+      if (!where.IsEmpty())
+        where += " OR ";
+      where += PrepareSQL("(media_type='%s' AND media_id IN (", type->first.c_str()) + typeIds + "))";
+    }
+
+    map<pair<string, int>, map<string, string> > art;
+    m_pDS2->query("SELECT media_type,media_id,type,url FROM art WHERE " + where);
+    while (!m_pDS2->eof())
+    {
+      art[make_pair(m_pDS2->fv(0).get_asString(), m_pDS2->fv(1).get_asInt())].insert(make_pair(m_pDS2->fv(2).get_asString(), m_pDS2->fv(3).get_asString()));
+      m_pDS2->next();
+    }
+    m_pDS2->close();
+
+    // the items given art, which also get the fanart of their primary artist, as with CMusicThumbLoader::FillLibraryArt
+    map<pair<string, int>, vector<CFileItemPtr> > filled;
+    for (map<pair<string, int>, vector<CFileItemPtr> >::const_iterator i = artItems.begin(); i != artItems.end(); ++i)
+    {
+      map<pair<string, int>, map<string, string> >::const_iterator itemArt = art.find(i->first);
+      for (vector<CFileItemPtr>::const_iterator item = i->second.begin(); item != i->second.end(); ++item)
+      {
+        if (itemArt != art.end())
+          (*item)->SetArt(itemArt->second);
+        else if (i->first.first == "song")
+        { // no art for the song, try the album
+          map<pair<string, int>, map<string, string> >::const_iterator albumArt = art.find(make_pair(string("album"), (*item)->GetMusicInfoTag()->GetAlbumId()));
+          if (albumArt == art.end())
+            continue;
+          (*item)->SetArt(albumArt->second);
+        }
+        else
+          continue;
+        filled[i->first].push_back(*item);
+      }
+    }
+
+    // items without any art are left to the thumb loader, which looks for local art
+    if (filled.empty())
+      return;
+
+    CStdString songIds, albumIds;
+    for (map<pair<string, int>, vector<CFileItemPtr> >::const_iterator i = filled.begin(); i != filled.end(); ++i)
+    {
+      CStdString &typeIds = i->first.first == "song" ? songIds : albumIds;
+      typeIds += PrepareSQL(typeIds.IsEmpty() ? "%i" : ",%i", i->first.second);
+    }
+    CStdString sql;
+    if (!songIds.IsEmpty())
+      sql = "SELECT 'song',song_artist.idSong,art.url,song_artist.iOrder FROM song_artist JOIN art ON art.media_id=song_artist.idArtist "
+            "WHERE art.media_type='artist' AND art.type='fanart' AND song_artist.idSong IN (" + songIds + ")";
+    if (!albumIds.IsEmpty())
+      sql += CStdString(sql.IsEmpty() ? "" : " UNION ALL ") +
+             "SELECT 'album',album_artist.idAlbum,art.url,album_artist.iOrder FROM album_artist JOIN art ON art.media_id=album_artist.idArtist "
+             "WHERE art.media_type='artist' AND art.type='fanart' AND album_artist.idAlbum IN (" + albumIds + ")";
+
+    map<pair<string, int>, string> fanart;
+    m_pDS2->query(sql + " ORDER BY 4");
+    while (!m_pDS2->eof())
+    {
+      fanart.insert(make_pair(make_pair(m_pDS2->fv(0).get_asString(), m_pDS2->fv(1).get_asInt()), m_pDS2->fv(2).get_asString()));
+      m_pDS2->next();
+    }
+    m_pDS2->close();
+
+    for (map<pair<string, int>, vector<CFileItemPtr> >::const_iterator i = filled.begin(); i != filled.end(); ++i)
+    {
+      map<pair<string, int>, string>::const_iterator itemFanart = fanart.find(i->first);
+      for (vector<CFileItemPtr>::const_iterator item = i->second.begin(); item != i->second.end(); ++item)
+        (*item)->SetProperty("fanart_image", itemFanart != fanart.end() ? itemFanart->second : "");
+    }
+  }
+  catch (...)
+  {
+    CLog::Log(LOGERROR, "%s(%u items) failed", __FUNCTION__, (unsigned int)artItems.size());
+  }
+}
+
 string CMusicDatabase::GetArtForItem(int mediaId, const string &mediaType, const string &artType)
 {
   std::string query = PrepareSQL("SELECT url FROM art WHERE media_id=%i AND media_type='%s' AND type='%s'", mediaId, mediaType.c_str(), artType.c_str());
@@ -151,6 +151,17 @@ public:
   bool GetSongsByPath(const CStdString& strPath, CSongMap& songs, bool bAppendToMap = false);
   bool Search(const CStdString& search, CFileItemList &items);
 
+  /*! \brief Search the names of artists, the albums or the songs, best matches first.
+   Each word of the search matches the start of a word of the name, or for songs of the title, artists or album.
+   Without a full-text search index (eg. on MySQL) only the start of names is matched.
+   \param mediaType MediaTypeArtist, MediaTypeAlbum or MediaTypeSong.
+   \param search the text to search for.
+   \param items the items found, with their name and database id.
+   \param limit the maximum number of items to return.
+   \return true on success, false on error.
+   */
+  bool SearchIndex(MediaType mediaType, const CStdString& search, CFileItemList &items, int limit = 1000);
+
   bool GetAlbumFromSong(int idSong, CAlbum &album);
   bool GetAlbumFromSong(const CSong &song, CAlbum &album);
   
@@ -271,6 +282,14 @@ public:
    */
   std::string GetArtForItem(int mediaId, const std::string &mediaType, const std::string &artType);
 
+  /*! \brief Fill in the art of the songs and albums of a listing with a query for the art and one for
+   the artist fanart, rather than queries for each item. Items that have art are left alone, songs without
+   art of their own are given the art of their album, as in CMusicThumbLoader::FillLibraryArt.
+   \param items the listing.
+   \sa GetArtForItem, GetArtistArtForItem
+   */
+  void GetArtForItems(CFileItemList &items);
+
   /*! \brief Fetch artist art for a song or album item.
    Fetches the art associated with the primary artist for the song or album.
    \param mediaId the id in the media (song/album) table.
@@ -299,7 +318,7 @@ protected:
   std::map<CStdString, CAlbumCache> m_albumCache;
 
   virtual bool CreateTables();
-  virtual int GetMinVersion() const { return 27; };
+  virtual int GetMinVersion() const { return 30; };
   const char *GetBaseDBName() const { return "MyMusic"; };
 
   int AddSong(const CSong& song, bool bCheck = true, int idAlbum = -1);
@@ -24,6 +24,7 @@
 #include "music/tags/MusicInfoTagLoaderFactory.h"
 #include "MusicAlbumInfo.h"
 #include "MusicInfoScraper.h"
+#include "filesystem/ChangeJournal.h"
 #include "filesystem/MusicDatabaseDirectory.h"
 #include "filesystem/MusicDatabaseDirectory/DirectoryNode.h"
 #include "Util.h"
@@ -50,14 +51,96 @@
 #include "TextureCache.h"
 #include "ThumbLoader.h"
 #include "interfaces/AnnouncementManager.h"
+#include "threads/Event.h"
+#include "threads/SingleLock.h"
+#include "utils/JobManager.h"
 
 #include <algorithm>
+#include <boost/shared_ptr.hpp>
 
 using namespace std;
 using namespace MUSIC_INFO;
 using namespace XFILE;
 using namespace MUSIC_GRABBER;
 
+static void LoadTag(CFileItem &item)
+{
+  CMusicInfoTag& tag = *item.GetMusicInfoTag();
+  if (!tag.Loaded())
+  { // read the tag from a file
+    auto_ptr<IMusicInfoTagLoader> pLoader (CMusicInfoTagLoaderFactory::CreateLoader(item.GetPath()));
+    if (NULL != pLoader.get())
+      pLoader->Load(item.GetPath(), tag);
+  }
+}
+
+/*! \brief Reads tags for the scanner.
+ A number of jobs share a list of files, each taking the next unread file until none are left.
+ A job counts itself as running from when it is created until it has finished, or until it is
+ deleted unrun, as the job manager does with jobs it cancels or refuses while shutting down.
+ */
+class CMusicTagLoaderJob : public CJob
+{
+public:
+  class CFiles
+  {
+  public:
+    CFiles(const vector<CFileItemPtr> &files) : m_files(files), m_next(0), m_running(0), m_cancelled(false) {}
+
+    const vector<CFileItemPtr> &m_files;
+    size_t m_next;
+    unsigned int m_running;
+    bool m_cancelled;
+    CCriticalSection m_section;
+    CEvent m_finished;
+  };
+  typedef boost::shared_ptr<CFiles> CFilesPtr;
+
+  CMusicTagLoaderJob(const CFilesPtr &files) : m_files(files), m_ran(false)
+  {
+    CSingleLock lock(m_files->m_section);
+    m_files->m_running++;
+  }
+
+  virtual ~CMusicTagLoaderJob()
+  {
+    if (!m_ran)
+      Finished();
+  }
+
+  virtual const char *GetType() const { return "musictagloader"; }
+
+  virtual bool DoWork()
+  {
+    while (true)
+    {
+      CFileItemPtr item;
+      {
+        CSingleLock lock(m_files->m_section);
+        if (m_files->m_cancelled || m_files->m_next >= m_files->m_files.size())
+          break;
+        item = m_files->m_files[m_files->m_next++];
+      }
+      LoadTag(*item);
+    }
+
+    m_ran = true;
+    Finished();
+    return true;
+  }
+
+private:
+  void Finished()
+  {
+    CSingleLock lock(m_files->m_section);
+    m_files->m_running--;
+    m_files->m_finished.Set();
+  }
+
+  CFilesPtr m_files;
+  bool m_ran;
+};
+
 CMusicInfoScanner::CMusicInfoScanner() : CThread("CMusicInfoScanner")
 {
   m_bRunning = false;
@@ -66,6 +149,10 @@ CMusicInfoScanner::CMusicInfoScanner() : CThread("CMusicInfoScanner")
   m_currentItem=0;
   m_itemCount=0;
   m_flags = 0;
+  m_scanLibrary = false;
+  m_journalFullScan = false;
+  m_journalComplete = false;
+  m_filesRead = 0;
 }
 
 CMusicInfoScanner::~CMusicInfoScanner()
@@ -95,6 +182,10 @@ void CMusicInfoScanner::Process()
       // Reset progress vars
       m_currentItem=0;
       m_itemCount=-1;
+      m_filesRead=0;
+
+      // unchanged folders are skipped using the change journal, unless a full check is due
+      m_journalFullScan = (m_flags & SCAN_RESCAN) || CChangeJournal::Get().IsFullScanDue("music");
 
       // Create the thread to count all files to be scanned
       SetPriority( GetMinPriority() );
@@ -128,6 +219,9 @@ void CMusicInfoScanner::Process()
       {
         g_infoManager.ResetLibraryBools();
 
+        if (m_journalFullScan && m_scanLibrary)
+          CChangeJournal::Get().SetFullScanDone("music");
+
         if (m_needsCleanup)
         {
           if (m_pObserver)
@@ -151,6 +245,8 @@ void CMusicInfoScanner::Process()
 
       tick = XbmcThreads::SystemClockMillis() - tick;
       CLog::Log(LOGNOTICE, "My Music: Scanning for music info using worker thread, operation took %s", StringUtils::SecondsToTimeString(tick / 1000).c_str());
+      if (m_filesRead)
+        CLog::Log(LOGNOTICE, "My Music: Read tags from %u files (%.1f files/sec)", m_filesRead, m_filesRead * 1000.0f / max(tick, 1u));
     }
     bool bCanceled;
     if (m_scanType == 1) // load album info
@@ -212,6 +308,7 @@ void CMusicInfoScanner::Start(const CStdString& strDirectory, int flags)
   m_albumsScanned.clear();
   m_artistsScanned.clear();
   m_flags = flags;
+  m_scanLibrary = strDirectory.IsEmpty();
 
   if (strDirectory.IsEmpty())
   { // scan all paths in the database.  We do this by scanning all paths in the db, and crossing them off the list as
@@ -360,6 +457,9 @@ bool CMusicInfoScanner::DoScan(const CStdString& strDirectory)
   if (it != m_pathsToScan.end())
     m_pathsToScan.erase(it);
 
+  // folders that are not scanned have nothing to be watched for
+  m_journalComplete = true;
+
   // Discard all excluded files defined by m_musicExcludeRegExps
 
   CStdStringArray regexps = g_advancedSettings.m_audioExcludeFromScanRegExps;
@@ -367,6 +467,15 @@ bool CMusicInfoScanner::DoScan(const CStdString& strDirectory)
   if (CUtil::ExcludeFileOrFolder(strDirectory, regexps))
     return true;
 
+  if (!m_journalFullScan && CChangeJournal::Get().IsUnchanged(strDirectory))
+  { // nothing in or below the folder has changed since it was last scanned
+    CLog::Log(LOGDEBUG, "%s Skipping dir '%s' due to no change (change journal)", __FUNCTION__, strDirectory.c_str());
+    if (m_pObserver)
+      m_pObserver->OnDirectoryScanned(strDirectory);
+    return true;
+  }
+  unsigned int journalToken = CChangeJournal::Get().BeginScan(strDirectory);
+
   // load subfolder
   CFileItemList items;
   CDirectory::GetDirectory(strDirectory, items, g_settings.m_musicExtensions + "|.jpg|.tbn|.lrc|.cdg");
@@ -416,6 +525,7 @@ bool CMusicInfoScanner::DoScan(const CStdString& strDirectory)
   }
 
   // now scan the subfolders
+  bool journalComplete = journalToken && !hash.IsEmpty();
   for (int i = 0; i < items.Size(); ++i)
   {
     CFileItemPtr pItem = items[i];
@@ -430,9 +540,15 @@ bool CMusicInfoScanner::DoScan(const CStdString& strDirectory)
       {
         m_bStop = true;
       }
+      journalComplete &= m_journalComplete;
     }
   }
 
+  // the hash of the folder and those below it are in the database, so changes before now have been picked up
+  if (journalComplete && !m_bStop)
+    CChangeJournal::Get().EndScan(strDirectory, journalToken);
+  m_journalComplete = journalComplete;
+
   return !m_bStop;
 }
 
@@ -449,14 +565,10 @@ int CMusicInfoScanner::RetrieveMusicInfo(CFileItemList& items, const CStdString&
   CStdStringArray regexps = g_advancedSettings.m_audioExcludeFromScanRegExps;
 
   // for every file found, but skip folder
+  vector<CFileItemPtr> files;
   for (int i = 0; i < items.Size(); ++i)
   {
     CFileItemPtr pItem = items[i];
-    CStdString strExtension;
-    URIUtils::GetExtension(pItem->GetPath(), strExtension);
-
-    if (m_bStop)
-      return 0;
 
     // Discard all excluded files defined by m_musicExcludeRegExps
     if (CUtil::ExcludeFileOrFolder(pItem->GetPath(), regexps))
@@ -464,64 +576,67 @@ int CMusicInfoScanner::RetrieveMusicInfo(CFileItemList& items, const CStdString&
 
     // dont try reading id3tags for folders, playlists or shoutcast streams
     if (!pItem->m_bIsFolder && !pItem->IsPlayList() && !pItem->IsPicture() && !pItem->IsLyrics() )
-    {
-      m_currentItem++;
-//      CLog::Log(LOGDEBUG, "%s - Reading tag for: %s", __FUNCTION__, pItem->GetPath().c_str());
-
-      // grab info from the song
-      CSong *dbSong = songsMap.Find(pItem->GetPath());
-
-      CMusicInfoTag& tag = *pItem->GetMusicInfoTag();
-      if (!tag.Loaded() )
-      { // read the tag from a file
-        auto_ptr<IMusicInfoTagLoader> pLoader (CMusicInfoTagLoaderFactory::CreateLoader(pItem->GetPath()));
-        if (NULL != pLoader.get())
-          pLoader->Load(pItem->GetPath(), tag);
-      }
+      files.push_back(pItem);
+  }
 
-      // if we have the itemcount, notify our
-      // observer with the progress we made
-      if (m_pObserver && m_itemCount>0)
-        m_pObserver->OnSetProgress(m_currentItem, m_itemCount);
+  LoadTags(files);
+
+  for (vector<CFileItemPtr>::iterator i = files.begin(); i != files.end(); ++i)
+  {
+    CFileItemPtr pItem = *i;
+
+    if (m_bStop)
+      return 0;
 
-      if (tag.Loaded())
+    m_currentItem++;
+
+    // grab info from the song
+    CSong *dbSong = songsMap.Find(pItem->GetPath());
+
+    CMusicInfoTag& tag = *pItem->GetMusicInfoTag();
+
+    // if we have the itemcount, notify our
+    // observer with the progress we made
+    if (m_pObserver && m_itemCount>0)
+      m_pObserver->OnSetProgress(m_currentItem, m_itemCount);
+
+    if (tag.Loaded())
+    {
+      CSong song(tag);
+
+      // ensure our song has a valid filename or else it will assert in AddSong()
+      if (song.strFileName.IsEmpty())
       {
-        CSong song(tag);
+        // copy filename from path in case UPnP or other tag loaders didn't specify one (FIXME?)
+        song.strFileName = pItem->GetPath();
 
-        // ensure our song has a valid filename or else it will assert in AddSong()
+        // if we still don't have a valid filename, skip the song
         if (song.strFileName.IsEmpty())
         {
-          // copy filename from path in case UPnP or other tag loaders didn't specify one (FIXME?)
-          song.strFileName = pItem->GetPath();
-
-          // if we still don't have a valid filename, skip the song
-          if (song.strFileName.IsEmpty())
-          {
-            // this shouldn't ideally happen!
-            CLog::Log(LOGERROR, "Skipping song since it doesn't seem to have a filename");
-            continue;
-          }
+          // this shouldn't ideally happen!
+          CLog::Log(LOGERROR, "Skipping song since it doesn't seem to have a filename");
+          continue;
         }
+      }
 
-        song.iStartOffset = pItem->m_lStartOffset;
-        song.iEndOffset = pItem->m_lEndOffset;
-        song.strThumb = pItem->GetUserMusicThumb(true);
-        if (dbSong)
-        { // keep the db-only fields intact on rescan...
-          song.iTimesPlayed = dbSong->iTimesPlayed;
-          song.lastPlayed = dbSong->lastPlayed;
-          song.iKaraokeNumber = dbSong->iKaraokeNumber;
-
-          if (song.rating == '0') song.rating = dbSong->rating;
-          if (song.strThumb.empty())
-            song.strThumb = dbSong->strThumb;
-        }
-        songsToAdd.push_back(song);
-//        CLog::Log(LOGDEBUG, "%s - Tag loaded for: %s", __FUNCTION__, pItem->GetPath().c_str());
+      song.iStartOffset = pItem->m_lStartOffset;
+      song.iEndOffset = pItem->m_lEndOffset;
+      song.strThumb = pItem->GetUserMusicThumb(true);
+      if (dbSong)
+      { // keep the db-only fields intact on rescan...
+        song.iTimesPlayed = dbSong->iTimesPlayed;
+        song.lastPlayed = dbSong->lastPlayed;
+        song.iKaraokeNumber = dbSong->iKaraokeNumber;
+
+        if (song.rating == '0') song.rating = dbSong->rating;
+        if (song.strThumb.empty())
+          song.strThumb = dbSong->strThumb;
       }
-      else
-        CLog::Log(LOGDEBUG, "%s - No tag found for: %s", __FUNCTION__, pItem->GetPath().c_str());
+      songsToAdd.push_back(song);
+//        CLog::Log(LOGDEBUG, "%s - Tag loaded for: %s", __FUNCTION__, pItem->GetPath().c_str());
     }
+    else
+      CLog::Log(LOGDEBUG, "%s - No tag found for: %s", __FUNCTION__, pItem->GetPath().c_str());
   }
 
   VECALBUMS albums;
@@ -544,17 +659,27 @@ int CMusicInfoScanner::RetrieveMusicInfo(CFileItemList& items, const CStdString&
       return numAdded;
     }
 
-    // Build the artist & album sets
+    // Build the artist & album sets from the primary artists of the songs and album.
+    // These have just been added, so are found in the database cache.
     albumsToScan.insert(idAlbum);
-    for (vector<int>::iterator j = songIDs.begin(); j != songIDs.end(); ++j)
+    set<CStdString> artists;
+    for (VECSONGS::const_iterator j = i->songs.begin(); j != i->songs.end(); ++j)
     {
-      vector<long> songArtists;
-      m_musicDatabase.GetArtistsBySong(*j, false, songArtists);
-      artistsToScan.insert(songArtists.begin(), songArtists.end());
+      if (!j->artist.empty())
+        artists.insert(j->artist[0]);
+      if (!j->albumArtist.empty())
+        artists.insert(j->albumArtist[0]);
+    }
+    for (set<CStdString>::const_iterator j = artists.begin(); j != artists.end(); ++j)
+    {
+      CStdString strArtist = *j;
+      strArtist.Trim();
+      if (strArtist.IsEmpty())
+        strArtist = g_localizeStrings.Get(13205); // Unknown
+      int idArtist = m_musicDatabase.GetArtistByName(strArtist);
+      if (idArtist >= 0)
+        artistsToScan.insert(idArtist);
     }
-    std::vector<long> albumArtists;
-    m_musicDatabase.GetArtistsByAlbum(idAlbum, false, albumArtists);
-    artistsToScan.insert(albumArtists.begin(), albumArtists.end());
   }
   m_musicDatabase.CommitTransaction();
 
@@ -610,6 +735,45 @@ int CMusicInfoScanner::RetrieveMusicInfo(CFileItemList& items, const CStdString&
   return songsToAdd.size();
 }
 
+void CMusicInfoScanner::LoadTags(const vector<CFileItemPtr> &files)
+{
+  m_filesRead += files.size();
+
+  unsigned int jobs = min((unsigned int)g_advancedSettings.m_musicLibraryTagReadThreads, (unsigned int)files.size());
+  if (jobs <= 1 || files[0]->IsCDDA())
+  {
+    for (vector<CFileItemPtr>::const_iterator i = files.begin(); i != files.end() && !m_bStop; ++i)
+      LoadTag(**i);
+    return;
+  }
+
+  CMusicTagLoaderJob::CFilesPtr shared(new CMusicTagLoaderJob::CFiles(files));
+  unsigned int queued = 0;
+  for (unsigned int i = 0; i < jobs; i++)
+  {
+    if (CJobManager::GetInstance().AddJob(new CMusicTagLoaderJob(shared), NULL, CJob::PRIORITY_NORMAL))
+      queued++;
+  }
+
+  if (!queued)
+  { // the job manager is shutting down
+    for (vector<CFileItemPtr>::const_iterator i = files.begin(); i != files.end() && !m_bStop; ++i)
+      LoadTag(**i);
+    return;
+  }
+
+  // wait for the jobs to finish, as they use our list of files
+  CSingleLock lock(shared->m_section);
+  while (shared->m_running)
+  {
+    if (m_bStop)
+      shared->m_cancelled = true;
+    lock.Leave();
+    shared->m_finished.WaitMSec(100);
+    lock.Enter();
+  }
+}
+
 static bool SortSongsByTrack(CSong *song, CSong *song2)
 {
   return song->iTrack < song2->iTrack;
@@ -806,6 +970,13 @@ void CMusicInfoScanner::Run()
 // Recurse through all folders we scan and count files
 int CMusicInfoScanner::CountFilesRecursively(const CStdString& strPath)
 {
+  // folders skipped by DoScan() aren't counted either
+  if (!m_journalFullScan && CChangeJournal::Get().IsUnchanged(strPath))
+  {
+    m_pathsToCount.erase(strPath);
+    return 0;
+  }
+
   // load subfolder
   CFileItemList items;
 //  CLog::Log(LOGDEBUG, __FUNCTION__" - processing dir: %s", strPath.c_str());
@@ -22,6 +22,7 @@
 #include "threads/Thread.h"
 #include "music/MusicDatabase.h"
 #include "MusicAlbumInfo.h"
+#include "FileItem.h"
 
 class CAlbum;
 class CArtist;
@@ -108,6 +109,12 @@ public:
 protected:
   virtual void Process();
   int RetrieveMusicInfo(CFileItemList& items, const CStdString& strDirectory);
+
+  /*! \brief Read the tags of the given files
+   Tags are read by a number of jobs in parallel, as set by the tagreadthreads advanced setting.
+   \param files the files to read tags for, each tag is loaded into the item.
+   */
+  void LoadTags(const std::vector<CFileItemPtr> &files);
   int GetPathHash(const CFileItemList &items, CStdString &hash);
   void GetAlbumArtwork(long id, const CAlbum &artist);
 
@@ -134,5 +141,9 @@ protected:
   std::vector<long> m_artistsScanned;
   std::vector<long> m_albumsScanned;
   int m_flags;
+  unsigned int m_filesRead; ///< number of files whose tags were read during the scan
+  bool m_scanLibrary;       ///< whether every path in the library is being scanned
+  bool m_journalFullScan;   ///< whether the change journal may not be used to skip folders
+  bool m_journalComplete;   ///< whether the last folder passed to DoScan() was completely scanned and watched
 };
 }
@@ -25,13 +25,23 @@
 #include <memory.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <algorithm>
+#include <errno.h>
+#ifndef _WIN32
+#include <sys/ioctl.h>
+#endif
+#ifdef TARGET_LINUX
+#include <sys/epoll.h>
+#endif
 
 #include "settings/AdvancedSettings.h"
 #include "interfaces/json-rpc/JSONRPC.h"
 #include "interfaces/AnnouncementManager.h"
+#include "utils/JSONVariantWriter.h"
 #include "utils/log.h"
 #include "utils/Variant.h"
 #include "threads/SingleLock.h"
+#include "utils/JobManager.h"
 #include "websocket/WebSocketManager.h"
 
 static const char     bt_service_name[] = "XBMC JSON-RPC";
@@ -56,9 +66,48 @@ using namespace ANNOUNCEMENT;
 //using namespace std; On VS2010, bind conflicts with std::bind
 
 #define RECEIVEBUFFER 1024
+#define MAX_EVENTS    64
+#define MAX_SENDBUFFER  (256 * 1024) // per connection
+#define MAX_REQUEST     (1024 * 1024)
+
+static bool IsWouldBlock()
+{
+#ifdef _WIN32
+  return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+  return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
 
 CTCPServer *CTCPServer::ServerInstance = NULL;
 
+class CTCPServer::CRequestJob : public CJob
+{
+public:
+  CRequestJob(CTCPServer *host, CTCPClient *client) : m_host(host), m_client(client), m_ran(false) { }
+
+  virtual ~CRequestJob()
+  {
+    // the job manager deletes the jobs it hasn't run yet when shutting down
+    if (!m_ran)
+      m_client->AbandonRequests();
+  }
+
+  virtual bool DoWork()
+  {
+    m_ran = true;
+    m_client->ProcessRequests(m_host);
+    return true;
+  }
+
+  virtual const char *GetType() const { return "jsonrpcrequest"; }
+
+private:
+  CTCPServer *m_host;
+  CTCPClient *m_client;
+  bool        m_ran;
+};
+
 bool CTCPServer::StartServer(int port, bool nonlocal)
 {
   StopServer(true);
@@ -91,6 +140,9 @@ CTCPServer::CTCPServer(int port, bool nonlocal) : CThread("CTCPServer")
   m_port = port;
   m_nonlocal = nonlocal;
   m_sdpd = NULL;
+#ifdef TARGET_LINUX
+  m_epoll = -1;
+#endif
 }
 
 void CTCPServer::Process()
@@ -99,97 +151,214 @@ void CTCPServer::Process()
 
   while (!m_bStop)
   {
-    SOCKET          max_fd = 0;
-    fd_set          rfds;
-    struct timeval  to     = {1, 0};
-    FD_ZERO(&rfds);
-
-    for (std::vector<SOCKET>::iterator it = m_servers.begin(); it != m_servers.end(); it++)
+    std::vector<SOCKET> readable, writable;
+    if (!WaitForSockets(readable, writable))
     {
-      FD_SET(*it, &rfds);
-      if ((intptr_t)*it > (intptr_t)max_fd)
-        max_fd = *it;
+      CLog::Log(LOGERROR, "JSONRPC Server: Waiting for the sockets failed");
+      Sleep(1000);
+      Initialize();
+      continue;
     }
 
-    for (unsigned int i = 0; i < m_connections.size(); i++)
+    for (std::vector<SOCKET>::const_iterator it = writable.begin(); it != writable.end(); it++)
     {
-      FD_SET(m_connections[i]->m_socket, &rfds);
-      if ((intptr_t)m_connections[i]->m_socket > (intptr_t)max_fd)
-        max_fd = m_connections[i]->m_socket;
+      int index = FindConnection(*it);
+      if (index >= 0 && !m_connections[index]->Flush())
+        RemoveConnection(index);
     }
 
-    int res = select((intptr_t)max_fd+1, &rfds, NULL, NULL, &to);
-    if (res < 0)
+    for (std::vector<SOCKET>::const_iterator it = readable.begin(); it != readable.end(); it++)
     {
-      CLog::Log(LOGERROR, "JSONRPC Server: Select failed");
-      Sleep(1000);
-      Initialize();
+      if (std::find(m_servers.begin(), m_servers.end(), *it) != m_servers.end())
+      {
+        // take every pending connection, a busy backlog refuses the ones after it
+        while (AcceptConnection(*it)) ;
+        continue;
+      }
+
+      int index = FindConnection(*it);
+      if (index >= 0 && !ReadConnection(index))
+        RemoveConnection(index);
     }
-    else if (res > 0)
+
+    for (int i = m_disconnected.size() - 1; i >= 0; i--)
     {
-      for (int i = m_connections.size() - 1; i >= 0; i--)
+      if (!m_disconnected[i]->IsProcessing())
       {
-        int socket = m_connections[i]->m_socket;
-        if (FD_ISSET(socket, &rfds))
-        {
-          char buffer[RECEIVEBUFFER] = {};
-          int  nread = 0;
-          nread = recv(socket, (char*)&buffer, RECEIVEBUFFER, 0);
-          if (nread > 0)
-          {
-            std::string response;
-            if (m_connections[i]->IsNew())
-            {
-              CWebSocket *websocket = CWebSocketManager::Handle(buffer, nread, response);
-
-              if (response.size() > 0)
-                m_connections[i]->Send(response.c_str(), response.size());
-
-              if (websocket != NULL)
-              {
-                // Replace the CTCPClient with a CWebSocketClient
-                CWebSocketClient *websocketClient = new CWebSocketClient(websocket, *(m_connections[i]));
-                delete m_connections[i];
-                m_connections.erase(m_connections.begin() + i);
-                m_connections.insert(m_connections.begin() + i, websocketClient);
-              }
-            }
-
-            if (response.size() <= 0)
-              m_connections[i]->PushBuffer(this, buffer, nread);
-
-          }
-          if (nread <= 0)
-          {
-            CLog::Log(LOGINFO, "JSONRPC Server: Disconnection detected");
-            m_connections[i]->Disconnect();
-            delete m_connections[i];
-            m_connections.erase(m_connections.begin() + i);
-          }
-        }
+        delete m_disconnected[i];
+        m_disconnected.erase(m_disconnected.begin() + i);
       }
+    }
+  }
+
+  Deinitialize();
+}
+
+bool CTCPServer::WaitForSockets(std::vector<SOCKET> &readable, std::vector<SOCKET> &writable)
+{
+#ifdef TARGET_LINUX
+  // the connections are registered edge-triggered for both reading and writing
+  // when they are accepted, so nothing depends on the number of connections here
+  struct epoll_event events[MAX_EVENTS];
+  int res = epoll_wait(m_epoll, events, MAX_EVENTS, 1000);
+  if (res < 0)
+    return errno == EINTR;
+
+  for (int i = 0; i < res; i++)
+  {
+    if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+      readable.push_back(events[i].data.fd);
+    if (events[i].events & EPOLLOUT)
+      writable.push_back(events[i].data.fd);
+  }
+#else
+  SOCKET          max_fd = 0;
+  fd_set          rfds, wfds;
+  struct timeval  to     = {1, 0};
+  FD_ZERO(&rfds);
+  FD_ZERO(&wfds);
+
+  for (std::vector<SOCKET>::iterator it = m_servers.begin(); it != m_servers.end(); it++)
+  {
+    FD_SET(*it, &rfds);
+    if ((intptr_t)*it > (intptr_t)max_fd)
+      max_fd = *it;
+  }
+
+  for (unsigned int i = 0; i < m_connections.size(); i++)
+  {
+    FD_SET(m_connections[i]->m_socket, &rfds);
+    if (m_connections[i]->HasPendingData())
+    {
+      FD_SET(m_connections[i]->m_socket, &wfds);
+      // data queued later by other threads is only sent on the next round
+      to.tv_sec = 0;
+      to.tv_usec = 100000;
+    }
+    if ((intptr_t)m_connections[i]->m_socket > (intptr_t)max_fd)
+      max_fd = m_connections[i]->m_socket;
+  }
+
+  int res = select((intptr_t)max_fd+1, &rfds, &wfds, NULL, &to);
+  if (res < 0)
+    return false;
 
-      for (std::vector<SOCKET>::iterator it = m_servers.begin(); it != m_servers.end(); it++)
+  for (std::vector<SOCKET>::iterator it = m_servers.begin(); it != m_servers.end(); it++)
+  {
+    if (FD_ISSET(*it, &rfds))
+      readable.push_back(*it);
+  }
+
+  for (unsigned int i = 0; i < m_connections.size(); i++)
+  {
+    if (FD_ISSET(m_connections[i]->m_socket, &rfds))
+      readable.push_back(m_connections[i]->m_socket);
+    if (FD_ISSET(m_connections[i]->m_socket, &wfds) || m_connections[i]->HasPendingData())
+      writable.push_back(m_connections[i]->m_socket);
+  }
+#endif
+
+  return true;
+}
+
+bool CTCPServer::AcceptConnection(SOCKET server)
+{
+  CTCPClient *newconnection = new CTCPClient();
+  newconnection->m_socket = accept(server, (sockaddr*)&newconnection->m_cliaddr, &newconnection->m_addrlen);
+
+  if (newconnection->m_socket == INVALID_SOCKET)
+  {
+    if (!IsWouldBlock())
+      CLog::Log(LOGERROR, "JSONRPC Server: Accept of new connection failed");
+    delete newconnection;
+    return false;
+  }
+
+  CLog::Log(LOGDEBUG, "JSONRPC Server: New connection detected");
+
+  // neither reading nor sending may block the other connections
+  unsigned long nonblocking = 1;
+  ioctlsocket(newconnection->m_socket, FIONBIO, &nonblocking);
+
+#ifdef TARGET_LINUX
+  struct epoll_event event = {};
+  event.events = EPOLLIN | EPOLLOUT | EPOLLET;
+  event.data.fd = newconnection->m_socket;
+  if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, newconnection->m_socket, &event) < 0)
+  {
+    CLog::Log(LOGERROR, "JSONRPC Server: Failed to watch new connection");
+    newconnection->Disconnect();
+    delete newconnection;
+    return true;
+  }
+#endif
+
+  CLog::Log(LOGINFO, "JSONRPC Server: New connection added");
+  CSingleLock lock(m_connectionsSection);
+  m_connections.push_back(newconnection);
+  return true;
+}
+
+bool CTCPServer::ReadConnection(int index)
+{
+  // read everything there is, as the connection is only signalled again once more arrives
+  while (true)
+  {
+    char buffer[RECEIVEBUFFER] = {};
+    int nread = recv(m_connections[index]->m_socket, (char*)&buffer, RECEIVEBUFFER, 0);
+    if (nread < 0 && IsWouldBlock())
+      return true;
+    if (nread <= 0)
+    {
+      CLog::Log(LOGINFO, "JSONRPC Server: Disconnection detected");
+      return false;
+    }
+
+    std::string response;
+    if (m_connections[index]->IsNew())
+    {
+      CWebSocket *websocket = CWebSocketManager::Handle(buffer, nread, response);
+
+      // the server thread must never wait for room to send
+      if (response.size() > 0)
+        m_connections[index]->Send(response.c_str(), response.size(), false);
+
+      if (websocket != NULL)
       {
-        if (FD_ISSET(*it, &rfds))
-        {
-          CLog::Log(LOGDEBUG, "JSONRPC Server: New connection detected");
-          CTCPClient *newconnection = new CTCPClient();
-          newconnection->m_socket = accept(*it, (sockaddr*)&newconnection->m_cliaddr, &newconnection->m_addrlen);
-
-          if (newconnection->m_socket == INVALID_SOCKET)
-            CLog::Log(LOGERROR, "JSONRPC Server: Accept of new connection failed");
-          else
-          {
-            CLog::Log(LOGINFO, "JSONRPC Server: New connection added");
-            m_connections.push_back(newconnection);
-          }
-        }
+        // Replace the CTCPClient with a CWebSocketClient
+        CWebSocketClient *websocketClient = new CWebSocketClient(websocket, *(m_connections[index]));
+        CSingleLock lock(m_connectionsSection);
+        delete m_connections[index];
+        m_connections[index] = websocketClient;
       }
     }
+
+    if (response.size() <= 0)
+      m_connections[index]->PushBuffer(this, buffer, nread);
   }
+}
 
-  Deinitialize();
+int CTCPServer::FindConnection(SOCKET socket) const
+{
+  for (unsigned int i = 0; i < m_connections.size(); i++)
+  {
+    if (m_connections[i]->m_socket == socket)
+      return i;
+  }
+
+  return -1;
+}
+
+void CTCPServer::RemoveConnection(int index)
+{
+  CSingleLock lock(m_connectionsSection);
+  m_connections[index]->Disconnect();
+  // the request being processed still needs the client
+  if (m_connections[index]->IsProcessing())
+    m_disconnected.push_back(m_connections[index]);
+  else
+    delete m_connections[index];
+  m_connections.erase(m_connections.begin() + index);
 }
 
 bool CTCPServer::PrepareDownload(const char *path, CVariant &details, std::string &protocol)
@@ -211,6 +380,8 @@ void CTCPServer::Announce(AnnouncementFlag flag, const char *sender, const char
 {
   std::string str = IJSONRPCAnnouncer::AnnouncementToJSONRPC(flag, sender, message, data, g_advancedSettings.m_jsonOutputCompact);
 
+  // announcements come from a thread of their own, while the server thread may change the connections
+  CSingleLock connectionsLock(m_connectionsSection);
   for (unsigned int i = 0; i < m_connections.size(); i++)
   {
     {
@@ -219,7 +390,7 @@ void CTCPServer::Announce(AnnouncementFlag flag, const char *sender, const char
         continue;
     }
 
-    m_connections[i]->Send(str.c_str(), str.size());
+    m_connections[i]->SendAnnouncement(str);
   }
 }
 
@@ -229,12 +400,40 @@ bool CTCPServer::Initialize()
 
   bool started = false;
 
+#ifdef TARGET_LINUX
+  m_epoll = epoll_create(MAX_EVENTS);
+  if (m_epoll < 0)
+  {
+    CLog::Log(LOGERROR, "JSONRPC Server: Failed to create epoll instance");
+    return false;
+  }
+#endif
+
   started |= InitializeBlue();
   started |= InitializeTCP();
 
+  // the pending connections are accepted until there are none left
+  for (std::vector<SOCKET>::const_iterator it = m_servers.begin(); it != m_servers.end(); it++)
+  {
+    unsigned long nonblocking = 1;
+    ioctlsocket(*it, FIONBIO, &nonblocking);
+  }
+
+#ifdef TARGET_LINUX
+  for (std::vector<SOCKET>::const_iterator it = m_servers.begin(); it != m_servers.end(); it++)
+  {
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = *it;
+    if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, *it, &event) < 0)
+      CLog::Log(LOGERROR, "JSONRPC Server: Failed to watch serversocket");
+  }
+#endif
+
   if(started)
   {
-    CAnnouncementManager::AddAnnouncer(this);
+    // a slow client mustn't hold up the thread making an announcement
+    CAnnouncementManager::AddQueuedAnnouncer(this, "JSONRPC Announcer");
     CLog::Log(LOGINFO, "JSONRPC Server: Successfully initialized");
     return true;
   }
@@ -277,7 +476,7 @@ bool CTCPServer::InitializeBlue()
   if(getsockname(fd, (SOCKADDR*)&sa, &len) < 0)
     CLog::Log(LOGERROR, "JSONRPC Server: Failed to get bluetooth port");
 
-  if (listen(fd, 10) < 0)
+  if (listen(fd, SOMAXCONN) < 0)
   {
     CLog::Log(LOGERROR, "JSONRPC Server: Failed to listen to bluetooth port");
     closesocket(fd);
@@ -334,7 +533,7 @@ bool CTCPServer::InitializeBlue()
   if(getsockname(fd, (struct sockaddr*)&sa, &len) < 0)
     CLog::Log(LOGERROR, "JSONRPC Server: Failed to get bluetooth port");
 
-  if (listen(fd, 10) < 0)
+  if (listen(fd, SOMAXCONN) < 0)
   {
     CLog::Log(LOGERROR, "JSONRPC Server: Failed to listen to bluetooth port %d", sa.rc_channel);
     closesocket(fd);
@@ -451,7 +650,7 @@ bool CTCPServer::InitializeTCP()
     return false;
   }
 
-  if (listen(fd, 10) < 0)
+  if (listen(fd, SOMAXCONN) < 0)
   {
     CLog::Log(LOGERROR, "JSONRPC Server: Failed to set listen");
     closesocket(fd);
@@ -463,19 +662,39 @@ bool CTCPServer::InitializeTCP()
 
 void CTCPServer::Deinitialize()
 {
-  for (unsigned int i = 0; i < m_connections.size(); i++)
+  // don't hold the lock while waiting for the requests being processed
+  std::vector<CTCPClient*> connections;
   {
-    m_connections[i]->Disconnect();
-    delete m_connections[i];
+    CSingleLock lock(m_connectionsSection);
+    connections.swap(m_connections);
   }
 
-  m_connections.clear();
+  for (unsigned int i = 0; i < connections.size(); i++)
+  {
+    connections[i]->Disconnect();
+    connections[i]->CancelRequests();
+    delete connections[i];
+  }
+
+  for (unsigned int i = 0; i < m_disconnected.size(); i++)
+  {
+    m_disconnected[i]->CancelRequests();
+    delete m_disconnected[i];
+  }
+
+  m_disconnected.clear();
 
   for (unsigned int i = 0; i < m_servers.size(); i++)
     closesocket(m_servers[i]);
 
   m_servers.clear();
 
+#ifdef TARGET_LINUX
+  if (m_epoll >= 0)
+    close(m_epoll);
+  m_epoll = -1;
+#endif
+
 #ifdef HAVE_LIBBLUETOOTH
   if(m_sdpd)
     sdp_close( (sdp_session_t*)m_sdpd );
@@ -486,6 +705,7 @@ void CTCPServer::Deinitialize()
 }
 
 CTCPServer::CTCPClient::CTCPClient()
+  : m_processing(false), m_processed(true, true), m_sendOffset(0), m_responding(false)
 {
   m_new = true;
   m_announcementflags = ANNOUNCE_ALL;
@@ -499,6 +719,7 @@ CTCPServer::CTCPClient::CTCPClient()
 }
 
 CTCPServer::CTCPClient::CTCPClient(const CTCPClient& client)
+  : m_processing(false), m_processed(true, true), m_sendOffset(0), m_responding(false)
 {
   Copy(client);
 }
@@ -525,14 +746,104 @@ bool CTCPServer::CTCPClient::SetAnnouncementFlags(int flags)
   return true;
 }
 
-void CTCPServer::CTCPClient::Send(const char *data, unsigned int size)
+bool CTCPServer::CTCPClient::Send(const char *data, unsigned int size, bool wait /* = true */)
+{
+  CSingleLock lock (m_critSection);
+  while (m_sendBuffer.size() - m_sendOffset + size > MAX_SENDBUFFER && m_sendBuffer.size() > m_sendOffset)
+  {
+    if (!wait || m_socket == INVALID_SOCKET)
+      return false;
+
+    // wait for the server to send some of the queued data
+    lock.Leave();
+    m_sendRoom.WaitMSec(500);
+    lock.Enter();
+  }
+
+  if (m_socket == INVALID_SOCKET)
+    return false;
+
+  m_sendBuffer.append(data, size);
+  // anything the socket doesn't take now is sent by the server once it can be
+  Flush();
+  return true;
+}
+
+bool CTCPServer::CTCPClient::Flush()
+{
+  CSingleLock lock (m_critSection);
+  bool sent = false;
+  while (m_sendOffset < m_sendBuffer.size())
+  {
+    int result = send(m_socket, m_sendBuffer.c_str() + m_sendOffset, m_sendBuffer.size() - m_sendOffset, 0);
+    if (result < 0 && IsWouldBlock())
+      break;
+    if (result <= 0)
+    {
+      m_sendBuffer.clear();
+      m_sendOffset = 0;
+      m_sendRoom.Set();
+      return false;
+    }
+    m_sendOffset += result;
+    sent = true;
+  }
+
+  // drop what has been sent once it is a good part of the buffer
+  if (m_sendOffset == m_sendBuffer.size() || m_sendOffset > MAX_SENDBUFFER / 2)
+  {
+    m_sendBuffer.erase(0, m_sendOffset);
+    m_sendOffset = 0;
+  }
+
+  if (sent)
+    m_sendRoom.Set();
+
+  return true;
+}
+
+bool CTCPServer::CTCPClient::HasPendingData()
+{
+  CSingleLock lock (m_critSection);
+  return m_sendOffset < m_sendBuffer.size();
+}
+
+void CTCPServer::CTCPClient::SendResponse(const CVariant &response)
 {
-  unsigned int sent = 0;
-  do
   {
     CSingleLock lock (m_critSection);
-    sent += send(m_socket, data, size - sent, 0);
-  } while (sent < size);
+    m_responding = true;
+  }
+
+  // send the response while it is written rather than writing all of it first
+  CJSONVariantStream stream(response, g_advancedSettings.m_jsonOutputCompact);
+  std::string chunk;
+  while (stream.Read(chunk))
+    Send(chunk.c_str(), chunk.size());
+
+  // send the announcements held back while the response was sent, before any new one
+  CSingleLock lock (m_critSection);
+  m_responding = false;
+  if (!m_heldAnnouncements.empty())
+  {
+    Send(m_heldAnnouncements.c_str(), m_heldAnnouncements.size(), false);
+    m_heldAnnouncements.clear();
+  }
+}
+
+void CTCPServer::CTCPClient::SendAnnouncement(const std::string &announcement)
+{
+  CSingleLock lock (m_critSection);
+  // an announcement mustn't end up between two chunks of a response
+  if (m_responding)
+  {
+    if (m_heldAnnouncements.size() + announcement.size() <= MAX_SENDBUFFER)
+      m_heldAnnouncements.append(announcement);
+    return;
+  }
+
+  // a client which doesn't keep up misses the announcement rather than holding up the others
+  Send(announcement.c_str(), announcement.size(), false);
 }
 
 void CTCPServer::CTCPClient::PushBuffer(CTCPServer *host, const char *buffer, int length)
@@ -561,10 +872,15 @@ void CTCPServer::CTCPClient::PushBuffer(CTCPServer *host, const char *buffer, in
         m_beginBrackets++;
       else if (c == m_endChar)
         m_endBrackets++;
-      if (m_beginBrackets > 0 && m_endBrackets > 0 && m_beginBrackets == m_endBrackets)
+      if (m_buffer.size() > MAX_REQUEST)
+      {
+        CLog::Log(LOGERROR, "JSONRPC Server: Dropping request exceeding %d bytes", MAX_REQUEST);
+        m_beginChar = m_beginBrackets = m_endBrackets = 0;
+        m_buffer.clear();
+      }
+      else if (m_beginBrackets > 0 && m_endBrackets > 0 && m_beginBrackets == m_endBrackets)
       {
-        std::string line = CJSONRPC::MethodCall(m_buffer, host, this);
-        Send(line.c_str(), line.size());
+        QueueRequest(host, m_buffer);
         m_beginChar = m_beginBrackets = m_endBrackets = 0;
         m_buffer.clear();
       }
@@ -572,6 +888,67 @@ void CTCPServer::CTCPClient::PushBuffer(CTCPServer *host, const char *buffer, in
   }
 }
 
+void CTCPServer::CTCPClient::QueueRequest(CTCPServer *host, const std::string &request)
+{
+  CSingleLock lock(m_requestSection);
+  m_requests.push_back(request);
+
+  // the server keeps receiving while the requests are processed
+  if (!m_processing)
+  {
+    m_processing = true;
+    m_processed.Reset();
+    if (CJobManager::GetInstance().AddJob(new CRequestJob(host, this), NULL, CJob::PRIORITY_HIGH) == 0)
+      CLog::Log(LOGWARNING, "JSONRPC Server: Dropped a request received while shutting down");
+  }
+}
+
+void CTCPServer::CTCPClient::ProcessRequests(CTCPServer *host)
+{
+  while (true)
+  {
+    std::string request;
+    {
+      CSingleLock lock(m_requestSection);
+      if (m_requests.empty())
+      {
+        m_processing = false;
+        m_processed.Set();
+        return;
+      }
+      request.swap(m_requests.front());
+      m_requests.pop_front();
+    }
+
+    CVariant response;
+    if (CJSONRPC::MethodCall(request, host, this, response))
+      SendResponse(response);
+  }
+}
+
+void CTCPServer::CTCPClient::AbandonRequests()
+{
+  CSingleLock lock(m_requestSection);
+  m_requests.clear();
+  m_processing = false;
+  m_processed.Set();
+}
+
+bool CTCPServer::CTCPClient::IsProcessing()
+{
+  CSingleLock lock(m_requestSection);
+  return m_processing;
+}
+
+void CTCPServer::CTCPClient::CancelRequests()
+{
+  {
+    CSingleLock lock(m_requestSection);
+    m_requests.clear();
+  }
+  m_processed.Wait();
+}
+
 void CTCPServer::CTCPClient::Disconnect()
 {
   if (m_socket > 0)
@@ -580,6 +957,9 @@ void CTCPServer::CTCPClient::Disconnect()
     shutdown(m_socket, SHUT_RDWR);
     closesocket(m_socket);
     m_socket = INVALID_SOCKET;
+    m_sendBuffer.clear();
+    m_sendOffset = 0;
+    m_sendRoom.Set();
   }
 }
 
@@ -595,6 +975,8 @@ void CTCPServer::CTCPClient::Copy(const CTCPClient& client)
   m_beginChar         = client.m_beginChar;
   m_endChar           = client.m_endChar;
   m_buffer            = client.m_buffer;
+  m_sendBuffer        = client.m_sendBuffer;
+  m_sendOffset        = client.m_sendOffset;
 }
 
 CTCPServer::CWebSocketClient::CWebSocketClient(CWebSocket *websocket)
@@ -630,15 +1012,26 @@ CTCPServer::CWebSocketClient& CTCPServer::CWebSocketClient::operator=(const CWeb
   return *this;
 }
 
-void CTCPServer::CWebSocketClient::Send(const char *data, unsigned int size)
+bool CTCPServer::CWebSocketClient::Send(const char *data, unsigned int size, bool wait /* = true */)
 {
   const CWebSocketMessage *msg = m_websocket->Send(WebSocketTextFrame, data, size);
   if (msg == NULL || !msg->IsComplete())
-    return;
+    return false;
 
+  // queue the frames together, so that the message is either sent or dropped as a whole
+  std::string message;
   std::vector<const CWebSocketFrame *> frames = msg->GetFrames();
   for (unsigned int index = 0; index < frames.size(); index++)
-    CTCPClient::Send(frames.at(index)->GetFrameData(), (unsigned int)frames.at(index)->GetFrameLength());
+    message.append(frames.at(index)->GetFrameData(), (unsigned int)frames.at(index)->GetFrameLength());
+
+  return CTCPClient::Send(message.c_str(), message.size(), wait);
+}
+
+void CTCPServer::CWebSocketClient::SendResponse(const CVariant &response)
+{
+  // a response has to be sent as a single message
+  std::string message = CJSONVariantWriter::Write(response, g_advancedSettings.m_jsonOutputCompact);
+  Send(message.c_str(), message.size());
 }
 
 void CTCPServer::CWebSocketClient::PushBuffer(CTCPServer *host, const char *buffer, int length)
@@ -650,8 +1043,10 @@ void CTCPServer::CWebSocketClient::PushBuffer(CTCPServer *host, const char *buff
     std::vector<const CWebSocketFrame *> frames = msg->GetFrames();
     if (send)
     {
+      // the frames are framed already, and this runs on the server thread which must never wait
+      // for room to send, so a reply which doesn't fit in the queue is dropped
       for (unsigned int index = 0; index < frames.size(); index++)
-        Send(frames.at(index)->GetFrameData(), (unsigned int)frames.at(index)->GetFrameLength());
+        CTCPClient::Send(frames.at(index)->GetFrameData(), (unsigned int)frames.at(index)->GetFrameLength(), false);
     }
     else
     {
@@ -674,7 +1069,7 @@ void CTCPServer::CWebSocketClient::Disconnect()
     {
       const CWebSocketFrame *closeFrame = m_websocket->Close();
       if (closeFrame)
-        Send(closeFrame->GetFrameData(), (unsigned int)closeFrame->GetFrameLength());
+        CTCPClient::Send(closeFrame->GetFrameData(), (unsigned int)closeFrame->GetFrameLength(), false);
     }
 
     if (m_websocket->GetState() == WebSocketStateClosed)
@@ -20,6 +20,7 @@
  *
  */
 
+#include <deque>
 #include <vector>
 #include <sys/socket.h>
 
@@ -27,6 +28,7 @@
 #include "interfaces/json-rpc/IJSONRPCAnnouncer.h"
 #include "interfaces/json-rpc/ITransportLayer.h"
 #include "threads/CriticalSection.h"
+#include "threads/Event.h"
 #include "threads/Thread.h"
 #include "websocket/WebSocket.h"
 
@@ -52,6 +54,12 @@ namespace JSONRPC
     bool InitializeTCP();
     void Deinitialize();
 
+    bool WaitForSockets(std::vector<SOCKET> &readable, std::vector<SOCKET> &writable);
+    bool AcceptConnection(SOCKET server);
+    bool ReadConnection(int index);
+    int  FindConnection(SOCKET socket) const;
+    void RemoveConnection(int index);
+
     class CTCPClient : public IClient
     {
     public:
@@ -66,12 +74,55 @@ namespace JSONRPC
       virtual int  GetAnnouncementFlags();
       virtual bool SetAnnouncementFlags(int flags);
 
-      virtual void Send(const char *data, unsigned int size);
+      /*!
+       \brief Queue data to be sent, and send as much of it as the socket takes
+       without blocking. The rest is sent by the server once the socket can take it.
+       \param wait whether to wait for the queue to have room for the data, or to drop it.
+       Only worker threads may wait, as the room is made by the server thread.
+       \return true if the data was queued, false if it was dropped
+       */
+      virtual bool Send(const char *data, unsigned int size, bool wait = true);
+      virtual void SendResponse(const CVariant &response);
+
+      /*!
+       \brief Queue an announcement without waiting, unless a response is being sent, in which
+       case the announcement is sent once the response has been
+       */
+      void SendAnnouncement(const std::string &announcement);
       virtual void PushBuffer(CTCPServer *host, const char *buffer, int length);
       virtual void Disconnect();
 
       virtual bool IsNew() const { return m_new; }
 
+      /*!
+       \brief Send as much of the queued data as the socket takes without blocking
+       \return false if the connection failed, true otherwise
+       */
+      bool Flush();
+      bool HasPendingData();
+
+      /*!
+       \brief Run the requests received so far on a worker thread, one
+       after another, and send back their responses in the same order
+       */
+      void ProcessRequests(CTCPServer *host);
+
+      /*!
+       \brief Drop the requests received so far, as they won't be processed
+       */
+      void AbandonRequests();
+
+      /*!
+       \brief Whether a request is being processed on a worker thread
+       */
+      bool IsProcessing();
+
+      /*!
+       \brief Drop the requests which haven't been processed yet and wait
+       for the one being processed, if any
+       */
+      void CancelRequests();
+
       SOCKET           m_socket;
       sockaddr_storage m_cliaddr;
       socklen_t        m_addrlen;
@@ -79,7 +130,19 @@ namespace JSONRPC
 
     protected:
       void Copy(const CTCPClient& client);
+      void QueueRequest(CTCPServer *host, const std::string &request);
     private:
+      std::string m_sendBuffer;
+      size_t m_sendOffset;
+      CEvent m_sendRoom;
+      bool m_responding;
+      std::string m_heldAnnouncements;
+
+      std::deque<std::string> m_requests;
+      bool m_processing;
+      CEvent m_processed;
+      CCriticalSection m_requestSection;
+
       bool m_new;
       int m_announcementflags;
       int m_beginBrackets, m_endBrackets;
@@ -96,7 +159,14 @@ namespace JSONRPC
       CWebSocketClient& operator=(const CWebSocketClient& client);
       ~CWebSocketClient();
 
-      virtual void Send(const char *data, unsigned int size);
+      virtual bool Send(const char *data, unsigned int size, bool wait = true);
+      virtual void SendResponse(const CVariant &response);
+
+      /*!
+       \brief Queue an announcement without waiting, unless a response is being sent, in which
+       case the announcement is sent once the response has been
+       */
+      void SendAnnouncement(const std::string &announcement);
       virtual void PushBuffer(CTCPServer *host, const char *buffer, int length);
       virtual void Disconnect();
 
@@ -106,11 +176,18 @@ namespace JSONRPC
       CWebSocket *m_websocket;
     };
 
+    class CRequestJob;
+
     std::vector<CTCPClient*> m_connections;
+    CCriticalSection m_connectionsSection; // held by the server thread to change m_connections, and to read it elsewhere
+    std::vector<CTCPClient*> m_disconnected; // waiting for their last request to be processed
     std::vector<SOCKET> m_servers;
     int m_port;
     bool m_nonlocal;
     void* m_sdpd;
+#ifdef TARGET_LINUX
+    int m_epoll;
+#endif
 
     static CTCPServer *ServerInstance;
   };
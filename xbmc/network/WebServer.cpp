@@ -22,11 +22,17 @@
 #include "WebServer.h"
 #ifdef HAS_WEB_SERVER
 #include "filesystem/File.h"
+#include "filesystem/SpecialProtocol.h"
 #include "utils/log.h"
+#include "utils/StringUtils.h"
 #include "utils/URIUtils.h"
 #include "utils/Variant.h"
 #include "utils/Base64.h"
 #include "threads/SingleLock.h"
+#include "threads/SystemClock.h"
+#include "settings/AdvancedSettings.h"
+#include "utils/CPUInfo.h"
+#include "network/httprequesthandler/HTTPRequestStatistics.h"
 #include "XBDateTime.h"
 #include "URL.h"
 
@@ -39,12 +45,159 @@
 #define PAGE_FILE_NOT_FOUND "<html><head><title>File not found</title></head><body>File not found</body></html>"
 #define NOT_SUPPORTED       "<html><head><title>Not Supported</title></head><body>The method you are trying to use is not supported by this server</body></html>"
 
+#ifndef MHD_SIZE_UNKNOWN
+#define MHD_SIZE_UNKNOWN    -1
+#endif
+
+#if defined(TARGET_POSIX) && (MHD_VERSION >= 0x00090500)
+#define HAS_FILE_DESCRIPTOR_RESPONSE
+#include <fcntl.h>
+#endif
+
+#define FILE_READ_BLOCK_SIZE  2048
+#define VFS_READ_BLOCK_SIZE   65536
+#define MAX_RANGES            16
+#define RANGE_BOUNDARY        "XBMC-BYTERANGES-BOUNDARY"
+
 using namespace XFILE;
 using namespace std;
 using namespace JSONRPC;
 
 vector<IHTTPRequestHandler *> CWebServer::m_requestHandlers;
 
+typedef pair<int64_t, int64_t> HttpRange; // first and last byte
+
+/*! \brief Reads the body of a response made of (ranges of) a file
+ and the text surrounding them, like the parts of a multipart/byteranges response.
+ */
+class CHttpFileReader
+{
+public:
+  CHttpFileReader(CFile *file) : m_file(file), m_size(0) { }
+  ~CHttpFileReader()
+  {
+    m_file->Close();
+    delete m_file;
+  }
+
+  void AddText(const string &text)
+  {
+    Segment segment = { m_size, (int64_t)text.size(), -1, text };
+    m_segments.push_back(segment);
+    m_size += text.size();
+  }
+
+  void AddRange(int64_t first, int64_t last)
+  {
+    Segment segment = { m_size, last - first + 1, first, "" };
+    m_segments.push_back(segment);
+    m_size += last - first + 1;
+  }
+
+  int64_t GetSize() const { return m_size; }
+
+  int Read(uint64_t pos, char *buf, int max)
+  {
+    for (vector<Segment>::const_iterator it = m_segments.begin(); it != m_segments.end(); it++)
+    {
+      if ((int64_t)pos >= it->start + it->length)
+        continue;
+
+      int64_t offset = pos - it->start;
+      int size = (int)min((int64_t)max, it->length - offset);
+      if (it->fileOffset < 0)
+      {
+        memcpy(buf, it->text.c_str() + offset, size);
+        return size;
+      }
+
+      if (it->fileOffset + offset != m_file->GetPosition() &&
+          m_file->Seek(it->fileOffset + offset) < 0)
+        return -1;
+      unsigned int res = m_file->Read(buf, size);
+      if (res == 0)
+        return -1;
+      return res;
+    }
+    return -1;
+  }
+
+private:
+  typedef struct Segment
+  {
+    int64_t start;      // position in the body
+    int64_t length;
+    int64_t fileOffset; // -1 for text
+    string  text;
+  } Segment;
+
+  CFile *m_file;
+  vector<Segment> m_segments;
+  int64_t m_size;
+};
+
+/*! \brief Parse the value of a Range header
+ \param header the value, eg. "bytes=0-499,1000-"
+ \param size size of the file
+ \param ranges [out] the requested ranges, left empty if the whole file is to be sent
+ \return false if none of the requested ranges can be satisfied, true otherwise
+ */
+static bool ParseRangeHeader(const string &header, int64_t size, vector<HttpRange> &ranges)
+{
+  ranges.clear();
+  // anything we can't make sense of is ignored, and the whole file is sent
+  if (header.compare(0, 6, "bytes=") != 0 || size <= 0)
+    return true;
+
+  vector<HttpRange> parsed;
+  CStdStringArray specs;
+  StringUtils::SplitString(header.substr(6), ",", specs);
+  for (unsigned int i = 0; i < specs.size(); i++)
+  {
+    CStdString spec = specs[i];
+    spec.Trim();
+    size_t dash = spec.find('-');
+    if (dash == string::npos || spec.find_first_not_of("0123456789-") != string::npos)
+      return true;
+
+    CStdString first = spec.substr(0, dash);
+    CStdString last = spec.substr(dash + 1);
+    HttpRange range;
+    if (first.IsEmpty())
+    {
+      // the last n bytes
+      if (last.IsEmpty())
+        return true;
+      int64_t suffix = _atoi64(last.c_str());
+      if (suffix <= 0)
+        continue;
+      range.first = max((int64_t)0, size - suffix);
+      range.second = size - 1;
+    }
+    else
+    {
+      range.first = _atoi64(first.c_str());
+      range.second = last.IsEmpty() ? size - 1 : (int64_t)_atoi64(last.c_str());
+      if (range.second < range.first)
+        return true;
+      if (range.first >= size)
+        continue;
+      range.second = min(range.second, size - 1);
+    }
+    parsed.push_back(range);
+  }
+
+  if (parsed.empty())
+    return false;
+
+  // sending many small ranges costs more than sending the whole file
+  if (parsed.size() > MAX_RANGES)
+    return true;
+
+  ranges = parsed;
+  return true;
+}
+
 CWebServer::CWebServer()
 {
   m_running = false;
@@ -267,6 +420,19 @@ int CWebServer::HandleRequest(IHTTPRequestHandler *handler, const HTTPRequest &r
   if (handler == NULL)
     return SendErrorResponse(request.connection, MHD_HTTP_INTERNAL_SERVER_ERROR, request.method);
 
+  std::string name = handler->GetName();
+  CHTTPRequestStatistics::Get().StartRequest();
+  unsigned int start = XbmcThreads::SystemClockMillis();
+
+  int responseCode = MHD_HTTP_INTERNAL_SERVER_ERROR;
+  int ret = HandleRequest(handler, request, responseCode);
+
+  CHTTPRequestStatistics::Get().EndRequest(name, XbmcThreads::SystemClockMillis() - start, responseCode);
+  return ret;
+}
+
+int CWebServer::HandleRequest(IHTTPRequestHandler *handler, const HTTPRequest &request, int &responseCode)
+{
   int ret = handler->HandleHTTPRequest(request);
   if (ret == MHD_NO)
   {
@@ -275,6 +441,7 @@ int CWebServer::HandleRequest(IHTTPRequestHandler *handler, const HTTPRequest &r
   }
 
   struct MHD_Response *response = NULL;
+  responseCode = handler->GetHTTPResonseCode();
   switch (handler->GetHTTPResponseType())
   {
     case HTTPNone:
@@ -286,7 +453,7 @@ int CWebServer::HandleRequest(IHTTPRequestHandler *handler, const HTTPRequest &r
       break;
 
     case HTTPFileDownload:
-      ret = CreateFileDownloadResponse(request.connection, handler->GetHTTPResponseFile(), request.method, response);
+      ret = CreateFileDownloadResponse(request.connection, handler->GetHTTPResponseFile(), request.method, response, responseCode);
       break;
 
     case HTTPMemoryDownloadNoFreeNoCopy:
@@ -305,18 +472,24 @@ int CWebServer::HandleRequest(IHTTPRequestHandler *handler, const HTTPRequest &r
       ret = CreateMemoryDownloadResponse(request.connection, handler->GetHTTPResponseData(), handler->GetHTTPResonseDataLength(), true, true, response);
       break;
 
+    case HTTPStreamDownload:
+      ret = CreateStreamDownloadResponse(request.connection, handler->GetHTTPResponseStream(), response);
+      break;
+
     case HTTPError:
       ret = CreateErrorResponse(request.connection, handler->GetHTTPResonseCode(), request.method, response);
       break;
 
     default:
       delete handler;
+      responseCode = MHD_HTTP_INTERNAL_SERVER_ERROR;
       return SendErrorResponse(request.connection, MHD_HTTP_INTERNAL_SERVER_ERROR, request.method);
   }
 
   if (ret == MHD_NO)
   {
     delete handler;
+    responseCode = MHD_HTTP_INTERNAL_SERVER_ERROR;
     return SendErrorResponse(request.connection, MHD_HTTP_INTERNAL_SERVER_ERROR, request.method);
   }
 
@@ -324,7 +497,7 @@ int CWebServer::HandleRequest(IHTTPRequestHandler *handler, const HTTPRequest &r
   for (multimap<string, string>::const_iterator it = header.begin(); it != header.end(); it++)
     MHD_add_response_header(response, it->first.c_str(), it->second.c_str());
 
-  MHD_queue_response(request.connection, handler->GetHTTPResonseCode(), response);
+  MHD_queue_response(request.connection, responseCode, response);
   MHD_destroy_response(response);
   delete handler;
 
@@ -354,25 +527,114 @@ int CWebServer::CreateRedirect(struct MHD_Connection *connection, const string &
   return MHD_NO;
 }
 
-int CWebServer::CreateFileDownloadResponse(struct MHD_Connection *connection, const string &strURL, HTTPMethod methodType, struct MHD_Response *&response)
+int CWebServer::CreateFileDownloadResponse(struct MHD_Connection *connection, const string &strURL, HTTPMethod methodType, struct MHD_Response *&response, int &responseCode)
 {
   CFile *file = new CFile();
 
-  if (file->Open(strURL, READ_NO_CACHE))
+  // local files are read as they are sent, others are read ahead in the background
+  bool local = URIUtils::IsHD(strURL);
+  if (file->Open(strURL, local ? READ_NO_CACHE : READ_CACHED | READ_CHUNKED))
   {
-    if (methodType != HEAD)
+    int64_t fileLength = file->GetLength();
+    CStdString ext = URIUtils::GetExtension(strURL);
+    ext = ext.ToLower();
+    const char *mime = CreateMimeTypeFromExtension(ext.c_str());
+
+    vector<HttpRange> ranges;
+    if (methodType == GET && !ParseRangeHeader(GetRequestHeaderValue(connection, MHD_HEADER_KIND, "Range"), fileLength, ranges))
     {
-      response = MHD_create_response_from_callback ( file->GetLength(),
-                                                     2048,
-                                                     &CWebServer::ContentReaderCallback, file,
-                                                     &CWebServer::ContentReaderFreeCallback);
-      if (response == NULL)
+      file->Close();
+      delete file;
+
+      CStdString contentRange;
+      contentRange.Format("bytes */%" PRId64, fileLength);
+      responseCode = MHD_HTTP_REQUESTED_RANGE_NOT_SATISFIABLE;
+      if (CreateErrorResponse(connection, responseCode, methodType, response) == MHD_NO)
         return MHD_NO;
+      MHD_add_response_header(response, "Content-Range", contentRange);
+      return MHD_YES;
+    }
+
+    if (methodType != HEAD)
+    {
+      CStdString contentRange;
+      if (ranges.size() == 1)
+      {
+        contentRange.Format("bytes %" PRId64 "-%" PRId64 "/%" PRId64, ranges[0].first, ranges[0].second, fileLength);
+        responseCode = MHD_HTTP_PARTIAL_CONTENT;
+      }
+
+#ifdef HAS_FILE_DESCRIPTOR_RESPONSE
+      // a local file (or a range of it) is sent by the kernel, without being copied through here
+      int64_t offset = ranges.empty() ? 0 : ranges[0].first;
+      int64_t length = ranges.empty() ? fileLength : ranges[0].second - ranges[0].first + 1;
+      int fd = -1;
+#if (MHD_VERSION >= 0x00093300)
+      if (local && ranges.size() <= 1)
+#else
+      // before 0.9.33 the length is a size_t and the offset an off_t, which may not hold them
+      if (local && ranges.size() <= 1 && (int64_t)(size_t)length == length && (int64_t)(off_t)offset == offset)
+#endif
+        fd = open(CSpecialProtocol::TranslatePath(strURL).c_str(), O_RDONLY);
+      if (fd >= 0)
+      {
+        file->Close();
+        delete file;
+
+#if (MHD_VERSION >= 0x00093300)
+        response = MHD_create_response_from_fd_at_offset64(length, fd, offset);
+#else
+        response = MHD_create_response_from_fd_at_offset((size_t)length, fd, (off_t)offset);
+#endif
+        if (response == NULL)
+        {
+          close(fd);
+          return MHD_NO;
+        }
+      }
+      else
+#endif
+      {
+        CHttpFileReader *reader = new CHttpFileReader(file);
+        if (ranges.empty())
+          reader->AddRange(0, fileLength - 1);
+        else if (ranges.size() == 1)
+          reader->AddRange(ranges[0].first, ranges[0].second);
+        else
+        {
+          // every range is sent as a part of a multipart/byteranges body
+          for (vector<HttpRange>::const_iterator range = ranges.begin(); range != ranges.end(); range++)
+          {
+            CStdString part;
+            part.Format("\r\n--" RANGE_BOUNDARY "\r\nContent-Type: %s\r\nContent-Range: bytes %" PRId64 "-%" PRId64 "/%" PRId64 "\r\n\r\n",
+                        mime ? mime : "application/octet-stream", range->first, range->second, fileLength);
+            reader->AddText(part);
+            reader->AddRange(range->first, range->second);
+          }
+          reader->AddText("\r\n--" RANGE_BOUNDARY "--\r\n");
+          responseCode = MHD_HTTP_PARTIAL_CONTENT;
+        }
+
+        response = MHD_create_response_from_callback ( reader->GetSize(),
+                                                       local ? FILE_READ_BLOCK_SIZE : VFS_READ_BLOCK_SIZE,
+                                                       &CWebServer::ContentReaderCallback, reader,
+                                                       &CWebServer::ContentReaderFreeCallback);
+        if (response == NULL)
+        {
+          delete reader;
+          return MHD_NO;
+        }
+      }
+
+      if (!contentRange.IsEmpty())
+        MHD_add_response_header(response, "Content-Range", contentRange);
+      if (ranges.size() > 1)
+        mime = "multipart/byteranges; boundary=" RANGE_BOUNDARY;
     }
     else
     {
       CStdString contentLength;
-      contentLength.Format("%I64d", file->GetLength());
+      contentLength.Format("%I64d", fileLength);
       file->Close();
       delete file;
 
@@ -382,9 +644,7 @@ int CWebServer::CreateFileDownloadResponse(struct MHD_Connection *connection, co
       MHD_add_response_header(response, "Content-Length", contentLength);
     }
 
-    CStdString ext = URIUtils::GetExtension(strURL);
-    ext = ext.ToLower();
-    const char *mime = CreateMimeTypeFromExtension(ext.c_str());
+    MHD_add_response_header(response, "Accept-Ranges", "bytes");
     if (mime)
       MHD_add_response_header(response, "Content-Type", mime);
 
@@ -435,6 +695,23 @@ int CWebServer::CreateMemoryDownloadResponse(struct MHD_Connection *connection,
   return MHD_NO;
 }
 
+int CWebServer::CreateStreamDownloadResponse(struct MHD_Connection *connection, IHTTPResponseStream *stream, struct MHD_Response *&response)
+{
+  if (stream == NULL)
+    return MHD_NO;
+
+  // the length of the response isn't known, so it is sent with chunked transfer encoding
+  response = MHD_create_response_from_callback (MHD_SIZE_UNKNOWN,
+                                                16384,
+                                                &CWebServer::StreamReaderCallback, stream,
+                                                &CWebServer::StreamReaderFreeCallback);
+  if (response)
+    return MHD_YES;
+
+  delete stream;
+  return MHD_NO;
+}
+
 int CWebServer::SendErrorResponse(struct MHD_Connection *connection, int errorType, HTTPMethod method)
 {
   struct MHD_Response *response = NULL;
@@ -462,21 +739,37 @@ int CWebServer::ContentReaderCallback(void *cls, uint64_t pos, char *buf, int ma
 int CWebServer::ContentReaderCallback(void *cls, size_t pos, char *buf, int max)
 #endif
 {
-  CFile *file = (CFile *)cls;
-  if((unsigned int)pos != file->GetPosition())
-    file->Seek(pos);
-  unsigned res = file->Read(buf, max);
-  if(res == 0)
-    return -1;
-  return res;
+  return ((CHttpFileReader *)cls)->Read(pos, buf, max);
 }
 
 void CWebServer::ContentReaderFreeCallback(void *cls)
 {
-  CFile *file = (CFile *)cls;
-  file->Close();
+  delete (CHttpFileReader *)cls;
+}
 
-  delete file;
+#if (MHD_VERSION >= 0x00090200)
+ssize_t CWebServer::StreamReaderCallback (void *cls, uint64_t pos, char *buf, size_t max)
+#elif (MHD_VERSION >= 0x00040001)
+int CWebServer::StreamReaderCallback(void *cls, uint64_t pos, char *buf, int max)
+#else   //libmicrohttpd < 0.4.0
+int CWebServer::StreamReaderCallback(void *cls, size_t pos, char *buf, int max)
+#endif
+{
+  IHTTPResponseStream *stream = (IHTTPResponseStream *)cls;
+  int res = stream->Read(buf, max);
+#ifdef MHD_CONTENT_READER_END_WITH_ERROR
+  // a response which failed half way must not look complete to the client
+  if (res < 0)
+    return MHD_CONTENT_READER_END_WITH_ERROR;
+#endif
+  if (res <= 0)
+    return -1;
+  return res;
+}
+
+void CWebServer::StreamReaderFreeCallback(void *cls)
+{
+  delete (IHTTPResponseStream *)cls;
 }
 
 struct MHD_Daemon* CWebServer::StartMHD(unsigned int flags, int port)
@@ -484,10 +777,35 @@ struct MHD_Daemon* CWebServer::StartMHD(unsigned int flags, int port)
   // WARNING: when using MHD_USE_THREAD_PER_CONNECTION, set MHD_OPTION_CONNECTION_TIMEOUT to something higher than 1
   // otherwise on libmicrohttpd 0.4.4-1 it spins a busy loop
 
-  unsigned int timeout = 60 * 60 * 24;
+  unsigned int timeout = g_advancedSettings.m_webserverConnectionTimeout;
   // MHD_USE_THREAD_PER_CONNECTION = one thread per connection
   // MHD_USE_SELECT_INTERNALLY = use main thread for each connection, can only handle one request at a time [unless you set the thread pool size]
 
+  if (flags & MHD_USE_THREAD_PER_CONNECTION)
+  {
+    CLog::Log(LOGDEBUG, "WebServer: handling every connection on a thread of its own");
+    return MHD_start_daemon(flags,
+                            port,
+                            NULL,
+                            NULL,
+                            &CWebServer::AnswerToConnection,
+                            this,
+                            MHD_OPTION_CONNECTION_LIMIT, 512,
+                            MHD_OPTION_CONNECTION_TIMEOUT, timeout,
+                            MHD_OPTION_URI_LOG_CALLBACK, &CWebServer::UriRequestLogger, this,
+                            MHD_OPTION_END);
+  }
+
+#if (MHD_VERSION >= 0x00040002)
+  // requests block the thread handling them until their response is created (eg. while a JSON-RPC
+  // method runs or a file is opened), so there is a thread for every core unless configured otherwise.
+  // There are never fewer than the 4 threads there used to be, as most of the time is spent waiting.
+  unsigned int threads = g_advancedSettings.m_webserverThreads;
+  if (threads == 0)
+    threads = std::max(g_cpuInfo.getCPUCount(), 4);
+  CLog::Log(LOGDEBUG, "WebServer: handling connections on a pool of %u threads", threads);
+#endif
+
   return MHD_start_daemon(flags,
                           port,
                           NULL,
@@ -495,7 +813,7 @@ struct MHD_Daemon* CWebServer::StartMHD(unsigned int flags, int port)
                           &CWebServer::AnswerToConnection,
                           this,
 #if (MHD_VERSION >= 0x00040002)
-                          MHD_OPTION_THREAD_POOL_SIZE, 4,
+                          MHD_OPTION_THREAD_POOL_SIZE, threads,
 #endif
                           MHD_OPTION_CONNECTION_LIMIT, 512,
                           MHD_OPTION_CONNECTION_TIMEOUT, timeout,
@@ -508,7 +826,7 @@ bool CWebServer::Start(int port, const string &username, const string &password)
   SetCredentials(username, password);
   if (!m_running)
   {
-    m_daemon = StartMHD(MHD_USE_SELECT_INTERNALLY, port);
+    m_daemon = StartMHD(g_advancedSettings.m_webserverThreadPerConnection ? MHD_USE_THREAD_PER_CONNECTION : MHD_USE_SELECT_INTERNALLY, port);
 
     m_running = m_daemon != NULL;
     if (m_running)
@@ -22,10 +22,62 @@
 #include "HTTPImageHandler.h"
 #include "network/WebServer.h"
 #include "URL.h"
+#include "TextureCache.h"
 #include "filesystem/ImageFile.h"
+#include "settings/AdvancedSettings.h"
+
+#include <stdlib.h>
 
 using namespace std;
 
+static unsigned int GetSizeArgument(const HTTPRequest &request, const std::string &name, unsigned int maxSize)
+{
+  string value = CWebServer::GetRequestHeaderValue(request.connection, MHD_GET_ARGUMENT_KIND, name);
+  if (value.empty())
+    return 0;
+
+  int size = atoi(value.c_str());
+  if (size <= 0)
+    return 0;
+
+  // every size gets its own cached variant, so round it up to one of a few sizes, which keeps
+  // the number of variants of an image small whatever sizes the clients ask for
+  static const unsigned int sizes[] = { 64, 128, 256, 512, 1024 };
+  unsigned int bucket = maxSize;
+  for (unsigned int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+  {
+    if ((unsigned int)size <= sizes[i])
+    {
+      bucket = sizes[i];
+      break;
+    }
+  }
+
+  // the texture cache never caches images larger than this, so don't cache the same variant twice
+  return std::min(bucket, maxSize);
+}
+
+/*!
+ \brief Get the URL of a variant of an image scaled down to fit the given size
+ The variant is cached by the texture cache like any other image, under its own URL.
+ */
+static CStdString GetScaledImageURL(const CStdString &path, unsigned int width, unsigned int height)
+{
+  CStdString options;
+  if (width > 0)
+    options.AppendFormat("width=%u", width);
+  if (height > 0)
+    options.AppendFormat("%sheight=%u", options.IsEmpty() ? "" : "&", height);
+
+  if (path.compare(0, 8, "image://") != 0)
+    return CTextureCache::GetWrappedImageURL(path, "", options);
+
+  // already wrapped (the wrapped path is encoded, so any '?' starts the options)
+  if (path.Find('?') >= 0)
+    return path + "&" + options;
+  return path + (path.Right(1) == "/" ? "transform?" : "/transform?") + options;
+}
+
 bool CHTTPImageHandler::CheckHTTPRequest(const HTTPRequest &request)
 {
   return (request.url.find("/image/") == 0);
@@ -37,6 +89,12 @@ int CHTTPImageHandler::HandleHTTPRequest(const HTTPRequest &request)
   {
     m_path = request.url.substr(7);
 
+    unsigned int maxHeight = g_advancedSettings.m_imageRes;
+    unsigned int width = GetSizeArgument(request, "width", maxHeight * 16 / 9);
+    unsigned int height = GetSizeArgument(request, "height", maxHeight);
+    if (width > 0 || height > 0)
+      m_path = GetScaledImageURL(m_path, width, height);
+
     XFILE::CImageFile imageFile;
     if (imageFile.Exists(m_path) ||
        // temporary workaround for music images until they are integrated into CTextureCache and therefore CImageFile
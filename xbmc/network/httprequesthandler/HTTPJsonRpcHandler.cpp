@@ -21,9 +21,12 @@
 
 #include "HTTPJsonRpcHandler.h"
 #include "network/WebServer.h"
+#include "settings/AdvancedSettings.h"
+#include "utils/JSONVariantWriter.h"
 #include "utils/log.h"
 #include "interfaces/json-rpc/JSONRPC.h"
 #include "interfaces/json-rpc/JSONUtils.h"
+#include "interfaces/json-rpc/ResultCache.h"
 
 #define MAX_STRING_POST_SIZE 20000
 #define PAGE_JSONRPC_INFO   "<html><head><title>JSONRPC</title></head><body>JSONRPC active and working</body></html>"
@@ -31,6 +34,44 @@
 using namespace std;
 using namespace JSONRPC;
 
+/*! \brief Writes a JSON-RPC response while the web server sends it.
+ */
+class CHTTPJsonRpcResponseStream : public IHTTPResponseStream
+{
+public:
+  CHTTPJsonRpcResponseStream(CVariant &response)
+    : m_stream(m_response, g_advancedSettings.m_jsonOutputCompact), m_position(0)
+  {
+    m_response.swap(response);
+  }
+
+  virtual int Read(char *buffer, size_t size)
+  {
+    while (m_position >= m_chunk.size())
+    {
+      if (!m_stream.Read(m_chunk))
+        return m_stream.Failed() ? -1 : 0;
+      m_position = 0;
+    }
+
+    size_t length = min(size, m_chunk.size() - m_position);
+    memcpy(buffer, m_chunk.c_str() + m_position, length);
+    m_position += length;
+    return (int)length;
+  }
+
+private:
+  CVariant           m_response;
+  CJSONVariantStream m_stream;
+  string             m_chunk;
+  size_t             m_position;
+};
+
+CHTTPJsonRpcHandler::~CHTTPJsonRpcHandler()
+{
+  delete m_responseStream;
+}
+
 bool CHTTPJsonRpcHandler::CheckHTTPRequest(const HTTPRequest &request)
 {
   return (request.url.compare("/jsonrpc") == 0);
@@ -49,22 +90,52 @@ int CHTTPJsonRpcHandler::HandleHTTPRequest(const HTTPRequest &request)
       return MHD_YES;
     }
 
+    // requests only reading the libraries have the same response until the libraries change
+    string etag;
+    if (CResultCache::Get().GetETag(m_request, etag))
+    {
+      m_responseHeaderFields.insert(pair<string, string>(MHD_HTTP_HEADER_ETAG, etag));
+      if (CWebServer::GetRequestHeaderValue(request.connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_IF_NONE_MATCH) == etag)
+      {
+        m_responseType = HTTPError;
+        m_responseCode = MHD_HTTP_NOT_MODIFIED;
+        m_request.clear();
+        return MHD_YES;
+      }
+    }
+
     CHTTPClient client;
-    m_response = CJSONRPC::MethodCall(m_request, request.webserver, &client);
+    CVariant response;
+    m_responseType = HTTPMemoryDownloadNoFreeCopy;
+    if (CJSONRPC::MethodCall(m_request, request.webserver, &client, response))
+    {
+      // the response is written while it is sent, so it is never held as one string
+      m_responseStream = new CHTTPJsonRpcResponseStream(response);
+      m_responseType = HTTPStreamDownload;
+    }
 
     m_responseHeaderFields.insert(pair<string, string>("Content-Type", "application/json"));
 
     m_request.clear();
   }
   else
+  {
     m_response = PAGE_JSONRPC_INFO;
-  
-  m_responseType = HTTPMemoryDownloadNoFreeCopy;
+    m_responseType = HTTPMemoryDownloadNoFreeCopy;
+  }
+
   m_responseCode = MHD_HTTP_OK;
 
   return MHD_YES;
 }
 
+IHTTPResponseStream* CHTTPJsonRpcHandler::GetHTTPResponseStream()
+{
+  IHTTPResponseStream *stream = m_responseStream;
+  m_responseStream = NULL;
+  return stream;
+}
+
 #if (MHD_VERSION >= 0x00040001)
 bool CHTTPJsonRpcHandler::appendPostData(const char *data, size_t size)
 #else
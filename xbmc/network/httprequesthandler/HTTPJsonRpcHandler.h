@@ -26,16 +26,19 @@
 class CHTTPJsonRpcHandler : public IHTTPRequestHandler
 {
 public:
-  CHTTPJsonRpcHandler() { };
-  
+  CHTTPJsonRpcHandler() : m_responseStream(NULL) { };
+  virtual ~CHTTPJsonRpcHandler();
+
   virtual IHTTPRequestHandler* GetInstance() { return new CHTTPJsonRpcHandler(); }
   virtual bool CheckHTTPRequest(const HTTPRequest &request);
   virtual int HandleHTTPRequest(const HTTPRequest &request);
 
   virtual void* GetHTTPResponseData() const { return (void *)m_response.c_str(); };
   virtual size_t GetHTTPResonseDataLength() const { return m_response.size(); }
+  virtual IHTTPResponseStream* GetHTTPResponseStream();
 
   virtual int GetPriority() const { return 2; }
+  virtual std::string GetName() const { return "jsonrpc"; }
 
 protected:
 #if (MHD_VERSION >= 0x00040001)
@@ -47,6 +50,7 @@ protected:
 private:
   std::string m_request;
   std::string m_response;
+  IHTTPResponseStream *m_responseStream;
 
   class CHTTPClient : public JSONRPC::IClient
   {
@@ -0,0 +1,70 @@
+/*
+ *      Copyright (C) 2012 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "HTTPMetricsHandler.h"
+#include "HTTPRequestStatistics.h"
+#include "interfaces/AnnouncementManager.h"
+#include "network/WebServer.h"
+
+using namespace std;
+using namespace ANNOUNCEMENT;
+
+bool CHTTPMetricsHandler::CheckHTTPRequest(const HTTPRequest &request)
+{
+  return (request.url.compare("/metrics") == 0);
+}
+
+int CHTTPMetricsHandler::HandleHTTPRequest(const HTTPRequest &request)
+{
+  if (request.method != GET && request.method != HEAD)
+  {
+    m_responseCode = MHD_HTTP_NOT_IMPLEMENTED;
+    m_responseType = HTTPError;
+    return MHD_YES;
+  }
+
+  CHTTPRequestStatistics::Get().GetMetrics(m_response);
+
+  // the queues of the announcers passing announcements on to the clients
+  vector<AnnouncementQueueStatistics> queues;
+  CAnnouncementManager::GetQueueStatistics(queues);
+  CStdString queued     = "# TYPE xbmc_announcements_queued gauge\n";
+  CStdString maxQueued  = "# TYPE xbmc_announcements_queued_max gauge\n";
+  CStdString delivered  = "# TYPE xbmc_announcements_delivered_total counter\n";
+  CStdString coalesced  = "# TYPE xbmc_announcements_coalesced_total counter\n";
+  CStdString dropped    = "# TYPE xbmc_announcements_dropped_total counter\n";
+  for (vector<AnnouncementQueueStatistics>::const_iterator queue = queues.begin(); queue != queues.end(); ++queue)
+  {
+    const char *name = queue->name.c_str();
+    queued.AppendFormat("xbmc_announcements_queued{announcer=\"%s\"} %u\n", name, queue->queued);
+    maxQueued.AppendFormat("xbmc_announcements_queued_max{announcer=\"%s\"} %u\n", name, queue->maxQueued);
+    delivered.AppendFormat("xbmc_announcements_delivered_total{announcer=\"%s\"} %u\n", name, queue->delivered);
+    coalesced.AppendFormat("xbmc_announcements_coalesced_total{announcer=\"%s\"} %u\n", name, queue->coalesced);
+    dropped.AppendFormat("xbmc_announcements_dropped_total{announcer=\"%s\"} %u\n", name, queue->dropped);
+  }
+  m_response += queued + maxQueued + delivered + coalesced + dropped;
+
+  m_responseHeaderFields.insert(pair<string, string>("Content-Type", "text/plain; version=0.0.4"));
+  m_responseCode = MHD_HTTP_OK;
+  m_responseType = HTTPMemoryDownloadNoFreeCopy;
+
+  return MHD_YES;
+}
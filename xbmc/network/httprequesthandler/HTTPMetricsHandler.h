@@ -0,0 +1,47 @@
+#pragma once
+/*
+ *      Copyright (C) 2012 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "IHTTPRequestHandler.h"
+
+#include "utils/StdString.h"
+
+/*! \brief Serves the statistics of the web server's request handlers (see CHTTPRequestStatistics)
+ at /metrics, in the Prometheus text format.
+ */
+class CHTTPMetricsHandler : public IHTTPRequestHandler
+{
+public:
+  CHTTPMetricsHandler() { };
+
+  virtual IHTTPRequestHandler* GetInstance() { return new CHTTPMetricsHandler(); }
+  virtual bool CheckHTTPRequest(const HTTPRequest &request);
+  virtual int HandleHTTPRequest(const HTTPRequest &request);
+
+  virtual void* GetHTTPResponseData() const { return (void *)m_response.c_str(); };
+  virtual size_t GetHTTPResonseDataLength() const { return m_response.size(); }
+
+  virtual int GetPriority() const { return 2; }
+  virtual std::string GetName() const { return "metrics"; }
+
+private:
+  CStdString m_response;
+};
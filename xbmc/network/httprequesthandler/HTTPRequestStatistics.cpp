@@ -0,0 +1,180 @@
+/*
+ *      Copyright (C) 2012 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "system.h"
+#include "HTTPRequestStatistics.h"
+#include "threads/SingleLock.h"
+#include "threads/SystemClock.h"
+#include "utils/Variant.h"
+
+#include <string.h>
+
+using namespace std;
+
+const unsigned int CHTTPRequestStatistics::LatencyBuckets[HTTP_LATENCY_BUCKETS] =
+  { 1, 5, 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000 };
+
+CHTTPRequestStatistics::CHTTPRequestStatistics()
+  : m_active(0), m_started(XbmcThreads::SystemClockMillis())
+{ }
+
+CHTTPRequestStatistics &CHTTPRequestStatistics::Get()
+{
+  static CHTTPRequestStatistics statistics;
+  return statistics;
+}
+
+void CHTTPRequestStatistics::StartRequest()
+{
+  CSingleLock lock(m_critSection);
+  m_active++;
+}
+
+void CHTTPRequestStatistics::EndRequest(const std::string &handler, unsigned int duration, int responseCode)
+{
+  unsigned int second = (XbmcThreads::SystemClockMillis() - m_started) / 1000;
+
+  CSingleLock lock(m_critSection);
+  if (m_active > 0)
+    m_active--;
+
+  map<string, HandlerStatistics>::iterator iter = m_handlers.find(handler);
+  if (iter == m_handlers.end())
+  {
+    HandlerStatistics empty;
+    memset(&empty, 0, sizeof(empty));
+    iter = m_handlers.insert(make_pair(handler, empty)).first;
+  }
+
+  HandlerStatistics &statistics = iter->second;
+  statistics.requests++;
+  if (responseCode >= 400)
+    statistics.errors++;
+  statistics.totalDuration += duration;
+  if (duration > statistics.maxDuration)
+    statistics.maxDuration = duration;
+
+  unsigned int bucket = 0;
+  while (bucket < HTTP_LATENCY_BUCKETS && duration > LatencyBuckets[bucket])
+    bucket++;
+  statistics.latency[bucket]++;
+
+  unsigned int slot = second % HTTP_THROUGHPUT_SECONDS;
+  if (statistics.second[slot] != second)
+  {
+    statistics.second[slot] = second;
+    statistics.perSecond[slot] = 0;
+  }
+  statistics.perSecond[slot]++;
+}
+
+void CHTTPRequestStatistics::GetStatistics(CVariant &statistics)
+{
+  unsigned int now = (XbmcThreads::SystemClockMillis() - m_started) / 1000;
+
+  CSingleLock lock(m_critSection);
+  statistics = CVariant(CVariant::VariantTypeObject);
+  statistics["active"] = m_active;
+  statistics["uptime"] = now;
+  statistics["handlers"] = CVariant(CVariant::VariantTypeObject);
+
+  for (map<string, HandlerStatistics>::const_iterator iter = m_handlers.begin(); iter != m_handlers.end(); ++iter)
+  {
+    const HandlerStatistics &handler = iter->second;
+    CVariant &object = statistics["handlers"][iter->first];
+    object["requests"] = handler.requests;
+    object["errors"] = handler.errors;
+
+    CVariant &latency = object["latency"];
+    latency["average"] = handler.requests > 0 ? (unsigned int)(handler.totalDuration / handler.requests) : 0;
+    latency["maximum"] = handler.maxDuration;
+    latency["histogram"] = CVariant(CVariant::VariantTypeArray);
+    for (unsigned int i = 0; i < HTTP_LATENCY_BUCKETS; i++)
+    {
+      CVariant bucket(CVariant::VariantTypeObject);
+      bucket["milliseconds"] = LatencyBuckets[i];
+      bucket["requests"] = handler.latency[i];
+      latency["histogram"].push_back(bucket);
+    }
+    latency["slower"] = handler.latency[HTTP_LATENCY_BUCKETS];
+
+    unsigned int lastMinute, peak;
+    GetThroughput(handler, now, lastMinute, peak);
+    object["throughput"]["lastminute"] = lastMinute;
+    object["throughput"]["peakpersecond"] = peak;
+  }
+}
+
+void CHTTPRequestStatistics::GetMetrics(CStdString &metrics)
+{
+  unsigned int now = (XbmcThreads::SystemClockMillis() - m_started) / 1000;
+
+  CSingleLock lock(m_critSection);
+  metrics.Format("# TYPE xbmc_http_requests_active gauge\n"
+                 "xbmc_http_requests_active %u\n", m_active);
+
+  CStdString requests    = "# TYPE xbmc_http_requests_total counter\n";
+  CStdString errors      = "# TYPE xbmc_http_request_errors_total counter\n";
+  CStdString latency     = "# TYPE xbmc_http_request_duration_milliseconds histogram\n";
+  CStdString lastMinute  = "# TYPE xbmc_http_requests_last_minute gauge\n";
+  CStdString peak        = "# TYPE xbmc_http_requests_peak_per_second gauge\n";
+
+  for (map<string, HandlerStatistics>::const_iterator iter = m_handlers.begin(); iter != m_handlers.end(); ++iter)
+  {
+    const HandlerStatistics &handler = iter->second;
+    const char *name = iter->first.c_str();
+
+    requests.AppendFormat("xbmc_http_requests_total{handler=\"%s\"} %" PRIu64 "\n", name, handler.requests);
+    errors.AppendFormat("xbmc_http_request_errors_total{handler=\"%s\"} %" PRIu64 "\n", name, handler.errors);
+
+    // the buckets of the text format are cumulative
+    uint64_t count = 0;
+    for (unsigned int i = 0; i < HTTP_LATENCY_BUCKETS; i++)
+    {
+      count += handler.latency[i];
+      latency.AppendFormat("xbmc_http_request_duration_milliseconds_bucket{handler=\"%s\",le=\"%u\"} %" PRIu64 "\n", name, LatencyBuckets[i], count);
+    }
+    latency.AppendFormat("xbmc_http_request_duration_milliseconds_bucket{handler=\"%s\",le=\"+Inf\"} %" PRIu64 "\n", name, handler.requests);
+    latency.AppendFormat("xbmc_http_request_duration_milliseconds_sum{handler=\"%s\"} %" PRIu64 "\n", name, handler.totalDuration);
+    latency.AppendFormat("xbmc_http_request_duration_milliseconds_count{handler=\"%s\"} %" PRIu64 "\n", name, handler.requests);
+
+    unsigned int minute, perSecond;
+    GetThroughput(handler, now, minute, perSecond);
+    lastMinute.AppendFormat("xbmc_http_requests_last_minute{handler=\"%s\"} %u\n", name, minute);
+    peak.AppendFormat("xbmc_http_requests_peak_per_second{handler=\"%s\"} %u\n", name, perSecond);
+  }
+
+  metrics += requests + errors + latency + lastMinute + peak;
+}
+
+void CHTTPRequestStatistics::GetThroughput(const HandlerStatistics &handler, unsigned int now, unsigned int &lastMinute, unsigned int &peak) const
+{
+  lastMinute = peak = 0;
+  for (unsigned int i = 0; i < HTTP_THROUGHPUT_SECONDS; i++)
+  {
+    if (handler.second[i] + HTTP_THROUGHPUT_SECONDS <= now)
+      continue;
+
+    lastMinute += handler.perSecond[i];
+    if (handler.perSecond[i] > peak)
+      peak = handler.perSecond[i];
+  }
+}
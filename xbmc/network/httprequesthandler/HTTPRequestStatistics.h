@@ -0,0 +1,92 @@
+#pragma once
+/*
+ *      Copyright (C) 2012 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <map>
+#include <string>
+
+#include "threads/CriticalSection.h"
+#include "utils/StdString.h"
+
+class CVariant;
+
+#define HTTP_LATENCY_BUCKETS    12
+#define HTTP_THROUGHPUT_SECONDS 60
+
+/*! \brief Statistics of the requests handled by the web server, by request handler.
+
+ The latency of a request is the time taken by its handler and by creating its response, which
+ is what keeps one of the web server's threads busy. Sending the response body, eg. a file or a
+ streamed JSON-RPC response, is left out as it depends on the client as much as on the server.
+
+ The throughput is counted per second over the last minute.
+ */
+class CHTTPRequestStatistics
+{
+public:
+  static CHTTPRequestStatistics &Get();
+
+  /*! \brief Count a request as being handled, until EndRequest() is called for it.
+   */
+  void StartRequest();
+
+  /*! \brief Record a handled request
+   \param handler name of the handler of the request, see IHTTPRequestHandler::GetName().
+   \param duration the time taken to handle the request, in ms.
+   \param responseCode the HTTP status code of the response.
+   */
+  void EndRequest(const std::string &handler, unsigned int duration, int responseCode);
+
+  /*! \brief Get the statistics of all handlers
+   \param statistics [out] object of the number of requests being handled ("active"), the seconds
+   the statistics cover ("uptime") and the statistics of every handler by name ("handlers").
+   */
+  void GetStatistics(CVariant &statistics);
+
+  /*! \brief Get the statistics of all handlers in the Prometheus text format
+   */
+  void GetMetrics(CStdString &metrics);
+
+  /*! \brief The upper bounds (in ms) of the buckets of the latency histogram
+   */
+  static const unsigned int LatencyBuckets[HTTP_LATENCY_BUCKETS];
+
+private:
+  CHTTPRequestStatistics();
+
+  struct HandlerStatistics
+  {
+    uint64_t     requests;
+    uint64_t     errors;
+    uint64_t     totalDuration;
+    unsigned int maxDuration;
+    uint64_t     latency[HTTP_LATENCY_BUCKETS + 1]; // the last bucket holds the slower requests
+    unsigned int second[HTTP_THROUGHPUT_SECONDS];   // second (since the start) each count is for
+    unsigned int perSecond[HTTP_THROUGHPUT_SECONDS];
+  };
+
+  void GetThroughput(const HandlerStatistics &handler, unsigned int now, unsigned int &lastMinute, unsigned int &peak) const;
+
+  CCriticalSection                          m_critSection;
+  std::map<std::string, HandlerStatistics>  m_handlers;
+  unsigned int                              m_active;
+  unsigned int                              m_started;
+};
@@ -35,6 +35,7 @@ public:
   virtual size_t GetHTTPResonseDataLength() const { return m_response.size(); }
 
   virtual int GetPriority() const { return 1; }
+  virtual std::string GetName() const { return "webinterface-addons"; }
 
 private:
   std::string m_response;
@@ -32,6 +32,8 @@ public:
   virtual bool CheckHTTPRequest(const HTTPRequest &request);
   virtual int HandleHTTPRequest(const HTTPRequest &request);
 
+  virtual std::string GetName() const { return "webinterface"; }
+
   virtual std::string GetHTTPRedirectUrl() const { return m_url; }
   virtual std::string GetHTTPResponseFile() const { return m_url; }
   
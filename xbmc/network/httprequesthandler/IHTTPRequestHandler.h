@@ -51,7 +51,8 @@ enum HTTPResponseType
   HTTPMemoryDownloadNoFreeNoCopy,
   HTTPMemoryDownloadNoFreeCopy,
   HTTPMemoryDownloadFreeNoCopy,
-  HTTPMemoryDownloadFreeCopy
+  HTTPMemoryDownloadFreeCopy,
+  HTTPStreamDownload
 };
 
 typedef struct HTTPRequest
@@ -63,6 +64,22 @@ typedef struct HTTPRequest
   CWebServer *webserver;
 } HTTPRequest;
 
+/*! \brief Response data produced while it is sent, for responses whose length isn't known up front.
+ Such responses are sent with chunked transfer encoding.
+ */
+class IHTTPResponseStream
+{
+public:
+  virtual ~IHTTPResponseStream() { }
+
+  /*! \brief Read the next part of the response
+   \param buffer the buffer to read into.
+   \param size the size of the buffer.
+   \return the number of bytes read, 0 at the end of the response or -1 on error.
+   */
+  virtual int Read(char *buffer, size_t size) = 0;
+};
+
 class IHTTPRequestHandler
 {
 public:
@@ -76,10 +93,17 @@ public:
   virtual size_t GetHTTPResonseDataLength() const { return 0; }
   virtual std::string GetHTTPRedirectUrl() const { return ""; }
   virtual std::string GetHTTPResponseFile() const { return ""; }
+  /*! \brief The response data of an HTTPStreamDownload response, which the caller takes ownership of.
+   */
+  virtual IHTTPResponseStream* GetHTTPResponseStream() { return NULL; }
 
   // The higher the more important
   virtual int GetPriority() const { return 0; }
 
+  /*! \brief Name of the handler in the statistics of the web server, see CHTTPRequestStatistics.
+   */
+  virtual std::string GetName() const = 0;
+
   void AddPostField(const std::string &key, const std::string &value);
 #if (MHD_VERSION >= 0x00040001)
   bool AddPostData(const char *data, size_t size);
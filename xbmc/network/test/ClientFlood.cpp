@@ -0,0 +1,511 @@
+/*
+ *      Copyright (C) 2005-2012 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+/*
+ * rpcflood - floods the JSON-RPC TCP server of a running instance with
+ * notification subscribers and measures how announcements reach them.
+ *
+ *   rpcflood [--host=<address>] [--port=<port>] [--clients=<n>] [--stalled=<n>]
+ *            [--announcements=<n>] [--interval=<ms>]
+ *
+ * It opens --clients connections (500 by default) at once, which read
+ * everything the server sends, and --stalled connections (none by default)
+ * which never read, like remotes that went to sleep. Once the server answered
+ * a JSONRPC.Ping on every reading connection, one more connection calls
+ * JSONRPC.NotifyAll --announcements times (100 by default), every --interval
+ * milliseconds (50 by default), and every reading connection times how long
+ * each announcement takes to arrive.
+ *
+ * It reports the connections the server answered and kept open until the
+ * end, the announcements each of them missed, and the latency of the
+ * announcements that arrived. The exit code is 1 if a reading connection
+ * wasn't answered, was dropped or missed an announcement.
+ *
+ * It only needs POSIX sockets, so it is built on its own:
+ *
+ *   make rpcflood && ./rpcflood --clients=1000 --stalled=10
+ */
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#define FLOOD_SENDER   "rpcflood"
+#define FLOOD_MESSAGE  "Other.ping"
+#define FLOOD_LINGER   2000 /* ms to wait for late announcements after the last one was sent */
+#define FLOOD_RETRIES  100  /* attempts to connect again when refused */
+#define FLOOD_CONNECT_TIMEOUT 30000 /* ms to connect the clients and have them answered */
+
+struct Connection
+{
+  Connection() : fd(-1), depth(0), inString(false), escaped(false), received(0), open(false), ready(false) {}
+
+  int          fd;
+  std::string  buffer;   /* the JSON object being received */
+  int          depth;    /* of the braces of the object being received */
+  bool         inString;
+  bool         escaped;
+  unsigned int received; /* announcements received */
+  bool         open;
+  bool         ready;    /* whether the server answered the ping, ie. it serves the connection */
+};
+
+static double Now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static void PrintUsage()
+{
+  fprintf(stderr, "Usage: rpcflood [--host=<address>] [--port=<port>] [--clients=<n>] [--stalled=<n>]\n"
+                  "                [--announcements=<n>] [--interval=<ms>]\n");
+}
+
+/* connects all the sockets at once, like remotes do when the server comes back, and
+   returns the number connected. Sockets which failed to connect are left at -1. */
+static unsigned int ConnectAll(const struct addrinfo *address, std::vector<int> &sockets, unsigned int &retries)
+{
+  std::vector<unsigned int> attempts(sockets.size(), 0);
+  std::vector<bool> done(sockets.size(), false);
+  unsigned int connected = 0, finished = 0;
+  double deadline = Now() + FLOOD_CONNECT_TIMEOUT;
+
+  while (finished < sockets.size() && Now() < deadline)
+  {
+    /* start the connections which aren't in progress */
+    for (unsigned int i = 0; i < sockets.size(); i++)
+    {
+      if (done[i] || sockets[i] >= 0)
+        continue;
+
+      int fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+      if (fd < 0)
+      {
+        done[i] = true;
+        finished++;
+        continue;
+      }
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+      attempts[i]++;
+      if (connect(fd, address->ai_addr, address->ai_addrlen) < 0 && errno != EINPROGRESS)
+      {
+        close(fd);
+        if (errno != ECONNREFUSED || attempts[i] > FLOOD_RETRIES)
+        {
+          done[i] = true;
+          finished++;
+        }
+        else
+          retries++;
+        continue;
+      }
+      sockets[i] = fd;
+    }
+
+    std::vector<struct pollfd> fds;
+    std::vector<unsigned int> indices;
+    for (unsigned int i = 0; i < sockets.size(); i++)
+    {
+      if (done[i] || sockets[i] < 0)
+        continue;
+      struct pollfd pfd = { sockets[i], POLLOUT, 0 };
+      fds.push_back(pfd);
+      indices.push_back(i);
+    }
+    if (fds.empty())
+    {
+      /* everything was refused, give the server a moment */
+      usleep(10 * 1000);
+      continue;
+    }
+
+    if (poll(&fds[0], fds.size(), 100) <= 0)
+      continue;
+
+    for (unsigned int k = 0; k < fds.size(); k++)
+    {
+      if (!fds[k].revents)
+        continue;
+
+      unsigned int i = indices[k];
+      int error = 0;
+      socklen_t length = sizeof(error);
+      getsockopt(sockets[i], SOL_SOCKET, SO_ERROR, &error, &length);
+      if (error == 0)
+      {
+        int on = 1;
+        setsockopt(sockets[i], IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        done[i] = true;
+        finished++;
+        connected++;
+        continue;
+      }
+
+      /* some stacks refuse rather than drop connections while the listen backlog is full */
+      close(sockets[i]);
+      sockets[i] = -1;
+      if (error != ECONNREFUSED || attempts[i] > FLOOD_RETRIES)
+      {
+        done[i] = true;
+        finished++;
+      }
+      else
+        retries++;
+    }
+  }
+
+  for (unsigned int i = 0; i < sockets.size(); i++)
+  {
+    if (!done[i] && sockets[i] >= 0)
+    {
+      close(sockets[i]);
+      sockets[i] = -1;
+    }
+  }
+
+  return connected;
+}
+
+/* returns the sequence number of the flood announcement in object, -1 if it is something else */
+static int ParseAnnouncement(const std::string &object)
+{
+  if (object.find("\"" FLOOD_MESSAGE "\"") == std::string::npos ||
+      object.find("\"" FLOOD_SENDER "\"") == std::string::npos)
+    return -1;
+
+  size_t pos = object.find("\"data\"");
+  if (pos == std::string::npos)
+    return -1;
+
+  pos += 6;
+  while (pos < object.size() && (object[pos] == ' ' || object[pos] == ':' || object[pos] == '\t' || object[pos] == '\n'))
+    pos++;
+
+  return atoi(object.c_str() + pos);
+}
+
+/* reads everything available, returns false once the server closed the connection */
+static bool Receive(Connection &connection, const std::vector<double> &sent, std::vector<double> &latencies)
+{
+  char data[16384];
+  while (true)
+  {
+    ssize_t size = recv(connection.fd, data, sizeof(data), 0);
+    if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      return true;
+    if (size <= 0)
+      return false;
+
+    double now = Now();
+    for (ssize_t i = 0; i < size; i++)
+    {
+      char c = data[i];
+      if (connection.depth == 0 && c != '{')
+        continue;
+
+      connection.buffer.push_back(c);
+      if (connection.inString)
+      {
+        if (connection.escaped)
+          connection.escaped = false;
+        else if (c == '\\')
+          connection.escaped = true;
+        else if (c == '"')
+          connection.inString = false;
+        continue;
+      }
+
+      if (c == '"')
+        connection.inString = true;
+      else if (c == '{')
+        connection.depth++;
+      else if (c == '}' && --connection.depth == 0)
+      {
+        int sequence = ParseAnnouncement(connection.buffer);
+        if (sequence >= 0 && sequence < (int)sent.size())
+        {
+          connection.received++;
+          latencies.push_back(now - sent[sequence]);
+        }
+        else if (connection.buffer.find("\"id\"") != std::string::npos)
+          connection.ready = true;
+        connection.buffer.clear();
+      }
+    }
+  }
+}
+
+static double Percentile(const std::vector<double> &sorted, double percentile)
+{
+  if (sorted.empty())
+    return 0.0;
+  size_t index = (size_t)(percentile / 100.0 * (sorted.size() - 1) + 0.5);
+  return sorted[std::min(index, sorted.size() - 1)];
+}
+
+int main(int argc, char* argv[])
+{
+  std::string  host          = "127.0.0.1";
+  std::string  port          = "9090";
+  unsigned int clients       = 500;
+  unsigned int stalled       = 0;
+  unsigned int announcements = 100;
+  unsigned int interval      = 50;
+
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    if (arg.compare(0, 7, "--host=") == 0)
+      host = arg.substr(7);
+    else if (arg.compare(0, 7, "--port=") == 0)
+      port = arg.substr(7);
+    else if (arg.compare(0, 10, "--clients=") == 0)
+      clients = atoi(arg.c_str() + 10);
+    else if (arg.compare(0, 10, "--stalled=") == 0)
+      stalled = atoi(arg.c_str() + 10);
+    else if (arg.compare(0, 16, "--announcements=") == 0)
+      announcements = atoi(arg.c_str() + 16);
+    else if (arg.compare(0, 11, "--interval=") == 0)
+      interval = atoi(arg.c_str() + 11);
+    else
+    {
+      PrintUsage();
+      return 2;
+    }
+  }
+
+  if (clients == 0 || announcements == 0)
+  {
+    PrintUsage();
+    return 2;
+  }
+
+  signal(SIGPIPE, SIG_IGN);
+
+  struct addrinfo hints, *address = NULL;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family   = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  if (getaddrinfo(host.c_str(), port.c_str(), &hints, &address) != 0 || !address)
+  {
+    fprintf(stderr, "Unable to resolve %s:%s\n", host.c_str(), port.c_str());
+    return 2;
+  }
+
+  double start = Now();
+  unsigned int retries = 0;
+  std::vector<int> sockets(clients, -1);
+  unsigned int connected = ConnectAll(address, sockets, retries);
+
+  /* the server stops sending to these once their socket buffers are full */
+  std::vector<int> stalledConnections(stalled, -1);
+  ConnectAll(address, stalledConnections, retries);
+
+  std::vector<int> control(1, -1);
+  ConnectAll(address, control, retries);
+  freeaddrinfo(address);
+  if (control[0] < 0)
+  {
+    fprintf(stderr, "Unable to connect to %s:%s\n", host.c_str(), port.c_str());
+    return 2;
+  }
+
+  std::vector<Connection> connections(clients);
+  for (unsigned int i = 0; i < clients; i++)
+  {
+    connections[i].fd = sockets[i];
+    connections[i].open = sockets[i] >= 0;
+  }
+
+  std::vector<double> sent;
+  std::vector<double> latencies;
+  latencies.reserve((size_t)connected * announcements);
+  std::vector<struct pollfd> fds(clients + 1);
+
+  /* the server has accepted a connection once it answers a request on it */
+  static const char ping[] = "{\"jsonrpc\":\"2.0\",\"method\":\"JSONRPC.Ping\",\"id\":0}";
+  for (unsigned int i = 0; i < clients; i++)
+  {
+    if (connections[i].open && send(connections[i].fd, ping, sizeof(ping) - 1, 0) != (ssize_t)sizeof(ping) - 1)
+    {
+      connections[i].open = false;
+      close(connections[i].fd);
+    }
+  }
+
+  unsigned int ready = 0;
+  double deadline = Now() + FLOOD_CONNECT_TIMEOUT;
+  while (Now() < deadline)
+  {
+    unsigned int count = 0;
+    ready = 0;
+    for (unsigned int i = 0; i < clients; i++)
+    {
+      if (connections[i].ready)
+        ready++;
+      else if (connections[i].open)
+      {
+        fds[count].fd = connections[i].fd;
+        fds[count].events = POLLIN;
+        fds[count].revents = 0;
+        count++;
+      }
+    }
+    if (count == 0)
+      break;
+
+    if (poll(&fds[0], count, 100) <= 0)
+      continue;
+
+    for (unsigned int i = 0, index = 0; i < clients; i++)
+    {
+      if (connections[i].ready || !connections[i].open)
+        continue;
+      if ((fds[index++].revents & (POLLIN | POLLERR | POLLHUP)) && !Receive(connections[i], sent, latencies))
+      {
+        connections[i].open = false;
+        close(connections[i].fd);
+      }
+    }
+  }
+  double setup = Now() - start;
+
+  double nextSend = Now();
+  double end = 0.0;
+  while (true)
+  {
+    double now = Now();
+    if (sent.size() < announcements && now >= nextSend)
+    {
+      char request[256];
+      int length = snprintf(request, sizeof(request),
+                            "{\"jsonrpc\":\"2.0\",\"method\":\"JSONRPC.NotifyAll\",\"params\":{\"sender\":\"" FLOOD_SENDER "\",\"message\":\"ping\",\"data\":%u},\"id\":%u}",
+                            (unsigned int)sent.size(), (unsigned int)sent.size());
+      sent.push_back(Now());
+      if (send(control[0], request, length, 0) != length)
+      {
+        fprintf(stderr, "Unable to send announcement %u (%s)\n", (unsigned int)sent.size() - 1, strerror(errno));
+        return 2;
+      }
+      nextSend += interval;
+      if (sent.size() == announcements)
+        end = Now() + FLOOD_LINGER;
+    }
+
+    if (end > 0.0 && now >= end)
+      break;
+
+    unsigned int count = 0;
+    for (unsigned int i = 0; i < clients; i++)
+    {
+      if (!connections[i].open)
+        continue;
+      fds[count].fd = connections[i].fd;
+      fds[count].events = POLLIN;
+      fds[count].revents = 0;
+      count++;
+    }
+    fds[count].fd = control[0];
+    fds[count].events = POLLIN;
+    fds[count].revents = 0;
+    count++;
+
+    double wait = end > 0.0 ? end - now : nextSend - now;
+    if (poll(&fds[0], count, std::max(0, (int)wait)) < 0 && errno != EINTR)
+      break;
+
+    /* the connections are polled in the order they are stored in */
+    unsigned int index = 0;
+    for (unsigned int i = 0; i < clients; i++)
+    {
+      if (!connections[i].open)
+        continue;
+      if (fds[index].revents & (POLLIN | POLLERR | POLLHUP))
+      {
+        if (!Receive(connections[i], sent, latencies))
+        {
+          connections[i].open = false;
+          close(connections[i].fd);
+        }
+      }
+      index++;
+    }
+
+    if (fds[index].revents & (POLLIN | POLLERR | POLLHUP))
+    {
+      char drain[16384];
+      while (recv(control[0], drain, sizeof(drain), 0) > 0) ;
+    }
+  }
+
+  unsigned int open = 0, complete = 0;
+  unsigned long missed = 0;
+  for (unsigned int i = 0; i < clients; i++)
+  {
+    if (connections[i].open)
+      open++;
+    if (connections[i].fd < 0)
+      continue;
+    if (connections[i].received >= announcements)
+      complete++;
+    else
+      missed += announcements - connections[i].received;
+  }
+
+  std::sort(latencies.begin(), latencies.end());
+
+  printf("subscribers     %u requested, %u connected (%u refused attempts), %u answered in %.0f ms, %u still connected, %u stalled\n",
+         clients, connected, retries, ready, setup, open, (unsigned int)stalledConnections.size());
+  printf("announcements   %u sent every %u ms\n", announcements, interval);
+  printf("deliveries      %lu received, %lu missed, %u subscribers received all\n", (unsigned long)latencies.size(), missed, complete);
+  printf("latency (ms)    p50 %.2f  p95 %.2f  p99 %.2f  max %.2f\n",
+         Percentile(latencies, 50.0), Percentile(latencies, 95.0), Percentile(latencies, 99.0),
+         latencies.empty() ? 0.0 : latencies.back());
+
+  for (unsigned int i = 0; i < clients; i++)
+  {
+    if (connections[i].open)
+      close(connections[i].fd);
+  }
+  for (unsigned int i = 0; i < stalledConnections.size(); i++)
+  {
+    if (stalledConnections[i] >= 0)
+      close(stalledConnections[i]);
+  }
+  close(control[0]);
+
+  return (ready < clients || open < connected || missed > 0) ? 1 : 0;
+}
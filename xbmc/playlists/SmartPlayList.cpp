@@ -20,6 +20,7 @@
  */
 
 #include "SmartPlayList.h"
+#include "SmartPlaylistCache.h"
 #include "utils/log.h"
 #include "utils/StringUtils.h"
 #include "filesystem/SmartPlaylistDirectory.h"
@@ -933,6 +934,26 @@ bool CSmartPlaylist::LoadFromXML(TiXmlElement *root, const CStdString &encoding)
 bool CSmartPlaylist::Save(const CStdString &path)
 {
   CXBMCTinyXML doc;
+  if (!SaveToXML(doc) || !doc.SaveFile(path))
+    return false;
+
+  // playlists can include this one by name, so their queries may have changed
+  CSmartPlaylistCache::Get().Clear();
+  return true;
+}
+
+CStdString CSmartPlaylist::GetSignature() const
+{
+  CXBMCTinyXML doc;
+  SaveToXML(doc);
+  TiXmlPrinter printer;
+  printer.SetStreamPrinting();
+  doc.Accept(&printer);
+  return printer.CStr();
+}
+
+bool CSmartPlaylist::SaveToXML(CXBMCTinyXML &doc) const
+{
   TiXmlDeclaration decl("1.0", "UTF-8", "yes");
   doc.InsertEndChild(decl);
 
@@ -955,7 +976,7 @@ bool CSmartPlaylist::Save(const CStdString &path)
   pRoot->InsertEndChild(nodeMatch);
 
   // add <rule> tags
-  for (vector<CSmartPlaylistRule>::iterator it = m_playlistRules.begin(); it != m_playlistRules.end(); ++it)
+  for (vector<CSmartPlaylistRule>::const_iterator it = m_playlistRules.begin(); it != m_playlistRules.end(); ++it)
     it->Save(pRoot);
 
   // add <limit> tag
@@ -978,7 +999,7 @@ bool CSmartPlaylist::Save(const CStdString &path)
     nodeOrder.InsertEndChild(order);
     pRoot->InsertEndChild(nodeOrder);
   }
-  return doc.SaveFile(path);
+  return true;
 }
 
 void CSmartPlaylist::SetName(const CStdString &name)
@@ -998,6 +1019,17 @@ void CSmartPlaylist::AddRule(const CSmartPlaylistRule &rule)
 
 CStdString CSmartPlaylist::GetWhereClause(CDatabase &db, set<CStdString> &referencedPlaylists) const
 {
+  // the clause of a playlist included by others depends on the playlists already referenced, so only
+  // the clauses of top level playlists are cached
+  CStdString signature;
+  if (referencedPlaylists.empty())
+  {
+    CStdString cached;
+    signature = GetSignature();
+    if (CSmartPlaylistCache::Get().GetWhereClause(signature, cached))
+      return cached;
+  }
+
   CStdString rule, currentRule;
   for (vector<CSmartPlaylistRule>::const_iterator it = m_playlistRules.begin(); it != m_playlistRules.end(); ++it)
   {
@@ -1037,6 +1069,24 @@ CStdString CSmartPlaylist::GetWhereClause(CDatabase &db, set<CStdString> &refere
     rule += currentRule;
     rule += ")";
   }
+
+  if (!signature.IsEmpty())
+  {
+    // the clause changes when an included playlist is modified, or one is added to or removed from
+    // the folder the playlists are looked up in
+    set<CStdString> files(referencedPlaylists);
+    for (vector<CSmartPlaylistRule>::const_iterator it = m_playlistRules.begin(); it != m_playlistRules.end(); ++it)
+    {
+      if (it->m_field == FieldPlaylist)
+      {
+        CStdString folder = CSmartPlaylistDirectory::GetPlaylistsPath(GetType());
+        URIUtils::RemoveSlashAtEnd(folder);
+        files.insert(folder);
+        break;
+      }
+    }
+    CSmartPlaylistCache::Get().SetWhereClause(signature, rule, files);
+  }
   return rule;
 }
 
@@ -134,10 +134,16 @@ public:
 
   const std::vector<CSmartPlaylistRule> &GetRules() const;
 
+  /*! \brief a string identifying the type, rules, limit and order of the playlist, eg. for use as a cache key
+   */
+  CStdString GetSignature() const;
+
   CStdString GetSaveLocation() const;
 private:
   friend class CGUIDialogSmartPlaylistEditor;
 
+  bool SaveToXML(CXBMCTinyXML &doc) const;
+
   std::vector<CSmartPlaylistRule> m_playlistRules;
   CStdString m_playlistName;
   CStdString m_playlistType;
@@ -0,0 +1,234 @@
+/*
+ *      Copyright (C) 2012 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "system.h"
+#include "SmartPlaylistCache.h"
+#include "SmartPlayList.h"
+#include "FileItem.h"
+#include "dbwrappers/Database.h"
+#include "filesystem/File.h"
+#include "interfaces/AnnouncementManager.h"
+#include "settings/AdvancedSettings.h"
+#include "settings/Settings.h"
+#include "threads/SingleLock.h"
+#include "threads/SystemClock.h"
+#include "utils/log.h"
+
+#define MAX_CACHE_AGE       900000 // 15 minutes
+#define MAX_CACHED_LISTS    50
+#define MAX_CACHED_ITEMS    1000   // per list
+
+using namespace std;
+using namespace ANNOUNCEMENT;
+using namespace XFILE;
+
+CSmartPlaylistCache::CSmartPlaylistCache()
+{
+  CAnnouncementManager::AddAnnouncer(this);
+}
+
+CSmartPlaylistCache::~CSmartPlaylistCache()
+{
+  CAnnouncementManager::RemoveAnnouncer(this);
+  Clear();
+}
+
+CSmartPlaylistCache &CSmartPlaylistCache::Get()
+{
+  static CSmartPlaylistCache cache;
+  return cache;
+}
+
+CStdString CSmartPlaylistCache::GetClauseKey(const CStdString &signature)
+{
+  // playlists are looked up in the folders of the current profile
+  return signature + "|" + g_settings.GetProfileUserDataFolder();
+}
+
+int64_t CSmartPlaylistCache::GetModificationTime(const CStdString &path)
+{
+  struct __stat64 st;
+  if (CFile::Stat(path, &st) != 0)
+    return -1;
+  return st.st_mtime;
+}
+
+bool CSmartPlaylistCache::IsModified(const FileTimes &files)
+{
+  for (FileTimes::const_iterator i = files.begin(); i != files.end(); ++i)
+  {
+    if (GetModificationTime(i->first) != i->second)
+      return true;
+  }
+  return false;
+}
+
+bool CSmartPlaylistCache::GetWhereClause(const CStdString &signature, CStdString &whereClause)
+{
+  CSingleLock lock(m_section);
+  map<CStdString, CachedClause>::iterator i = m_whereClauses.find(GetClauseKey(signature));
+  if (i == m_whereClauses.end())
+    return false;
+
+  if (XbmcThreads::SystemClockMillis() - i->second.time > MAX_CACHE_AGE || IsModified(i->second.files))
+  {
+    m_whereClauses.erase(i);
+    return false;
+  }
+  whereClause = i->second.whereClause;
+  return true;
+}
+
+void CSmartPlaylistCache::SetWhereClause(const CStdString &signature, const CStdString &whereClause, const set<CStdString> &files)
+{
+  FileTimes times;
+  for (set<CStdString>::const_iterator i = files.begin(); i != files.end(); ++i)
+    times[*i] = GetModificationTime(*i);
+
+  CStdString key = GetClauseKey(signature);
+  CSingleLock lock(m_section);
+  if (m_whereClauses.size() >= MAX_CACHED_LISTS && m_whereClauses.find(key) == m_whereClauses.end())
+    m_whereClauses.clear();
+
+  CachedClause &cached = m_whereClauses[key];
+  cached.whereClause = whereClause;
+  cached.time = XbmcThreads::SystemClockMillis();
+  cached.files = times;
+}
+
+bool CSmartPlaylistCache::GetItems(const CStdString &key, CFileItemList &items)
+{
+  unsigned int revision = GetRevision();
+
+  CSingleLock lock(m_section);
+  map<CStdString, CachedItems>::iterator i = m_items.find(key);
+  if (i == m_items.end())
+    return false;
+
+  if (XbmcThreads::SystemClockMillis() - i->second.time > MAX_CACHE_AGE || i->second.revision != revision ||
+      IsModified(i->second.files))
+  {
+    delete i->second.items;
+    m_items.erase(i);
+    return false;
+  }
+  // copy the items only, the list itself belongs to the caller
+  const CFileItemList &cached = *i->second.items;
+  for (int j = 0; j < cached.Size(); j++)
+    items.Add(CFileItemPtr(new CFileItem(*cached[j])));
+  items.SetContent(cached.GetContent());
+  items.SetLabel(cached.GetLabel());
+  return true;
+}
+
+unsigned int CSmartPlaylistCache::GetRevision()
+{
+  // the databases count the writes that aren't announced, like play counts and bookmarks
+  return CDatabase::GetRevision("MyVideos") + CDatabase::GetRevision("MyMusic");
+}
+
+void CSmartPlaylistCache::SetItems(const CStdString &key, const CSmartPlaylist &playlist, const CFileItemList &items, unsigned int revision)
+{
+  const CStdString &type = playlist.GetType();
+  bool music = type.Equals("songs") || type.Equals("albums") || type.Equals("mixed") || type.IsEmpty();
+  bool video = !type.Equals("songs") && !type.Equals("albums");
+  if ((music && g_advancedSettings.m_databaseMusic.type.Equals("mysql")) ||
+      (video && g_advancedSettings.m_databaseVideo.type.Equals("mysql")))
+    return;
+
+  if (items.Size() > MAX_CACHED_ITEMS)
+    return;
+
+  // the libraries changed while the items were retrieved
+  if (revision != GetRevision())
+    return;
+
+  // mixed playlists are queried as songs and music videos
+  vector<CStdString> signatures;
+  if (type.Equals("mixed") || type.IsEmpty())
+  {
+    CSmartPlaylist songPlaylist(playlist);
+    songPlaylist.SetType("songs");
+    signatures.push_back(songPlaylist.GetSignature());
+    if (type.Equals("mixed"))
+    {
+      CSmartPlaylist mvidPlaylist(playlist);
+      mvidPlaylist.SetType("musicvideos");
+      signatures.push_back(mvidPlaylist.GetSignature());
+    }
+  }
+  else
+    signatures.push_back(playlist.GetSignature());
+
+  CSingleLock lock(m_section);
+  // the items depend on the same files as the clauses they were retrieved with
+  FileTimes files;
+  for (vector<CStdString>::const_iterator i = signatures.begin(); i != signatures.end(); ++i)
+  {
+    map<CStdString, CachedClause>::const_iterator clause = m_whereClauses.find(GetClauseKey(*i));
+    if (clause == m_whereClauses.end())
+      return;
+    files.insert(clause->second.files.begin(), clause->second.files.end());
+  }
+
+  if (m_items.size() >= MAX_CACHED_LISTS && m_items.find(key) == m_items.end())
+    ClearItems();
+
+  CachedItems &cached = m_items[key];
+  if (!cached.items)
+    cached.items = new CFileItemList;
+  cached.items->Clear();
+  cached.items->Copy(items);
+  cached.time = XbmcThreads::SystemClockMillis();
+  cached.revision = revision;
+  cached.files = files;
+}
+
+void CSmartPlaylistCache::Clear()
+{
+  CSingleLock lock(m_section);
+  m_whereClauses.clear();
+  ClearItems();
+}
+
+void CSmartPlaylistCache::ClearItems()
+{
+  CSingleLock lock(m_section);
+  for (map<CStdString, CachedItems>::iterator i = m_items.begin(); i != m_items.end(); ++i)
+    delete i->second.items;
+  m_items.clear();
+}
+
+void CSmartPlaylistCache::Announce(AnnouncementFlag flag, const char *sender, const char *message, const CVariant &data)
+{
+  if (!(flag & (VideoLibrary | AudioLibrary)))
+    return;
+
+  // any change to the library, including play counts, may change what the playlists list
+  if (strcmp(message, "OnUpdate") == 0 || strcmp(message, "OnRemove") == 0 ||
+      strcmp(message, "OnScanFinished") == 0 || strcmp(message, "OnCleanFinished") == 0)
+  {
+    CSingleLock lock(m_section);
+    if (!m_items.empty())
+      CLog::Log(LOGDEBUG, "%s - library changed (%s), dropping %u cached playlists", __FUNCTION__, message, (unsigned int)m_items.size());
+    ClearItems();
+  }
+}
@@ -0,0 +1,123 @@
+#pragma once
+/*
+ *      Copyright (C) 2012 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <map>
+#include <set>
+
+#include "interfaces/IAnnouncer.h"
+#include "threads/CriticalSection.h"
+#include "utils/StdString.h"
+
+class CFileItemList;
+class CSmartPlaylist;
+
+/*! \brief Cache of the queries and results of smart playlists.
+
+ Smart playlists used as widgets are listed every time a window showing them is activated. The WHERE
+ clause of each playlist is cached by its signature (see CSmartPlaylist::GetSignature()) and the
+ profile, which saves looking up and loading the playlists it includes, and so are the items it lists.
+ Clauses and items are no longer used once one of the included playlists, or the folder they were
+ looked up in, was modified.
+
+ The items are dropped whenever the library changes, as announced by the announcement manager, and
+ aren't used once anything was written to the video or music database since they were retrieved (eg.
+ play counts and resume points, which aren't announced). Both expire after a while in any case, as
+ rules such as "in the last 2 weeks" depend on the date. No items are cached from MySQL databases,
+ whose changes made by other clients aren't seen.
+ */
+class CSmartPlaylistCache : public ANNOUNCEMENT::IAnnouncer
+{
+public:
+  static CSmartPlaylistCache &Get();
+
+  /*! \brief Retrieve the cached WHERE clause of a playlist
+   \param signature the signature of the playlist, see CSmartPlaylist::GetSignature().
+   \param whereClause the cached clause.
+   \return true if the clause was cached and the files it depends on are unchanged, false otherwise.
+   */
+  bool GetWhereClause(const CStdString &signature, CStdString &whereClause);
+
+  /*! \brief Cache the WHERE clause of a playlist
+   \param signature the signature of the playlist, see CSmartPlaylist::GetSignature().
+   \param whereClause the clause to cache.
+   \param files the included playlists and the folders they were looked up in.
+   */
+  void SetWhereClause(const CStdString &signature, const CStdString &whereClause, const std::set<CStdString> &files);
+
+  /*! \brief Retrieve the cached items of a playlist
+   \param key identifies the playlist and the way its items were retrieved.
+   \param items a copy of the cached items.
+   \return true if the items were cached, false otherwise.
+   */
+  bool GetItems(const CStdString &key, CFileItemList &items);
+
+  /*! \brief Current revision of the libraries, to be passed to SetItems() for items retrieved after calling this
+   */
+  static unsigned int GetRevision();
+
+  /*! \brief Cache the items of a playlist, unless the library they came from can't be cached.
+   \param key identifies the playlist and the way its items were retrieved.
+   \param playlist the playlist, whose cached clauses tell the files the items depend on.
+   \param items the items to cache a copy of.
+   \param revision the revision of the libraries before the items were retrieved.
+   */
+  void SetItems(const CStdString &key, const CSmartPlaylist &playlist, const CFileItemList &items, unsigned int revision);
+
+  /*! \brief Drop all cached clauses and items.
+   */
+  void Clear();
+
+  virtual void Announce(ANNOUNCEMENT::AnnouncementFlag flag, const char *sender, const char *message, const CVariant &data);
+
+private:
+  CSmartPlaylistCache();
+  virtual ~CSmartPlaylistCache();
+
+  typedef std::map<CStdString, int64_t> FileTimes; // modification time by path
+
+  struct CachedClause
+  {
+    CStdString     whereClause;
+    unsigned int   time;
+    FileTimes      files;
+  };
+
+  struct CachedItems
+  {
+    CachedItems() : items(NULL), time(0), revision(0) {}
+
+    CFileItemList *items;
+    unsigned int   time;
+    unsigned int   revision;
+    FileTimes      files;
+  };
+
+  static CStdString GetClauseKey(const CStdString &signature);
+  static int64_t GetModificationTime(const CStdString &path);
+  static bool IsModified(const FileTimes &files);
+
+  void ClearItems();
+
+  CCriticalSection                    m_section;
+  std::map<CStdString, CachedClause>  m_whereClauses;
+  std::map<CStdString, CachedItems>   m_items;
+};
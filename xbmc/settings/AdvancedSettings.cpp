@@ -51,6 +51,9 @@ void CAdvancedSettings::Initialize()
   m_audioApplyDrc = true;
   m_dvdplayerIgnoreDTSinWAV = false;
   m_audioResample = 0;
+  m_audioResampleQuality = 3;
+  m_audioPreDecodeSeconds = 10;
+  m_audioPCMCacheSize = 16;
   m_allowTranscode44100 = false;
   m_audioForceDirectSound = false;
   m_audioAudiophile = false;
@@ -90,6 +93,7 @@ void CAdvancedSettings::Initialize()
   m_videoPercentSeekBackward = -2;
   m_videoPercentSeekForwardBig = 10;
   m_videoPercentSeekBackwardBig = -10;
+  m_videoDemuxIndexCache = true;
   m_videoBlackBarColour = 0;
   m_videoPPFFmpegDeint = "linblenddeint";
   m_videoPPFFmpegPostProc = "ha:128:7,va,dr";
@@ -207,6 +211,7 @@ void CAdvancedSettings::Initialize()
   m_strMusicLibraryAlbumFormatRight = "";
   m_prioritiseAPEv2tags = false;
   m_musicItemSeparator = " / ";
+  m_musicLibraryTagReadThreads = 4;
   m_videoItemSeparator = " / ";
 
   m_bVideoLibraryHideAllItems = false;
@@ -219,8 +224,12 @@ void CAdvancedSettings::Initialize()
   m_bVideoLibraryImportWatchedState = false;
   m_bVideoLibraryImportResumePoint = false;
   m_bVideoScannerIgnoreErrors = false;
+  m_videoScannerLookupThreads = 4;
   m_iVideoLibraryDateAdded = 1; // prefer mtime over ctime and current time
 
+  m_bChangeJournal = false;
+  m_iChangeJournalFullScanHours = 24;
+
   m_iTuxBoxStreamtsPort = 31339;
   m_bTuxBoxAudioChannelSelection = false;
   m_bTuxBoxSubMenuSelection = false;
@@ -290,6 +299,10 @@ void CAdvancedSettings::Initialize()
   m_jsonOutputCompact = true;
   m_jsonTcpPort = 9090;
 
+  m_webserverThreads = 0;
+  m_webserverThreadPerConnection = false;
+  m_webserverConnectionTimeout = 60 * 60 * 24;
+
   m_enableMultimediaKeys = false;
 
   m_canWindowed = true;
@@ -303,6 +316,9 @@ void CAdvancedSettings::Initialize()
 
   m_databaseMusic.Reset();
   m_databaseVideo.Reset();
+  m_databaseTextures.Reset();
+  m_databaseAddons.Reset();
+  m_databaseViewModes.Reset();
 }
 
 bool CAdvancedSettings::Load()
@@ -371,6 +387,9 @@ void CAdvancedSettings::ParseSettingsFile(const CStdString &file)
     XMLUtils::GetInt(pElement, "percentseekbackwardbig", m_musicPercentSeekBackwardBig, -100, 0);
 
     XMLUtils::GetInt(pElement, "resample", m_audioResample, 0, 192000);
+    XMLUtils::GetInt(pElement, "resamplequality", m_audioResampleQuality, 0, 3);
+    XMLUtils::GetInt(pElement, "predecodeseconds", m_audioPreDecodeSeconds, 2, 60);
+    XMLUtils::GetInt(pElement, "pcmcachesize", m_audioPCMCacheSize, 0, 256);
     XMLUtils::GetBoolean(pElement, "allowtranscode44100", m_allowTranscode44100);
     XMLUtils::GetBoolean(pElement, "forceDirectSound", m_audioForceDirectSound);
     XMLUtils::GetBoolean(pElement, "audiophile", m_audioAudiophile);
@@ -453,6 +472,7 @@ void CAdvancedSettings::ParseSettingsFile(const CStdString &file)
     XMLUtils::GetInt(pElement, "percentseekbackward", m_videoPercentSeekBackward, -100, 0);
     XMLUtils::GetInt(pElement, "percentseekforwardbig", m_videoPercentSeekForwardBig, 0, 100);
     XMLUtils::GetInt(pElement, "percentseekbackwardbig", m_videoPercentSeekBackwardBig, -100, 0);
+    XMLUtils::GetBoolean(pElement, "demuxindexcache", m_videoDemuxIndexCache);
 
     TiXmlElement* pVideoExcludes = pElement->FirstChildElement("excludefromlisting");
     if (pVideoExcludes)
@@ -619,6 +639,7 @@ void CAdvancedSettings::ParseSettingsFile(const CStdString &file)
     XMLUtils::GetString(pElement, "albumformat", m_strMusicLibraryAlbumFormat);
     XMLUtils::GetString(pElement, "albumformatright", m_strMusicLibraryAlbumFormatRight);
     XMLUtils::GetString(pElement, "itemseparator", m_musicItemSeparator);
+    XMLUtils::GetInt(pElement, "tagreadthreads", m_musicLibraryTagReadThreads, 1, 8);
   }
 
   pElement = pRootElement->FirstChildElement("videolibrary");
@@ -641,6 +662,14 @@ void CAdvancedSettings::ParseSettingsFile(const CStdString &file)
   if (pElement)
   {
     XMLUtils::GetBoolean(pElement, "ignoreerrors", m_bVideoScannerIgnoreErrors);
+    XMLUtils::GetInt(pElement, "lookupthreads", m_videoScannerLookupThreads, 1, 8);
+  }
+
+  pElement = pRootElement->FirstChildElement("changejournal");
+  if (pElement)
+  {
+    XMLUtils::GetBoolean(pElement, "enabled", m_bChangeJournal);
+    XMLUtils::GetInt(pElement, "fullscanhours", m_iChangeJournalFullScanHours, 1, 24 * 365);
   }
 
   // Backward-compatibility of ExternalPlayer config
@@ -682,6 +711,14 @@ void CAdvancedSettings::ParseSettingsFile(const CStdString &file)
     XMLUtils::GetUInt(pElement, "tcpport", m_jsonTcpPort);
   }
 
+  pElement = pRootElement->FirstChildElement("webserver");
+  if (pElement)
+  {
+    XMLUtils::GetInt(pElement, "threads", m_webserverThreads, 0, 64);
+    XMLUtils::GetBoolean(pElement, "threadperconnection", m_webserverThreadPerConnection);
+    XMLUtils::GetInt(pElement, "connectiontimeout", m_webserverConnectionTimeout, 2, 60 * 60 * 24);
+  }
+
   pElement = pRootElement->FirstChildElement("samba");
   if (pElement)
   {
@@ -961,6 +998,7 @@ void CAdvancedSettings::ParseSettingsFile(const CStdString &file)
     XMLUtils::GetString(pDatabase, "user", m_databaseVideo.user);
     XMLUtils::GetString(pDatabase, "pass", m_databaseVideo.pass);
     XMLUtils::GetString(pDatabase, "name", m_databaseVideo.name);
+    GetDatabaseTuning(pDatabase, m_databaseVideo);
   }
 
   pDatabase = pRootElement->FirstChildElement("musicdatabase");
@@ -972,8 +1010,21 @@ void CAdvancedSettings::ParseSettingsFile(const CStdString &file)
     XMLUtils::GetString(pDatabase, "user", m_databaseMusic.user);
     XMLUtils::GetString(pDatabase, "pass", m_databaseMusic.pass);
     XMLUtils::GetString(pDatabase, "name", m_databaseMusic.name);
+    GetDatabaseTuning(pDatabase, m_databaseMusic);
   }
 
+  pDatabase = pRootElement->FirstChildElement("texturedatabase");
+  if (pDatabase)
+    GetDatabaseTuning(pDatabase, m_databaseTextures);
+
+  pDatabase = pRootElement->FirstChildElement("addondatabase");
+  if (pDatabase)
+    GetDatabaseTuning(pDatabase, m_databaseAddons);
+
+  pDatabase = pRootElement->FirstChildElement("viewmodedatabase");
+  if (pDatabase)
+    GetDatabaseTuning(pDatabase, m_databaseViewModes);
+
   pElement = pRootElement->FirstChildElement("enablemultimediakeys");
   if (pElement)
   {
@@ -1097,6 +1148,17 @@ void CAdvancedSettings::GetCustomRegexps(TiXmlElement *pRootElement, CStdStringA
   }
 }
 
+void CAdvancedSettings::GetDatabaseTuning(TiXmlElement *pDatabase, DatabaseSettings& settings)
+{
+  // these only apply to sqlite databases
+  XMLUtils::GetString(pDatabase, "journalmode", settings.journalmode);
+  XMLUtils::GetString(pDatabase, "synchronous", settings.synchronous);
+  XMLUtils::GetInt(pDatabase, "cachesize", settings.cachesize, 0, 1000000);
+  XMLUtils::GetInt(pDatabase, "mmapsize", settings.mmapsize, 0, 4096);
+  settings.journalmode.ToUpper();
+  settings.synchronous.ToUpper();
+}
+
 void CAdvancedSettings::GetCustomExtensions(TiXmlElement *pRootElement, CStdString& extensions)
 {
   CStdString extraExtensions;
@@ -29,6 +29,7 @@ class TiXmlElement;
 class DatabaseSettings
 {
 public:
+  DatabaseSettings() { Reset(); };
   void Reset()
   {
     type.clear();
@@ -37,6 +38,10 @@ public:
     user.clear();
     pass.clear();
     name.clear();
+    journalmode.clear();
+    synchronous = "NORMAL";
+    cachesize = 4096;
+    mmapsize = 0;
   };
   CStdString type;
   CStdString host;
@@ -44,6 +49,10 @@ public:
   CStdString user;
   CStdString pass;
   CStdString name;
+  CStdString journalmode; // sqlite journal mode (eg. WAL), empty for the sqlite default
+  CStdString synchronous; // sqlite synchronous level (OFF, NORMAL or FULL)
+  int cachesize;          // sqlite page cache size, in pages
+  int mmapsize;           // size of the sqlite database file that is memory mapped, in MB
 };
 
 struct TVShowRegexp
@@ -98,6 +107,7 @@ class CAdvancedSettings
     static void GetCustomRegexps(TiXmlElement *pRootElement, CStdStringArray& settings);
     static void GetCustomRegexpReplacers(TiXmlElement *pRootElement, CStdStringArray& settings);
     static void GetCustomExtensions(TiXmlElement *pRootElement, CStdString& extensions);
+    static void GetDatabaseTuning(TiXmlElement *pDatabase, DatabaseSettings& settings);
 
     int m_audioHeadRoom;
     float m_ac3Gain;
@@ -105,6 +115,9 @@ class CAdvancedSettings
     float m_audioPlayCountMinimumPercent;
     bool m_dvdplayerIgnoreDTSinWAV;
     int m_audioResample;
+    int m_audioResampleQuality;
+    int m_audioPreDecodeSeconds;
+    int m_audioPCMCacheSize;
     bool m_allowTranscode44100;
     bool m_audioForceDirectSound;
     bool m_audioAudiophile;
@@ -131,6 +144,7 @@ class CAdvancedSettings
     int m_videoPercentSeekBackward;
     int m_videoPercentSeekForwardBig;
     int m_videoPercentSeekBackwardBig;
+    bool m_videoDemuxIndexCache;
     CStdString m_videoPPFFmpegDeint;
     CStdString m_videoPPFFmpegPostProc;
     bool m_musicUseTimeSeeking;
@@ -242,6 +256,7 @@ class CAdvancedSettings
     CStdString m_strMusicLibraryAlbumFormatRight;
     bool m_prioritiseAPEv2tags;
     CStdString m_musicItemSeparator;
+    int m_musicLibraryTagReadThreads;
     CStdString m_videoItemSeparator;
     std::vector<CStdString> m_musicTagsFromFileFilters;
 
@@ -256,8 +271,12 @@ class CAdvancedSettings
     bool m_bVideoLibraryImportResumePoint;
 
     bool m_bVideoScannerIgnoreErrors;
+    int m_videoScannerLookupThreads;
     int m_iVideoLibraryDateAdded;
 
+    bool m_bChangeJournal;
+    int m_iChangeJournalFullScanHours;
+
     std::vector<CStdString> m_vecTokens; // cleaning strings tied to language
     //TuxBox
     int m_iTuxBoxStreamtsPort;
@@ -327,6 +346,9 @@ class CAdvancedSettings
 
     DatabaseSettings m_databaseMusic; // advanced music database setup
     DatabaseSettings m_databaseVideo; // advanced video database setup
+    DatabaseSettings m_databaseTextures; // sqlite setup of the texture database
+    DatabaseSettings m_databaseAddons; // sqlite setup of the add-on database
+    DatabaseSettings m_databaseViewModes; // sqlite setup of the view mode database
 
     bool m_guiVisualizeDirtyRegions;
     int  m_guiAlgorithmDirtyRegions;
@@ -337,6 +359,10 @@ class CAdvancedSettings
     bool m_jsonOutputCompact;
     unsigned int m_jsonTcpPort;
 
+    int m_webserverThreads; ///< \brief size of the web server's thread pool, 0 for one thread per core (at least 4)
+    bool m_webserverThreadPerConnection; ///< \brief whether the web server handles every connection on a thread of its own instead
+    int m_webserverConnectionTimeout; ///< \brief seconds after which the web server closes idle connections
+
     bool m_enableMultimediaKeys;
     std::vector<CStdString> m_settingsFiles;
     void ParseSettingsFile(const CStdString &file);
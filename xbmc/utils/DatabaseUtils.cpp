@@ -24,6 +24,7 @@
 #include "dbwrappers/dataset.h"
 #include "music/MusicDatabase.h"
 #include "utils/log.h"
+#include "utils/SortUtils.h"
 #include "utils/Variant.h"
 #include "video/VideoDatabase.h"
 
@@ -631,3 +632,75 @@ std::string DatabaseUtils::BuildLimitClause(int end, int start /* = 0 */)
 
   return sql.str();
 }
+
+bool DatabaseUtils::BuildOrderClause(const SortDescription &sortDescription, MediaType mediaType, std::string &orderClause)
+{
+  bool isVideo = mediaType == MediaTypeMovie || mediaType == MediaTypeTvShow ||
+                 mediaType == MediaTypeEpisode || mediaType == MediaTypeMusicVideo;
+
+  // only sorts whose ties are ordered the same way in memory are supported. Sorting by date added
+  // orders ties by id, in the same direction. Sorting by title, track number or duration keeps the
+  // order of ties (the order of the ids). Sorting by year or rating orders ties by label, which is
+  // only the plain title for movies and music videos.
+  Field field;
+  bool byLabel = false;
+  bool idFollowsOrder = false;
+  switch (sortDescription.sortBy)
+  {
+  case SortByDateAdded:
+    field = FieldDateAdded;
+    idFollowsOrder = true;
+    break;
+  case SortByTitle:
+    field = FieldTitle;
+    break;
+  case SortByYear:
+  case SortByRating:
+    if (mediaType != MediaTypeMovie && mediaType != MediaTypeMusicVideo)
+      return false;
+    field = sortDescription.sortBy == SortByYear ? FieldYear : FieldRating;
+    byLabel = true;
+    break;
+  case SortByTrackNumber:
+    field = FieldTrackNumber;
+    break;
+  case SortByTime:
+    // the runtime of videos is free text
+    if (isVideo)
+      return false;
+    field = FieldTime;
+    break;
+  default:
+    return false;
+  }
+
+  // the database can't strip the articles from titles
+  if ((field == FieldTitle || byLabel) && (sortDescription.sortAttributes & SortAttributeIgnoreArticle))
+    return false;
+
+  // SortUtils sorts by the plain title (not the sort title) and ignores its case
+  std::string title;
+  if (field == FieldTitle || byLabel)
+  {
+    title = GetField(FieldTitle, mediaType, DatabaseQueryPartSelect);
+    if (title.empty())
+      return false;
+    title = "LOWER(" + title + ")";
+  }
+
+  std::string column = field == FieldTitle ? title : GetField(field, mediaType, DatabaseQueryPartOrderBy);
+  std::string id = GetField(FieldId, mediaType, DatabaseQueryPartOrderBy);
+  if (column.empty() || id.empty())
+    return false;
+
+  // the details of videos are stored as text, so numbers need to be compared as such
+  if (isVideo && column.find("CAST(") != 0 && (field == FieldTrackNumber || field == FieldYear || field == FieldRating))
+    column = "CAST(" + column + " as DECIMAL(10,3))";
+
+  const char *order = sortDescription.sortOrder == SortOrderDescending ? " DESC" : " ASC";
+  orderClause = column + order;
+  if (byLabel)
+    orderClause += ", " + title + order;
+  orderClause += ", " + id + (idFollowsOrder ? order : " ASC");
+  return true;
+}
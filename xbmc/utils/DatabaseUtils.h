@@ -26,6 +26,7 @@
 #include <vector>
 
 class CVariant;
+struct SortDescription;
 
 namespace dbiplus
 {
@@ -153,4 +154,17 @@ public:
   static bool GetDatabaseResults(MediaType mediaType, const FieldList &fields, const std::auto_ptr<dbiplus::Dataset> &dataset, DatabaseResults &results);
 
   static std::string BuildLimitClause(int end, int start = 0);
+
+  /*! \brief Build the ORDER BY clause (without the keyword) for sorting in the database.
+   Only sorting by date added, title, track number, duration, and the year or rating of movies and
+   music videos is supported, as the database can't build the labels SortUtils orders the other
+   sorts by. Titles are compared without case, but numbers within them are compared as text rather
+   than by value as SortUtils does. Ties are ordered by id, like SortUtils orders them, so that
+   pages of the result are stable.
+   \param sortDescription the sorting to apply.
+   \param mediaType the type of the items being sorted.
+   \param orderClause the resulting clause.
+   \return true if the sorting can be done by the database, false otherwise.
+   */
+  static bool BuildOrderClause(const SortDescription &sortDescription, MediaType mediaType, std::string &orderClause);
 };
@@ -27,45 +27,129 @@ using namespace std;
 
 string CJSONVariantWriter::Write(const CVariant &value, bool compact)
 {
-  string output;
+  string output, chunk;
 
+  CJSONVariantStream stream(value, compact);
+  while (stream.Read(chunk))
+    output += chunk;
+
+  if (stream.Failed())
+    return "";
+
+  return output;
+}
+
+CJSONVariantStream::CJSONVariantStream(const CVariant &value, bool compact)
+  : m_value(value), m_started(false), m_done(false), m_failed(false)
+{
 #if YAJL_MAJOR == 2
-  yajl_gen g = yajl_gen_alloc(NULL);
-  yajl_gen_config(g, yajl_gen_beautify, compact ? 0 : 1);
-  yajl_gen_config(g, yajl_gen_indent_string, "\t");
+  m_generator = yajl_gen_alloc(NULL);
+  yajl_gen_config(m_generator, yajl_gen_beautify, compact ? 0 : 1);
+  yajl_gen_config(m_generator, yajl_gen_indent_string, "\t");
 #else
   yajl_gen_config conf = { compact ? 0 : 1, "\t" };
-  yajl_gen g = yajl_gen_alloc(&conf, NULL);
+  m_generator = yajl_gen_alloc(&conf, NULL);
 #endif
+}
+
+CJSONVariantStream::~CJSONVariantStream()
+{
+  yajl_gen_clear(m_generator);
+  yajl_gen_free(m_generator);
+}
+
+bool CJSONVariantStream::Read(std::string &chunk, size_t size /* = 16384 */)
+{
+  chunk.clear();
+  if (m_done)
+    return false;
 
   // Set locale to classic ("C") to ensure valid JSON numbers
   std::string currentLocale = setlocale(LC_NUMERIC, NULL);
   setlocale(LC_NUMERIC, "C");
 
-  if (InternalWrite(g, value))
-  {
-    const unsigned char * buffer;
-
+  const unsigned char *buffer = NULL;
 #if YAJL_MAJOR == 2
-    size_t length;
-    yajl_gen_get_buf(g, &buffer, &length);
+  size_t length = 0;
 #else
-    unsigned int length;
-    yajl_gen_get_buf(g, &buffer, &length);
+  unsigned int length = 0;
 #endif
-    output = string((const char *)buffer, length);
+  while (!m_done && length < size)
+  {
+    if (!WriteNext())
+    {
+      m_failed = true;
+      m_done = true;
+    }
+    yajl_gen_get_buf(m_generator, &buffer, &length);
   }
 
+  if (!m_failed)
+    chunk.assign((const char *)buffer, length);
+  yajl_gen_clear(m_generator);
+
   // Re-set locale to what it was before using yajl
   setlocale(LC_NUMERIC, currentLocale.c_str());
 
-  yajl_gen_clear(g);
-  yajl_gen_free(g);
+  return !m_failed;
+}
 
-  return output;
+bool CJSONVariantStream::WriteNext()
+{
+  bool success = false;
+
+  if (!m_started)
+  {
+    m_started = true;
+    success = WriteValue(m_value);
+  }
+  else
+  {
+    // note: writing a value may add a container, so the current one isn't used afterwards
+    Container &container = m_containers.back();
+    if (container.value->isArray())
+    {
+      if (container.array == container.value->end_array())
+      {
+        success = yajl_gen_status_ok == yajl_gen_array_close(m_generator);
+        m_containers.pop_back();
+      }
+      else
+      {
+        const CVariant &value = *container.array++;
+        success = WriteValue(value);
+      }
+    }
+    else
+    {
+      if (container.map == container.value->end_map())
+      {
+        success = yajl_gen_status_ok == yajl_gen_map_close(m_generator);
+        m_containers.pop_back();
+      }
+      else
+      {
+        const string &key = container.map->first;
+        const CVariant &value = container.map->second;
+        container.map++;
+#if YAJL_MAJOR == 2
+        success = yajl_gen_status_ok == yajl_gen_string(m_generator, (const unsigned char*)key.c_str(), (size_t)key.length());
+#else
+        success = yajl_gen_status_ok == yajl_gen_string(m_generator, (const unsigned char*)key.c_str(), key.length());
+#endif
+        if (success)
+          success = WriteValue(value);
+      }
+    }
+  }
+
+  if (m_containers.empty())
+    m_done = true;
+
+  return success;
 }
 
-bool CJSONVariantWriter::InternalWrite(yajl_gen g, const CVariant &value)
+bool CJSONVariantStream::WriteValue(const CVariant &value)
 {
   bool success = false;
 
@@ -73,63 +157,55 @@ bool CJSONVariantWriter::InternalWrite(yajl_gen g, const CVariant &value)
   {
   case CVariant::VariantTypeInteger:
 #if YAJL_MAJOR == 2
-    success = yajl_gen_status_ok == yajl_gen_integer(g, (long long int)value.asInteger());
+    success = yajl_gen_status_ok == yajl_gen_integer(m_generator, (long long int)value.asInteger());
 #else
-    success = yajl_gen_status_ok == yajl_gen_integer(g, (long int)value.asInteger());
+    success = yajl_gen_status_ok == yajl_gen_integer(m_generator, (long int)value.asInteger());
 #endif
     break;
   case CVariant::VariantTypeUnsignedInteger:
 #if YAJL_MAJOR == 2
-    success = yajl_gen_status_ok == yajl_gen_integer(g, (long long int)value.asUnsignedInteger());
+    success = yajl_gen_status_ok == yajl_gen_integer(m_generator, (long long int)value.asUnsignedInteger());
 #else
-    success = yajl_gen_status_ok == yajl_gen_integer(g, (long int)value.asUnsignedInteger());
+    success = yajl_gen_status_ok == yajl_gen_integer(m_generator, (long int)value.asUnsignedInteger());
 #endif
     break;
   case CVariant::VariantTypeDouble:
-    success = yajl_gen_status_ok == yajl_gen_double(g, value.asDouble());
+    success = yajl_gen_status_ok == yajl_gen_double(m_generator, value.asDouble());
     break;
   case CVariant::VariantTypeBoolean:
-    success = yajl_gen_status_ok == yajl_gen_bool(g, value.asBoolean() ? 1 : 0);
+    success = yajl_gen_status_ok == yajl_gen_bool(m_generator, value.asBoolean() ? 1 : 0);
     break;
   case CVariant::VariantTypeString:
 #if YAJL_MAJOR == 2
-    success = yajl_gen_status_ok == yajl_gen_string(g, (const unsigned char*)value.c_str(), (size_t)value.size());
+    success = yajl_gen_status_ok == yajl_gen_string(m_generator, (const unsigned char*)value.c_str(), (size_t)value.size());
 #else
-    success = yajl_gen_status_ok == yajl_gen_string(g, (const unsigned char*)value.c_str(), value.size());
+    success = yajl_gen_status_ok == yajl_gen_string(m_generator, (const unsigned char*)value.c_str(), value.size());
 #endif
     break;
   case CVariant::VariantTypeArray:
-    success = yajl_gen_status_ok == yajl_gen_array_open(g);
-
-    for (CVariant::const_iterator_array itr = value.begin_array(); itr != value.end_array() && success; itr++)
-      success &= InternalWrite(g, *itr);
-
-    if (success)
-      success = yajl_gen_status_ok == yajl_gen_array_close(g);
-
-    break;
   case CVariant::VariantTypeObject:
-    success = yajl_gen_status_ok == yajl_gen_map_open(g);
-
-    for (CVariant::const_iterator_map itr = value.begin_map(); itr != value.end_map() && success; itr++)
+  {
+    // the members are written by the following calls of WriteNext()
+    Container container;
+    container.value = &value;
+    if (value.isArray())
     {
-#if YAJL_MAJOR == 2
-      success &= yajl_gen_status_ok == yajl_gen_string(g, (const unsigned char*)itr->first.c_str(), (size_t)itr->first.length());
-#else
-      success &= yajl_gen_status_ok == yajl_gen_string(g, (const unsigned char*)itr->first.c_str(), itr->first.length());
-#endif
-      if (success)
-        success &= InternalWrite(g, itr->second);
+      success = yajl_gen_status_ok == yajl_gen_array_open(m_generator);
+      container.array = value.begin_array();
+    }
+    else
+    {
+      success = yajl_gen_status_ok == yajl_gen_map_open(m_generator);
+      container.map = value.begin_map();
     }
-
     if (success)
-      success &= yajl_gen_status_ok == yajl_gen_map_close(g);
-
+      m_containers.push_back(container);
     break;
+  }
   case CVariant::VariantTypeConstNull:
   case CVariant::VariantTypeNull:
   default:
-    success = yajl_gen_status_ok == yajl_gen_null(g);
+    success = yajl_gen_status_ok == yajl_gen_null(m_generator);
     break;
   }
 
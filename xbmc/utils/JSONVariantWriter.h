@@ -27,10 +27,52 @@
 #include <yajl/yajl_version.h>
 #endif
 
+#include <vector>
+
 class CJSONVariantWriter
 {
 public:
   static std::string Write(const CVariant &value, bool compact);
+};
+
+/*! \brief Writes a variant as JSON a chunk at a time, as the output is consumed.
+
+ Large values, eg. JSON-RPC responses listing a whole library, never have to be held as one string.
+ The variant must outlive the stream and must not be changed while the stream is read.
+ */
+class CJSONVariantStream
+{
+public:
+  CJSONVariantStream(const CVariant &value, bool compact);
+  ~CJSONVariantStream();
+
+  /*! \brief Write the next chunk of JSON
+   \param chunk [out] the next chunk, of at least size bytes unless it is the last one.
+   \param size the size of the chunks to write.
+   \return true if a chunk was written, false once the whole value has been written or writing failed.
+   \sa Failed
+   */
+  bool Read(std::string &chunk, size_t size = 16384);
+
+  /*! \brief Whether writing the value failed, in which case the output is incomplete.
+   */
+  bool Failed() const { return m_failed; }
+
 private:
-  static bool InternalWrite(yajl_gen g, const CVariant &value);
+  bool WriteNext();
+  bool WriteValue(const CVariant &value);
+
+  struct Container
+  {
+    const CVariant                      *value;
+    CVariant::const_iterator_array       array;
+    CVariant::const_iterator_map         map;
+  };
+
+  const CVariant         &m_value;
+  yajl_gen                m_generator;
+  std::vector<Container>  m_containers; ///< the arrays and objects being written, innermost last
+  bool                    m_started;
+  bool                    m_done;
+  bool                    m_failed;
 };
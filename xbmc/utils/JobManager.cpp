@@ -204,8 +204,15 @@ unsigned int CJobManager::AddJob(CJob *job, IJobCallback *callback, CJob::PRIORI
 {
   CSingleLock lock(m_section);
 
+  // jobs added while shutting down would never run
+  if (!m_running)
+  {
+    delete job;
+    return 0;
+  }
+
   // create a work item for this job
-  CWorkItem work(job, m_jobCounter++, callback);
+  CWorkItem work(job, ++m_jobCounter, callback);
   m_jobQueue[priority].push_back(work);
 
   StartWorkers(priority);
@@ -206,7 +206,8 @@ public:
    \param job a pointer to the job to add. The job should be subclassed from CJob
    \param callback a pointer to an IJobCallback instance to receive job progress and completion notices.
    \param priority the priority that this job should run at.
-   \return a unique identifier for this job, to be used with other interaction
+   \return a unique identifier for this job, to be used with other interaction, or 0 if the job
+   manager is shutting down, in which case the job is deleted without being run.
    \sa CJob, IJobCallback, CancelJob()
    */
   unsigned int AddJob(CJob *job, IJobCallback *callback, CJob::PRIORITY priority = CJob::PRIORITY_LOW);
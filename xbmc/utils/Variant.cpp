@@ -112,6 +112,7 @@ double str2double(const wstring &str, double fallback /* = 0.0 */)
 CVariant CVariant::ConstNullVariant = CVariant::VariantTypeConstNull;
 
 CVariant::CVariant(VariantType type)
+  : m_shortString(false)
 {
   m_type = type;
 
@@ -130,7 +131,7 @@ CVariant::CVariant(VariantType type)
       m_data.dvalue = 0.0;
       break;
     case VariantTypeString:
-      m_data.string = new string();
+      setString("", 0);
       break;
     case VariantTypeWideString:
       m_data.wstring = new wstring();
@@ -148,93 +149,110 @@ CVariant::CVariant(VariantType type)
 }
 
 CVariant::CVariant(int integer)
+  : m_shortString(false)
 {
   m_type = VariantTypeInteger;
   m_data.integer = integer;
 }
 
 CVariant::CVariant(int64_t integer)
+  : m_shortString(false)
 {
   m_type = VariantTypeInteger;
   m_data.integer = integer;
 }
 
 CVariant::CVariant(unsigned int unsignedinteger)
+  : m_shortString(false)
 {
   m_type = VariantTypeUnsignedInteger;
   m_data.unsignedinteger = unsignedinteger;
 }
 
 CVariant::CVariant(uint64_t unsignedinteger)
+  : m_shortString(false)
 {
   m_type = VariantTypeUnsignedInteger;
   m_data.unsignedinteger = unsignedinteger;
 }
 
 CVariant::CVariant(double value)
+  : m_shortString(false)
 {
   m_type = VariantTypeDouble;
   m_data.dvalue = value;
 }
 
 CVariant::CVariant(float value)
+  : m_shortString(false)
 {
   m_type = VariantTypeDouble;
   m_data.dvalue = (double)value;
 }
 
 CVariant::CVariant(bool boolean)
+  : m_shortString(false)
 {
   m_type = VariantTypeBoolean;
   m_data.boolean = boolean;
 }
 
 CVariant::CVariant(const char *str)
+  : m_shortString(false)
 {
   m_type = VariantTypeString;
-  m_data.string = new string(str);
+  setString(str, strlen(str));
 }
 
 CVariant::CVariant(const char *str, unsigned int length)
+  : m_shortString(false)
 {
   m_type = VariantTypeString;
-  m_data.string = new string(str, length);
+  setString(str, length);
 }
 
 CVariant::CVariant(const string &str)
+  : m_shortString(false)
 {
   m_type = VariantTypeString;
-  m_data.string = new string(str);
+  setString(str.c_str(), str.size());
 }
 
 CVariant::CVariant(const wchar_t *str)
+  : m_shortString(false)
 {
   m_type = VariantTypeWideString;
   m_data.wstring = new wstring(str);
 }
 
 CVariant::CVariant(const wchar_t *str, unsigned int length)
+  : m_shortString(false)
 {
   m_type = VariantTypeWideString;
   m_data.wstring = new wstring(str, length);
 }
 
 CVariant::CVariant(const wstring &str)
+  : m_shortString(false)
 {
   m_type = VariantTypeWideString;
   m_data.wstring = new wstring(str);
 }
 
 CVariant::CVariant(const std::vector<std::string> &strArray)
+  : m_shortString(false)
 {
   m_type = VariantTypeArray;
-  m_data.array = new VariantArray;
-  m_data.array->reserve(strArray.size());
+  m_data.array = new VariantArray(strArray.size());
   for (unsigned int index = 0; index < strArray.size(); index++)
-    m_data.array->push_back(strArray.at(index));
+  {
+    m_data.array->at(index).m_type = VariantTypeString;
+    m_data.array->at(index).setString(strArray[index].c_str(), strArray[index].size());
+  }
 }
 
 CVariant::CVariant(const CVariant &variant)
+  : m_shortString(false)
 {
   m_type = VariantTypeNull;
   *this = variant;
@@ -247,7 +265,7 @@ CVariant::~CVariant()
 
 void CVariant::cleanup()
 {
-  if (m_type == VariantTypeString)
+  if (m_type == VariantTypeString && !m_shortString)
     delete m_data.string;
   else if (m_type == VariantTypeWideString)
     delete m_data.wstring;
@@ -256,6 +274,33 @@ void CVariant::cleanup()
   else if (m_type == VariantTypeObject)
     delete m_data.map;
   m_type = VariantTypeNull;
+  m_shortString = false;
+}
+
+void CVariant::setString(const char *str, size_t length)
+{
+  // strings with embedded nulls are kept in a std::string
+  if (length <= SHORT_STRING_LENGTH && memchr(str, '\0', length) == NULL)
+  {
+    memcpy(m_data.shortstring, str, length);
+    m_data.shortstring[length] = '\0';
+    m_shortString = true;
+  }
+  else
+  {
+    m_data.string = new string(str, length);
+    m_shortString = false;
+  }
+}
+
+const char *CVariant::stringData() const
+{
+  return m_shortString ? m_data.shortstring : m_data.string->c_str();
+}
+
+size_t CVariant::stringLength() const
+{
+  return m_shortString ? strlen(m_data.shortstring) : m_data.string->size();
 }
 
 bool CVariant::isInteger() const
@@ -319,7 +364,7 @@ int64_t CVariant::asInteger(int64_t fallback) const
     case VariantTypeDouble:
       return (int64_t)m_data.dvalue;
     case VariantTypeString:
-      return str2int64(*m_data.string, fallback);
+      return str2int64(asString(), fallback);
     case VariantTypeWideString:
       return str2int64(*m_data.wstring, fallback);
     default:
@@ -340,7 +385,7 @@ uint64_t CVariant::asUnsignedInteger(uint64_t fallback) const
     case VariantTypeDouble:
       return (uint64_t)m_data.dvalue;
     case VariantTypeString:
-      return str2uint64(*m_data.string, fallback);
+      return str2uint64(asString(), fallback);
     case VariantTypeWideString:
       return str2uint64(*m_data.wstring, fallback);
     default:
@@ -361,7 +406,7 @@ double CVariant::asDouble(double fallback) const
     case VariantTypeUnsignedInteger:
       return (double)m_data.unsignedinteger;
     case VariantTypeString:
-      return str2double(*m_data.string, fallback);
+      return str2double(asString(), fallback);
     case VariantTypeWideString:
       return str2double(*m_data.wstring, fallback);
     default:
@@ -382,7 +427,7 @@ float CVariant::asFloat(float fallback) const
     case VariantTypeUnsignedInteger:
       return (float)m_data.unsignedinteger;
     case VariantTypeString:
-      return (float)str2double(*m_data.string, fallback);
+      return (float)str2double(asString(), fallback);
     case VariantTypeWideString:
       return (float)str2double(*m_data.wstring, fallback);
     default:
@@ -405,7 +450,7 @@ bool CVariant::asBoolean(bool fallback) const
     case VariantTypeDouble:
       return (m_data.dvalue != 0);
     case VariantTypeString:
-      if (m_data.string->empty() || m_data.string->compare("0") == 0 || m_data.string->compare("false") == 0)
+      if (stringLength() == 0 || strcmp(stringData(), "0") == 0 || strcmp(stringData(), "false") == 0)
         return false;
       return true;
     case VariantTypeWideString:
@@ -424,7 +469,7 @@ std::string CVariant::asString(const std::string &fallback /* = "" */) const
   switch (m_type)
   {
     case VariantTypeString:
-      return *m_data.string;
+      return m_shortString ? std::string(m_data.shortstring) : *m_data.string;
     case VariantTypeBoolean:
       return m_data.boolean ? "true" : "false";
     case VariantTypeInteger:
@@ -539,7 +584,13 @@ CVariant &CVariant::operator=(const CVariant &rhs)
     m_data.dvalue = rhs.m_data.dvalue;
     break;
   case VariantTypeString:
-    m_data.string = new string(*rhs.m_data.string);
+    if (rhs.m_shortString)
+    {
+      memcpy(m_data.shortstring, rhs.m_data.shortstring, sizeof(m_data.shortstring));
+      m_shortString = true;
+    }
+    else
+      m_data.string = new string(*rhs.m_data.string);
     break;
   case VariantTypeWideString:
     m_data.wstring = new wstring(*rhs.m_data.wstring);
@@ -572,7 +623,9 @@ bool CVariant::operator==(const CVariant &rhs) const
     case VariantTypeDouble:
       return m_data.dvalue == rhs.m_data.dvalue;
     case VariantTypeString:
-      return *m_data.string == *rhs.m_data.string;
+      if (m_shortString && rhs.m_shortString)
+        return strcmp(m_data.shortstring, rhs.m_data.shortstring) == 0;
+      return asString() == rhs.asString();
     case VariantTypeWideString:
       return *m_data.wstring == *rhs.m_data.wstring;
     case VariantTypeArray:
@@ -596,7 +649,28 @@ void CVariant::push_back(const CVariant &variant)
   }
 
   if (m_type == VariantTypeArray)
+  {
+    // std::vector would copy every element, and all they contain, when growing. The elements are
+    // swapped into the larger array instead, which only swaps their (shallow) values.
+    if (m_data.array->size() == m_data.array->capacity())
+    {
+      if (!m_data.array->empty() && &variant >= &m_data.array->front() && &variant <= &m_data.array->back())
+      { // the variant is one of our own elements, which are about to be swapped out
+        CVariant copy(variant);
+        push_back(copy);
+        return;
+      }
+
+      VariantArray *array = new VariantArray;
+      array->reserve(m_data.array->empty() ? 4 : m_data.array->size() * 2);
+      array->resize(m_data.array->size());
+      for (unsigned int index = 0; index < array->size(); index++)
+        (*array)[index].swap((*m_data.array)[index]);
+      delete m_data.array;
+      m_data.array = array;
+    }
     m_data.array->push_back(variant);
+  }
 }
 
 void CVariant::append(const CVariant &variant)
@@ -607,7 +681,7 @@ void CVariant::append(const CVariant &variant)
 const char *CVariant::c_str() const
 {
   if (m_type == VariantTypeString)
-    return m_data.string->c_str();
+    return stringData();
   else
     return NULL;
 }
@@ -615,12 +689,15 @@ const char *CVariant::c_str() const
 void CVariant::swap(CVariant &rhs)
 {
   VariantType  temp_type = m_type;
+  bool         temp_short = m_shortString;
   VariantUnion temp_data = m_data;
 
   m_type = rhs.m_type;
+  m_shortString = rhs.m_shortString;
   m_data = rhs.m_data;
 
   rhs.m_type = temp_type;
+  rhs.m_shortString = temp_short;
   rhs.m_data = temp_data;
 }
 
@@ -695,7 +772,7 @@ unsigned int CVariant::size() const
   else if (m_type == VariantTypeArray)
     return m_data.array->size();
   else if (m_type == VariantTypeString)
-    return m_data.string->size();
+    return stringLength();
   else if (m_type == VariantTypeWideString)
     return m_data.wstring->size();
   else
@@ -709,7 +786,7 @@ bool CVariant::empty() const
   else if (m_type == VariantTypeArray)
     return m_data.array->empty();
   else if (m_type == VariantTypeString)
-    return m_data.string->empty();
+    return stringLength() == 0;
   else if (m_type == VariantTypeWideString)
     return m_data.wstring->empty();
   else
@@ -723,7 +800,11 @@ void CVariant::clear()
   else if (m_type == VariantTypeArray)
     m_data.array->clear();
   else if (m_type == VariantTypeString)
-    m_data.string->clear();
+  {
+    cleanup();
+    m_type = VariantTypeString;
+    setString("", 0);
+  }
   else if (m_type == VariantTypeWideString)
     m_data.wstring->clear();
 }
@@ -748,7 +829,12 @@ void CVariant::erase(unsigned int position)
   }
 
   if (m_type == VariantTypeArray && position < size())
-    m_data.array->erase(m_data.array->begin() + position);
+  {
+    // swap the following elements down rather than copying them
+    for (unsigned int index = position; index + 1 < m_data.array->size(); index++)
+      (*m_data.array)[index].swap((*m_data.array)[index + 1]);
+    m_data.array->pop_back();
+  }
 }
 
 bool CVariant::isMember(const std::string &key) const
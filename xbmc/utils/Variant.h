@@ -135,6 +135,15 @@ public:
 
 private:
   void cleanup();
+  void setString(const char *str, size_t length);
+  const char *stringData() const;
+  size_t stringLength() const;
+
+  /*! \brief Longest string stored within the variant itself rather than on the heap.
+   Most strings, eg. labels, numbers and dates, are short, so this saves an allocation for each.
+   */
+  static const size_t SHORT_STRING_LENGTH = 23;
+
   union VariantUnion
   {
     int64_t integer;
@@ -145,8 +154,10 @@ private:
     std::wstring *wstring;
     VariantArray *array;
     VariantMap *map;
+    char shortstring[SHORT_STRING_LENGTH + 1];
   };
 
   VariantType m_type;
+  bool m_shortString; ///< whether a string is stored in m_data.shortstring rather than m_data.string
   VariantUnion m_data;
 };
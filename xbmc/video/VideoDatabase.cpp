@@ -20,6 +20,7 @@
  */
 
 #include "threads/SystemClock.h"
+#include "threads/Thread.h"
 #include "VideoDatabase.h"
 #include "video/windows/GUIWindowVideoBase.h"
 #include "utils/RegExp.h"
@@ -332,6 +333,9 @@ bool CVideoDatabase::CreateTables()
     m_pDS->exec("CREATE UNIQUE INDEX ix_taglinks_2 ON taglinks (idMedia, media_type(20), idTag)");
     m_pDS->exec("CREATE INDEX ix_taglinks_3 ON taglinks (media_type(20))");
 
+    CLog::Log(LOGINFO, "create cleanstate table");
+    m_pDS->exec("CREATE TABLE cleanstate (idPath integer)");
+
     // we create views last to ensure all indexes are rolled in
     CreateViews();
   }
@@ -345,6 +349,17 @@ bool CVideoDatabase::CreateTables()
   return true;
 }
 
+/* SQL replacing the row of an item in a search index, for use in a trigger body.
+   select retrieves the docid and indexed columns of items, key is its column identifying an item
+   and id the item to refresh, eg. "new.idMovie". The optional condition restricts when it's refreshed. */
+static CStdString RefreshSearchSQL(const CStdString &index, const CStdString &columns, const CStdString &select,
+                                   const CStdString &key, const CStdString &id, const CStdString &condition = "")
+{
+  CStdString where = condition.IsEmpty() ? "" : " AND " + condition;
+  return "DELETE FROM " + index + " WHERE docid=" + id + where + "; " +
+         "INSERT INTO " + index + " (docid, " + columns + ") " + select + " WHERE " + key + "=" + id + where + "; ";
+}
+
 void CVideoDatabase::CreateViews()
 {
   CLog::Log(LOGINFO, "create episodeview");
@@ -435,6 +450,160 @@ void CVideoDatabase::CreateViews()
               "    path.idPath=files.idPath"
               "  LEFT JOIN bookmark ON"
               "    bookmark.idFile=movie.idFile AND bookmark.type=1");
+
+  // the listings read these copies of the views so that they don't need to join, with triggers
+  // on every table the views join keeping them up to date
+  MaterializeView("movielist", "movieview", "idMovie");
+  m_pDS->exec("CREATE INDEX ix_movielist_2 ON movielist (idFile)");
+  MaterializeView("episodelist", "episodeview", "idEpisode");
+  m_pDS->exec("CREATE INDEX ix_episodelist_2 ON episodelist (idFile)");
+  m_pDS->exec("CREATE INDEX ix_episodelist_3 ON episodelist (idShow)");
+  MaterializeView("musicvideolist", "musicvideoview", "idMVideo");
+  m_pDS->exec("CREATE INDEX ix_musicvideolist_2 ON musicvideolist (idFile)");
+
+  // full-text search indexes of titles, plots, cast and tags, rebuilt from the tables
+  const char *searchTypes[] = { "movie", "tvshow", "episode", "musicvideo" };
+  const unsigned int searchCount = sizeof(searchTypes) / sizeof(searchTypes[0]);
+  bool indexed = true;
+  for (unsigned int i = 0; i < searchCount && indexed; i++)
+  {
+    CStdString index, columns, select, key;
+    GetSearchIndex(searchTypes[i], index, columns, select, key);
+    indexed = CreateSearchIndex(index, columns);
+  }
+
+  map<string, CStdString> search, searchDelete;
+  if (indexed)
+  {
+    for (unsigned int i = 0; i < searchCount; i++)
+    {
+      CStdString index, columns, select, key;
+      GetSearchIndex(searchTypes[i], index, columns, select, key);
+      m_pDS->exec("INSERT INTO " + index + " (docid, " + columns + ") " + select);
+      search[searchTypes[i]] = RefreshSearchSQL(index, columns, select, key, "new." + key);
+      searchDelete[searchTypes[i]] = "DELETE FROM " + index + " WHERE docid=old." + key + "; ";
+    }
+    CreateTrigger("insert_tvshow", "INSERT ON tvshow", search["tvshow"]);
+  }
+  else
+    m_pDS->exec("DROP TRIGGER IF EXISTS insert_tvshow");
+
+  // the cast and tags are in link tables, but an item is only refreshed once, by the update of its row at
+  // the end of SetDetailsFor*(), rather than for each link. Tags changed on their own call UpdateSearchIndex().
+  const char *linkTriggers[] = { "insert_actorlinkmovie", "insert_actorlinktvshow", "insert_actorlinkepisode", "insert_taglinks",
+                                 "delete_actorlinkmovie", "delete_actorlinktvshow", "delete_actorlinkepisode", "delete_taglinks" };
+  for (unsigned int i = 0; i < sizeof(linkTriggers) / sizeof(linkTriggers[0]); i++)
+    m_pDS->exec(CStdString("DROP TRIGGER IF EXISTS ") + linkTriggers[i]);
+
+  CStdString movieSearch = search["movie"], movieSearchDelete = searchDelete["movie"],
+             tvshowSearch = search["tvshow"], tvshowSearchDelete = searchDelete["tvshow"],
+             episodeSearch = search["episode"], episodeSearchDelete = searchDelete["episode"],
+             musicvideoSearch = search["musicvideo"], musicvideoSearchDelete = searchDelete["musicvideo"];
+
+  CLog::Log(LOGINFO, "create list triggers");
+  CreateTrigger("insert_movie", "INSERT ON movie", "INSERT INTO movielist SELECT * FROM movieview WHERE idMovie=new.idMovie; " + movieSearch);
+  CreateTrigger("update_movie", "UPDATE ON movie", RefreshRowsSQL("movielist", "movieview", "idMovie=new.idMovie") + movieSearch);
+  CreateTrigger("delete_movie", "DELETE ON movie", "DELETE FROM art WHERE media_id=old.idMovie AND media_type='movie'; "
+                                                   "DELETE FROM movielist WHERE idMovie=old.idMovie; " + movieSearchDelete);
+
+  CreateTrigger("insert_episode", "INSERT ON episode", "INSERT INTO episodelist SELECT * FROM episodeview WHERE idEpisode=new.idEpisode; " + episodeSearch);
+  CreateTrigger("update_episode", "UPDATE ON episode", RefreshRowsSQL("episodelist", "episodeview", "idEpisode=new.idEpisode") + episodeSearch);
+  CreateTrigger("delete_episode", "DELETE ON episode", "DELETE FROM art WHERE media_id=old.idEpisode AND media_type='episode'; "
+                                                       "DELETE FROM episodelist WHERE idEpisode=old.idEpisode; " + episodeSearchDelete);
+
+  CreateTrigger("insert_musicvideo", "INSERT ON musicvideo", "INSERT INTO musicvideolist SELECT * FROM musicvideoview WHERE idMVideo=new.idMVideo; " + musicvideoSearch);
+  CreateTrigger("update_musicvideo", "UPDATE ON musicvideo", RefreshRowsSQL("musicvideolist", "musicvideoview", "idMVideo=new.idMVideo") + musicvideoSearch);
+  CreateTrigger("delete_musicvideo", "DELETE ON musicvideo", "DELETE FROM art WHERE media_id=old.idMVideo AND media_type='musicvideo'; "
+                                                             "DELETE FROM musicvideolist WHERE idMVideo=old.idMVideo; " + musicvideoSearchDelete);
+  CreateTrigger("delete_tvshow", "DELETE ON tvshow", "DELETE FROM art WHERE media_id=old.idShow AND media_type='tvshow'; " + tvshowSearchDelete);
+
+  // episodes carry details of their show and season
+  CStdString showColumns = PrepareSQL("UPDATE OF c%02d, c%02d, c%02d, c%02d, c%02d, c%02d ON tvshow", VIDEODB_ID_TV_TITLE, VIDEODB_ID_TV_PLOT, VIDEODB_ID_TV_STUDIOS,
+                                      VIDEODB_ID_TV_PREMIERED, VIDEODB_ID_TV_MPAA, VIDEODB_ID_TV_BASEPATH);
+  CreateTrigger("update_tvshow", showColumns, RefreshRowsSQL("episodelist", "episodeview", "idShow=new.idShow") + tvshowSearch);
+  CreateTrigger("insert_season", "INSERT ON seasons", RefreshRowsSQL("episodelist", "episodeview", "idShow=new.idShow"));
+  CreateTrigger("delete_season", "DELETE ON seasons", "DELETE FROM art WHERE media_id=old.idSeason AND media_type='season'; " +
+                                                      RefreshRowsSQL("episodelist", "episodeview", "idShow=old.idShow"));
+
+  // play counts, resume points and paths
+  CStdString refreshFile = RefreshRowsSQL("movielist", "movieview", "idFile=new.idFile") +
+                           RefreshRowsSQL("episodelist", "episodeview", "idFile=new.idFile") +
+                           RefreshRowsSQL("musicvideolist", "musicvideoview", "idFile=new.idFile");
+  CStdString refreshOldFile = refreshFile;
+  refreshOldFile.Replace("new.idFile", "old.idFile");
+  // the triggers only run for the columns in the views, paths for example have their hash updated with each scan
+  CStdString pathFiles = "idFile IN (SELECT idFile FROM files WHERE idPath=new.idPath)";
+  CStdString refreshPath = RefreshRowsSQL("movielist", "movieview", pathFiles) +
+                           RefreshRowsSQL("episodelist", "episodeview", pathFiles) +
+                           RefreshRowsSQL("musicvideolist", "musicvideoview", pathFiles);
+  CreateTrigger("update_files", "UPDATE OF idPath, strFilename, playCount, lastPlayed, dateAdded ON files", refreshFile);
+  CreateTrigger("delete_files", "DELETE ON files", refreshOldFile);
+  CreateTrigger("update_path", "UPDATE OF strPath ON path", refreshPath);
+  CreateTrigger("insert_bookmark", "INSERT ON bookmark", refreshFile);
+  CreateTrigger("update_bookmark", "UPDATE OF idFile, timeInSeconds, totalTimeInSeconds, type ON bookmark", refreshFile);
+  CreateTrigger("delete_bookmark", "DELETE ON bookmark", refreshOldFile);
+}
+
+bool CVideoDatabase::GetSearchIndex(const std::string &mediaType, CStdString &index, CStdString &columns, CStdString &select, CStdString &key) const
+{
+  if (mediaType == "movie")
+  {
+    index = "moviesearch";
+    columns = "title, plot, actors, tags";
+    // the plot of movies includes their plot outline and tagline, which a search by plot has always matched
+    select = PrepareSQL("SELECT idMovie, c%02d, ifnull(c%02d, '') || ' ' || ifnull(c%02d, '') || ' ' || ifnull(c%02d, ''), "
+                        "(SELECT group_concat(strActor, ' ') FROM actorlinkmovie JOIN actors ON actors.idActor=actorlinkmovie.idActor WHERE actorlinkmovie.idMovie=movie.idMovie), "
+                        "(SELECT group_concat(strTag, ' ') FROM taglinks JOIN tag ON tag.idTag=taglinks.idTag WHERE taglinks.idMedia=movie.idMovie AND taglinks.media_type='movie') "
+                        "FROM movie", VIDEODB_ID_TITLE, VIDEODB_ID_PLOT, VIDEODB_ID_PLOTOUTLINE, VIDEODB_ID_TAGLINE);
+    key = "idMovie";
+  }
+  else if (mediaType == "tvshow")
+  {
+    index = "tvshowsearch";
+    columns = "title, plot, actors";
+    select = PrepareSQL("SELECT idShow, c%02d, c%02d, "
+                        "(SELECT group_concat(strActor, ' ') FROM actorlinktvshow JOIN actors ON actors.idActor=actorlinktvshow.idActor WHERE actorlinktvshow.idShow=tvshow.idShow) "
+                        "FROM tvshow", VIDEODB_ID_TV_TITLE, VIDEODB_ID_TV_PLOT);
+    key = "idShow";
+  }
+  else if (mediaType == "episode")
+  {
+    index = "episodesearch";
+    columns = "title, plot, actors";
+    select = PrepareSQL("SELECT idEpisode, c%02d, c%02d, "
+                        "(SELECT group_concat(strActor, ' ') FROM actorlinkepisode JOIN actors ON actors.idActor=actorlinkepisode.idActor WHERE actorlinkepisode.idEpisode=episode.idEpisode) "
+                        "FROM episode", VIDEODB_ID_EPISODE_TITLE, VIDEODB_ID_EPISODE_PLOT);
+    key = "idEpisode";
+  }
+  else if (mediaType == "musicvideo")
+  {
+    index = "musicvideosearch";
+    columns = "title, artists, album";
+    select = PrepareSQL("SELECT idMVideo, c%02d, c%02d, c%02d FROM musicvideo",
+                        VIDEODB_ID_MUSICVIDEO_TITLE, VIDEODB_ID_MUSICVIDEO_ARTIST, VIDEODB_ID_MUSICVIDEO_ALBUM);
+    key = "idMVideo";
+  }
+  else
+    return false;
+
+  return true;
+}
+
+void CVideoDatabase::UpdateSearchIndex(int idMedia, const std::string &mediaType)
+{
+  CStdString index, columns, select, key;
+  if (!GetSearchIndex(mediaType, index, columns, select, key) || !HasSearchIndex(index))
+    return;
+
+  try
+  {
+    m_pDS->exec(PrepareSQL("DELETE FROM %s WHERE docid=%i", index.c_str(), idMedia));
+    m_pDS->exec("INSERT INTO " + index + " (docid, " + columns + ") " + select + PrepareSQL(" WHERE %s=%i", key.c_str(), idMedia));
+  }
+  catch (...)
+  {
+    CLog::Log(LOGERROR, "%s (%i, %s) failed", __FUNCTION__, idMedia, mediaType.c_str());
+  }
 }
 
 //********************************************************************************************************************************
@@ -576,6 +745,15 @@ int CVideoDatabase::RunQuery(const CStdString &sql)
   return rows;
 }
 
+CStdString CVideoDatabase::GetSearchCondition(const CStdString &index, const CStdString &column, const CStdString &key,
+                                              const CStdString &search, const CStdString &fallback)
+{
+  CStdString match = HasSearchIndex(index) ? SearchIndexSQL(index, search, "1", 0, column) : "";
+  if (match.IsEmpty())
+    return fallback;
+  return key + " IN (SELECT docid FROM (" + match + ") AS hits)";
+}
+
 bool CVideoDatabase::GetSubPaths(const CStdString &basepath, vector< pair<int,string> >& subpaths)
 {
   CStdString sql;
@@ -802,6 +980,72 @@ bool CVideoDatabase::SetPathHash(const CStdString &path, const CStdString &hash)
   return false;
 }
 
+bool CVideoDatabase::SearchIndex(MediaType mediaType, const CStdString& search, CFileItemList& items, int limit /* = 1000 */)
+{
+  CStdString index, table, key, weights, type, baseDir;
+  switch (mediaType)
+  {
+  case MediaTypeMovie:
+    index = "moviesearch"; table = "movie"; key = "idMovie"; weights = "10, 2, 4, 4";
+    type = "movie"; baseDir = "videodb://1/2/";
+    break;
+  case MediaTypeTvShow:
+    index = "tvshowsearch"; table = "tvshow"; key = "idShow"; weights = "10, 2, 4";
+    type = "tvshow"; baseDir = "videodb://2/2/";
+    break;
+  case MediaTypeEpisode:
+    index = "episodesearch"; table = "episode"; key = "idEpisode"; weights = "10, 2, 4";
+    type = "episode"; baseDir = "videodb://2/2/-1/-1/";
+    break;
+  case MediaTypeMusicVideo:
+    index = "musicvideosearch"; table = "musicvideo"; key = "idMVideo"; weights = "10, 6, 4";
+    type = "musicvideo"; baseDir = "videodb://3/2/";
+    break;
+  default:
+    return false;
+  }
+
+  CStdString strSQL;
+  try
+  {
+    if (NULL == m_pDB.get()) return false;
+    if (NULL == m_pDS.get()) return false;
+
+    // all the titles are in c00
+    CStdString match = HasSearchIndex(index) ? SearchIndexSQL(index, search, weights, limit) : "";
+    if (!match.IsEmpty())
+      strSQL.Format("SELECT %s.%s, %s.c00 FROM (%s) AS hits JOIN %s ON %s.%s=hits.docid ORDER BY hits.rank DESC",
+                    table.c_str(), key.c_str(), table.c_str(), match.c_str(), table.c_str(), table.c_str(), key.c_str());
+    else
+      strSQL = PrepareSQL("SELECT %s, c00 FROM %s WHERE c00 LIKE '%s%%' ORDER BY c00 LIMIT %i",
+                          key.c_str(), table.c_str(), search.c_str(), limit);
+
+    if (!m_pDS->query(strSQL.c_str()))
+      return false;
+
+    while (!m_pDS->eof())
+    {
+      int id = m_pDS->fv(0).get_asInt();
+      CFileItemPtr item(new CFileItem(m_pDS->fv(1).get_asString()));
+      CStdString path;
+      path.Format("%s%i", baseDir.c_str(), id);
+      item->SetPath(path);
+      item->m_bIsFolder = mediaType == MediaTypeTvShow;
+      item->GetVideoInfoTag()->m_iDbId = id;
+      item->GetVideoInfoTag()->m_type = type;
+      items.Add(item);
+      m_pDS->next();
+    }
+    m_pDS->close();
+    return true;
+  }
+  catch (...)
+  {
+    CLog::Log(LOGERROR, "%s (%s) failed", __FUNCTION__, strSQL.c_str());
+  }
+  return false;
+}
+
 bool CVideoDatabase::LinkMovieToTvshow(int idMovie, int idShow, bool bRemove)
 {
    try
@@ -1349,6 +1593,15 @@ void CVideoDatabase::AddLinkToActor(const char *table, int actorID, const char *
     if (NULL == m_pDB.get()) return ;
     if (NULL == m_pDS.get()) return ;
 
+    // within a transaction the link is queued, to be sent with the other writes when it's committed.
+    // the unique index on the link table takes care of existing links.
+    if (InTransaction())
+    {
+      QueueInsertQuery(PrepareSQL("%s into %s (idActor, %s, strRole, iOrder) values(%i,%i,'%s',%i)", m_sqlite ? "insert or ignore" : "insert ignore",
+                                  table, secondField, actorID, secondID, role.c_str(), order));
+      return;
+    }
+
     CStdString strSQL=PrepareSQL("select * from %s where idActor=%i and %s=%i", table, actorID, secondField, secondID);
     m_pDS->query(strSQL.c_str());
     if (m_pDS->num_rows() == 0)
@@ -1372,6 +1625,17 @@ void CVideoDatabase::AddToLinkTable(const char *table, const char *firstField, i
     if (NULL == m_pDB.get()) return ;
     if (NULL == m_pDS.get()) return ;
 
+    // queue the link within a transaction, as in AddLinkToActor()
+    if (InTransaction())
+    {
+      const char *insert = m_sqlite ? "insert or ignore" : "insert ignore";
+      if (typeField == NULL || type == NULL)
+        QueueInsertQuery(PrepareSQL("%s into %s (%s,%s) values(%i,%i)", insert, table, firstField, secondField, firstID, secondID));
+      else
+        QueueInsertQuery(PrepareSQL("%s into %s (%s,%s,%s) values(%i,%i,'%s')", insert, table, firstField, secondField, typeField, firstID, secondID, type));
+      return;
+    }
+
     CStdString strSQL = PrepareSQL("select * from %s where %s=%i and %s=%i", table, firstField, firstID, secondField, secondID);
     if (typeField != NULL && type != NULL)
       strSQL += PrepareSQL(" and %s='%s'", typeField, type);
@@ -1423,6 +1687,7 @@ void CVideoDatabase::AddTagToItem(int idMovie, int idTag, const std::string &typ
     return;
 
   AddToLinkTable("taglinks", "idTag", idTag, "idMedia", idMovie, "media_type", type.c_str());
+  UpdateSearchIndex(idMovie, type);
 }
 
 void CVideoDatabase::RemoveTagFromItem(int idMovie, int idTag, const std::string &type)
@@ -1431,6 +1696,7 @@ void CVideoDatabase::RemoveTagFromItem(int idMovie, int idTag, const std::string
     return;
 
   RemoveFromLinkTable("taglinks", "idTag", idTag, "idMedia", idMovie, "media_type", type.c_str());
+  UpdateSearchIndex(idMovie, type);
 }
 
 //****Actors****
@@ -1956,11 +2222,11 @@ int CVideoDatabase::SetDetailsForMovie(const CStdString& strFilenameAndPath, con
       AddSetToMovie(idMovie, idSet);
     }
 
-    // add tags...
+    // add tags, the search index is refreshed by the update of the movie below
     for (unsigned int i = 0; i < details.m_tags.size(); i++)
     {
       int idTag = AddTag(details.m_tags[i]);
-      AddTagToItem(idMovie, idTag, "movie");
+      AddToLinkTable("taglinks", "idTag", idTag, "idMedia", idMovie, "media_type", "movie");
     }
 
     // add countries...
@@ -2911,8 +3177,20 @@ void CVideoDatabase::DeleteTag(int idTag, const std::string &mediaType)
       return;
 
     CStdString strSQL;
+    vector<int> items;
+    strSQL = PrepareSQL("SELECT idMedia FROM taglinks WHERE idTag = %i AND media_type = '%s'", idTag, mediaType.c_str());
+    m_pDS->query(strSQL.c_str());
+    while (!m_pDS->eof())
+    {
+      items.push_back(m_pDS->fv(0).get_asInt());
+      m_pDS->next();
+    }
+    m_pDS->close();
+
     strSQL = PrepareSQL("DELETE FROM taglinks WHERE idTag = %i AND media_type = '%s'", idTag, mediaType.c_str());
     m_pDS->exec(strSQL.c_str());
+    for (vector<int>::const_iterator item = items.begin(); item != items.end(); ++item)
+      UpdateSearchIndex(*item, mediaType);
 
     // check if the tag is used for another media type as well before deleting it completely
     strSQL = PrepareSQL("SELECT 1 FROM taglinks WHERE idTag = %i", idTag);
@@ -2993,6 +3271,46 @@ CVideoInfoTag CVideoDatabase::GetDetailsByTypeAndId(VIDEODB_CONTENT_TYPE type, i
   return details;
 }
 
+// adds the stream of the current row of a "SELECT * FROM streamdetails" query to details
+static bool AddStreamDetail(Dataset *pDS, CStreamDetails &details)
+{
+  CStreamDetail::StreamType e = (CStreamDetail::StreamType)pDS->fv(1).get_asInt();
+  switch (e)
+  {
+  case CStreamDetail::VIDEO:
+    {
+      CStreamDetailVideo *p = new CStreamDetailVideo();
+      p->m_strCodec = pDS->fv(2).get_asString();
+      p->m_fAspect = pDS->fv(3).get_asFloat();
+      p->m_iWidth = pDS->fv(4).get_asInt();
+      p->m_iHeight = pDS->fv(5).get_asInt();
+      p->m_iDuration = pDS->fv(10).get_asInt();
+      details.AddStream(p);
+      return true;
+    }
+  case CStreamDetail::AUDIO:
+    {
+      CStreamDetailAudio *p = new CStreamDetailAudio();
+      p->m_strCodec = pDS->fv(6).get_asString();
+      if (pDS->fv(7).get_isNull())
+        p->m_iChannels = -1;
+      else
+        p->m_iChannels = pDS->fv(7).get_asInt();
+      p->m_strLanguage = pDS->fv(8).get_asString();
+      details.AddStream(p);
+      return true;
+    }
+  case CStreamDetail::SUBTITLE:
+    {
+      CStreamDetailSubtitle *p = new CStreamDetailSubtitle();
+      p->m_strLanguage = pDS->fv(9).get_asString();
+      details.AddStream(p);
+      return true;
+    }
+  }
+  return false;
+}
+
 bool CVideoDatabase::GetStreamDetails(CVideoInfoTag& tag) const
 {
   if (tag.m_iFileId < 0)
@@ -3008,44 +3326,8 @@ bool CVideoDatabase::GetStreamDetails(CVideoInfoTag& tag) const
   details.Reset();
   while (!pDS->eof())
   {
-    CStreamDetail::StreamType e = (CStreamDetail::StreamType)pDS->fv(1).get_asInt();
-    switch (e)
-    {
-    case CStreamDetail::VIDEO:
-      {
-        CStreamDetailVideo *p = new CStreamDetailVideo();
-        p->m_strCodec = pDS->fv(2).get_asString();
-        p->m_fAspect = pDS->fv(3).get_asFloat();
-        p->m_iWidth = pDS->fv(4).get_asInt();
-        p->m_iHeight = pDS->fv(5).get_asInt();
-        p->m_iDuration = pDS->fv(10).get_asInt();
-        details.AddStream(p);
-        retVal = true;
-        break;
-      }
-    case CStreamDetail::AUDIO:
-      {
-        CStreamDetailAudio *p = new CStreamDetailAudio();
-        p->m_strCodec = pDS->fv(6).get_asString();
-        if (pDS->fv(7).get_isNull())
-          p->m_iChannels = -1;
-        else
-          p->m_iChannels = pDS->fv(7).get_asInt();
-        p->m_strLanguage = pDS->fv(8).get_asString();
-        details.AddStream(p);
-        retVal = true;
-        break;
-      }
-    case CStreamDetail::SUBTITLE:
-      {
-        CStreamDetailSubtitle *p = new CStreamDetailSubtitle();
-        p->m_strLanguage = pDS->fv(9).get_asString();
-        details.AddStream(p);
-        retVal = true;
-        break;
-      }
-    }
-
+    if (AddStreamDetail(pDS.get(), details))
+      retVal = true;
     pDS->next();
   }
 
@@ -3057,6 +3339,63 @@ bool CVideoDatabase::GetStreamDetails(CVideoInfoTag& tag) const
 
   return retVal;
 }
+
+void CVideoDatabase::GetStreamDetailsForItems(CFileItemList &items) const
+{
+  map<int, vector<CFileItemPtr> > files;
+  for (int i = 0; i < items.Size(); i++)
+  {
+    CFileItemPtr item = items[i];
+    if (!item->HasVideoInfoTag())
+      continue;
+
+    const CVideoInfoTag &tag = *item->GetVideoInfoTag();
+    if (tag.m_iFileId < 0 || tag.HasStreamDetails() ||
+       (tag.m_type != "movie" && tag.m_type != "episode" && tag.m_type != "musicvideo"))
+      continue;
+
+    files[tag.m_iFileId].push_back(item);
+  }
+
+  if (files.empty() || NULL == m_pDB.get())
+    return;
+
+  try
+  {
+    CStdString ids;
+    for (map<int, vector<CFileItemPtr> >::const_iterator i = files.begin(); i != files.end(); ++i)
+      ids += PrepareSQL(ids.IsEmpty() ? "%i" : ",%i", i->first);
+
+    map<int, CStreamDetails> details;
+    auto_ptr<Dataset> pDS(m_pDB->CreateDataset());
+    pDS->query("SELECT * FROM streamdetails WHERE idFile IN (" + ids + ")");
+    while (!pDS->eof())
+    {
+      AddStreamDetail(pDS.get(), details[pDS->fv(0).get_asInt()]);
+      pDS->next();
+    }
+    pDS->close();
+
+    for (map<int, CStreamDetails>::iterator i = details.begin(); i != details.end(); ++i)
+    {
+      i->second.DetermineBestStreams();
+
+      const vector<CFileItemPtr> &fileItems = files[i->first];
+      for (vector<CFileItemPtr>::const_iterator item = fileItems.begin(); item != fileItems.end(); ++item)
+      {
+        CVideoInfoTag &tag = *(*item)->GetVideoInfoTag();
+        tag.m_streamDetails = i->second;
+        if (i->second.GetVideoDuration() > 0)
+          tag.m_strRuntime.Format("%i", i->second.GetVideoDuration() / 60 );
+        (*item)->SetInvalid();
+      }
+    }
+  }
+  catch (...)
+  {
+    CLog::Log(LOGERROR, "%s(%u items) failed", __FUNCTION__, (unsigned int)files.size());
+  }
+}
  
 bool CVideoDatabase::GetResumePoint(CVideoInfoTag& tag)
 {
@@ -3535,6 +3874,90 @@ bool CVideoDatabase::GetArtForItem(int mediaId, const string &mediaType, map<str
   return false;
 }
 
+void CVideoDatabase::GetArtForItems(CFileItemList &items)
+{
+  // the items without art by media type and id, and the shows of the episodes among them
+  map<pair<string, int>, vector<CFileItemPtr> > artItems;
+  map<int, vector<CFileItemPtr> > showItems;
+  map<string, set<int> > ids;
+  for (int i = 0; i < items.Size(); i++)
+  {
+    CFileItemPtr item = items[i];
+    if (!item->HasVideoInfoTag() || !item->GetArt().empty())
+      continue;
+
+    const CVideoInfoTag &tag = *item->GetVideoInfoTag();
+    if (tag.m_iDbId < 0 ||
+       (tag.m_type != "movie" && tag.m_type != "episode" && tag.m_type != "musicvideo" && tag.m_type != "tvshow"))
+      continue;
+
+    artItems[make_pair(string(tag.m_type), tag.m_iDbId)].push_back(item);
+    ids[tag.m_type].insert(tag.m_iDbId);
+    if (tag.m_iIdShow >= 0 && !item->HasProperty("fanart_image"))
+    {
+      showItems[tag.m_iIdShow].push_back(item);
+      ids["tvshow"].insert(tag.m_iIdShow);
+    }
+  }
+
+  if (ids.empty() || NULL == m_pDB.get() || NULL == m_pDS2.get())
+    return;
+
+  try
+  {
+    CStdString where;
+    for (map<string, set<int> >::const_iterator type = ids.begin(); type != ids.end(); ++type)
+    {
+      CStdString typeIds;
+      for (set<int>::const_iterator id = type->second.begin(); id != type->second.end(); ++id)
+        typeIds += PrepareSQL(typeIds.IsEmpty() ? "%i" : ",%i", *id);
+      if (!where.IsEmpty())
+        where += " OR ";
+      where += PrepareSQL("(media_type='%s' AND media_id IN (", type->first.c_str()) + typeIds + "))";
+    }
+
+    map<pair<string, int>, map<string, string> > art;
+    m_pDS2->query("SELECT media_type,media_id,type,url FROM art WHERE " + where);
+    while (!m_pDS2->eof())
+    {
+      art[make_pair(m_pDS2->fv(0).get_asString(), m_pDS2->fv(1).get_asInt())].insert(make_pair(m_pDS2->fv(2).get_asString(), m_pDS2->fv(3).get_asString()));
+      m_pDS2->next();
+    }
+    m_pDS2->close();
+
+    // items without any art are left to the thumb loader, which looks for local art
+    for (map<pair<string, int>, vector<CFileItemPtr> >::const_iterator i = artItems.begin(); i != artItems.end(); ++i)
+    {
+      map<pair<string, int>, map<string, string> >::const_iterator itemArt = art.find(i->first);
+      if (itemArt == art.end())
+        continue;
+      for (vector<CFileItemPtr>::const_iterator item = i->second.begin(); item != i->second.end(); ++item)
+        (*item)->SetArt(itemArt->second);
+    }
+
+    // episodes get the fanart of their show, as with CVideoThumbLoader::FillLibraryArt
+    for (map<int, vector<CFileItemPtr> >::const_iterator i = showItems.begin(); i != showItems.end(); ++i)
+    {
+      map<pair<string, int>, map<string, string> >::const_iterator showArt = art.find(make_pair(string("tvshow"), i->first));
+      if (showArt == art.end())
+        continue;
+      map<string, string>::const_iterator fanart = showArt->second.find("fanart");
+      map<string, string>::const_iterator thumb = showArt->second.find("thumb");
+      for (vector<CFileItemPtr>::const_iterator item = i->second.begin(); item != i->second.end(); ++item)
+      {
+        if (fanart != showArt->second.end())
+          (*item)->SetProperty("fanart_image", fanart->second);
+        if (thumb != showArt->second.end())
+          (*item)->SetProperty("tvshowthumb", thumb->second);
+      }
+    }
+  }
+  catch (...)
+  {
+    CLog::Log(LOGERROR, "%s(%u items) failed", __FUNCTION__, (unsigned int)artItems.size());
+  }
+}
+
 string CVideoDatabase::GetArtForItem(int mediaId, const string &mediaType, const string &artType)
 {
   std::string query = PrepareSQL("SELECT url FROM art WHERE media_id=%i AND media_type='%s' AND type='%s'", mediaId, mediaType.c_str(), artType.c_str());
@@ -4009,6 +4432,10 @@ bool CVideoDatabase::UpdateOldVersion(int iVersion)
     m_pDS->exec("CREATE UNIQUE INDEX ix_taglinks_2 ON taglinks (idMedia, media_type(20), idTag)");
     m_pDS->exec("CREATE INDEX ix_taglinks_3 ON taglinks (media_type(20))");
   }
+  if (iVersion < 71)
+  { // the path an interrupted cleanup resumes from
+    m_pDS->exec("CREATE TABLE cleanstate (idPath integer)");
+  }
   // always recreate the view after any table change
   CreateViews();
   return true;
@@ -5367,7 +5794,7 @@ bool CVideoDatabase::GetMoviesByWhere(const CStdString& strBaseDir, const Filter
 
     int total = -1;
 
-    CStdString strSQL = "select %s from movieview ";
+    CStdString strSQL = "select %s from movielist AS movieview ";
     CStdString strSQLExtra;
     CFileItemList setItems;
     if (fetchSets && g_guiSettings.GetBool("videolibrary.groupmoviesets"))
@@ -5415,12 +5842,20 @@ bool CVideoDatabase::GetMoviesByWhere(const CStdString& strBaseDir, const Filter
       strSQLExtra += " GROUP BY " + filter.group;
     if (filter.order.size())
       strSQLExtra += " ORDER BY " + filter.order;
+    SortDescription sorting = sortDescription;
+    std::string order;
     if (!filter.limit.empty())
       strSQLExtra += " LIMIT " + filter.limit;
-    else if (sortDescription.sortBy == SortByNone &&
-            (sortDescription.limitStart > 0 || sortDescription.limitEnd > 0))
-    {
+    else if ((sortDescription.limitStart > 0 || sortDescription.limitEnd > 0) &&
+             (sortDescription.sortBy == SortByNone ||
+             (filter.order.empty() && setItems.Size() == 0 && DatabaseUtils::BuildOrderClause(sortDescription, MediaTypeMovie, order))))
+    { // only the requested page is retrieved, sorted by the database if need be
       total = (int)strtol(GetSingleValue(PrepareSQL(strSQL, "COUNT(1)") + strSQLExtra, m_pDS).c_str(), NULL, 10);
+      if (!order.empty())
+      {
+        strSQLExtra += " ORDER BY " + order;
+        sorting.sortBy = SortByNone;
+      }
       strSQLExtra += DatabaseUtils::BuildLimitClause(sortDescription.limitEnd, sortDescription.limitStart);
     }
 
@@ -5448,7 +5883,7 @@ bool CVideoDatabase::GetMoviesByWhere(const CStdString& strBaseDir, const Filter
       results.push_back(result);
     }
 
-    if (!SortUtils::SortFromDataset(sortDescription, MediaTypeMovie, m_pDS, results))
+    if (!SortUtils::SortFromDataset(sorting, MediaTypeMovie, m_pDS, results))
       return false;
 
     // get data from returned rows
@@ -5856,7 +6291,7 @@ bool CVideoDatabase::GetEpisodesByWhere(const CStdString& strBaseDir, const Filt
 
     int total = -1;
 
-    CStdString strSQL = "select %s from episodeview ";
+    CStdString strSQL = "select %s from episodelist AS episodeview ";
     CStdString strSQLExtra;
     if (!filter.join.empty())
       strSQLExtra += filter.join;
@@ -5866,13 +6301,21 @@ bool CVideoDatabase::GetEpisodesByWhere(const CStdString& strBaseDir, const Filt
       strSQLExtra += " GROUP BY " + filter.group;
     if (!filter.order.empty())
       strSQLExtra += " ORDER BY " + filter.order;
+    SortDescription sorting = sortDescription;
+    std::string order;
     if (!filter.limit.empty())
       strSQLExtra += " LIMIT " + filter.limit;
-    // Apply the limiting directly here if there's no special sorting but limiting
-    else if (sortDescription.sortBy == SortByNone &&
-            (sortDescription.limitStart > 0 || sortDescription.limitEnd > 0))
+    // Apply the sorting and limiting directly here if there's no special sorting or it maps to a column
+    else if ((sortDescription.limitStart > 0 || sortDescription.limitEnd > 0) &&
+             (sortDescription.sortBy == SortByNone ||
+             (filter.order.empty() && DatabaseUtils::BuildOrderClause(sortDescription, MediaTypeEpisode, order))))
     {
       total = (int)strtol(GetSingleValue(PrepareSQL(strSQL, "COUNT(1)") + strSQLExtra, m_pDS).c_str(), NULL, 10);
+      if (!order.empty())
+      {
+        strSQLExtra += " ORDER BY " + order;
+        sorting.sortBy = SortByNone;
+      }
       strSQLExtra += DatabaseUtils::BuildLimitClause(sortDescription.limitEnd, sortDescription.limitStart);
     }
 
@@ -5889,7 +6332,7 @@ bool CVideoDatabase::GetEpisodesByWhere(const CStdString& strBaseDir, const Filt
     
     DatabaseResults results;
     results.reserve(iRowsFound);
-    if (!SortUtils::SortFromDataset(sortDescription, MediaTypeEpisode, m_pDS, results))
+    if (!SortUtils::SortFromDataset(sorting, MediaTypeEpisode, m_pDS, results))
       return false;
     
     // get data from returned rows
@@ -6721,7 +7164,7 @@ bool CVideoDatabase::GetMusicVideosByWhere(const CStdString &baseDir, const Filt
 
     int total = -1;
 
-    CStdString strSQL = "select %s from musicvideoview ";
+    CStdString strSQL = "select %s from musicvideolist AS musicvideoview ";
     CStdString strSQLExtra;
     if (!filter.join.empty())
       strSQLExtra += filter.join;
@@ -6731,13 +7174,21 @@ bool CVideoDatabase::GetMusicVideosByWhere(const CStdString &baseDir, const Filt
       strSQLExtra += PrepareSQL(" GROUP BY " + filter.group);
     if (!filter.order.empty())
       strSQLExtra += " ORDER BY " + filter.order;
+    SortDescription sorting = sortDescription;
+    std::string order;
     if (!filter.limit.empty())
       strSQLExtra += PrepareSQL(" LIMIT " + filter.limit);
-    // Apply the limiting directly here if there's no special sorting but limiting
-    else if (sortDescription.sortBy == SortByNone &&
-            (sortDescription.limitStart > 0 || sortDescription.limitEnd > 0))
+    // Apply the sorting and limiting directly here if there's no special sorting or it maps to a column
+    else if ((sortDescription.limitStart > 0 || sortDescription.limitEnd > 0) &&
+             (sortDescription.sortBy == SortByNone ||
+             (filter.order.empty() && DatabaseUtils::BuildOrderClause(sortDescription, MediaTypeMusicVideo, order))))
     {
       total = (int)strtol(GetSingleValue(PrepareSQL(strSQL, "COUNT(1)") + strSQLExtra, m_pDS).c_str(), NULL, 10);
+      if (!order.empty())
+      {
+        strSQLExtra += " ORDER BY " + order;
+        sorting.sortBy = SortByNone;
+      }
       strSQLExtra += DatabaseUtils::BuildLimitClause(sortDescription.limitEnd, sortDescription.limitStart);
     }
 
@@ -6754,7 +7205,7 @@ bool CVideoDatabase::GetMusicVideosByWhere(const CStdString &baseDir, const Filt
     
     DatabaseResults results;
     results.reserve(iRowsFound);
-    if (!SortUtils::SortFromDataset(sortDescription, MediaTypeMusicVideo, m_pDS, results))
+    if (!SortUtils::SortFromDataset(sorting, MediaTypeMusicVideo, m_pDS, results))
       return false;
     
     // get data from returned rows
@@ -6916,10 +7367,12 @@ void CVideoDatabase::GetMoviesByName(const CStdString& strSearch, CFileItemList&
     if (NULL == m_pDB.get()) return;
     if (NULL == m_pDS.get()) return;
 
+    CStdString where = GetSearchCondition("moviesearch", "title", "movie.idMovie", strSearch,
+                                          PrepareSQL("movie.c%02d like '%%%s%%'",VIDEODB_ID_TITLE,strSearch.c_str()));
     if (g_settings.GetMasterProfile().getLockMode() != LOCK_MODE_EVERYONE && !g_passwordManager.bMasterUser)
-      strSQL = PrepareSQL("select movie.idMovie,movie.c%02d,path.strPath from movie,files,path where files.idFile=movie.idFile and files.idPath=path.idPath and movie.c%02d like '%%%s%%'",VIDEODB_ID_TITLE,VIDEODB_ID_TITLE,strSearch.c_str());
+      strSQL = PrepareSQL("select movie.idMovie,movie.c%02d,path.strPath from movie,files,path where files.idFile=movie.idFile and files.idPath=path.idPath and ",VIDEODB_ID_TITLE) + where;
     else
-      strSQL = PrepareSQL("select movie.idMovie,movie.c%02d from movie where movie.c%02d like '%%%s%%'",VIDEODB_ID_TITLE,VIDEODB_ID_TITLE,strSearch.c_str());
+      strSQL = PrepareSQL("select movie.idMovie,movie.c%02d from movie where ",VIDEODB_ID_TITLE) + where;
     m_pDS->query( strSQL.c_str() );
 
     while (!m_pDS->eof())
@@ -6963,10 +7416,12 @@ void CVideoDatabase::GetTvShowsByName(const CStdString& strSearch, CFileItemList
     if (NULL == m_pDB.get()) return;
     if (NULL == m_pDS.get()) return;
 
+    CStdString where = GetSearchCondition("tvshowsearch", "title", "tvshow.idShow", strSearch,
+                                          PrepareSQL("tvshow.c%02d like '%%%s%%'",VIDEODB_ID_TV_TITLE,strSearch.c_str()));
     if (g_settings.GetMasterProfile().getLockMode() != LOCK_MODE_EVERYONE && !g_passwordManager.bMasterUser)
-      strSQL = PrepareSQL("select tvshow.idShow,tvshow.c%02d,path.strPath from tvshow,path,tvshowlinkpath where tvshowlinkpath.idPath=path.idPath and tvshowlinkpath.idShow=tvshow.idShow and tvshow.c%02d like '%%%s%%'",VIDEODB_ID_TV_TITLE,VIDEODB_ID_TV_TITLE,strSearch.c_str());
+      strSQL = PrepareSQL("select tvshow.idShow,tvshow.c%02d,path.strPath from tvshow,path,tvshowlinkpath where tvshowlinkpath.idPath=path.idPath and tvshowlinkpath.idShow=tvshow.idShow and ",VIDEODB_ID_TV_TITLE) + where;
     else
-      strSQL = PrepareSQL("select tvshow.idShow,tvshow.c%02d from tvshow where tvshow.c%02d like '%%%s%%'",VIDEODB_ID_TV_TITLE,VIDEODB_ID_TV_TITLE,strSearch.c_str());
+      strSQL = PrepareSQL("select tvshow.idShow,tvshow.c%02d from tvshow where ",VIDEODB_ID_TV_TITLE) + where;
     m_pDS->query( strSQL.c_str() );
 
     while (!m_pDS->eof())
@@ -7005,10 +7460,12 @@ void CVideoDatabase::GetEpisodesByName(const CStdString& strSearch, CFileItemLis
     if (NULL == m_pDB.get()) return;
     if (NULL == m_pDS.get()) return;
 
+    CStdString where = GetSearchCondition("episodesearch", "title", "episode.idEpisode", strSearch,
+                                          PrepareSQL("episode.c%02d like '%%%s%%'",VIDEODB_ID_EPISODE_TITLE,strSearch.c_str()));
     if (g_settings.GetMasterProfile().getLockMode() != LOCK_MODE_EVERYONE && !g_passwordManager.bMasterUser)
-      strSQL = PrepareSQL("select episode.idEpisode,episode.c%02d,episode.c%02d,episode.idShow,tvshow.c%02d,path.strPath from episode,files,path,tvshow where files.idFile=episode.idFile and episode.idShow=tvshow.idShow and files.idPath=path.idPath and episode.c%02d like '%%%s%%'",VIDEODB_ID_EPISODE_TITLE,VIDEODB_ID_EPISODE_SEASON,VIDEODB_ID_TV_TITLE,VIDEODB_ID_EPISODE_TITLE,strSearch.c_str());
+      strSQL = PrepareSQL("select episode.idEpisode,episode.c%02d,episode.c%02d,episode.idShow,tvshow.c%02d,path.strPath from episode,files,path,tvshow where files.idFile=episode.idFile and episode.idShow=tvshow.idShow and files.idPath=path.idPath and ",VIDEODB_ID_EPISODE_TITLE,VIDEODB_ID_EPISODE_SEASON,VIDEODB_ID_TV_TITLE) + where;
     else
-      strSQL = PrepareSQL("select episode.idEpisode,episode.c%02d,episode.c%02d,episode.idShow,tvshow.c%02d from episode,tvshow where tvshow.idShow=episode.idShow and episode.c%02d like '%%%s%%'",VIDEODB_ID_EPISODE_TITLE,VIDEODB_ID_EPISODE_SEASON,VIDEODB_ID_TV_TITLE,VIDEODB_ID_EPISODE_TITLE,strSearch.c_str());
+      strSQL = PrepareSQL("select episode.idEpisode,episode.c%02d,episode.c%02d,episode.idShow,tvshow.c%02d from episode,tvshow where tvshow.idShow=episode.idShow and ",VIDEODB_ID_EPISODE_TITLE,VIDEODB_ID_EPISODE_SEASON,VIDEODB_ID_TV_TITLE) + where;
     m_pDS->query( strSQL.c_str() );
 
     while (!m_pDS->eof())
@@ -7048,10 +7505,12 @@ void CVideoDatabase::GetMusicVideosByName(const CStdString& strSearch, CFileItem
     if (NULL == m_pDB.get()) return;
     if (NULL == m_pDS.get()) return;
 
+    CStdString where = GetSearchCondition("musicvideosearch", "title", "musicvideo.idMVideo", strSearch,
+                                          PrepareSQL("musicvideo.c%02d like '%%%s%%'",VIDEODB_ID_MUSICVIDEO_TITLE,strSearch.c_str()));
     if (g_settings.GetMasterProfile().getLockMode() != LOCK_MODE_EVERYONE && !g_passwordManager.bMasterUser)
-      strSQL = PrepareSQL("select musicvideo.idMVideo,musicvideo.c%02d,path.strPath from musicvideo,files,path where files.idFile=musicvideo.idFile and files.idPath=path.idPath and musicvideo.c%02d like '%%%s%%'",VIDEODB_ID_MUSICVIDEO_TITLE,VIDEODB_ID_MUSICVIDEO_TITLE,strSearch.c_str());
+      strSQL = PrepareSQL("select musicvideo.idMVideo,musicvideo.c%02d,path.strPath from musicvideo,files,path where files.idFile=musicvideo.idFile and files.idPath=path.idPath and ",VIDEODB_ID_MUSICVIDEO_TITLE) + where;
     else
-      strSQL = PrepareSQL("select musicvideo.idMVideo,musicvideo.c%02d from musicvideo where musicvideo.c%02d like '%%%s%%'",VIDEODB_ID_MUSICVIDEO_TITLE,VIDEODB_ID_MUSICVIDEO_TITLE,strSearch.c_str());
+      strSQL = PrepareSQL("select musicvideo.idMVideo,musicvideo.c%02d from musicvideo where ",VIDEODB_ID_MUSICVIDEO_TITLE) + where;
     m_pDS->query( strSQL.c_str() );
 
     while (!m_pDS->eof())
@@ -7096,10 +7555,12 @@ void CVideoDatabase::GetEpisodesByPlot(const CStdString& strSearch, CFileItemLis
     if (NULL == m_pDB.get()) return;
     if (NULL == m_pDS.get()) return;
 
+    CStdString where = GetSearchCondition("episodesearch", "plot", "episode.idEpisode", strSearch,
+                                          PrepareSQL("episode.c%02d like '%%%s%%'",VIDEODB_ID_EPISODE_PLOT,strSearch.c_str()));
     if (g_settings.GetMasterProfile().getLockMode() != LOCK_MODE_EVERYONE && !g_passwordManager.bMasterUser)
-      strSQL = PrepareSQL("select episode.idEpisode,episode.c%02d,episode.c%02d,episode.idShow,tvshow.c%02d,path.strPath from episode,files,path,tvshow where files.idFile=episode.idFile and files.idPath=path.idPath and tvshow.idShow=episode.idShow and episode.c%02d like '%%%s%%'",VIDEODB_ID_EPISODE_TITLE,VIDEODB_ID_EPISODE_SEASON,VIDEODB_ID_TV_TITLE,VIDEODB_ID_EPISODE_PLOT,strSearch.c_str());
+      strSQL = PrepareSQL("select episode.idEpisode,episode.c%02d,episode.c%02d,episode.idShow,tvshow.c%02d,path.strPath from episode,files,path,tvshow where files.idFile=episode.idFile and files.idPath=path.idPath and tvshow.idShow=episode.idShow and ",VIDEODB_ID_EPISODE_TITLE,VIDEODB_ID_EPISODE_SEASON,VIDEODB_ID_TV_TITLE) + where;
     else
-      strSQL = PrepareSQL("select episode.idEpisode,episode.c%02d,episode.c%02d,episode.idShow,tvshow.c%02d from episode,tvshow where tvshow.idShow=episode.idShow and episode.c%02d like '%%%s%%'",VIDEODB_ID_EPISODE_TITLE,VIDEODB_ID_EPISODE_SEASON,VIDEODB_ID_TV_TITLE,VIDEODB_ID_EPISODE_PLOT,strSearch.c_str());
+      strSQL = PrepareSQL("select episode.idEpisode,episode.c%02d,episode.c%02d,episode.idShow,tvshow.c%02d from episode,tvshow where tvshow.idShow=episode.idShow and ",VIDEODB_ID_EPISODE_TITLE,VIDEODB_ID_EPISODE_SEASON,VIDEODB_ID_TV_TITLE) + where;
     m_pDS->query( strSQL.c_str() );
 
     while (!m_pDS->eof())
@@ -7135,10 +7596,12 @@ void CVideoDatabase::GetMoviesByPlot(const CStdString& strSearch, CFileItemList&
     if (NULL == m_pDB.get()) return;
     if (NULL == m_pDS.get()) return;
 
+    CStdString where = GetSearchCondition("moviesearch", "plot", "movie.idMovie", strSearch,
+                                          PrepareSQL("(movie.c%02d like '%%%s%%' or movie.c%02d like '%%%s%%' or movie.c%02d like '%%%s%%')",VIDEODB_ID_PLOT,strSearch.c_str(),VIDEODB_ID_PLOTOUTLINE,strSearch.c_str(),VIDEODB_ID_TAGLINE,strSearch.c_str()));
     if (g_settings.GetMasterProfile().getLockMode() != LOCK_MODE_EVERYONE && !g_passwordManager.bMasterUser)
-      strSQL = PrepareSQL("select movie.idMovie, movie.c%02d, path.strPath from movie,files,path where files.idFile=movie.idFile and files.idPath=path.idPath and (movie.c%02d like '%%%s%%' or movie.c%02d like '%%%s%%' or movie.c%02d like '%%%s%%')",VIDEODB_ID_TITLE,VIDEODB_ID_PLOT,strSearch.c_str(),VIDEODB_ID_PLOTOUTLINE,strSearch.c_str(),VIDEODB_ID_TAGLINE,strSearch.c_str());
+      strSQL = PrepareSQL("select movie.idMovie, movie.c%02d, path.strPath from movie,files,path where files.idFile=movie.idFile and files.idPath=path.idPath and ",VIDEODB_ID_TITLE) + where;
     else
-      strSQL = PrepareSQL("select movie.idMovie, movie.c%02d from movie where (movie.c%02d like '%%%s%%' or movie.c%02d like '%%%s%%' or movie.c%02d like '%%%s%%')",VIDEODB_ID_TITLE,VIDEODB_ID_PLOT,strSearch.c_str(),VIDEODB_ID_PLOTOUTLINE,strSearch.c_str(),VIDEODB_ID_TAGLINE,strSearch.c_str());
+      strSQL = PrepareSQL("select movie.idMovie, movie.c%02d from movie where ",VIDEODB_ID_TITLE) + where;
 
     m_pDS->query( strSQL.c_str() );
 
@@ -7294,9 +7757,46 @@ void CVideoDatabase::GetMusicVideoDirectorsByName(const CStdString& strSearch, C
   }
 }
 
-void CVideoDatabase::CleanDatabase(IVideoInfoScannerObserver* pObserver, const set<int>* paths)
+#define CLEAN_SLICE_FILES 500  // most files removed in a single transaction
+#define CLEAN_SLICE_TIME  10000 // most time between transactions, in ms
+
+int CVideoDatabase::GetCleanResumePath()
+{
+  int idPath = 0;
+  try
+  {
+    m_pDS2->query("select idPath from cleanstate");
+    if (!m_pDS2->eof())
+      idPath = m_pDS2->fv(0).get_asInt();
+    m_pDS2->close();
+  }
+  catch (...)
+  {
+    CLog::Log(LOGERROR, "%s failed", __FUNCTION__);
+  }
+  return idPath;
+}
+
+void CVideoDatabase::SetCleanResumePath(int idPath)
+{
+  try
+  {
+    // m_pDS may be holding the files being checked
+    m_pDS2->exec("delete from cleanstate");
+    if (idPath > 0)
+      m_pDS2->exec(PrepareSQL("insert into cleanstate (idPath) values (%i)", idPath).c_str());
+  }
+  catch (...)
+  {
+    CLog::Log(LOGERROR, "%s (%i) failed", __FUNCTION__, idPath);
+  }
+}
+
+void CVideoDatabase::CleanDatabase(IVideoInfoScannerObserver* pObserver, const set<int>* paths, bool showProgress, const volatile bool *stop)
 {
   CGUIDialogProgress *progress=NULL;
+  CThread *thread = NULL;
+  int priority = 0;
   try
   {
     if (NULL == m_pDB.get()) return;
@@ -7305,30 +7805,40 @@ void CVideoDatabase::CleanDatabase(IVideoInfoScannerObserver* pObserver, const s
     unsigned int time = XbmcThreads::SystemClockMillis();
     CLog::Log(LOGNOTICE, "%s: Starting videodatabase cleanup ..", __FUNCTION__);
 
-    BeginTransaction();
-
-    // find all the files
-    CStdString sql;
+    // find all the files, grouped by path so that each directory is listed once
+    CStdString sql = "select files.idFile, files.strFileName, path.idPath, path.strPath from files, path where files.idPath = path.idPath";
     if (paths)
     {
       if (paths->size() == 0)
-      {
-        RollbackTransaction();
         return;
-      }
 
       CStdString strPaths;
       for (std::set<int>::const_iterator i = paths->begin(); i != paths->end(); ++i)
         strPaths.AppendFormat(",%i",*i);
-      sql = PrepareSQL("select * from files,path where files.idPath=path.idPath and path.idPath in (%s)",strPaths.Mid(1).c_str());
+      sql += PrepareSQL(" and path.idPath in (%s)",strPaths.Mid(1).c_str());
     }
     else
-      sql = "select * from files, path where files.idPath = path.idPath";
+    {
+      // the path a full cleanup of this database was interrupted at
+      int resumePath = GetCleanResumePath();
+      if (resumePath > 0)
+      {
+        CLog::Log(LOGNOTICE, "%s: Resuming the cleanup cancelled at path %i", __FUNCTION__, resumePath);
+        sql += PrepareSQL(" and path.idPath >= %i", resumePath);
+      }
+    }
+    sql += " order by path.idPath";
 
     m_pDS->query(sql.c_str());
-    if (m_pDS->num_rows() == 0) return;
+    if (m_pDS->num_rows() == 0)
+    {
+      m_pDS->close();
+      if (!paths)
+        SetCleanResumePath(0);
+      return;
+    }
 
-    if (!pObserver)
+    if (!pObserver && showProgress)
     {
       progress = (CGUIDialogProgress *)g_windowManager.GetWindow(WINDOW_DIALOG_PROGRESS);
       if (progress)
@@ -7342,7 +7852,7 @@ void CVideoDatabase::CleanDatabase(IVideoInfoScannerObserver* pObserver, const s
         progress->ShowProgressBar(true);
       }
     }
-    else
+    else if (pObserver)
     {
       pObserver->OnDirectoryChanged("");
       pObserver->OnSetTitle("");
@@ -7350,25 +7860,47 @@ void CVideoDatabase::CleanDatabase(IVideoInfoScannerObserver* pObserver, const s
       pObserver->OnStateChanged(CLEANING_UP_DATABASE);
     }
 
-    CStdString filesToDelete = "";
-    CStdString moviesToDelete = "";
-    CStdString episodesToDelete = "";
-    CStdString musicVideosToDelete = "";
+    // checking the files is mostly waiting on the network, so don't hold up anything else while in the background
+    thread = CThread::GetCurrentThread();
+    if (thread)
+    {
+      priority = thread->GetPriority();
+      thread->SetPriority(thread->GetMinPriority());
+    }
 
+    std::vector<int> filesToDelete;
     std::vector<int> movieIDs;
     std::vector<int> episodeIDs;
     std::vector<int> musicVideoIDs;
+    std::vector<int> tvshowIDs;
 
     int total = m_pDS->num_rows();
     int current = 0;
+    unsigned int directories = 0;
+    bool cancelled = false;
+
+    CStdString listedDirectory;
+    bool listed = false;
+    set<CStdString> listedFiles;
+    unsigned int sliceStart = XbmcThreads::SystemClockMillis();
 
     bool bIsSource;
     VECSOURCES *pShares = g_settings.GetSourcesFromType("video");
 
     while (!m_pDS->eof())
     {
-      CStdString path = m_pDS->fv("path.strPath").get_asString();
-      CStdString fileName = m_pDS->fv("files.strFileName").get_asString();
+      int idPath = m_pDS->fv(2).get_asInt();
+      if (stop && *stop)
+      {
+        // a full cleanup carries on from this path next time
+        cancelled = true;
+        if (!paths)
+          SetCleanResumePath(idPath);
+        break;
+      }
+
+      CStdString path = m_pDS->fv(3).get_asString();
+      CStdString fileName = m_pDS->fv(1).get_asString();
       CStdString fullPath;
       ConstructPath(fullPath,path,fileName);
 
@@ -7376,20 +7908,50 @@ void CVideoDatabase::CleanDatabase(IVideoInfoScannerObserver* pObserver, const s
       if (URIUtils::IsStack(fullPath))
         fullPath = CStackDirectory::GetFirstStackedFile(fullPath);
 
-      // check if we have a internet related file that is part of a media source
-      if (URIUtils::IsInternetStream(fullPath, true) && CUtil::GetMatchingSource(fullPath, *pShares, bIsSource) > -1)
+      bool exists;
+      if (URIUtils::IsInternetStream(fullPath, true))
       {
-        if (!CFile::Exists(fullPath, false))
-          filesToDelete += m_pDS->fv("files.idFile").get_asString() + ",";
+        // keep internet related files that are part of a media source and still exist
+        exists = CUtil::GetMatchingSource(fullPath, *pShares, bIsSource) > -1 && CFile::Exists(fullPath, false);
       }
+      else if (URIUtils::IsOnDVD(fullPath))
+        exists = false; // remove optical files
       else
       {
-        // remove optical, internet related and non-existing files
+        // list the directory of the file once rather than checking each of its files, unless listing it failed
+        CStdString directory;
+        URIUtils::GetDirectory(fullPath, directory);
+        if (directory != listedDirectory)
+        {
+          // a good time to commit the files found so far, as the transaction can't block anything for long
+          if (filesToDelete.size() >= CLEAN_SLICE_FILES ||
+             (!filesToDelete.empty() && XbmcThreads::SystemClockMillis() - sliceStart > CLEAN_SLICE_TIME))
+          {
+            CleanFiles(filesToDelete, movieIDs, episodeIDs, musicVideoIDs);
+            filesToDelete.clear();
+            sliceStart = XbmcThreads::SystemClockMillis();
+            if (!paths)
+              SetCleanResumePath(idPath);
+          }
+
+          CFileItemList items;
+          listedDirectory = directory;
+          listedFiles.clear();
+          listed = CDirectory::GetDirectory(directory, items, "", DIR_FLAG_NO_FILE_DIRS | DIR_FLAG_NO_FILE_INFO | DIR_FLAG_BYPASS_CACHE | DIR_FLAG_GET_HIDDEN);
+          for (int i = 0; i < items.Size(); i++)
+            listedFiles.insert(items[i]->GetPath());
+          directories++;
+        }
         // note: this will also remove entries from previously existing media sources
-        if (URIUtils::IsOnDVD(fullPath) || URIUtils::IsInternetStream(fullPath, true) || !CFile::Exists(fullPath, false))
-          filesToDelete += m_pDS->fv("files.idFile").get_asString() + ",";
+        if (listed)
+          exists = listedFiles.find(fullPath) != listedFiles.end() || CFile::Exists(fullPath, false);
+        else
+          exists = CFile::Exists(fullPath, false);
       }
 
+      if (!exists)
+        filesToDelete.push_back(m_pDS->fv(0).get_asInt());
+
       if (!pObserver)
       {
         if (progress)
@@ -7398,9 +7960,10 @@ void CVideoDatabase::CleanDatabase(IVideoInfoScannerObserver* pObserver, const s
           progress->Progress();
           if (progress->IsCanceled())
           {
-            progress->Close();
-            m_pDS->close();
-            return;
+            cancelled = true;
+            if (!paths)
+              SetCleanResumePath(idPath);
+            break;
           }
         }
       }
@@ -7412,269 +7975,147 @@ void CVideoDatabase::CleanDatabase(IVideoInfoScannerObserver* pObserver, const s
     }
     m_pDS->close();
 
-    // Add any files that don't have a valid idPath entry to the filesToDelete list.
-    sql = "select files.idFile from files where idPath not in (select idPath from path)";
-    m_pDS->query(sql.c_str());
-    while (!m_pDS->eof())
+    unsigned int elapsed = XbmcThreads::SystemClockMillis() - time;
+    CLog::Log(LOGNOTICE, "%s: Checked %i files in %u directories in %s (%.1f files/s), %u missing", __FUNCTION__,
+              current, directories, StringUtils::SecondsToTimeString(elapsed / 1000).c_str(), elapsed ? current * 1000.0f / elapsed : 0.0f, (unsigned int)filesToDelete.size());
+
+    if (thread)
+      thread->SetPriority(priority);
+    thread = NULL;
+
+    if (cancelled)
     {
-      filesToDelete += m_pDS->fv("files.idFile").get_asString() + ",";
-      m_pDS->next();
+      // keep what was found, the next cleanup carries on from where this one stopped
+      CleanFiles(filesToDelete, movieIDs, episodeIDs, musicVideoIDs);
     }
-    m_pDS->close();
-
-    if ( ! filesToDelete.IsEmpty() )
+    else
     {
-      filesToDelete.TrimRight(",");
-      // now grab them movies
-      sql = PrepareSQL("select idMovie from movie where idFile in (%s)",filesToDelete.c_str());
+      if (!paths)
+        SetCleanResumePath(0);
+
+      // Add any files that don't have a valid idPath entry to the filesToDelete list.
+      sql = "select files.idFile from files where idPath not in (select idPath from path)";
       m_pDS->query(sql.c_str());
       while (!m_pDS->eof())
       {
-        movieIDs.push_back(m_pDS->fv(0).get_asInt());
-        moviesToDelete += m_pDS->fv(0).get_asString() + ",";
+        filesToDelete.push_back(m_pDS->fv(0).get_asInt());
         m_pDS->next();
       }
       m_pDS->close();
-      // now grab them episodes
-      sql = PrepareSQL("select idEpisode from episode where idFile in (%s)",filesToDelete.c_str());
-       m_pDS->query(sql.c_str());
-      while (!m_pDS->eof())
+
+      CleanFiles(filesToDelete, movieIDs, episodeIDs, musicVideoIDs);
+
+      if (progress)
       {
-        episodeIDs.push_back(m_pDS->fv(0).get_asInt());
-        episodesToDelete += m_pDS->fv(0).get_asString() + ",";
-        m_pDS->next();
+        progress->SetPercentage(100);
+        progress->Progress();
       }
-      m_pDS->close();
 
-      // now grab them musicvideos
-      sql = PrepareSQL("select idMVideo from musicvideo where idFile in (%s)",filesToDelete.c_str());
+      BeginTransaction();
+      CLog::Log(LOGDEBUG, "%s: Cleaning paths that don't exist and have content set...", __FUNCTION__);
+      sql = "select * from path where strContent != ''";
       m_pDS->query(sql.c_str());
+      CStdString strIds;
       while (!m_pDS->eof())
       {
-        musicVideoIDs.push_back(m_pDS->fv(0).get_asInt());
-        musicVideosToDelete += m_pDS->fv(0).get_asString() + ",";
+        if (!CDirectory::Exists(m_pDS->fv("path.strPath").get_asString()))
+          strIds.AppendFormat("%i,", m_pDS->fv("path.idPath").get_asInt());
         m_pDS->next();
       }
       m_pDS->close();
-    }
-
-    if (progress)
-    {
-      progress->SetPercentage(100);
-      progress->Progress();
-    }
-
-    if ( ! filesToDelete.IsEmpty() )
-    {
-      filesToDelete = "(" + filesToDelete + ")";
-      CLog::Log(LOGDEBUG, "%s: Cleaning files table", __FUNCTION__);
-      sql = "delete from files where idFile in " + filesToDelete;
+      if (!strIds.IsEmpty())
+      {
+        strIds.TrimRight(",");
+        sql = PrepareSQL("delete from path where idPath in (%s)",strIds.c_str());
+        m_pDS->exec(sql.c_str());
+        sql = PrepareSQL("delete from tvshowlinkpath where idPath in (%s)",strIds.c_str());
+        m_pDS->exec(sql.c_str());
+      }
+      sql = "delete from tvshowlinkpath where idPath not in (select idPath from path)";
       m_pDS->exec(sql.c_str());
 
-      CLog::Log(LOGDEBUG, "%s: Cleaning streamdetails table", __FUNCTION__);
-      sql = "delete from streamdetails where idFile in " + filesToDelete;
+      CLog::Log(LOGDEBUG, "%s: Cleaning tvshow table", __FUNCTION__);
+      sql = "delete from tvshow where idShow not in (select idShow from tvshowlinkpath)";
       m_pDS->exec(sql.c_str());
 
-      CLog::Log(LOGDEBUG, "%s: Cleaning bookmark table", __FUNCTION__);
-      sql = "delete from bookmark where idFile in " + filesToDelete;
-      m_pDS->exec(sql.c_str());
+      CStdString showsToDelete;
+      sql = "select tvshow.idShow from tvshow "
+              "join tvshowlinkpath on tvshow.idShow=tvshowlinkpath.idShow "
+              "join path on path.idPath=tvshowlinkpath.idPath "
+            "where tvshow.idShow not in (select idShow from episode) "
+              "and path.strContent=''";
+      m_pDS->query(sql.c_str());
+      while (!m_pDS->eof())
+      {
+        tvshowIDs.push_back(m_pDS->fv(0).get_asInt());
+        showsToDelete += m_pDS->fv(0).get_asString() + ",";
+        m_pDS->next();
+      }
+      m_pDS->close();
+      if (!showsToDelete.IsEmpty())
+      {
+        sql = "delete from tvshow where idShow in (" + showsToDelete.TrimRight(",") + ")";
+        m_pDS->exec(sql.c_str());
+      }
 
-      CLog::Log(LOGDEBUG, "%s: Cleaning settings table", __FUNCTION__);
-      sql = "delete from settings where idFile in " + filesToDelete;
+      CLog::Log(LOGDEBUG, "%s: Cleaning actorlinktvshow table", __FUNCTION__);
+      sql = "delete from actorlinktvshow where idShow not in (select idShow from tvshow)";
       m_pDS->exec(sql.c_str());
 
-      CLog::Log(LOGDEBUG, "%s: Cleaning stacktimes table", __FUNCTION__);
-      sql = "delete from stacktimes where idFile in " + filesToDelete;
+      CLog::Log(LOGDEBUG, "%s: Cleaning directorlinktvshow table", __FUNCTION__);
+      sql = "delete from directorlinktvshow where idShow not in (select idShow from tvshow)";
       m_pDS->exec(sql.c_str());
-    }
 
-    if ( ! moviesToDelete.IsEmpty() )
-    {
-      moviesToDelete = "(" + moviesToDelete.TrimRight(",") + ")";
-
-      CLog::Log(LOGDEBUG, "%s: Cleaning movie table", __FUNCTION__);
-      sql = "delete from movie where idMovie in " + moviesToDelete;
+      CLog::Log(LOGDEBUG, "%s: Cleaning tvshowlinkpath table", __FUNCTION__);
+      sql = "delete from tvshowlinkpath where idShow not in (select idShow from tvshow)";
       m_pDS->exec(sql.c_str());
 
-      CLog::Log(LOGDEBUG, "%s: Cleaning actorlinkmovie table", __FUNCTION__);
-      sql = "delete from actorlinkmovie where idMovie in " + moviesToDelete;
+      CLog::Log(LOGDEBUG, "%s: Cleaning genrelinktvshow table", __FUNCTION__);
+      sql = "delete from genrelinktvshow where idShow not in (select idShow from tvshow)";
       m_pDS->exec(sql.c_str());
 
-      CLog::Log(LOGDEBUG, "%s: Cleaning directorlinkmovie table", __FUNCTION__);
-      sql = "delete from directorlinkmovie where idMovie in " + moviesToDelete;
+      CLog::Log(LOGDEBUG, "%s: Cleaning seasons table", __FUNCTION__);
+      sql = "delete from seasons where idShow not in (select idShow from tvshow)";
       m_pDS->exec(sql.c_str());
 
-      CLog::Log(LOGDEBUG, "%s: Cleaning writerlinkmovie table", __FUNCTION__);
-      sql = "delete from writerlinkmovie where idMovie in " + moviesToDelete;
+      CLog::Log(LOGDEBUG, "%s: Cleaning movielinktvshow table", __FUNCTION__);
+      sql = "delete from movielinktvshow where idShow not in (select idShow from tvshow)";
       m_pDS->exec(sql.c_str());
-
-      CLog::Log(LOGDEBUG, "%s: Cleaning genrelinkmovie table", __FUNCTION__);
-      sql = "delete from genrelinkmovie where idMovie in " + moviesToDelete;
+      sql = "delete from movielinktvshow where idMovie not in (select distinct idMovie from movie)";
       m_pDS->exec(sql.c_str());
 
-      CLog::Log(LOGDEBUG, "%s: Cleaning countrylinkmovie table", __FUNCTION__);
-      sql = "delete from countrylinkmovie where idMovie in " + moviesToDelete;
+      CLog::Log(LOGDEBUG, "%s: Cleaning path table", __FUNCTION__);
+      sql = "delete from path where idPath not in (select distinct idPath from files) and idPath not in (select distinct idPath from tvshowlinkpath) and strContent=''";
       m_pDS->exec(sql.c_str());
 
-      CLog::Log(LOGDEBUG, "%s: Cleaning studiolinkmovie table", __FUNCTION__);
-      sql = "delete from studiolinkmovie where idMovie in " + moviesToDelete;
+      CLog::Log(LOGDEBUG, "%s: Cleaning genre table", __FUNCTION__);
+      sql = "delete from genre where idGenre not in (select distinct idGenre from genrelinkmovie) and idGenre not in (select distinct idGenre from genrelinktvshow) and idGenre not in (select distinct idGenre from genrelinkmusicvideo)";
       m_pDS->exec(sql.c_str());
 
-      CLog::Log(LOGDEBUG, "%s: Cleaning setlinkmovie table", __FUNCTION__);
-      sql = "delete from setlinkmovie where idMovie in " + moviesToDelete;
+      CLog::Log(LOGDEBUG, "%s: Cleaning country table", __FUNCTION__);
+      sql = "delete from country where idCountry not in (select distinct idCountry from countrylinkmovie)";
       m_pDS->exec(sql.c_str());
-    }
-
-    if ( ! episodesToDelete.IsEmpty() )
-    {
-      episodesToDelete = "(" + episodesToDelete.TrimRight(",") + ")";
 
-      CLog::Log(LOGDEBUG, "%s: Cleaning episode table", __FUNCTION__);
-      sql = "delete from episode where idEpisode in " + episodesToDelete;
+      CLog::Log(LOGDEBUG, "%s: Cleaning actor table of actors, directors and writers", __FUNCTION__);
+      sql = "delete from actors where idActor not in (select distinct idActor from actorlinkmovie) and idActor not in (select distinct idDirector from directorlinkmovie) and idActor not in (select distinct idWriter from writerlinkmovie) and idActor not in (select distinct idActor from actorlinktvshow) and idActor not in (select distinct idActor from actorlinkepisode) and idActor not in (select distinct idDirector from directorlinktvshow) and idActor not in (select distinct idDirector from directorlinkepisode) and idActor not in (select distinct idWriter from writerlinkepisode) and idActor not in (select distinct idArtist from artistlinkmusicvideo) and idActor not in (select distinct idDirector from directorlinkmusicvideo)";
       m_pDS->exec(sql.c_str());
 
-      CLog::Log(LOGDEBUG, "%s: Cleaning actorlinkepisode table", __FUNCTION__);
-      sql = "delete from actorlinkepisode where idEpisode in " + episodesToDelete;
+      CLog::Log(LOGDEBUG, "%s: Cleaning studio table", __FUNCTION__);
+      sql = "delete from studio where idStudio not in (select distinct idStudio from studiolinkmovie) and idStudio not in (select distinct idStudio from studiolinkmusicvideo) and idStudio not in (select distinct idStudio from studiolinktvshow)";
       m_pDS->exec(sql.c_str());
 
-      CLog::Log(LOGDEBUG, "%s: Cleaning directorlinkepisode table", __FUNCTION__);
-      sql = "delete from directorlinkepisode where idEpisode in " + episodesToDelete;
+      CLog::Log(LOGDEBUG, "%s: Cleaning set table", __FUNCTION__);
+      sql = "delete from sets where idSet not in (select distinct idSet from setlinkmovie)";
       m_pDS->exec(sql.c_str());
 
-      CLog::Log(LOGDEBUG, "%s: Cleaning writerlinkepisode table", __FUNCTION__);
-      sql = "delete from writerlinkepisode where idEpisode in " + episodesToDelete;
-      m_pDS->exec(sql.c_str());
-    }
+      CommitTransaction();
 
-    CLog::Log(LOGDEBUG, "%s: Cleaning paths that don't exist and have content set...", __FUNCTION__);
-    sql = "select * from path where strContent != ''";
-    m_pDS->query(sql.c_str());
-    CStdString strIds;
-    while (!m_pDS->eof())
-    {
-      if (!CDirectory::Exists(m_pDS->fv("path.strPath").get_asString()))
-        strIds.AppendFormat("%i,", m_pDS->fv("path.idPath").get_asInt());
-      m_pDS->next();
-    }
-    m_pDS->close();
-    if (!strIds.IsEmpty())
-    {
-      strIds.TrimRight(",");
-      sql = PrepareSQL("delete from path where idPath in (%s)",strIds.c_str());
-      m_pDS->exec(sql.c_str());
-      sql = PrepareSQL("delete from tvshowlinkpath where idPath in (%s)",strIds.c_str());
-      m_pDS->exec(sql.c_str());
-    }
-    sql = "delete from tvshowlinkpath where idPath not in (select idPath from path)";
-    m_pDS->exec(sql.c_str());
-
-    CLog::Log(LOGDEBUG, "%s: Cleaning tvshow table", __FUNCTION__);
-    sql = "delete from tvshow where idShow not in (select idShow from tvshowlinkpath)";
-    m_pDS->exec(sql.c_str());
-
-    std::vector<int> tvshowIDs;
-    CStdString showsToDelete;
-    sql = "select tvshow.idShow from tvshow "
-            "join tvshowlinkpath on tvshow.idShow=tvshowlinkpath.idShow "
-            "join path on path.idPath=tvshowlinkpath.idPath "
-          "where tvshow.idShow not in (select idShow from episode) "
-            "and path.strContent=''";
-    m_pDS->query(sql.c_str());
-    while (!m_pDS->eof())
-    {
-      tvshowIDs.push_back(m_pDS->fv(0).get_asInt());
-      showsToDelete += m_pDS->fv(0).get_asString() + ",";
-      m_pDS->next();
-    }
-    m_pDS->close();
-    if (!showsToDelete.IsEmpty())
-    {
-      sql = "delete from tvshow where idShow in (" + showsToDelete.TrimRight(",") + ")";
-      m_pDS->exec(sql.c_str());
-    }
-
-    CLog::Log(LOGDEBUG, "%s: Cleaning actorlinktvshow table", __FUNCTION__);
-    sql = "delete from actorlinktvshow where idShow not in (select idShow from tvshow)";
-    m_pDS->exec(sql.c_str());
-
-    CLog::Log(LOGDEBUG, "%s: Cleaning directorlinktvshow table", __FUNCTION__);
-    sql = "delete from directorlinktvshow where idShow not in (select idShow from tvshow)";
-    m_pDS->exec(sql.c_str());
-
-    CLog::Log(LOGDEBUG, "%s: Cleaning tvshowlinkpath table", __FUNCTION__);
-    sql = "delete from tvshowlinkpath where idShow not in (select idShow from tvshow)";
-    m_pDS->exec(sql.c_str());
-
-    CLog::Log(LOGDEBUG, "%s: Cleaning genrelinktvshow table", __FUNCTION__);
-    sql = "delete from genrelinktvshow where idShow not in (select idShow from tvshow)";
-    m_pDS->exec(sql.c_str());
+      if (pObserver)
+        pObserver->OnStateChanged(COMPRESSING_DATABASE);
 
-    CLog::Log(LOGDEBUG, "%s: Cleaning seasons table", __FUNCTION__);
-    sql = "delete from seasons where idShow not in (select idShow from tvshow)";
-    m_pDS->exec(sql.c_str());
-
-    CLog::Log(LOGDEBUG, "%s: Cleaning movielinktvshow table", __FUNCTION__);
-    sql = "delete from movielinktvshow where idShow not in (select idShow from tvshow)";
-    m_pDS->exec(sql.c_str());
-    sql = "delete from movielinktvshow where idMovie not in (select distinct idMovie from movie)";
-    m_pDS->exec(sql.c_str());
-
-    if ( ! musicVideosToDelete.IsEmpty() )
-    {
-      musicVideosToDelete = "(" + musicVideosToDelete.TrimRight(",") + ")";
-
-      CLog::Log(LOGDEBUG, "%s: Cleaning musicvideo table", __FUNCTION__);
-      sql = "delete from musicvideo where idMVideo in " + musicVideosToDelete;
-      m_pDS->exec(sql.c_str());
-
-      CLog::Log(LOGDEBUG, "%s: Cleaning artistlinkmusicvideo table", __FUNCTION__);
-      sql = "delete from artistlinkmusicvideo where idMVideo in " + musicVideosToDelete;
-      m_pDS->exec(sql.c_str());
-
-      CLog::Log(LOGDEBUG, "%s: Cleaning directorlinkmusicvideo table" ,__FUNCTION__);
-      sql = "delete from directorlinkmusicvideo where idMVideo in " + musicVideosToDelete;
-      m_pDS->exec(sql.c_str());
-
-      CLog::Log(LOGDEBUG, "%s: Cleaning genrelinkmusicvideo table" ,__FUNCTION__);
-      sql = "delete from genrelinkmusicvideo where idMVideo in " + musicVideosToDelete;
-      m_pDS->exec(sql.c_str());
-
-      CLog::Log(LOGDEBUG, "%s: Cleaning studiolinkmusicvideo table", __FUNCTION__);
-      sql = "delete from studiolinkmusicvideo where idMVideo in " + musicVideosToDelete;
-      m_pDS->exec(sql.c_str());
+      Compress(false);
     }
 
-    CLog::Log(LOGDEBUG, "%s: Cleaning path table", __FUNCTION__);
-    sql = "delete from path where idPath not in (select distinct idPath from files) and idPath not in (select distinct idPath from tvshowlinkpath) and strContent=''";
-    m_pDS->exec(sql.c_str());
-
-    CLog::Log(LOGDEBUG, "%s: Cleaning genre table", __FUNCTION__);
-    sql = "delete from genre where idGenre not in (select distinct idGenre from genrelinkmovie) and idGenre not in (select distinct idGenre from genrelinktvshow) and idGenre not in (select distinct idGenre from genrelinkmusicvideo)";
-    m_pDS->exec(sql.c_str());
-
-    CLog::Log(LOGDEBUG, "%s: Cleaning country table", __FUNCTION__);
-    sql = "delete from country where idCountry not in (select distinct idCountry from countrylinkmovie)";
-    m_pDS->exec(sql.c_str());
-
-    CLog::Log(LOGDEBUG, "%s: Cleaning actor table of actors, directors and writers", __FUNCTION__);
-    sql = "delete from actors where idActor not in (select distinct idActor from actorlinkmovie) and idActor not in (select distinct idDirector from directorlinkmovie) and idActor not in (select distinct idWriter from writerlinkmovie) and idActor not in (select distinct idActor from actorlinktvshow) and idActor not in (select distinct idActor from actorlinkepisode) and idActor not in (select distinct idDirector from directorlinktvshow) and idActor not in (select distinct idDirector from directorlinkepisode) and idActor not in (select distinct idWriter from writerlinkepisode) and idActor not in (select distinct idArtist from artistlinkmusicvideo) and idActor not in (select distinct idDirector from directorlinkmusicvideo)";
-    m_pDS->exec(sql.c_str());
-
-    CLog::Log(LOGDEBUG, "%s: Cleaning studio table", __FUNCTION__);
-    sql = "delete from studio where idStudio not in (select distinct idStudio from studiolinkmovie) and idStudio not in (select distinct idStudio from studiolinkmusicvideo) and idStudio not in (select distinct idStudio from studiolinktvshow)";
-    m_pDS->exec(sql.c_str());
-
-    CLog::Log(LOGDEBUG, "%s: Cleaning set table", __FUNCTION__);
-    sql = "delete from sets where idSet not in (select distinct idSet from setlinkmovie)";
-    m_pDS->exec(sql.c_str());
-
-    CommitTransaction();
-
-    if (pObserver)
-      pObserver->OnStateChanged(COMPRESSING_DATABASE);
-
-    Compress(false);
-
     CUtil::DeleteVideoDatabaseDirectoryCache();
 
     time = XbmcThreads::SystemClockMillis() - time;
@@ -7696,10 +8137,92 @@ void CVideoDatabase::CleanDatabase(IVideoInfoScannerObserver* pObserver, const s
   {
     CLog::Log(LOGERROR, "%s failed", __FUNCTION__);
   }
+  if (thread)
+    thread->SetPriority(priority);
   if (progress)
     progress->Close();
 }
 
+void CVideoDatabase::CleanFiles(const std::vector<int> &fileIDs, std::vector<int> &movieIDs, std::vector<int> &episodeIDs, std::vector<int> &musicVideoIDs)
+{
+  if (fileIDs.empty() || NULL == m_pDS2.get())
+    return;
+
+  CStdString filesToDelete;
+  for (std::vector<int>::const_iterator i = fileIDs.begin(); i != fileIDs.end(); ++i)
+    filesToDelete.AppendFormat("%i,", *i);
+  filesToDelete = "(" + filesToDelete.TrimRight(",") + ")";
+
+  CLog::Log(LOGDEBUG, "%s: Removing %u files", __FUNCTION__, (unsigned int)fileIDs.size());
+  BeginTransaction();
+
+  // now grab them movies, episodes and musicvideos
+  CStdString moviesToDelete;
+  CStdString sql = "select idMovie from movie where idFile in " + filesToDelete;
+  m_pDS2->query(sql.c_str());
+  while (!m_pDS2->eof())
+  {
+    movieIDs.push_back(m_pDS2->fv(0).get_asInt());
+    moviesToDelete += m_pDS2->fv(0).get_asString() + ",";
+    m_pDS2->next();
+  }
+  m_pDS2->close();
+
+  CStdString episodesToDelete;
+  sql = "select idEpisode from episode where idFile in " + filesToDelete;
+  m_pDS2->query(sql.c_str());
+  while (!m_pDS2->eof())
+  {
+    episodeIDs.push_back(m_pDS2->fv(0).get_asInt());
+    episodesToDelete += m_pDS2->fv(0).get_asString() + ",";
+    m_pDS2->next();
+  }
+  m_pDS2->close();
+
+  CStdString musicVideosToDelete;
+  sql = "select idMVideo from musicvideo where idFile in " + filesToDelete;
+  m_pDS2->query(sql.c_str());
+  while (!m_pDS2->eof())
+  {
+    musicVideoIDs.push_back(m_pDS2->fv(0).get_asInt());
+    musicVideosToDelete += m_pDS2->fv(0).get_asString() + ",";
+    m_pDS2->next();
+  }
+  m_pDS2->close();
+
+  const char *fileTables[] = { "files", "streamdetails", "bookmark", "settings", "stacktimes" };
+  for (unsigned int i = 0; i < sizeof(fileTables) / sizeof(fileTables[0]); i++)
+    m_pDS2->exec(("delete from " + CStdString(fileTables[i]) + " where idFile in " + filesToDelete).c_str());
+
+  if (!moviesToDelete.IsEmpty())
+  {
+    moviesToDelete = "(" + moviesToDelete.TrimRight(",") + ")";
+    const char *movieTables[] = { "movie", "actorlinkmovie", "directorlinkmovie", "writerlinkmovie", "genrelinkmovie",
+                                  "countrylinkmovie", "studiolinkmovie", "setlinkmovie" };
+    for (unsigned int i = 0; i < sizeof(movieTables) / sizeof(movieTables[0]); i++)
+      m_pDS2->exec(("delete from " + CStdString(movieTables[i]) + " where idMovie in " + moviesToDelete).c_str());
+  }
+
+  if (!episodesToDelete.IsEmpty())
+  {
+    episodesToDelete = "(" + episodesToDelete.TrimRight(",") + ")";
+    const char *episodeTables[] = { "episode", "actorlinkepisode", "directorlinkepisode", "writerlinkepisode" };
+    for (unsigned int i = 0; i < sizeof(episodeTables) / sizeof(episodeTables[0]); i++)
+      m_pDS2->exec(("delete from " + CStdString(episodeTables[i]) + " where idEpisode in " + episodesToDelete).c_str());
+  }
+
+  if (!musicVideosToDelete.IsEmpty())
+  {
+    musicVideosToDelete = "(" + musicVideosToDelete.TrimRight(",") + ")";
+    const char *musicVideoTables[] = { "musicvideo", "artistlinkmusicvideo", "directorlinkmusicvideo", "genrelinkmusicvideo",
+                                       "studiolinkmusicvideo" };
+    for (unsigned int i = 0; i < sizeof(musicVideoTables) / sizeof(musicVideoTables[0]); i++)
+      m_pDS2->exec(("delete from " + CStdString(musicVideoTables[i]) + " where idMVideo in " + musicVideosToDelete).c_str());
+  }
+
+  CommitTransaction();
+}
+
 void CVideoDatabase::DumpToDummyFiles(const CStdString &path)
 {
   // get all tvshows
@@ -8591,7 +9114,11 @@ void CVideoDatabase::InvalidatePathHash(const CStdString& strPath)
 bool CVideoDatabase::CommitTransaction()
 {
   if (CDatabase::CommitTransaction())
-  { // number of items in the db has likely changed, so recalculate
+  {
+    if (InBatch()) // nothing has been committed yet
+      return true;
+
+    // number of items in the db has likely changed, so recalculate
     g_infoManager.SetLibraryBool(LIBRARY_HAS_MOVIES, HasContent(VIDEODB_CONTENT_MOVIES));
     g_infoManager.SetLibraryBool(LIBRARY_HAS_TVSHOWS, HasContent(VIDEODB_CONTENT_TVSHOWS));
     g_infoManager.SetLibraryBool(LIBRARY_HAS_MUSICVIDEOS, HasContent(VIDEODB_CONTENT_MUSICVIDEOS));
@@ -483,6 +483,13 @@ public:
   bool GetResumePoint(CVideoInfoTag& tag);
   bool GetStreamDetails(CVideoInfoTag& tag) const;
 
+  /*! \brief Fill in the stream details of the movies, episodes and music videos of a listing
+   with one query, rather than one for each item. Items that have stream details are left alone.
+   \param items the listing.
+   \sa GetStreamDetails
+   */
+  void GetStreamDetailsForItems(CFileItemList &items) const;
+
   // scraper settings
   void SetScraperForPath(const CStdString& filePath, const ADDON::ScraperPtr& info, const VIDEO::SScanSettings& settings);
   ADDON::ScraperPtr GetScraperForPath(const CStdString& strPath);
@@ -570,6 +577,17 @@ public:
   void GetEpisodesByPlot(const CStdString& strSearch, CFileItemList& items);
   void GetMoviesByPlot(const CStdString& strSearch, CFileItemList& items);
 
+  /*! \brief Search the titles, plots, cast and tags of movies, tvshows, episodes or music videos, best matches first.
+   Each word of the search matches the start of a word. Without a full-text search index (eg. on MySQL)
+   only the start of titles is matched.
+   \param mediaType the type of items to search.
+   \param search the text to search for.
+   \param items the items found, with their title and database id.
+   \param limit the maximum number of items to return.
+   \return true on success, false on error.
+   */
+  bool SearchIndex(MediaType mediaType, const CStdString& search, CFileItemList& items, int limit = 1000);
+
   bool LinkMovieToTvshow(int idMovie, int idShow, bool bRemove);
   bool IsLinkedToTvshow(int idMovie);
   bool GetLinksToTvShow(int idMovie, std::vector<int>& ids);
@@ -604,7 +622,13 @@ public:
   bool HasContent(VIDEODB_CONTENT_TYPE type);
   bool HasSets() const;
 
-  void CleanDatabase(VIDEO::IVideoInfoScannerObserver* pObserver=NULL, const std::set<int>* paths=NULL);
+  /*! \brief Remove the files that no longer exist, along with their movies, episodes and music videos.
+   \param pObserver observer to report progress to, or NULL.
+   \param paths the paths to clean, or NULL to clean (or resume cleaning) the whole library.
+   \param showProgress whether to show a modal progress dialog when there is no observer.
+   \param stop flag that stops the cleanup between files once set, or NULL.
+   */
+  void CleanDatabase(VIDEO::IVideoInfoScannerObserver* pObserver=NULL, const std::set<int>* paths=NULL, bool showProgress=true, const volatile bool *stop=NULL);
 
   /*! \brief Add a file to the database, if necessary
    If the file is already in the database, we simply return its id.
@@ -682,6 +706,14 @@ public:
   void SetArtForItem(int mediaId, const std::string &mediaType, const std::map<std::string, std::string> &art);
   bool GetArtForItem(int mediaId, const std::string &mediaType, std::map<std::string, std::string> &art);
   std::string GetArtForItem(int mediaId, const std::string &mediaType, const std::string &artType);
+
+  /*! \brief Fill in the art of the movies, episodes, music videos and tvshows of a listing with
+   one query, rather than one for each item. Items that have art are left alone, and episodes are
+   given the fanart and thumb of their show.
+   \param items the listing.
+   \sa GetArtForItem
+   */
+  void GetArtForItems(CFileItemList &items);
   bool GetTvShowSeasonArt(int mediaId, std::map<int, std::string> &seasonArt);
 
   int AddTag(const std::string &tag);
@@ -783,6 +815,34 @@ private:
    */
   int RunQuery(const CStdString &sql);
 
+  /*! \brief Condition matching the items found by a search, using the full-text search index where there is one
+   \param index the search index, eg. "moviesearch"
+   \param column the column of the index to search, eg. "title"
+   \param key the column holding the id of the item, eg. "movie.idMovie"
+   \param search the text to search for
+   \param fallback the condition to use when the index can't be used, eg. a LIKE query
+   \return the condition for a WHERE clause
+   */
+  CStdString GetSearchCondition(const CStdString &index, const CStdString &column, const CStdString &key,
+                                const CStdString &search, const CStdString &fallback);
+
+  /*! \brief The full-text search index of a media type
+   \param mediaType the type of the indexed items, eg. "movie"
+   \param index [out] the name of the index, eg. "moviesearch"
+   \param columns [out] the indexed columns
+   \param select [out] query of the docid and indexed columns of the items, which a WHERE clause on key restricts
+   \param key [out] the column identifying an item in select, eg. "idMovie"
+   \return false if the media type isn't indexed
+   */
+  bool GetSearchIndex(const std::string &mediaType, CStdString &index, CStdString &columns, CStdString &select, CStdString &key) const;
+
+  /*! \brief Refresh an item in the full-text search index after its tags changed.
+   Changes to the item itself refresh it through the triggers on its table.
+   \param idMedia the id of the item
+   \param mediaType the type of the item, eg. "movie"
+   */
+  void UpdateSearchIndex(int idMedia, const std::string &mediaType);
+
   /*! \brief Update routine for base path of videos
    Only required for videodb version < 59
    \param table the table to update
@@ -808,7 +868,7 @@ private:
    */
   bool LookupByFolders(const CStdString &path, bool shows = false);
 
-  virtual int GetMinVersion() const { return 67; };
+  virtual int GetMinVersion() const { return 73; };
   virtual int GetExportVersion() const { return 1; };
   const char *GetBaseDBName() const { return "MyVideos"; };
 
@@ -826,6 +886,22 @@ private:
    */
   CStdString GetSafeFile(const CStdString &dir, const CStdString &name) const;
 
+  /*! \brief Remove files, along with the movies, episodes and music videos they hold, in a transaction of their own.
+   \param fileIDs the files to remove.
+   \param movieIDs [out] the removed movies are appended, for announcing their removal.
+   \param episodeIDs [out] the removed episodes are appended.
+   \param musicVideoIDs [out] the removed music videos are appended.
+   \sa CleanDatabase
+   */
+  void CleanFiles(const std::vector<int> &fileIDs, std::vector<int> &movieIDs, std::vector<int> &episodeIDs, std::vector<int> &musicVideoIDs);
+
+  /*! \brief The path an interrupted full cleanup of this database resumes from, kept in the cleanstate table.
+   \return the id of the path, or 0 to clean everything.
+   \sa SetCleanResumePath, CleanDatabase
+   */
+  int GetCleanResumePath();
+  void SetCleanResumePath(int idPath);
+
   void AnnounceRemove(std::string content, int id);
   void AnnounceUpdate(std::string content, int id);
 };
@@ -23,6 +23,7 @@
 #include "FileItem.h"
 #include "VideoInfoScanner.h"
 #include "addons/AddonManager.h"
+#include "filesystem/ChangeJournal.h"
 #include "filesystem/DirectoryCache.h"
 #include "Util.h"
 #include "NfoFile.h"
@@ -42,6 +43,7 @@
 #include "utils/StringUtils.h"
 #include "guilib/LocalizeStrings.h"
 #include "utils/TimeUtils.h"
+#include "utils/JobManager.h"
 #include "utils/log.h"
 #include "utils/URIUtils.h"
 #include "utils/Variant.h"
@@ -53,8 +55,73 @@ using namespace std;
 using namespace XFILE;
 using namespace ADDON;
 
+/*! \brief number of lookups committed to the database in a single transaction */
+#define LOOKUP_BATCH_SIZE 50
+
 namespace VIDEO
 {
+  /*! \brief Looks up a movie or music video in the background for the scanner */
+  class CVideoLookupJob : public CJob
+  {
+  public:
+    CVideoLookupJob(CVideoInfoScanner *scanner, const CVideoInfoScanner::LookupPtr &lookup)
+      : m_scanner(scanner), m_lookup(lookup)
+    {
+    }
+
+    virtual const char *GetType() const { return "videolookup"; }
+
+    virtual bool DoWork()
+    {
+      m_scanner->Lookup(*m_lookup);
+      return true;
+    }
+
+    const CVideoInfoScanner::LookupPtr &GetLookup() const { return m_lookup; }
+
+  private:
+    CVideoInfoScanner *m_scanner;
+    CVideoInfoScanner::LookupPtr m_lookup;
+  };
+
+  /*! \brief Fetches a directory listing in the background for the scanner */
+  class CVideoListingJob : public CJob
+  {
+  public:
+    CVideoListingJob(CVideoInfoScanner *scanner, const CVideoInfoScanner::ListingPtr &listing)
+      : m_scanner(scanner), m_listing(listing)
+    {
+    }
+
+    virtual const char *GetType() const { return "videolisting"; }
+
+    virtual bool DoWork()
+    {
+      m_scanner->FetchListing(*m_listing);
+      return true;
+    }
+
+    const CVideoInfoScanner::ListingPtr &GetListing() const { return m_listing; }
+
+  private:
+    CVideoInfoScanner *m_scanner;
+    CVideoInfoScanner::ListingPtr m_listing;
+  };
+
+  /*! \brief What the scanner waits on from a job, kept apart as the job manager may delete the job without running it */
+  struct SJobResult
+  {
+    SJobResult(CJob *job)
+    {
+      if (strcmp(job->GetType(), "videolookup") == 0)
+        lookup = ((CVideoLookupJob *)job)->GetLookup();
+      else if (strcmp(job->GetType(), "videolisting") == 0)
+        listing = ((CVideoListingJob *)job)->GetListing();
+    }
+
+    CVideoInfoScanner::LookupPtr lookup;
+    CVideoInfoScanner::ListingPtr listing;
+  };
 
   CVideoInfoScanner::CVideoInfoScanner() : CThread("CVideoInfoScanner")
   {
@@ -64,7 +131,13 @@ namespace VIDEO
     m_currentItem = 0;
     m_itemCount = 0;
     m_bClean = false;
+    m_cleanOnly = false;
     m_scanAll = false;
+    m_jobsAtOnce = 0;
+    m_jobsRunning = 0;
+    m_lookupsPending = 0;
+    m_journalFullScan = false;
+    m_journalComplete = false;
   }
 
   CVideoInfoScanner::~CVideoInfoScanner()
@@ -79,6 +152,21 @@ namespace VIDEO
 
       m_database.Open();
 
+      if (m_cleanOnly)
+      {
+        CLog::Log(LOGNOTICE, "VideoInfoScanner: Starting cleanup ..");
+        m_database.CleanDatabase(m_pObserver, NULL, false, &m_bStop);
+        m_database.Close();
+
+        tick = XbmcThreads::SystemClockMillis() - tick;
+        CLog::Log(LOGNOTICE, "VideoInfoScanner: Finished cleanup. Cleaning the video library took %s", StringUtils::SecondsToTimeString(tick / 1000).c_str());
+
+        m_bRunning = false;
+        if (m_pObserver)
+          m_pObserver->OnFinished();
+        return;
+      }
+
       if (m_pObserver)
         m_pObserver->OnStateChanged(PREPARING);
 
@@ -92,6 +180,20 @@ namespace VIDEO
 
       SetPriority(GetMinPriority());
 
+      // movies and music videos are looked up by a pool of jobs and committed by this thread
+      m_jobsAtOnce = g_advancedSettings.m_videoScannerLookupThreads > 1 ? g_advancedSettings.m_videoScannerLookupThreads : 0;
+      {
+        // jobs cancelled by an earlier Stop() never reported back
+        CSingleLock lock(m_lookupSection);
+        m_lookupsPending = 0;
+        m_lookupsDone.clear();
+        m_listings.clear();
+      }
+
+      // unchanged folders are skipped using the change journal, unless a full check is due
+      m_journalFullScan = m_scanAll || CChangeJournal::Get().IsFullScanDue("video");
+      m_journal.clear();
+
       // Database operations should not be canceled
       // using Interupt() while scanning as it could
       // result in unexpected behaviour.
@@ -111,10 +213,19 @@ namespace VIDEO
           bCancelled = true;
       }
 
+      // wait for the outstanding jobs, which return quickly once cancelled
+      CommitLookups(0);
+      m_listings.clear();
+      m_jobsAtOnce = 0;
+
       if (!bCancelled)
       {
+        EndJournalScans();
+        if (m_journalFullScan && m_strStartDir.IsEmpty())
+          CChangeJournal::Get().SetFullScanDone("video");
+
         if (m_bClean)
-          CleanDatabase(m_pObserver,&m_pathsToClean);
+          m_database.CleanDatabase(m_pObserver, &m_pathsToClean, true, &m_bStop);
         else
         {
           if (m_pObserver)
@@ -123,6 +234,7 @@ namespace VIDEO
         }
       }
 
+      m_journal.clear();
       m_database.Close();
 
       tick = XbmcThreads::SystemClockMillis() - tick;
@@ -143,6 +255,7 @@ namespace VIDEO
   {
     m_strStartDir = strDirectory;
     m_scanAll = scanAll;
+    m_cleanOnly = false;
     m_pathsToScan.clear();
     m_pathsToClean.clear();
 
@@ -164,6 +277,19 @@ namespace VIDEO
     m_bRunning = true;
   }
 
+  void CVideoInfoScanner::StartCleanDatabase()
+  {
+    m_strStartDir.Empty();
+    m_scanAll = false;
+    m_cleanOnly = true;
+    m_pathsToScan.clear();
+    m_pathsToClean.clear();
+
+    StopThread();
+    Create();
+    m_bRunning = true;
+  }
+
   bool CVideoInfoScanner::IsScanning()
   {
     return m_bRunning;
@@ -174,6 +300,10 @@ namespace VIDEO
     if (m_bCanInterrupt)
       m_database.Interupt();
 
+    // the waits for jobs give up once stopping, and jobs that never run don't call back
+    m_bStop = true;
+    CancelJobs();
+
     StopThread();
   }
 
@@ -208,6 +338,9 @@ namespace VIDEO
     if (it != m_pathsToScan.end())
       m_pathsToScan.erase(it);
 
+    // folders that are not scanned have nothing to be watched for
+    m_journalComplete = true;
+
     // load subfolder
     CFileItemList items;
     bool foundDirectly = false;
@@ -229,23 +362,41 @@ namespace VIDEO
       return true;
 
     CStdString hash, dbHash;
+    unsigned int journalToken = 0;
     if (content == CONTENT_MOVIES ||content == CONTENT_MUSICVIDEOS)
     {
       if (m_pObserver)
         m_pObserver->OnStateChanged(content == CONTENT_MOVIES ? FETCHING_MOVIE_INFO : FETCHING_MUSICVIDEO_INFO);
 
-      CStdString fastHash = GetFastHash(strDirectory);
+      if (!m_journalFullScan && CChangeJournal::Get().IsUnchanged(strDirectory))
+      { // nothing in or below the folder has changed since it was last scanned
+        CLog::Log(LOGDEBUG, "VideoInfoScanner: Skipping dir '%s' due to no change (change journal)", strDirectory.c_str());
+        if (m_pObserver)
+          m_pObserver->OnDirectoryScanned(strDirectory);
+        return true;
+      }
+      journalToken = CChangeJournal::Get().BeginScan(strDirectory);
+
+      ListingPtr listing = TakeListing(strDirectory);
+      CStdString fastHash = listing ? listing->fastHash : GetFastHash(strDirectory);
       if (m_database.GetPathHash(strDirectory, dbHash) && !fastHash.IsEmpty() && fastHash == dbHash)
       { // fast hashes match - no need to process anything
         CLog::Log(LOGDEBUG, "VideoInfoScanner: Skipping dir '%s' due to no change (fasthash)", strDirectory.c_str());
         hash = fastHash;
         bSkip = true;
       }
+      if (!bSkip || journalToken)
+      { // need to fetch the folder, or at least its subfolders so they are watched too
+        if (listing && listing->listed)
+          items.Copy(listing->items);
+        else
+        {
+          CDirectory::GetDirectory(strDirectory, items, g_settings.m_videoExtensions);
+          items.Stack();
+        }
+      }
       if (!bSkip)
-      { // need to fetch the folder
-        CDirectory::GetDirectory(strDirectory, items, g_settings.m_videoExtensions);
-        items.Stack();
-        // compute hash
+      { // compute hash
         GetPathHash(items, hash);
         if (hash != dbHash && !hash.IsEmpty())
         {
@@ -301,7 +452,17 @@ namespace VIDEO
       }
     }
 
-    if (!bSkip)
+    if (!bSkip && m_jobsAtOnce && (content == CONTENT_MOVIES || content == CONTENT_MUSICVIDEOS))
+    { // the hash is stored once all the lookups have been committed
+      PendingDirectoryPtr directory(new SPendingDirectory);
+      directory->path = strDirectory;
+      directory->hash = hash;
+      directory->outstanding = 0;
+      directory->foundInfo = false;
+      directory->failed = false;
+      QueueLookups(items, settings.parent_name_root, content, directory);
+    }
+    else if (!bSkip)
     {
       if (RetrieveVideoInfo(items, settings.parent_name_root, content))
       {
@@ -326,6 +487,10 @@ namespace VIDEO
     if (m_pObserver)
       m_pObserver->OnDirectoryScanned(strDirectory);
 
+    if (m_jobsAtOnce && settings.recurse > 0 && (content == CONTENT_MOVIES || content == CONTENT_MUSICVIDEOS))
+      PrefetchListings(items);
+
+    bool journalComplete = journalToken && !hash.IsEmpty();
     for (int i = 0; i < items.Size(); ++i)
     {
       CFileItemPtr pItem = items[i];
@@ -341,8 +506,19 @@ namespace VIDEO
         {
           m_bStop = true;
         }
+        journalComplete &= m_journalComplete;
       }
     }
+
+    if (journalComplete && !m_bStop)
+    {
+      SJournalEntry entry;
+      entry.path = strDirectory;
+      entry.hash = hash;
+      entry.token = journalToken;
+      m_journal.push_back(entry);
+    }
+    m_journalComplete = journalComplete;
     return !m_bStop;
   }
 
@@ -440,6 +616,372 @@ namespace VIDEO
     return FoundSomeInfo;
   }
 
+  void CVideoInfoScanner::QueueLookups(CFileItemList &items, bool bDirNames, CONTENT_TYPE content, const PendingDirectoryPtr &directory)
+  {
+    // hold the directory open until all its items have been queued
+    directory->outstanding = 1;
+
+    CFileItemList others;
+    for (int i = 0; i < items.Size() && !m_bStop; ++i)
+    {
+      CFileItemPtr pItem = items[i];
+
+      // we do this since we may have a override per dir
+      ScraperPtr info2 = m_database.GetScraperForPath(pItem->m_bIsFolder ? pItem->GetPath() : items.GetPath());
+      if (!info2) // skip
+        continue;
+
+      // Discard all exclude files defined by regExExclude
+      if (CUtil::ExcludeFileOrFolder(pItem->GetPath(), g_advancedSettings.m_moviesExcludeFromScanRegExps))
+        continue;
+
+      if (info2->Content() != CONTENT_MOVIES && info2->Content() != CONTENT_MUSICVIDEOS)
+      { // eg a tvshow folder, which is retrieved in this thread as usual
+        others.Add(pItem);
+        continue;
+      }
+
+      if (m_pObserver)
+      {
+        m_pObserver->OnSetCurrentProgress(i, items.Size());
+        if (!pItem->m_bIsFolder && m_itemCount)
+          m_pObserver->OnSetProgress(m_currentItem++, m_itemCount);
+      }
+
+      if (pItem->m_bIsFolder || !pItem->IsVideo() || pItem->IsNFO() ||
+         (pItem->IsPlayList() && !URIUtils::GetExtension(pItem->GetPath()).Equals(".strm")))
+        continue;
+
+      if (info2->Content() == CONTENT_MOVIES ? m_database.HasMovieInfo(pItem->GetPath())
+                                             : m_database.HasMusicVideoInfo(pItem->GetPath()))
+      {
+        directory->foundInfo = true;
+        continue;
+      }
+
+      LookupPtr lookup(new SLookup);
+      lookup->item.reset(new CFileItem(*pItem));
+      lookup->scraper = info2;
+      lookup->bDirNames = bDirNames;
+      lookup->result = INFO_CANCELLED;
+      lookup->directory = directory;
+      directory->outstanding++;
+      {
+        CSingleLock lock(m_lookupSection);
+        m_lookupsPending++;
+      }
+      AddJob(new CVideoLookupJob(this, lookup), false);
+
+      // don't get too far ahead of the database
+      CommitLookups(m_jobsAtOnce * 4);
+    }
+
+    if (!others.IsEmpty())
+    {
+      others.SetPath(items.GetPath());
+      if (RetrieveVideoInfo(others, bDirNames, content))
+        directory->foundInfo = true;
+    }
+
+    if (m_bStop)
+      directory->failed = true;
+    if (--directory->outstanding == 0)
+      FinishDirectory(*directory);
+  }
+
+  void CVideoInfoScanner::Lookup(SLookup &lookup)
+  {
+    lookup.result = INFO_CANCELLED;
+    if (m_bStop)
+      return;
+
+    CFileItem *pItem = lookup.item.get();
+
+    // clear our scraper cache
+    lookup.scraper->ClearCache();
+
+    CNfoFile nfoReader;
+    CScraperUrl scrUrl;
+    // handle .nfo files
+    CNfoFile::NFOResult result = CheckForNFOFile(pItem, lookup.bDirNames, lookup.scraper, scrUrl, nfoReader);
+    if (result == CNfoFile::FULL_NFO)
+    {
+      pItem->GetVideoInfoTag()->Reset();
+      nfoReader.GetDetails(*pItem->GetVideoInfoTag());
+      GetArtwork(pItem, lookup.scraper->Content(), lookup.bDirNames, true);
+      lookup.result = INFO_ADDED;
+      return;
+    }
+
+    CScraperUrl url;
+    if (result == CNfoFile::URL_NFO || result == CNfoFile::COMBINED_NFO)
+      url = scrUrl;
+    else
+    {
+      int retVal = FindVideo(pItem->GetMovieName(lookup.bDirNames), lookup.scraper, url, NULL);
+      if (retVal <= 0)
+      {
+        lookup.result = retVal < 0 ? INFO_CANCELLED : INFO_NOT_FOUND;
+        return;
+      }
+    }
+
+    if (GetDetails(pItem, url, lookup.scraper, result == CNfoFile::COMBINED_NFO ? &nfoReader : NULL))
+    {
+      GetArtwork(pItem, lookup.scraper->Content(), lookup.bDirNames, true);
+      lookup.result = INFO_ADDED;
+    }
+    else
+      lookup.result = INFO_NOT_FOUND;
+  }
+
+  void CVideoInfoScanner::CommitLookups(unsigned int maxPending)
+  {
+    while (true)
+    {
+      vector<LookupPtr> done;
+      {
+        CSingleLock lock(m_lookupSection);
+        bool wait = maxPending ? m_lookupsPending > maxPending
+                               : m_lookupsPending > 0 || m_jobsRunning > 0;
+        if (!wait && m_lookupsDone.size() < LOOKUP_BATCH_SIZE)
+          return;
+        if (m_lookupsDone.size() > LOOKUP_BATCH_SIZE)
+        {
+          done.assign(m_lookupsDone.begin(), m_lookupsDone.begin() + LOOKUP_BATCH_SIZE);
+          m_lookupsDone.erase(m_lookupsDone.begin(), m_lookupsDone.begin() + LOOKUP_BATCH_SIZE);
+        }
+        else
+          done.swap(m_lookupsDone);
+      }
+
+      if (done.empty())
+      {
+        // cancelled jobs never report back
+        if (m_bStop)
+          return;
+        m_lookupEvent.WaitMSec(100);
+        continue;
+      }
+
+      vector<CFileItemPtr> added;
+      bool batched = m_database.BeginBatch();
+      for (vector<LookupPtr>::iterator i = done.begin(); i != done.end(); ++i)
+      {
+        SLookup &lookup = **i;
+        if (lookup.result == INFO_ADDED)
+        {
+          if (CommitVideo(lookup.item.get(), lookup.scraper->Content(), lookup.bDirNames) < 0)
+            lookup.result = INFO_ERROR;
+          else
+            added.push_back(lookup.item);
+
+          if (batched && !m_database.InBatch())
+          {
+            // the whole batch was rolled back, so nothing added to it so far is in the library, and
+            // the directories finished in it have no hash stored and will be scanned again
+            CLog::Log(LOGERROR, "VideoInfoScanner: Lost the batch while adding %s", lookup.item->GetPath().c_str());
+            added.clear();
+            lookup.result = INFO_ERROR;
+            m_database.BeginBatch();
+          }
+        }
+
+        SPendingDirectory &directory = *lookup.directory;
+        if (lookup.result == INFO_CANCELLED || lookup.result == INFO_ERROR)
+          directory.failed = true;
+        else if (lookup.result == INFO_ADDED || lookup.result == INFO_HAVE_ALREADY)
+          directory.foundInfo = true;
+        if (--directory.outstanding == 0)
+          FinishDirectory(directory);
+      }
+      if (batched && !m_database.CommitBatch())
+      {
+        // the path hashes were stored in the batch as well, so these directories will be scanned again
+        CLog::Log(LOGERROR, "VideoInfoScanner: Failed to commit %u items", (unsigned int)done.size());
+        added.clear();
+      }
+      g_infoManager.ResetLibraryBools();
+
+      for (vector<CFileItemPtr>::iterator i = added.begin(); i != added.end(); ++i)
+        ANNOUNCEMENT::CAnnouncementManager::Announce(ANNOUNCEMENT::VideoLibrary, "xbmc", "OnUpdate", CFileItemPtr(new CFileItem(**i)));
+
+      CSingleLock lock(m_lookupSection);
+      m_lookupsPending -= done.size();
+    }
+  }
+
+  void CVideoInfoScanner::FinishDirectory(const SPendingDirectory &directory)
+  {
+    if (directory.foundInfo && !directory.failed)
+    {
+      if (!m_bStop)
+      {
+        m_database.SetPathHash(directory.path, directory.hash);
+        m_pathsToClean.insert(m_database.GetPathId(directory.path));
+        CLog::Log(LOGDEBUG, "VideoInfoScanner: Finished adding information from dir %s", directory.path.c_str());
+      }
+    }
+    else
+    {
+      m_pathsToClean.insert(m_database.GetPathId(directory.path));
+      CLog::Log(LOGDEBUG, "VideoInfoScanner: No (new) information was found in dir %s", directory.path.c_str());
+    }
+  }
+
+  void CVideoInfoScanner::PrefetchListings(const CFileItemList &items)
+  {
+    for (int i = 0; i < items.Size(); ++i)
+    {
+      CFileItemPtr pItem = items[i];
+      if (!pItem->m_bIsFolder || pItem->IsParentFolder() || pItem->IsPlayList() ||
+          CUtil::ExcludeFileOrFolder(pItem->GetPath(), g_advancedSettings.m_moviesExcludeFromScanRegExps))
+        continue;
+
+      // DoScan() skips it without a listing
+      if (!m_journalFullScan && CChangeJournal::Get().IsUnchanged(pItem->GetPath()))
+        continue;
+
+      ListingPtr listing(new SListing);
+      listing->path = pItem->GetPath();
+      m_database.GetPathHash(listing->path, listing->dbHash);
+      listing->listed = false;
+      listing->done = false;
+      {
+        CSingleLock lock(m_lookupSection);
+        m_listings[listing->path] = listing;
+      }
+      AddJob(new CVideoListingJob(this, listing), true);
+    }
+  }
+
+  CVideoInfoScanner::ListingPtr CVideoInfoScanner::TakeListing(const CStdString &strDirectory)
+  {
+    CSingleLock lock(m_lookupSection);
+    map<CStdString, ListingPtr>::iterator i = m_listings.find(strDirectory);
+    if (i == m_listings.end())
+      return ListingPtr();
+
+    ListingPtr listing = i->second;
+    m_listings.erase(i);
+    while (!listing->done)
+    {
+      // the job may still be filling it in, or may never run
+      if (m_bStop)
+        return ListingPtr();
+      lock.Leave();
+      m_lookupEvent.WaitMSec(100);
+      lock.Enter();
+    }
+    return listing;
+  }
+
+  void CVideoInfoScanner::FetchListing(SListing &listing)
+  {
+    if (m_bStop)
+      return;
+
+    // the subfolders of a folder the change journal watches are needed even if it is unchanged
+    listing.fastHash = GetFastHash(listing.path);
+    if (!listing.fastHash.IsEmpty() && listing.fastHash == listing.dbHash && !CChangeJournal::Get().CanWatch(listing.path))
+      return;
+
+    CDirectory::GetDirectory(listing.path, listing.items, g_settings.m_videoExtensions);
+    listing.items.Stack();
+    listing.listed = true;
+  }
+
+  void CVideoInfoScanner::EndJournalScans()
+  {
+    // folders whose hash didn't make it to the database are scanned again next time, as are the folders above them
+    set<CStdString> incomplete;
+    for (vector<SJournalEntry>::const_iterator i = m_journal.begin(); i != m_journal.end(); ++i)
+    {
+      CStdString dbHash;
+      if (!m_database.GetPathHash(i->path, dbHash) || dbHash != i->hash)
+        incomplete.insert(i->path);
+    }
+
+    for (vector<SJournalEntry>::const_iterator i = m_journal.begin(); i != m_journal.end(); ++i)
+    {
+      set<CStdString>::const_iterator below = incomplete.lower_bound(i->path);
+      if (below == incomplete.end() || !URIUtils::IsInPath(*below, i->path))
+        CChangeJournal::Get().EndScan(i->path, i->token);
+    }
+  }
+
+  void CVideoInfoScanner::AddJob(CJob *job, bool urgent)
+  {
+    CSingleLock lock(m_lookupSection);
+    if (m_jobsRunning < m_jobsAtOnce)
+      RunJob(job);
+    else if (urgent)
+      m_jobsQueued.push_front(job);
+    else
+      m_jobsQueued.push_back(job);
+  }
+
+  bool CVideoInfoScanner::RunJob(CJob *job)
+  {
+    CSingleLock lock(m_lookupSection);
+    SJobResult result(job);
+    unsigned int jobID = CJobManager::GetInstance().AddJob(job, this, CJob::PRIORITY_NORMAL);
+    if (!jobID)
+    { // the job manager is shutting down and has deleted the job
+      FinishJob(result.lookup, result.listing);
+      return false;
+    }
+    m_jobsRunning++;
+    m_jobIDs.insert(jobID);
+    return true;
+  }
+
+  void CVideoInfoScanner::FinishJob(const LookupPtr &lookup, const ListingPtr &listing)
+  {
+    CSingleLock lock(m_lookupSection);
+    if (lookup)
+      m_lookupsDone.push_back(lookup); // still INFO_CANCELLED if it never ran
+    if (listing)
+      listing->done = true;
+    m_lookupEvent.Set();
+  }
+
+  void CVideoInfoScanner::CancelJobs()
+  {
+    CSingleLock lock(m_lookupSection);
+    for (set<unsigned int>::const_iterator i = m_jobIDs.begin(); i != m_jobIDs.end(); ++i)
+      CJobManager::GetInstance().CancelJob(*i);
+    m_jobIDs.clear();
+    m_jobsRunning = 0;
+
+    for (deque<CJob*>::iterator i = m_jobsQueued.begin(); i != m_jobsQueued.end(); ++i)
+    {
+      SJobResult result(*i);
+      delete *i;
+      FinishJob(result.lookup, result.listing);
+    }
+    m_jobsQueued.clear();
+    m_lookupEvent.Set();
+  }
+
+  void CVideoInfoScanner::OnJobComplete(unsigned int jobID, bool success, CJob *job)
+  {
+    CSingleLock lock(m_lookupSection);
+    if (m_jobIDs.erase(jobID) == 0)
+      return; // cancelled, and no longer counted
+
+    SJobResult result(job);
+    FinishJob(result.lookup, result.listing);
+
+    m_jobsRunning--;
+    while (!m_jobsQueued.empty() && m_jobsRunning < m_jobsAtOnce)
+    {
+      CJob *next = m_jobsQueued.front();
+      m_jobsQueued.pop_front();
+      RunJob(next);
+    }
+  }
+
   INFO_RET CVideoInfoScanner::RetrieveInfoForTvShow(CFileItemPtr pItem, bool bDirNames, ScraperPtr &info2, bool useLocal, CScraperUrl* pURL, bool fetchEpisodes, CGUIDialogProgress* pDlgProgress)
   {
     long idTvShow = -1;
@@ -1018,6 +1560,21 @@ namespace VIDEO
       return -1;
 
     GetArtwork(pItem, content, videoFolder, useLocal);
+    long lResult = CommitVideo(pItem, content, videoFolder, idShow, libraryImport);
+
+    m_database.Close();
+
+    CFileItemPtr itemCopy = CFileItemPtr(new CFileItem(*pItem));
+    // Hack to make sure CVideoInfoTag::m_strShowTitle is set for tvshows
+    // to make sure CAnnouncementManager provides the correct type for the item
+    if (content == CONTENT_TVSHOWS && !pItem->m_bIsFolder && itemCopy->HasVideoInfoTag())
+      itemCopy->GetVideoInfoTag()->m_strShowTitle = itemCopy->GetVideoInfoTag()->m_strTitle;
+    ANNOUNCEMENT::CAnnouncementManager::Announce(ANNOUNCEMENT::VideoLibrary, "xbmc", "OnUpdate", itemCopy);
+    return lResult;
+  }
+
+  long CVideoInfoScanner::CommitVideo(CFileItem *pItem, const CONTENT_TYPE &content, bool videoFolder /* = false */, int idShow /* = -1 */, bool libraryImport /* = false */)
+  {
     // ensure the art map isn't completely empty by specifying an empty thumb
     map<string, string> art = pItem->GetArt();
     if (art.empty())
@@ -1109,14 +1666,6 @@ namespace VIDEO
         movieDetails.m_resumePoint.IsSet())
       m_database.AddBookMarkToFile(pItem->GetPath(), movieDetails.m_resumePoint, CBookmark::RESUME);
 
-    m_database.Close();
-
-    CFileItemPtr itemCopy = CFileItemPtr(new CFileItem(*pItem));
-    // Hack to make sure CVideoInfoTag::m_strShowTitle is set for tvshows
-    // to make sure CAnnouncementManager provides the correct type for the item
-    if (content == CONTENT_TVSHOWS && !pItem->m_bIsFolder && itemCopy->HasVideoInfoTag())
-      itemCopy->GetVideoInfoTag()->m_strShowTitle = itemCopy->GetVideoInfoTag()->m_strTitle;
-    ANNOUNCEMENT::CAnnouncementManager::Announce(ANNOUNCEMENT::VideoLibrary, "xbmc", "OnUpdate", itemCopy);
     return lResult;
   }
 
@@ -1624,6 +2173,11 @@ namespace VIDEO
   }
 
   CNfoFile::NFOResult CVideoInfoScanner::CheckForNFOFile(CFileItem* pItem, bool bGrabAny, ScraperPtr& info, CScraperUrl& scrUrl)
+  {
+    return CheckForNFOFile(pItem, bGrabAny, info, scrUrl, m_nfoReader);
+  }
+
+  CNfoFile::NFOResult CVideoInfoScanner::CheckForNFOFile(CFileItem* pItem, bool bGrabAny, ScraperPtr& info, CScraperUrl& scrUrl, CNfoFile& nfoReader)
   {
     CStdString strNfoFile;
     if (info->Content() == CONTENT_MOVIES || info->Content() == CONTENT_MUSICVIDEOS
@@ -1635,7 +2189,7 @@ namespace VIDEO
     CNfoFile::NFOResult result=CNfoFile::NO_NFO;
     if (!strNfoFile.IsEmpty() && CFile::Exists(strNfoFile))
     {
-      result = m_nfoReader.Create(strNfoFile,info,pItem->GetVideoInfoTag()->m_iEpisode);
+      result = nfoReader.Create(strNfoFile,info,pItem->GetVideoInfoTag()->m_iEpisode);
 
       CStdString type;
       switch(result)
@@ -1660,18 +2214,18 @@ namespace VIDEO
       if (result == CNfoFile::FULL_NFO)
       {
         if (info->Content() == CONTENT_TVSHOWS)
-          info = m_nfoReader.GetScraperInfo();
+          info = nfoReader.GetScraperInfo();
       }
       else if (result != CNfoFile::NO_NFO && result != CNfoFile::ERROR_NFO)
       {
-        scrUrl = m_nfoReader.ScraperUrl();
-        info = m_nfoReader.GetScraperInfo();
+        scrUrl = nfoReader.ScraperUrl();
+        info = nfoReader.GetScraperInfo();
 
         CLog::Log(LOGDEBUG, "VideoInfoScanner: Fetching url '%s' using %s scraper (content: '%s')",
           scrUrl.m_url[0].m_url.c_str(), info->Name().c_str(), TranslateContent(info->Content()).c_str());
 
         if (result == CNfoFile::COMBINED_NFO)
-          m_nfoReader.GetDetails(*pItem->GetVideoInfoTag());
+          nfoReader.GetDetails(*pItem->GetVideoInfoTag());
       }
     }
     else
@@ -1711,7 +2265,13 @@ namespace VIDEO
     MOVIELIST movielist;
     CVideoInfoDownloader imdb(scraper);
     int returncode = imdb.FindMovie(videoName, movielist, progress);
-    if (returncode < 0 || (returncode == 0 && !DownloadFailed(progress)))
+    if (returncode == 0)
+    { // lookups may run in parallel, so make sure the user is only asked once
+      CSingleLock lock(m_promptSection);
+      if ((!progress && m_bStop) || !DownloadFailed(progress))
+        returncode = -1;
+    }
+    if (returncode < 0)
     { // scraper reported an error, or we had an error and user wants to cancel the scan
       m_bStop = true;
       return -1; // cancelled
@@ -20,11 +20,17 @@
  *
  */
 #include "threads/Thread.h"
+#include "threads/CriticalSection.h"
+#include "threads/Event.h"
+#include "utils/Job.h"
 #include "VideoDatabase.h"
 #include "addons/Scraper.h"
 #include "NfoFile.h"
 #include "XBDateTime.h"
 
+#include <deque>
+#include <boost/shared_ptr.hpp>
+
 class CRegExp;
 
 namespace VIDEO
@@ -75,8 +81,16 @@ namespace VIDEO
                   INFO_NOT_FOUND,
                   INFO_ADDED };
 
-  class CVideoInfoScanner : CThread
+  class CVideoLookupJob;
+  class CVideoListingJob;
+  struct SJobResult;
+
+  class CVideoInfoScanner : CThread, IJobCallback
   {
+    friend class CVideoLookupJob;
+    friend class CVideoListingJob;
+    friend struct SJobResult;
+
   public:
     CVideoInfoScanner();
     virtual ~CVideoInfoScanner();
@@ -88,6 +102,11 @@ namespace VIDEO
     void Start(const CStdString& strDirectory, bool scanAll = false);
     bool IsScanning();
     void CleanDatabase(IVideoInfoScannerObserver* pObserver=NULL, const std::set<int>* paths=NULL);
+
+    /*! \brief Clean the whole library on the background thread, reporting to the observer (if any) rather than a modal dialog
+     \sa CleanDatabase
+     */
+    void StartCleanDatabase();
     void Stop();
     void SetObserver(IVideoInfoScannerObserver* pObserver);
 
@@ -102,6 +121,12 @@ namespace VIDEO
      */
     long AddVideo(CFileItem *pItem, const CONTENT_TYPE &content, bool videoFolder = false, bool useLocal = true, int idShow = -1, bool libraryImport = false);
 
+    /*! \brief Add an item to the database for which artwork has already been retrieved.
+     Does not open, close or commit the database, nor announce the update.
+     \sa AddVideo
+     */
+    long CommitVideo(CFileItem *pItem, const CONTENT_TYPE &content, bool videoFolder = false, int idShow = -1, bool libraryImport = false);
+
     /*! \brief Retrieve information for a list of items and add them to the database.
      \param items list of items to retrieve info for.
      \param bDirNames whether we should use folder or file names for lookups.
@@ -117,6 +142,7 @@ namespace VIDEO
     static void ApplyThumbToFolder(const CStdString &folder, const CStdString &imdbThumb);
     static bool DownloadFailed(CGUIDialogProgress* pDlgProgress);
     CNfoFile::NFOResult CheckForNFOFile(CFileItem* pItem, bool bGrabAny, ADDON::ScraperPtr& scraper, CScraperUrl& scrUrl);
+    CNfoFile::NFOResult CheckForNFOFile(CFileItem* pItem, bool bGrabAny, ADDON::ScraperPtr& scraper, CScraperUrl& scrUrl, CNfoFile& nfoReader);
 
     /*! \brief Retrieve any artwork associated with an item
      \param pItem item to find artwork for.
@@ -135,9 +161,123 @@ namespace VIDEO
     static void GetSeasonThumbs(const CVideoInfoTag &show, std::map<int, std::string> &art, bool useLocal = true);
 
   protected:
+    /*! \brief A folder of movies or music videos whose items are being looked up in the background.
+     Once all of them have been committed the folder hash is stored, as RetrieveVideoInfo() would have done.
+     */
+    struct SPendingDirectory
+    {
+      CStdString path;
+      CStdString hash;
+      unsigned int outstanding; ///< number of lookups not yet committed
+      bool foundInfo;           ///< whether information was found (or already present) for some items
+      bool failed;              ///< whether a lookup errored or was cancelled
+    };
+    typedef boost::shared_ptr<SPendingDirectory> PendingDirectoryPtr;
+
+    /*! \brief The background lookup of a single movie or music video.
+     Filled in by a CVideoLookupJob and committed to the database by the scanner thread.
+     */
+    struct SLookup
+    {
+      CFileItemPtr item;
+      ADDON::ScraperPtr scraper;
+      bool bDirNames;
+      INFO_RET result;
+      PendingDirectoryPtr directory;
+    };
+    typedef boost::shared_ptr<SLookup> LookupPtr;
+
+    /*! \brief A directory listing fetched ahead of the scanner thread reaching the directory.
+     The listing is skipped if the fast hash of the directory still matches the database.
+     */
+    struct SListing
+    {
+      CStdString path;
+      CStdString dbHash;
+      CStdString fastHash;
+      CFileItemList items;
+      bool listed;
+      bool done;
+    };
+    typedef boost::shared_ptr<SListing> ListingPtr;
+
+    /*! \brief A folder scanned while being watched by the change journal.
+     The folder is marked as scanned in the journal once the scan has finished, provided the hash was stored.
+     */
+    struct SJournalEntry
+    {
+      CStdString path;
+      CStdString hash;
+      unsigned int token; ///< returned by CChangeJournal::BeginScan()
+    };
+
     virtual void Process();
     bool DoScan(const CStdString& strDirectory);
 
+    /*! \brief Mark the folders that were completely scanned as such in the change journal.
+     A folder is only marked if its hash, and that of every folder below it, made it to the database.
+     */
+    void EndJournalScans();
+
+    /*! \brief Queue background lookups for the items of a movie or music video folder.
+     Lookups run on a bounded pool of jobs. The results are committed by the scanner thread in CommitLookups().
+     \param items the folder listing.
+     \param bDirNames whether we should use folder or file names for lookups.
+     \param content type of content in the folder.
+     \param directory the folder, which is finished once all its items are committed.
+     */
+    void QueueLookups(CFileItemList &items, bool bDirNames, CONTENT_TYPE content, const PendingDirectoryPtr &directory);
+
+    /*! \brief Lookup a single movie or music video, fetching its details and artwork but not touching the database.
+     Runs on a job thread.
+     \param lookup the lookup to perform, its result is set on return.
+     */
+    void Lookup(SLookup &lookup);
+
+    /*! \brief Commit finished lookups to the database in batched transactions.
+     \param maxPending wait until no more than this many lookups are outstanding. 0 waits for all of them.
+     */
+    void CommitLookups(unsigned int maxPending);
+
+    /*! \brief Store the hash of a folder whose items have all been processed and mark it for cleaning.
+     */
+    void FinishDirectory(const SPendingDirectory &directory);
+
+    /*! \brief Fetch the listings of the given subfolders in the background.
+     */
+    void PrefetchListings(const CFileItemList &items);
+
+    /*! \brief Retrieve the listing of a folder fetched by PrefetchListings(), waiting for it if needed.
+     \return the listing or an empty pointer if the folder was not prefetched.
+     */
+    ListingPtr TakeListing(const CStdString &strDirectory);
+
+    /*! \brief Fetch a folder listing unless the fast hash matches. Runs on a job thread.
+     */
+    void FetchListing(SListing &listing);
+
+    /*! \brief Run a lookup or listing job, or queue it if the pool is busy.
+     \param job the job to run.
+     \param urgent whether the job should run ahead of those already queued.
+     */
+    void AddJob(CJob *job, bool urgent);
+
+    /*! \brief Hand a job to the job manager, or finish it as cancelled if the job manager won't take it.
+     \return true if the job was queued with the job manager.
+     */
+    bool RunJob(CJob *job);
+
+    /*! \brief Make the result of a job, run or not, available to the scanner thread.
+     */
+    void FinishJob(const LookupPtr &lookup, const ListingPtr &listing);
+
+    /*! \brief Cancel the jobs handed to the job manager and drop those waiting for a slot.
+     */
+    void CancelJobs();
+
+    // IJobCallback
+    virtual void OnJobComplete(unsigned int jobID, bool success, CJob *job);
+
     INFO_RET RetrieveInfoForTvShow(CFileItemPtr pItem, bool bDirNames, ADDON::ScraperPtr &scraper, bool useLocal, CScraperUrl* pURL, bool fetchEpisodes, CGUIDialogProgress* pDlgProgress);
     INFO_RET RetrieveInfoForMovie(CFileItemPtr pItem, bool bDirNames, ADDON::ScraperPtr &scraper, bool useLocal, CScraperUrl* pURL, CGUIDialogProgress* pDlgProgress);
     INFO_RET RetrieveInfoForMusicVideo(CFileItemPtr pItem, bool bDirNames, ADDON::ScraperPtr &scraper, bool useLocal, CScraperUrl* pURL, CGUIDialogProgress* pDlgProgress);
@@ -245,6 +385,7 @@ namespace VIDEO
     bool m_bRunning;
     bool m_bCanInterrupt;
     bool m_bClean;
+    bool m_cleanOnly;
     bool m_scanAll;
     CStdString m_strStartDir;
     CVideoDatabase m_database;
@@ -252,6 +393,21 @@ namespace VIDEO
     std::set<CStdString> m_pathsToCount;
     std::set<int> m_pathsToClean;
     CNfoFile m_nfoReader;
+
+    unsigned int m_jobsAtOnce;         ///< size of the lookup pool, 0 when scanning serially
+    CCriticalSection m_lookupSection;  ///< guards the members below, which are shared with the jobs
+    CCriticalSection m_promptSection;  ///< serializes the prompt shown when a lookup fails
+    CEvent m_lookupEvent;              ///< set whenever a job finishes
+    std::deque<CJob*> m_jobsQueued;    ///< jobs waiting for a free slot in the pool
+    unsigned int m_jobsRunning;        ///< jobs handed to the job manager that have not yet finished
+    std::set<unsigned int> m_jobIDs;   ///< ids of those jobs, to cancel them when stopping
+    unsigned int m_lookupsPending;     ///< lookups that have not yet been committed
+    std::vector<LookupPtr> m_lookupsDone;
+    std::map<CStdString, ListingPtr> m_listings;
+
+    bool m_journalFullScan;                ///< whether the change journal may not be used to skip folders
+    bool m_journalComplete;                ///< whether the last folder passed to DoScan() was completely scanned and watched
+    std::vector<SJournalEntry> m_journal;  ///< folders completely scanned and watched, deepest first
   };
 }
 